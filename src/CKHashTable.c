@@ -5,187 +5,212 @@
 #include <string.h>
 #include <stdlib.h>
 
-int ck_str_n_hash_insert(const char *key, size_t keylen, const void *value, ck_hash_table_t *table);
-const void *ck_str_n_hash_lookup(const char *key, size_t keylen, ck_hash_table_t *table);
-static inline void ck_float2str(float key, char keystr[6]);
-static inline void ck_double2str(double key, char keystr[11]);
+#include "readstat.h"
+#include "readstat_malloc.h"
 
-inline uint64_t ck_hash_str(const char *str)
-{
-	uint64_t hash = 5381;
-	int c;
-	
-	while ((c = *str++))
-		hash = ((hash << 5) + hash) + c;
-	
-	return hash;
-}
-
-static inline void ck_float2str(float key, char keystr[6]) {
-    memcpy(keystr, &key, 4);
-    keystr[4] = (0xF0 | (keystr[0] & 0x01) | (keystr[1] & 0x02) | (keystr[2] & 0x04) | (keystr[3] & 0x08));
-    keystr[0] |= 0x01;
-    keystr[1] |= 0x02;
-    keystr[2] |= 0x04;
-    keystr[3] |= 0x08;
-    
-    keystr[5] = 0x00;
-}
-
-static inline void ck_double2str(double key, char keystr[11]) {
-    memcpy(keystr, &key, 8);
-    keystr[8] = (0xF0 | (keystr[0] & 0x01) | (keystr[1] & 0x02) | (keystr[2] & 0x04) | (keystr[3] & 0x08));
-    keystr[0] |= 0x01;
-    keystr[1] |= 0x02;
-    keystr[2] |= 0x04;
-    keystr[3] |= 0x08;
-    
-    keystr[9] = (0xF0 | (keystr[4] & 0x01) | (keystr[5] & 0x02) | (keystr[6] & 0x04) | (keystr[7] & 0x08));
-    keystr[4] |= 0x01;
-    keystr[5] |= 0x02;
-    keystr[6] |= 0x04;
-    keystr[7] |= 0x08;
-    
-    keystr[10] = 0x00;
-}
-
-const void *ck_float_hash_lookup(float key, ck_hash_table_t *table)
-{
-    char keystr[6];
-    ck_float2str(key, keystr);
-    return ck_str_n_hash_lookup(keystr, 5, table);
+#define CK_HASH_MIN_CAPACITY    16
+#define CK_HASH_KEYS_MIN_LEN    1024
+
+#define CK_HASH_K1 0x9E3779B97F4A7C15ULL
+#define CK_HASH_K2 0xC2B2AE3D27D4EB4FULL
+
+static inline uint64_t ck_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Eight bytes at a time, finished with MurmurHash3's 64-bit avalanche
+uint64_t ck_hash_bytes(const void *key, size_t keylen) {
+    const unsigned char *bytes = (const unsigned char *)key;
+    uint64_t hash = keylen * CK_HASH_K1;
+    uint64_t word = 0;
+
+    while (keylen >= 8) {
+        memcpy(&word, bytes, 8);
+        hash = ck_rotl(hash ^ (word * CK_HASH_K2), 31) * CK_HASH_K1;
+        bytes += 8;
+        keylen -= 8;
+    }
+    if (keylen) {
+        word = 0;
+        memcpy(&word, bytes, keylen);
+        hash = ck_rotl(hash ^ (word * CK_HASH_K2), 31) * CK_HASH_K1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t ck_hash_str(const char *str) {
+    return ck_hash_bytes(str, strlen(str));
+}
+
+// Floats and doubles are keyed by their bits
+const void *ck_float_hash_lookup(float key, ck_hash_table_t *table) {
+    char keystr[sizeof(float)];
+    memcpy(keystr, &key, sizeof(float));
+    return ck_str_n_hash_lookup(keystr, sizeof(float), table);
 }
 
 int ck_float_hash_insert(float key, const void *value, ck_hash_table_t *table) {
-    char keystr[6];
-    ck_float2str(key, keystr);
-    return ck_str_n_hash_insert(keystr, 5, value, table);
+    char keystr[sizeof(float)];
+    memcpy(keystr, &key, sizeof(float));
+    return ck_str_n_hash_insert(keystr, sizeof(float), value, table);
 }
 
-const void *ck_double_hash_lookup(double key, ck_hash_table_t *table)
-{
-    char keystr[11];
-    ck_double2str(key, keystr);
-    return ck_str_n_hash_lookup(keystr, 10, table);
+const void *ck_double_hash_lookup(double key, ck_hash_table_t *table) {
+    char keystr[sizeof(double)];
+    memcpy(keystr, &key, sizeof(double));
+    return ck_str_n_hash_lookup(keystr, sizeof(double), table);
 }
 
 int ck_double_hash_insert(double key, const void *value, ck_hash_table_t *table) {
-    char keystr[11];
-    ck_double2str(key, keystr);
-    return ck_str_n_hash_insert(keystr, 10, value, table);
+    char keystr[sizeof(double)];
+    memcpy(keystr, &key, sizeof(double));
+    return ck_str_n_hash_insert(keystr, sizeof(double), value, table);
 }
 
 const void *ck_str_hash_lookup(const char *key, ck_hash_table_t *table) {
-    size_t keylen = strlen(key);
-    if (keylen >= CK_HASH_KEY_SIZE)
-        keylen = CK_HASH_KEY_SIZE-1;
-    return ck_str_n_hash_lookup(key, keylen, table);
+    return ck_str_n_hash_lookup(key, strlen(key), table);
 }
 
-const void *ck_str_n_hash_lookup(const char *key, size_t keylen, ck_hash_table_t *table)
-{
-	if (table->count == 0)
-		return NULL;
-    	
-	if (keylen == 0 || keylen >= CK_HASH_KEY_SIZE)
+// Keys are stored in the pool after their length
+static int ck_hash_key_equals(const ck_hash_entry_t *entry, const char *key, uint32_t keylen,
+        const ck_hash_table_t *table) {
+    const char *stored = &table->keys[entry->key_offset - 1];
+    uint32_t stored_len = 0;
+    memcpy(&stored_len, stored, sizeof(uint32_t));
+    return stored_len == keylen && memcmp(stored + sizeof(uint32_t), key, keylen) == 0;
+}
+
+// Returns the slot holding `key', or the empty slot where it belongs
+static ck_hash_entry_t *ck_hash_find(const char *key, uint32_t keylen, uint32_t hash,
+        ck_hash_table_t *table) {
+    uint64_t mask = table->capacity - 1;
+    uint64_t slot = hash & mask;
+    while (1) {
+        ck_hash_entry_t *entry = &table->entries[slot];
+        if (entry->key_offset == 0)
+            return entry;
+        if (entry->hash == hash && ck_hash_key_equals(entry, key, keylen, table))
+            return entry;
+        slot = (slot + 1) & mask;
+    }
+}
+
+const void *ck_str_n_hash_lookup(const char *key, size_t keylen, ck_hash_table_t *table) {
+	if (table->count == 0 || keylen == 0 || keylen > UINT32_MAX)
 		return NULL;
-	
-	uint64_t hash_key = ck_hash_str(key);
-	hash_key %= table->capacity;
-	uint64_t end = (hash_key - 1) % table->capacity;
-	while (hash_key != end && table->entries[hash_key].key[0] != '\0') {
-		if (strncmp(table->entries[hash_key].key, key, keylen + 1) == 0) {
-			return table->entries[hash_key].value;
-		}
-		hash_key++;
-		hash_key %= table->capacity;
-	}
-	return NULL;
-}
-
-int ck_str_hash_insert(const char *key, const void *value, ck_hash_table_t *table)
-{
-    size_t keylen = strlen(key);
-    if (keylen >= CK_HASH_KEY_SIZE)
-        keylen = CK_HASH_KEY_SIZE-1;
-    return ck_str_n_hash_insert(key, keylen, value, table);
+
+    ck_hash_entry_t *entry = ck_hash_find(key, keylen, ck_hash_bytes(key, keylen), table);
+    return entry->key_offset ? entry->value : NULL;
+}
+
+int ck_str_hash_insert(const char *key, const void *value, ck_hash_table_t *table) {
+    return ck_str_n_hash_insert(key, strlen(key), value, table);
+}
+
+static int ck_hash_store_key(const char *key, uint32_t keylen, ck_hash_table_t *table) {
+    size_t len = sizeof(uint32_t) + keylen;
+    if (table->keys_len >= UINT32_MAX - len)
+        return -1;
+
+    if (table->keys_len + len > table->keys_capacity) {
+        size_t keys_capacity = table->keys_capacity ? 2 * table->keys_capacity : CK_HASH_KEYS_MIN_LEN;
+        char *keys = NULL;
+        while (keys_capacity < table->keys_len + len)
+            keys_capacity *= 2;
+        /* Not readstat_realloc(), which would free the keys on failure */
+        if ((keys = readstat_malloc(keys_capacity)) == NULL)
+            return -1;
+        if (table->keys_len)
+            memcpy(keys, table->keys, table->keys_len);
+        readstat_free(table->keys);
+        table->keys = keys;
+        table->keys_capacity = keys_capacity;
+    }
+    memcpy(&table->keys[table->keys_len], &keylen, sizeof(uint32_t));
+    memcpy(&table->keys[table->keys_len + sizeof(uint32_t)], key, keylen);
+    table->keys_len += len;
+    return 0;
 }
 
 int ck_str_n_hash_insert(const char *key, size_t keylen, const void *value, ck_hash_table_t *table)
-{    
-	if (table->capacity == 0)
-		return 0;
-    	
-	if (keylen == 0 || keylen >= CK_HASH_KEY_SIZE)
+{
+	if (table->capacity == 0 || keylen == 0 || keylen > UINT32_MAX)
 		return 0;
-    
-    if (table->count >= 0.75 * table->capacity) {
+
+    if (4 * (table->count + 1) > 3 * table->capacity) {
         if (ck_hash_table_grow(table) == -1) {
             return 0;
         }
     }
-	
-	uint64_t hash_key = ck_hash_str(key);
-	hash_key %= table->capacity;
-	uint64_t end = hash_key ? ((hash_key - 1) % table->capacity) : (table->capacity -1);
-	while (hash_key != end) {
-        if (table->entries[hash_key].key[0] == '\0') {
-            table->count++;
-        }
-		if (table->entries[hash_key].key[0] == '\0' ||
-			strncmp(table->entries[hash_key].key, key, keylen + 1) == 0) {
-			memcpy(table->entries[hash_key].key, key, keylen);
-            memset(table->entries[hash_key].key + keylen, 0, 1);
-			table->entries[hash_key].value = value;
-			return 1;
-		}
-		hash_key++;
-		hash_key %= table->capacity;
-	}
-	return 0;
+
+    uint32_t hash = ck_hash_bytes(key, keylen);
+    ck_hash_entry_t *entry = ck_hash_find(key, keylen, hash, table);
+    if (entry->key_offset == 0) {
+        size_t key_offset = table->keys_len;
+        if (ck_hash_store_key(key, keylen, table) == -1)
+            return 0;
+        entry->hash = hash;
+        entry->key_offset = key_offset + 1;
+        table->count++;
+    }
+    entry->value = value;
+	return 1;
 }
 
 ck_hash_table_t *ck_hash_table_init(size_t size)
 {
 	ck_hash_table_t *table;
-	if ((table = malloc(sizeof(ck_hash_table_t))) == NULL)
+	uint64_t capacity = CK_HASH_MIN_CAPACITY;
+	if ((table = readstat_calloc(1, sizeof(ck_hash_table_t))) == NULL)
 		return NULL;
-	size *= 2;
-    if ((table->entries = malloc(size * sizeof(ck_hash_entry_t))) == NULL) {
-        free(table);
+	while (capacity < 2 * (uint64_t)size)
+		capacity *= 2;
+    if ((table->entries = readstat_calloc(capacity, sizeof(ck_hash_entry_t))) == NULL) {
+        readstat_free(table);
         return NULL;
     }
-	table->capacity = size;
-    table->count = 0;
-    ck_hash_table_wipe(table);
+	table->capacity = capacity;
 	return table;
 }
 
 void ck_hash_table_free(ck_hash_table_t *table) {
-    free(table->entries);
-    free(table);
+    readstat_free(table->entries);
+    readstat_free(table->keys);
+    readstat_free(table);
 }
 
 void ck_hash_table_wipe(ck_hash_table_t *table) {
     memset(table->entries, 0, table->capacity * sizeof(ck_hash_entry_t));
+    table->count = 0;
+    table->keys_len = 0;
 }
 
+// Rehashes with the stored hashes; keys aren't looked at or moved
 int ck_hash_table_grow(ck_hash_table_t *table) {
     ck_hash_entry_t *old_entries = table->entries;
     uint64_t old_capacity = table->capacity;
     uint64_t new_capacity = 2 * table->capacity;
-    int i;
-    if ((table->entries = calloc(new_capacity, sizeof(ck_hash_entry_t))) == NULL) {
+    uint64_t mask = new_capacity - 1;
+    uint64_t i;
+    if ((table->entries = readstat_calloc(new_capacity, sizeof(ck_hash_entry_t))) == NULL) {
+        table->entries = old_entries;
         return -1;
     }
     table->capacity = new_capacity;
-    table->count = 0;
     for (i=0; i<old_capacity; i++) {
-        if (old_entries[i].key[0] !='\0') {
-            if (!ck_str_hash_insert(old_entries[i].key, old_entries[i].value, table))
-                return -1;
+        if (old_entries[i].key_offset) {
+            uint64_t slot = old_entries[i].hash & mask;
+            while (table->entries[slot].key_offset)
+                slot = (slot + 1) & mask;
+            table->entries[slot] = old_entries[i];
         }
     }
-    free(old_entries);
+    readstat_free(old_entries);
     return 0;
 }
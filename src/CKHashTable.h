@@ -4,10 +4,12 @@
 #include <stdint.h>
 #include <sys/types.h>
 
-#define CK_HASH_KEY_SIZE     128
-
+// Slots hold 32 bits of the key's hash and where the key starts in the
+// table's key pool (plus one, so that 0 marks an empty slot). Growing the
+// table never touches the keys themselves.
 typedef struct ck_hash_entry_s {
-	char key[CK_HASH_KEY_SIZE];
+	uint32_t hash;
+	uint32_t key_offset;
 	const void *value;
 } ck_hash_entry_t;
 
@@ -15,11 +17,21 @@ typedef struct ck_hash_table_s {
 	uint64_t capacity;
     uint64_t count;
 	ck_hash_entry_t *entries;
+
+	char *keys;
+	size_t keys_len;
+	size_t keys_capacity;
 } ck_hash_table_t;
 
+// Keys are copied into the table; they can be any length but not empty.
+// Since key_offset is 32 bits, the pool holds under 4 GB of keys (each with
+// a four-byte length) per table, and inserts that would go past that fail.
 int ck_str_hash_insert(const char *key, const void *value, ck_hash_table_t *table);
 const void *ck_str_hash_lookup(const char *key, ck_hash_table_t *table);
 
+int ck_str_n_hash_insert(const char *key, size_t keylen, const void *value, ck_hash_table_t *table);
+const void *ck_str_n_hash_lookup(const char *key, size_t keylen, ck_hash_table_t *table);
+
 int ck_float_hash_insert(float key, const void *value, ck_hash_table_t *table);
 const void *ck_float_hash_lookup(float key, ck_hash_table_t *table);
 
@@ -31,3 +43,4 @@ void ck_hash_table_wipe(ck_hash_table_t *table);
 int ck_hash_table_grow(ck_hash_table_t *table);
 void ck_hash_table_free(ck_hash_table_t *table);
 uint64_t ck_hash_str(const char *str);
+uint64_t ck_hash_bytes(const void *key, size_t keylen);
@@ -0,0 +1,846 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CODEC_HAVE_TSC 1
+#endif
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "../readstat.h"
+#include "../readstat_iconv.h"
+#include "../readstat_writer.h"
+#include "../CKHashTable.h"
+#include "../sas/ieee.h"
+#include "../sas/readstat_sas_rdc.h"
+#include "../sas/readstat_sas_rle.h"
+#include "../spss/readstat_spss.h"
+#include "../spss/readstat_por.h"
+#include "../spss/readstat_por_parse.h"
+#include "../spss/readstat_sav_compress.h"
+#if HAVE_ZLIB
+#include "../spss/readstat_zsav_compress.h"
+#endif
+
+/* Microbenchmarks for the compression and number-encoding kernels, run in
+ * isolation over a generated corpus of rows that look like survey data:
+ * small integer codes, system-missing values, measurements with fractional
+ * parts, and space-padded strings drawn from a small vocabulary. The symbol
+ * table used for variable and label set names is timed over one generated
+ * name per row.
+ *
+ * Usage: bench_codecs [-r rows] [-n repetitions] [filter]
+ *
+ * Only kernels whose name contains the filter string are run. Throughput is
+ * computed from the fastest repetition over the uncompressed (or decoded)
+ * side of each kernel, so that encoders and decoders are comparable. Cycles
+ * come from the time-stamp counter where one is available; it ticks at the
+ * nominal rather than the boosted clock rate. Every kernel's output is
+ * checked against the corpus after the first repetition. */
+
+#define CODEC_DEFAULT_ROWS          32768
+#define CODEC_DEFAULT_REPETITIONS   5
+#define CODEC_MAX_REPETITIONS       100
+
+#define CODEC_NUMERIC_COLUMNS       16
+#define CODEC_STRING_COLUMNS        4
+#define CODEC_STRING_WIDTH          32
+#define CODEC_ROW_LENGTH            (8 * CODEC_NUMERIC_COLUMNS + CODEC_STRING_WIDTH * CODEC_STRING_COLUMNS)
+
+#define CODEC_BASE30_PRECISION      50
+#define CODEC_BASE30_MAX_LENGTH     128
+
+#define CODEC_RDC_HASH_SIZE         4096
+#define CODEC_RDC_MAX_OFFSET        (3 + 15 + 255 * 16)
+#define CODEC_RDC_MAX_INSERT        (19 + 15 + 255 * 16)
+#define CODEC_RDC_MAX_COPY          (16 + 255)
+
+#define CODEC_SYMBOL_MAX_LENGTH     64
+
+typedef struct codec_corpus_s {
+    long                row_count;
+
+    /* Uncompressed rows, CODEC_ROW_LENGTH bytes apiece */
+    unsigned char      *rows;
+    size_t              rows_len;
+
+    /* Each row compressed separately, as in SAS7BDAT; the offsets array
+     * has row_count + 1 entries */
+    unsigned char      *sas_rle;
+    size_t             *sas_rle_offsets;
+    unsigned char      *sas_rdc;
+    size_t             *sas_rdc_offsets;
+
+    /* The SAV bytecode stream for all rows, plus where each row starts */
+    unsigned char      *sav;
+    size_t              sav_len;
+    size_t             *sav_offsets;
+    readstat_writer_t  *writer;
+
+#if HAVE_ZLIB
+    zsav_ctx_t         *zsav;
+#endif
+
+    /* Numeric values in native, XPORT and POR base-30 form */
+    double             *doubles;
+    long                doubles_count;
+    unsigned char      *xport;
+    char               *base30;
+    size_t              base30_len;
+    uint8_t             byte2base30[256];
+
+    /* Variable-like names, NUL-separated, and a table of all of them */
+    char               *symbols;
+    size_t              symbols_len;
+    size_t             *symbol_offsets;
+    ck_hash_table_t    *symbol_table;
+
+    /* Kernel output, large enough for anything a kernel writes */
+    unsigned char      *scratch;
+    size_t              scratch_len;
+    size_t              scratch_used;
+} codec_corpus_t;
+
+typedef struct codec_kernel_s {
+    const char     *name;
+    /* Returns the number of uncompressed bytes processed, or -1 */
+    ssize_t       (*run)(codec_corpus_t *corpus);
+    /* Returns zero if the last run's output is correct */
+    int           (*check)(codec_corpus_t *corpus);
+} codec_kernel_t;
+
+typedef struct codec_timing_s {
+    double      seconds[CODEC_MAX_REPETITIONS];
+    double      best;
+    uint64_t    best_cycles;
+} codec_timing_t;
+
+static double codec_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+static uint64_t codec_cycles(void) {
+#if CODEC_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* A fixed-seed xorshift, so that every run generates the same corpus */
+static uint64_t codec_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static double codec_random_double(uint64_t *state) {
+    uint64_t r = codec_random(state) % 100;
+    if (r < 45) {
+        /* Category codes, which SAV bytecode stores in a single byte */
+        return (double)(codec_random(state) % 12) + 1;
+    }
+    if (r < 55) {
+        return -(double)(codec_random(state) % 99 + 1);
+    }
+    if (r < 65) {
+        /* Counts and identifiers */
+        return (double)(codec_random(state) % 1000000);
+    }
+    if (r < 70) {
+        return NAN;
+    }
+    /* Measurements with two decimal places */
+    return (double)(codec_random(state) % 10000000) / 100.0;
+}
+
+static void codec_random_string(uint64_t *state, unsigned char *dest, size_t width) {
+    static const char *vocabulary[] = {
+        "Yes", "No", "Don't know", "Refused", "Strongly agree", "Agree",
+        "Neither agree nor disagree", "Disagree", "Strongly disagree",
+        "North", "South", "East", "West", "Urban", "Rural", "Other (specify)"
+    };
+    size_t offset = 0;
+    uint64_t r = codec_random(state) % 10;
+
+    memset(dest, ' ', width);
+    if (r < 2)
+        return;
+
+    /* One or two words from the vocabulary */
+    while (offset < width) {
+        const char *word = vocabulary[codec_random(state) % (sizeof(vocabulary)/sizeof(vocabulary[0]))];
+        size_t len = strlen(word);
+        if (offset + len > width)
+            len = width - offset;
+        memcpy(&dest[offset], word, len);
+        offset += len + 1;
+        if (r < 7)
+            break;
+        r = 0;
+    }
+}
+
+/* A greedy RDC encoder for building the corpus, so that the decoder runs
+ * over the same mix of literals, runs and back-references as SAS output */
+static size_t codec_rdc_compress(unsigned char *output, const unsigned char *input, size_t input_len) {
+    int hash[CODEC_RDC_HASH_SIZE];
+    size_t input_pos = 0;
+    size_t output_pos = 0;
+    size_t prefix_pos = 0;
+    int item = 16;
+    int i;
+
+    for (i=0; i<CODEC_RDC_HASH_SIZE; i++)
+        hash[i] = -1;
+
+    while (input_pos < input_len) {
+        size_t remaining = input_len - input_pos;
+        size_t run_len = 1;
+        size_t match_len = 0;
+        size_t back_offset = 0;
+
+        if (item == 16) {
+            prefix_pos = output_pos;
+            output[output_pos++] = 0;
+            output[output_pos++] = 0;
+            item = 0;
+        }
+
+        while (run_len < remaining && run_len < CODEC_RDC_MAX_INSERT &&
+                input[input_pos + run_len] == input[input_pos])
+            run_len++;
+
+        if (remaining >= 3) {
+            unsigned int h = ((input[input_pos] << 8) ^ (input[input_pos+1] << 4) ^
+                    input[input_pos+2]) % CODEC_RDC_HASH_SIZE;
+            int candidate = hash[h];
+            hash[h] = input_pos;
+            if (candidate != -1 && input_pos - candidate >= 3 &&
+                    input_pos - candidate <= CODEC_RDC_MAX_OFFSET) {
+                back_offset = input_pos - candidate;
+                while (match_len < remaining && match_len < back_offset &&
+                        match_len < CODEC_RDC_MAX_COPY &&
+                        input[candidate + match_len] == input[input_pos + match_len])
+                    match_len++;
+            }
+        }
+
+        if (run_len >= 3 && run_len >= match_len) {
+            unsigned char byte = input[input_pos];
+            if (run_len <= 18) {
+                output[output_pos++] = run_len - 3;
+                output[output_pos++] = byte;
+            } else {
+                size_t value = run_len - 19;
+                output[output_pos++] = 0x10 | (value & 0x0F);
+                output[output_pos++] = value >> 4;
+                output[output_pos++] = byte;
+            }
+            input_pos += run_len;
+        } else if (match_len >= 3) {
+            size_t value = back_offset - 3;
+            if (match_len < 16) {
+                output[output_pos++] = (match_len << 4) | (value & 0x0F);
+                output[output_pos++] = value >> 4;
+            } else {
+                output[output_pos++] = 0x20 | (value & 0x0F);
+                output[output_pos++] = value >> 4;
+                output[output_pos++] = match_len - 16;
+            }
+            input_pos += match_len;
+        } else {
+            output[output_pos++] = input[input_pos++];
+            item++;
+            continue;
+        }
+
+        output[prefix_pos + (item < 8 ? 0 : 1)] |= 1 << (7 - (item % 8));
+        item++;
+    }
+
+    return output_pos;
+}
+
+/* Missing values are written the way the XPORT writer does */
+static int codec_xport_encode(const double *value, unsigned char *output) {
+    if (isnan(*value)) {
+        memset(output, 0, 8);
+        output[0] = 0x2e;
+        return 0;
+    }
+    return cnxptiee(value, CN_TYPE_NATIVE, output, CN_TYPE_XPORT);
+}
+
+static void codec_corpus_free(codec_corpus_t *corpus) {
+    free(corpus->rows);
+    free(corpus->sas_rle);
+    free(corpus->sas_rle_offsets);
+    free(corpus->sas_rdc);
+    free(corpus->sas_rdc_offsets);
+    free(corpus->sav);
+    free(corpus->sav_offsets);
+    if (corpus->writer)
+        readstat_writer_free(corpus->writer);
+#if HAVE_ZLIB
+    if (corpus->zsav)
+        zsav_ctx_free(corpus->zsav);
+#endif
+    free(corpus->doubles);
+    free(corpus->xport);
+    free(corpus->base30);
+    free(corpus->symbols);
+    free(corpus->symbol_offsets);
+    if (corpus->symbol_table)
+        ck_hash_table_free(corpus->symbol_table);
+    free(corpus->scratch);
+    free(corpus);
+}
+
+/* Names like Q12_3, and longer ones like household_income_2019_12, unique
+ * thanks to the row number */
+static size_t codec_random_symbol(uint64_t *state, char *dest, long index) {
+    static const char *stems[] = {
+        "Q", "age", "sex", "region", "weight", "household_income", "employment_status",
+        "education_level_highest_completed", "satisfaction", "wave"
+    };
+    const char *stem = stems[codec_random(state) % (sizeof(stems)/sizeof(stems[0]))];
+    int len = 0;
+    if (codec_random(state) % 2) {
+        len = snprintf(dest, CODEC_SYMBOL_MAX_LENGTH, "%s%ld_%d", stem, index,
+                (int)(codec_random(state) % 10));
+    } else {
+        len = snprintf(dest, CODEC_SYMBOL_MAX_LENGTH, "%s_%d_%ld", stem,
+                (int)(codec_random(state) % 100), index);
+    }
+    return len;
+}
+
+static codec_corpus_t *codec_corpus_init(long row_count) {
+    codec_corpus_t *corpus = calloc(1, sizeof(codec_corpus_t));
+    uint16_t byte2unicode[256] = { 0 };
+    uint64_t state = 88172645463325252ULL;
+    size_t sas_rle_len = 0, sas_rdc_len = 0;
+    long i, j;
+
+    corpus->row_count = row_count;
+    corpus->rows_len = row_count * CODEC_ROW_LENGTH;
+    corpus->doubles_count = row_count * CODEC_NUMERIC_COLUMNS;
+
+    corpus->rows = malloc(corpus->rows_len);
+    corpus->doubles = malloc(corpus->doubles_count * sizeof(double));
+    corpus->xport = malloc(corpus->doubles_count * 8);
+    corpus->base30 = malloc(corpus->doubles_count * CODEC_BASE30_MAX_LENGTH);
+    corpus->sas_rle = malloc(corpus->rows_len + corpus->rows_len / 32 + row_count * 8);
+    corpus->sas_rle_offsets = malloc((row_count + 1) * sizeof(size_t));
+    corpus->sas_rdc = malloc(corpus->rows_len + corpus->rows_len / 8 + row_count * 8);
+    corpus->sas_rdc_offsets = malloc((row_count + 1) * sizeof(size_t));
+    corpus->sav = malloc(row_count * sav_compressed_row_bound(CODEC_ROW_LENGTH));
+    corpus->sav_offsets = malloc((row_count + 1) * sizeof(size_t));
+    corpus->symbols = malloc(row_count * CODEC_SYMBOL_MAX_LENGTH);
+    corpus->symbol_offsets = malloc(row_count * sizeof(size_t));
+    corpus->symbol_table = ck_hash_table_init(row_count);
+
+    for (i=0; i<row_count; i++) {
+        corpus->symbol_offsets[i] = corpus->symbols_len;
+        corpus->symbols_len += codec_random_symbol(&state, &corpus->symbols[corpus->symbols_len], i) + 1;
+        ck_str_hash_insert(&corpus->symbols[corpus->symbol_offsets[i]], (const void *)(intptr_t)(i + 1),
+                corpus->symbol_table);
+    }
+
+    for (i=0; i<row_count; i++) {
+        unsigned char *row = &corpus->rows[i * CODEC_ROW_LENGTH];
+        for (j=0; j<CODEC_NUMERIC_COLUMNS; j++) {
+            double value = codec_random_double(&state);
+            corpus->doubles[i * CODEC_NUMERIC_COLUMNS + j] = value;
+            if (isnan(value)) {
+                uint64_t missing = SAV_MISSING_DOUBLE;
+                memcpy(&row[8 * j], &missing, sizeof(uint64_t));
+            } else {
+                memcpy(&row[8 * j], &value, sizeof(double));
+            }
+        }
+        for (j=0; j<CODEC_STRING_COLUMNS; j++) {
+            codec_random_string(&state, &row[8 * CODEC_NUMERIC_COLUMNS + CODEC_STRING_WIDTH * j],
+                    CODEC_STRING_WIDTH);
+        }
+    }
+
+    /* SAS row compression */
+    for (i=0; i<row_count; i++) {
+        const unsigned char *row = &corpus->rows[i * CODEC_ROW_LENGTH];
+        corpus->sas_rle_offsets[i] = sas_rle_len;
+        sas_rle_len += sas_rle_compress(&corpus->sas_rle[sas_rle_len],
+                sas_rle_compressed_len(row, CODEC_ROW_LENGTH), row, CODEC_ROW_LENGTH);
+        corpus->sas_rdc_offsets[i] = sas_rdc_len;
+        sas_rdc_len += codec_rdc_compress(&corpus->sas_rdc[sas_rdc_len], row, CODEC_ROW_LENGTH);
+    }
+    corpus->sas_rle_offsets[row_count] = sas_rle_len;
+    corpus->sas_rdc_offsets[row_count] = sas_rdc_len;
+
+    /* SAV bytecode needs the variable types from a writer */
+    corpus->writer = readstat_writer_init();
+    for (j=0; j<CODEC_NUMERIC_COLUMNS; j++) {
+        char name[32];
+        snprintf(name, sizeof(name), "NUM%ld", j);
+        readstat_add_variable(corpus->writer, name, READSTAT_TYPE_DOUBLE, 0);
+    }
+    for (j=0; j<CODEC_STRING_COLUMNS; j++) {
+        char name[32];
+        snprintf(name, sizeof(name), "TEXT%ld", j);
+        readstat_variable_t *variable = readstat_add_variable(corpus->writer, name,
+                READSTAT_TYPE_STRING, CODEC_STRING_WIDTH);
+        /* Normally filled in by the SAV writer's begin_data callback */
+        variable->storage_width = CODEC_STRING_WIDTH;
+    }
+    for (i=0; i<row_count; i++) {
+        corpus->sav_offsets[i] = corpus->sav_len;
+        corpus->sav_len += sav_compress_row(&corpus->sav[corpus->sav_len],
+                &corpus->rows[i * CODEC_ROW_LENGTH], CODEC_ROW_LENGTH, corpus->writer);
+    }
+    corpus->sav_offsets[row_count] = corpus->sav_len;
+
+#if HAVE_ZLIB
+    corpus->zsav = zsav_ctx_init(sav_compressed_row_bound(CODEC_ROW_LENGTH), 0);
+    for (i=0; i<row_count; i++) {
+        zsav_compress_row(&corpus->sav[corpus->sav_offsets[i]],
+                corpus->sav_offsets[i+1] - corpus->sav_offsets[i], i + 1 == row_count, corpus->zsav);
+    }
+#endif
+
+    for (i=0; i<corpus->doubles_count; i++) {
+        codec_xport_encode(&corpus->doubles[i], &corpus->xport[8 * i]);
+        corpus->base30_len += por_write_double_to_buffer(&corpus->base30[corpus->base30_len],
+                CODEC_BASE30_MAX_LENGTH, corpus->doubles[i], CODEC_BASE30_PRECISION);
+    }
+    for (i=0x20; i<0x7F; i++) {
+        byte2unicode[i] = i;
+    }
+    por_build_base30_lookup(corpus->byte2base30, byte2unicode);
+
+    corpus->scratch_len = corpus->rows_len;
+    if (corpus->scratch_len < corpus->sav_len)
+        corpus->scratch_len = corpus->sav_len;
+    if (corpus->scratch_len < corpus->base30_len)
+        corpus->scratch_len = corpus->base30_len;
+    if (corpus->scratch_len < sas_rle_len)
+        corpus->scratch_len = sas_rle_len;
+    corpus->scratch = malloc(corpus->scratch_len);
+
+    return corpus;
+}
+
+static ssize_t codec_run_sas_rle_compress(codec_corpus_t *corpus) {
+    size_t output_len = 0;
+    long i;
+    for (i=0; i<corpus->row_count; i++) {
+        ssize_t len = sas_rle_compress(&corpus->scratch[output_len], corpus->scratch_len - output_len,
+                &corpus->rows[i * CODEC_ROW_LENGTH], CODEC_ROW_LENGTH);
+        if (len == -1)
+            return -1;
+        output_len += len;
+    }
+    corpus->scratch_used = output_len;
+    return corpus->rows_len;
+}
+
+static int codec_check_sas_rle_compress(codec_corpus_t *corpus) {
+    size_t len = corpus->sas_rle_offsets[corpus->row_count];
+    return corpus->scratch_used != len || memcmp(corpus->scratch, corpus->sas_rle, len) != 0;
+}
+
+static ssize_t codec_run_sas_rle_decompress(codec_corpus_t *corpus) {
+    long i;
+    for (i=0; i<corpus->row_count; i++) {
+        size_t offset = corpus->sas_rle_offsets[i];
+        if (sas_rle_decompress(&corpus->scratch[i * CODEC_ROW_LENGTH], CODEC_ROW_LENGTH,
+                &corpus->sas_rle[offset], corpus->sas_rle_offsets[i+1] - offset) != CODEC_ROW_LENGTH)
+            return -1;
+    }
+    corpus->scratch_used = corpus->rows_len;
+    return corpus->rows_len;
+}
+
+static ssize_t codec_run_sas_rdc_decompress(codec_corpus_t *corpus) {
+    long i;
+    for (i=0; i<corpus->row_count; i++) {
+        size_t offset = corpus->sas_rdc_offsets[i];
+        if (sas_rdc_decompress(&corpus->scratch[i * CODEC_ROW_LENGTH], CODEC_ROW_LENGTH,
+                &corpus->sas_rdc[offset], corpus->sas_rdc_offsets[i+1] - offset) != CODEC_ROW_LENGTH)
+            return -1;
+    }
+    corpus->scratch_used = corpus->rows_len;
+    return corpus->rows_len;
+}
+
+static int codec_check_rows(codec_corpus_t *corpus) {
+    return corpus->scratch_used != corpus->rows_len ||
+        memcmp(corpus->scratch, corpus->rows, corpus->rows_len) != 0;
+}
+
+static ssize_t codec_run_sav_compress_row(codec_corpus_t *corpus) {
+    size_t output_len = 0;
+    long i;
+    for (i=0; i<corpus->row_count; i++) {
+        output_len += sav_compress_row(&corpus->scratch[output_len],
+                &corpus->rows[i * CODEC_ROW_LENGTH], CODEC_ROW_LENGTH, corpus->writer);
+    }
+    corpus->scratch_used = output_len;
+    return corpus->rows_len;
+}
+
+static int codec_check_sav(codec_corpus_t *corpus) {
+    return corpus->scratch_used != corpus->sav_len ||
+        memcmp(corpus->scratch, corpus->sav, corpus->sav_len) != 0;
+}
+
+static ssize_t codec_sav_decompress(codec_corpus_t *corpus, const unsigned char *input, size_t input_len) {
+    struct sav_row_stream_s state = {
+        .missing_value = SAV_MISSING_DOUBLE,
+        .bias = 100.0,
+        .status = SAV_ROW_STREAM_HAVE_DATA };
+    size_t output_len = 0;
+
+    state.next_in = input;
+    state.avail_in = input_len;
+    while (state.status != SAV_ROW_STREAM_NEED_DATA && output_len < corpus->rows_len) {
+        state.next_out = &corpus->scratch[output_len];
+        state.avail_out = CODEC_ROW_LENGTH;
+        sav_decompress_row(&state);
+        if (state.status != SAV_ROW_STREAM_FINISHED_ROW)
+            return -1;
+        output_len += CODEC_ROW_LENGTH;
+    }
+    corpus->scratch_used = output_len;
+    return output_len;
+}
+
+static ssize_t codec_run_sav_decompress_row(codec_corpus_t *corpus) {
+    return codec_sav_decompress(corpus, corpus->sav, corpus->sav_len);
+}
+
+#if HAVE_ZLIB
+static ssize_t codec_run_zsav_deflate(codec_corpus_t *corpus) {
+    zsav_ctx_t *zctx = zsav_ctx_init(sav_compressed_row_bound(CODEC_ROW_LENGTH), 0);
+    size_t output_len = 0;
+    long i;
+    int j;
+    for (i=0; i<corpus->row_count; i++) {
+        int status = zsav_compress_row(&corpus->sav[corpus->sav_offsets[i]],
+                corpus->sav_offsets[i+1] - corpus->sav_offsets[i], i + 1 == corpus->row_count, zctx);
+        if (status != Z_OK && status != Z_STREAM_END) {
+            zsav_ctx_free(zctx);
+            return -1;
+        }
+    }
+    for (j=0; j<zctx->blocks_count; j++) {
+        output_len += zctx->blocks[j]->compressed_size;
+    }
+    corpus->scratch_used = output_len;
+    zsav_ctx_free(zctx);
+    return corpus->sav_len;
+}
+
+static int codec_check_zsav_deflate(codec_corpus_t *corpus) {
+    size_t output_len = 0;
+    int j;
+    for (j=0; j<corpus->zsav->blocks_count; j++) {
+        output_len += corpus->zsav->blocks[j]->compressed_size;
+    }
+    return corpus->scratch_used != output_len;
+}
+
+static ssize_t codec_run_zsav_inflate(codec_corpus_t *corpus) {
+    size_t output_len = 0;
+    int j;
+    for (j=0; j<corpus->zsav->blocks_count; j++) {
+        zsav_block_t *block = corpus->zsav->blocks[j];
+        uLongf block_len = corpus->scratch_len - output_len;
+        if (uncompress(&corpus->scratch[output_len], &block_len,
+                    block->compressed_data, block->compressed_size) != Z_OK ||
+                block_len != block->uncompressed_size)
+            return -1;
+        output_len += block_len;
+    }
+    corpus->scratch_used = output_len;
+    return output_len;
+}
+#endif
+
+static ssize_t codec_run_cnxptiee_decode(codec_corpus_t *corpus) {
+    double *output = (double *)corpus->scratch;
+    long i;
+    for (i=0; i<corpus->doubles_count; i++) {
+        if (cnxptiee(&corpus->xport[8 * i], CN_TYPE_XPORT, &output[i], CN_TYPE_NATIVE) != 0)
+            return -1;
+    }
+    corpus->scratch_used = corpus->doubles_count * sizeof(double);
+    return corpus->doubles_count * 8;
+}
+
+static ssize_t codec_run_cnxptiee_batch(codec_corpus_t *corpus) {
+    if (cnxptiee_batch(corpus->xport, 8, (double *)corpus->scratch, corpus->doubles_count) != 0)
+        return -1;
+    corpus->scratch_used = corpus->doubles_count * sizeof(double);
+    return corpus->doubles_count * 8;
+}
+
+static int codec_compare_doubles(codec_corpus_t *corpus, int compare_missing) {
+    const double *output = (const double *)corpus->scratch;
+    long i;
+    if (corpus->scratch_used != corpus->doubles_count * sizeof(double))
+        return 1;
+    for (i=0; i<corpus->doubles_count; i++) {
+        double expected = corpus->doubles[i];
+        if (isnan(expected)) {
+            if (compare_missing && !isnan(output[i]))
+                return 1;
+        } else if (fabs(output[i] - expected) > 1e-9 * fabs(expected)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int codec_check_doubles(codec_corpus_t *corpus) {
+    return codec_compare_doubles(corpus, 1);
+}
+
+/* The XPORT reader recognizes missing values before conversion, so
+ * whatever cnxptiee makes of them is ignored */
+static int codec_check_xport_doubles(codec_corpus_t *corpus) {
+    return codec_compare_doubles(corpus, 0);
+}
+
+static ssize_t codec_run_cnxptiee_encode(codec_corpus_t *corpus) {
+    long i;
+    for (i=0; i<corpus->doubles_count; i++) {
+        if (codec_xport_encode(&corpus->doubles[i], &corpus->scratch[8 * i]) != 0)
+            return -1;
+    }
+    corpus->scratch_used = corpus->doubles_count * 8;
+    return corpus->doubles_count * 8;
+}
+
+static int codec_check_xport(codec_corpus_t *corpus) {
+    return corpus->scratch_used != corpus->doubles_count * 8 ||
+        memcmp(corpus->scratch, corpus->xport, corpus->scratch_used) != 0;
+}
+
+static ssize_t codec_run_por_base30_encode(codec_corpus_t *corpus) {
+    char *output = (char *)corpus->scratch;
+    size_t output_len = 0;
+    long i;
+    for (i=0; i<corpus->doubles_count; i++) {
+        char buffer[CODEC_BASE30_MAX_LENGTH];
+        ssize_t len = por_write_double_to_buffer(buffer, sizeof(buffer),
+                corpus->doubles[i], CODEC_BASE30_PRECISION);
+        if (len == -1 || output_len + len > corpus->scratch_len)
+            return -1;
+        memcpy(&output[output_len], buffer, len);
+        output_len += len;
+    }
+    corpus->scratch_used = output_len;
+    return output_len;
+}
+
+static int codec_check_base30(codec_corpus_t *corpus) {
+    return corpus->scratch_used != corpus->base30_len ||
+        memcmp(corpus->scratch, corpus->base30, corpus->base30_len) != 0;
+}
+
+/* Parses with the fast path, falling back to the Ragel machine like the
+ * POR reader does */
+static ssize_t codec_run_por_base30_decode(codec_corpus_t *corpus) {
+    const unsigned char *input = (const unsigned char *)corpus->base30;
+    double *output = (double *)corpus->scratch;
+    size_t input_pos = 0;
+    long i;
+    for (i=0; i<corpus->doubles_count; i++) {
+        ssize_t len = por_parse_base30_double(&input[input_pos], corpus->base30_len - input_pos,
+                corpus->byte2base30, &output[i]);
+        if (len == -1) {
+            len = readstat_por_parse_double((const char *)&input[input_pos],
+                    corpus->base30_len - input_pos, &output[i], NULL, NULL);
+        }
+        if (len <= 0)
+            return -1;
+        input_pos += len;
+    }
+    corpus->scratch_used = corpus->doubles_count * sizeof(double);
+    return input_pos;
+}
+
+/* Builds a table from its default size, as the POR reader and SAV writer do */
+static ssize_t codec_run_symbol_insert(codec_corpus_t *corpus) {
+    ck_hash_table_t *table = ck_hash_table_init(1024);
+    intptr_t *output = (intptr_t *)corpus->scratch;
+    long i;
+    if (table == NULL)
+        return -1;
+    for (i=0; i<corpus->row_count; i++) {
+        if (!ck_str_hash_insert(&corpus->symbols[corpus->symbol_offsets[i]],
+                    (const void *)(intptr_t)(i + 1), table)) {
+            ck_hash_table_free(table);
+            return -1;
+        }
+    }
+    for (i=0; i<corpus->row_count; i++) {
+        output[i] = (intptr_t)ck_str_hash_lookup(&corpus->symbols[corpus->symbol_offsets[i]], table);
+    }
+    ck_hash_table_free(table);
+    corpus->scratch_used = corpus->row_count * sizeof(intptr_t);
+    return corpus->symbols_len;
+}
+
+static ssize_t codec_run_symbol_lookup(codec_corpus_t *corpus) {
+    intptr_t *output = (intptr_t *)corpus->scratch;
+    long i;
+    for (i=0; i<corpus->row_count; i++) {
+        output[i] = (intptr_t)ck_str_hash_lookup(&corpus->symbols[corpus->symbol_offsets[i]],
+                corpus->symbol_table);
+    }
+    corpus->scratch_used = corpus->row_count * sizeof(intptr_t);
+    return corpus->symbols_len;
+}
+
+static int codec_check_symbols(codec_corpus_t *corpus) {
+    const intptr_t *output = (const intptr_t *)corpus->scratch;
+    long i;
+    if (corpus->scratch_used != corpus->row_count * sizeof(intptr_t))
+        return 1;
+    for (i=0; i<corpus->row_count; i++) {
+        if (output[i] != i + 1)
+            return 1;
+    }
+    return 0;
+}
+
+static codec_kernel_t codec_kernels[] = {
+    { "sas_rle_compress",   &codec_run_sas_rle_compress,    &codec_check_sas_rle_compress },
+    { "sas_rle_decompress", &codec_run_sas_rle_decompress,  &codec_check_rows },
+    { "sas_rdc_decompress", &codec_run_sas_rdc_decompress,  &codec_check_rows },
+    { "sav_compress_row",   &codec_run_sav_compress_row,    &codec_check_sav },
+    { "sav_decompress_row", &codec_run_sav_decompress_row,  &codec_check_rows },
+#if HAVE_ZLIB
+    { "zsav_deflate",       &codec_run_zsav_deflate,        &codec_check_zsav_deflate },
+    { "zsav_inflate",       &codec_run_zsav_inflate,        &codec_check_sav },
+#endif
+    { "cnxptiee_decode",    &codec_run_cnxptiee_decode,     &codec_check_xport_doubles },
+    { "cnxptiee_batch",     &codec_run_cnxptiee_batch,      &codec_check_xport_doubles },
+    { "cnxptiee_encode",    &codec_run_cnxptiee_encode,     &codec_check_xport },
+    { "por_base30_encode",  &codec_run_por_base30_encode,   &codec_check_base30 },
+    { "por_base30_decode",  &codec_run_por_base30_decode,   &codec_check_doubles },
+    { "symbol_insert",      &codec_run_symbol_insert,       &codec_check_symbols },
+    { "symbol_lookup",      &codec_run_symbol_lookup,       &codec_check_symbols }
+};
+
+static void codec_usage(const char *cmd) {
+    fprintf(stderr, "Usage: %s [-r rows] [-n repetitions] [filter]\n", cmd);
+}
+
+int main(int argc, char *argv[]) {
+    codec_corpus_t *corpus = NULL;
+    long rows = CODEC_DEFAULT_ROWS;
+    int repetitions = CODEC_DEFAULT_REPETITIONS;
+    const char *filter = NULL;
+    int first = 1;
+    int failed = 0;
+    int k, i;
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rows = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && filter == NULL) {
+            filter = argv[i];
+        } else {
+            codec_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rows < 1 || repetitions < 1 || repetitions > CODEC_MAX_REPETITIONS) {
+        codec_usage(argv[0]);
+        return 1;
+    }
+
+    corpus = codec_corpus_init(rows);
+
+    printf("{\n  \"rows\": %ld,\n  \"row_length\": %d,\n  \"corpus_bytes\": %ld,\n"
+            "  \"repetitions\": %d,\n  \"cycle_counter\": %s,\n  \"results\": [",
+            rows, CODEC_ROW_LENGTH, (long)corpus->rows_len, repetitions,
+#if CODEC_HAVE_TSC
+            "\"tsc\""
+#else
+            "null"
+#endif
+            );
+
+    for (k=0; k<sizeof(codec_kernels)/sizeof(codec_kernels[0]); k++) {
+        const codec_kernel_t *kernel = &codec_kernels[k];
+        codec_timing_t timing = { .best = 0.0 };
+        ssize_t bytes = 0;
+
+        if (filter && strstr(kernel->name, filter) == NULL)
+            continue;
+
+        fprintf(stderr, "%s...\n", kernel->name);
+
+        printf("%s\n    {\"name\": \"%s\", ", first ? "" : ",", kernel->name);
+        first = 0;
+
+        for (i=0; i<repetitions; i++) {
+            double start = codec_now();
+            uint64_t start_cycles = codec_cycles();
+            bytes = kernel->run(corpus);
+            uint64_t cycles = codec_cycles() - start_cycles;
+            timing.seconds[i] = codec_now() - start;
+            if (bytes == -1 || (i == 0 && kernel->check(corpus) != 0)) {
+                bytes = -1;
+                break;
+            }
+            if (i == 0 || timing.seconds[i] < timing.best) {
+                timing.best = timing.seconds[i];
+                timing.best_cycles = cycles;
+            }
+        }
+
+        if (bytes == -1) {
+            printf("\"error\": \"output does not match the corpus\"}");
+            failed = 1;
+            continue;
+        }
+
+        printf("\"bytes\": %ld, \"output_bytes\": %ld, \"seconds\": [",
+                (long)bytes, (long)corpus->scratch_used);
+        for (i=0; i<repetitions; i++) {
+            printf("%s%.6lf", i ? ", " : "", timing.seconds[i]);
+        }
+        printf("], \"best_seconds\": %.6lf, ", timing.best);
+#if CODEC_HAVE_TSC
+        printf("\"cycles_per_byte\": %.3lf, ", bytes > 0 ? (double)timing.best_cycles / bytes : 0.0);
+#else
+        printf("\"cycles_per_byte\": null, ");
+#endif
+        printf("\"gb_per_second\": %.3lf}", timing.best > 0 ? bytes / 1e9 / timing.best : 0.0);
+    }
+
+    printf("\n  ]\n}\n");
+
+    codec_corpus_free(corpus);
+
+    return failed;
+}
@@ -0,0 +1,434 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "../readstat.h"
+
+#include "../test/test_buffer.h"
+#include "../test/test_buffer_io.h"
+
+/* Generates synthetic datasets through the writer API for each format and
+ * compression mode, times writing them to memory and reading them back,
+ * and prints the results as JSON.
+ *
+ * Usage: bench_readstat [-r rows] [-n repetitions] [-j threads] [filter]
+ *
+ * Only benchmarks whose name ("sav-rows/labelled" etc.) contains the filter
+ * string are run. Throughput figures are computed from the fastest
+ * repetition; MB/s counts the size of the file in the given format. */
+
+#define BENCH_DEFAULT_ROWS          50000
+#define BENCH_DEFAULT_REPETITIONS   3
+#define BENCH_MAX_REPETITIONS       100
+
+#define BENCH_NUMERIC_COLUMNS       8
+#define BENCH_STRING_COLUMNS        16
+#define BENCH_STRING_WIDTH          48
+#define BENCH_LABELLED_COLUMNS      8
+#define BENCH_LABELS_COUNT          10
+#define BENCH_STRL_COLUMNS          4
+#define BENCH_STRL_POOL_SIZE        256
+
+typedef enum bench_format_e {
+    BENCH_FORMAT_DTA,
+    BENCH_FORMAT_SAV,
+    BENCH_FORMAT_POR,
+    BENCH_FORMAT_SAS7BDAT,
+    BENCH_FORMAT_XPORT
+} bench_format_t;
+
+typedef enum bench_mix_e {
+    BENCH_MIX_NARROW_NUMERIC,
+    BENCH_MIX_WIDE_STRING,
+    BENCH_MIX_LABELLED,
+    BENCH_MIX_STRL
+} bench_mix_t;
+
+typedef struct bench_target_s {
+    const char         *name;
+    bench_format_t      format;
+    int                 version;
+    readstat_compress_t compression;
+} bench_target_t;
+
+typedef struct bench_mix_info_s {
+    const char         *name;
+    bench_mix_t         mix;
+} bench_mix_info_t;
+
+typedef struct bench_timing_s {
+    double      seconds[BENCH_MAX_REPETITIONS];
+    double      best;
+} bench_timing_t;
+
+typedef struct bench_read_ctx_s {
+    long        rows;
+    long        values;
+    double      checksum;
+} bench_read_ctx_t;
+
+static bench_target_t bench_targets[] = {
+    { "dta",            BENCH_FORMAT_DTA,      118, READSTAT_COMPRESS_NONE },
+    { "sav",            BENCH_FORMAT_SAV,      2,   READSTAT_COMPRESS_NONE },
+    { "sav-rows",       BENCH_FORMAT_SAV,      2,   READSTAT_COMPRESS_ROWS },
+#if HAVE_ZLIB
+    { "zsav",           BENCH_FORMAT_SAV,      3,   READSTAT_COMPRESS_BINARY },
+#endif
+    { "por",            BENCH_FORMAT_POR,      0,   READSTAT_COMPRESS_NONE },
+    { "sas7bdat",       BENCH_FORMAT_SAS7BDAT, 9,   READSTAT_COMPRESS_NONE },
+    { "sas7bdat-rows",  BENCH_FORMAT_SAS7BDAT, 9,   READSTAT_COMPRESS_ROWS },
+    { "xpt5",           BENCH_FORMAT_XPORT,    5,   READSTAT_COMPRESS_NONE },
+    { "xpt8",           BENCH_FORMAT_XPORT,    8,   READSTAT_COMPRESS_NONE }
+};
+
+static bench_mix_info_t bench_mixes[] = {
+    { "narrow_numeric", BENCH_MIX_NARROW_NUMERIC },
+    { "wide_string",    BENCH_MIX_WIDE_STRING },
+    { "labelled",       BENCH_MIX_LABELLED },
+    { "strl",           BENCH_MIX_STRL }
+};
+
+static double bench_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+/* A fixed-seed xorshift, so that every run generates the same data */
+static uint64_t bench_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void bench_random_string(uint64_t *state, char *dest, size_t len) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    size_t i;
+    for (i=0; i<len; i++) {
+        dest[i] = alphabet[bench_random(state) % (sizeof(alphabet) - 1)];
+    }
+    dest[len] = '\0';
+}
+
+static void handle_error(const char *error_message, void *ctx) {
+    fprintf(stderr, "%s\n", error_message);
+}
+
+static ssize_t write_data(const void *bytes, size_t len, void *ctx) {
+    rt_buffer_t *buffer = (rt_buffer_t *)ctx;
+    buffer_grow(buffer, len);
+    if (buffer->bytes == NULL) {
+        return -1;
+    }
+    memcpy(buffer->bytes + buffer->used, bytes, len);
+    buffer->used += len;
+    return len;
+}
+
+static int bench_supports(const bench_target_t *target, bench_mix_t mix) {
+    if (mix == BENCH_MIX_STRL)
+        return target->format == BENCH_FORMAT_DTA;
+    if (mix == BENCH_MIX_LABELLED)
+        return target->format != BENCH_FORMAT_XPORT && target->format != BENCH_FORMAT_SAS7BDAT;
+    return 1;
+}
+
+static readstat_error_t bench_begin_writing(readstat_writer_t *writer, const bench_target_t *target,
+        rt_buffer_t *buffer, long rows) {
+    if (target->version)
+        readstat_writer_set_file_format_version(writer, target->version);
+    if (target->compression != READSTAT_COMPRESS_NONE)
+        readstat_writer_set_compression(writer, target->compression);
+
+    if (target->format == BENCH_FORMAT_DTA)
+        return readstat_begin_writing_dta(writer, buffer, rows);
+    if (target->format == BENCH_FORMAT_SAV)
+        return readstat_begin_writing_sav(writer, buffer, rows);
+    if (target->format == BENCH_FORMAT_POR)
+        return readstat_begin_writing_por(writer, buffer, rows);
+    if (target->format == BENCH_FORMAT_SAS7BDAT)
+        return readstat_begin_writing_sas7bdat(writer, buffer, rows);
+
+    return readstat_begin_writing_xport(writer, buffer, rows);
+}
+
+static readstat_error_t bench_write(const bench_target_t *target, bench_mix_t mix,
+        rt_buffer_t *buffer, long rows) {
+    readstat_error_t error = READSTAT_OK;
+    readstat_writer_t *writer = readstat_writer_init();
+    readstat_variable_t *variables[BENCH_STRING_COLUMNS];
+    readstat_string_ref_t *refs[BENCH_STRL_POOL_SIZE];
+    readstat_label_set_t *label_set = NULL;
+    readstat_type_t labelled_type = (target->format == BENCH_FORMAT_DTA) ? READSTAT_TYPE_INT32 : READSTAT_TYPE_DOUBLE;
+    char string[4096];
+    char name[32];
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    int columns = 0;
+    long i;
+    int j;
+
+    buffer_reset(buffer);
+
+    readstat_set_data_writer(writer, &write_data);
+    readstat_writer_set_error_handler(writer, &handle_error);
+    readstat_writer_set_file_label(writer, "ReadStat benchmark");
+
+    if (mix == BENCH_MIX_NARROW_NUMERIC) {
+        columns = BENCH_NUMERIC_COLUMNS;
+        for (j=0; j<columns; j++) {
+            snprintf(name, sizeof(name), "NUM%d", j);
+            variables[j] = readstat_add_variable(writer, name, READSTAT_TYPE_DOUBLE, 0);
+        }
+    } else if (mix == BENCH_MIX_WIDE_STRING) {
+        columns = BENCH_STRING_COLUMNS;
+        for (j=0; j<columns; j++) {
+            snprintf(name, sizeof(name), "TEXT%d", j);
+            variables[j] = readstat_add_variable(writer, name, READSTAT_TYPE_STRING, BENCH_STRING_WIDTH);
+        }
+    } else if (mix == BENCH_MIX_LABELLED) {
+        label_set = readstat_add_label_set(writer, labelled_type, "LEVELS");
+        for (j=0; j<BENCH_LABELS_COUNT; j++) {
+            snprintf(string, sizeof(string), "Level %d of %d", j + 1, BENCH_LABELS_COUNT);
+            if (labelled_type == READSTAT_TYPE_INT32) {
+                readstat_label_int32_value(label_set, j + 1, string);
+            } else {
+                readstat_label_double_value(label_set, j + 1, string);
+            }
+        }
+        columns = BENCH_LABELLED_COLUMNS;
+        for (j=0; j<columns; j++) {
+            snprintf(name, sizeof(name), "LAB%d", j);
+            variables[j] = readstat_add_variable(writer, name, labelled_type, 0);
+            readstat_variable_set_label_set(variables[j], label_set);
+            readstat_variable_set_label(variables[j], "A labelled variable");
+        }
+    } else if (mix == BENCH_MIX_STRL) {
+        columns = BENCH_STRL_COLUMNS + 1;
+        variables[0] = readstat_add_variable(writer, "ID", READSTAT_TYPE_INT32, 0);
+        for (j=1; j<columns; j++) {
+            snprintf(name, sizeof(name), "STRL%d", j);
+            variables[j] = readstat_add_variable(writer, name, READSTAT_TYPE_STRING_REF, 0);
+        }
+        for (j=0; j<BENCH_STRL_POOL_SIZE; j++) {
+            bench_random_string(&state, string, 200 + bench_random(&state) % 1800);
+            refs[j] = readstat_add_string_ref(writer, string);
+        }
+    }
+
+    if ((error = bench_begin_writing(writer, target, buffer, rows)) != READSTAT_OK)
+        goto cleanup;
+
+    for (i=0; i<rows; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            goto cleanup;
+
+        for (j=0; j<columns; j++) {
+            uint64_t r = bench_random(&state);
+            if (mix == BENCH_MIX_NARROW_NUMERIC) {
+                if (r % 50 == 0) {
+                    error = readstat_insert_missing_value(writer, variables[j]);
+                } else if (j % 2) {
+                    error = readstat_insert_double_value(writer, variables[j], (double)(r % 100000));
+                } else {
+                    error = readstat_insert_double_value(writer, variables[j], (r % 10000000) / 1024.0);
+                }
+            } else if (mix == BENCH_MIX_WIDE_STRING) {
+                bench_random_string(&state, string, r % (BENCH_STRING_WIDTH + 1));
+                error = readstat_insert_string_value(writer, variables[j], string);
+            } else if (mix == BENCH_MIX_LABELLED) {
+                if (labelled_type == READSTAT_TYPE_INT32) {
+                    error = readstat_insert_int32_value(writer, variables[j], 1 + r % BENCH_LABELS_COUNT);
+                } else {
+                    error = readstat_insert_double_value(writer, variables[j], 1 + r % BENCH_LABELS_COUNT);
+                }
+            } else if (j == 0) {
+                error = readstat_insert_int32_value(writer, variables[j], i);
+            } else {
+                error = readstat_insert_string_ref(writer, variables[j], refs[r % BENCH_STRL_POOL_SIZE]);
+            }
+            if (error != READSTAT_OK)
+                goto cleanup;
+        }
+
+        if ((error = readstat_end_row(writer)) != READSTAT_OK)
+            goto cleanup;
+    }
+
+    error = readstat_end_writing(writer);
+
+cleanup:
+    readstat_writer_free(writer);
+
+    return error;
+}
+
+static int bench_handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    return READSTAT_HANDLER_OK;
+}
+
+static int bench_handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx) {
+    bench_read_ctx_t *read_ctx = (bench_read_ctx_t *)ctx;
+    if (readstat_variable_get_index(variable) == 0)
+        read_ctx->rows++;
+    read_ctx->values++;
+    if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        const char *string = readstat_string_value(value);
+        if (string)
+            read_ctx->checksum += string[0];
+    } else if (!readstat_value_is_system_missing(value)) {
+        read_ctx->checksum += readstat_double_value(value);
+    }
+    return READSTAT_HANDLER_OK;
+}
+
+static readstat_error_t bench_read(const bench_target_t *target, rt_buffer_t *buffer, int threads,
+        bench_read_ctx_t *read_ctx) {
+    readstat_error_t error = READSTAT_OK;
+    readstat_parser_t *parser = readstat_parser_init();
+    rt_buffer_ctx_t buffer_ctx = { .buffer = buffer };
+
+    memset(read_ctx, 0, sizeof(bench_read_ctx_t));
+
+    readstat_set_open_handler(parser, rt_open_handler);
+    readstat_set_close_handler(parser, rt_close_handler);
+    readstat_set_seek_handler(parser, rt_seek_handler);
+    readstat_set_read_handler(parser, rt_read_handler);
+    readstat_set_update_handler(parser, rt_update_handler);
+    readstat_set_io_ctx(parser, &buffer_ctx);
+    readstat_set_error_handler(parser, &handle_error);
+    readstat_set_variable_handler(parser, &bench_handle_variable);
+    readstat_set_value_handler(parser, &bench_handle_value);
+    readstat_set_thread_count(parser, threads);
+
+    if (target->format == BENCH_FORMAT_DTA) {
+        error = readstat_parse_dta(parser, NULL, read_ctx);
+    } else if (target->format == BENCH_FORMAT_SAV) {
+        error = readstat_parse_sav(parser, NULL, read_ctx);
+    } else if (target->format == BENCH_FORMAT_POR) {
+        error = readstat_parse_por(parser, NULL, read_ctx);
+    } else if (target->format == BENCH_FORMAT_SAS7BDAT) {
+        error = readstat_parse_sas7bdat(parser, NULL, read_ctx);
+    } else {
+        error = readstat_parse_xport(parser, NULL, read_ctx);
+    }
+
+    readstat_parser_free(parser);
+
+    return error;
+}
+
+static void bench_print_timing(const char *key, bench_timing_t *timing, int repetitions,
+        long rows, size_t bytes) {
+    int i;
+    printf("\"%s\": {\"seconds\": [", key);
+    for (i=0; i<repetitions; i++) {
+        printf("%s%.6lf", i ? ", " : "", timing->seconds[i]);
+    }
+    printf("], \"best_seconds\": %.6lf, \"rows_per_second\": %.0lf, \"mb_per_second\": %.2lf}",
+            timing->best,
+            timing->best > 0 ? rows / timing->best : 0.0,
+            timing->best > 0 ? bytes / 1e6 / timing->best : 0.0);
+}
+
+static void bench_usage(const char *cmd) {
+    fprintf(stderr, "Usage: %s [-r rows] [-n repetitions] [-j threads] [filter]\n", cmd);
+}
+
+int main(int argc, char *argv[]) {
+    rt_buffer_t *buffer = buffer_init();
+    long rows = BENCH_DEFAULT_ROWS;
+    int repetitions = BENCH_DEFAULT_REPETITIONS;
+    int threads = 1;
+    const char *filter = NULL;
+    int first = 1;
+    int failed = 0;
+    int t, m, i;
+
+    for (i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rows = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && filter == NULL) {
+            filter = argv[i];
+        } else {
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rows < 1 || repetitions < 1 || repetitions > BENCH_MAX_REPETITIONS || threads < 1) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    printf("{\n  \"rows\": %ld,\n  \"repetitions\": %d,\n  \"threads\": %d,\n  \"results\": [",
+            rows, repetitions, threads);
+
+    for (t=0; t<sizeof(bench_targets)/sizeof(bench_targets[0]); t++) {
+        const bench_target_t *target = &bench_targets[t];
+        for (m=0; m<sizeof(bench_mixes)/sizeof(bench_mixes[0]); m++) {
+            const bench_mix_info_t *mix = &bench_mixes[m];
+            bench_timing_t write_timing = { .best = 0.0 };
+            bench_timing_t read_timing = { .best = 0.0 };
+            bench_read_ctx_t read_ctx;
+            readstat_error_t error = READSTAT_OK;
+            char name[64];
+
+            snprintf(name, sizeof(name), "%s/%s", target->name, mix->name);
+            if (!bench_supports(target, mix->mix) || (filter && strstr(name, filter) == NULL))
+                continue;
+
+            fprintf(stderr, "%s...\n", name);
+
+            for (i=0; i<repetitions && error == READSTAT_OK; i++) {
+                double start = bench_now();
+                error = bench_write(target, mix->mix, buffer, rows);
+                write_timing.seconds[i] = bench_now() - start;
+                if (i == 0 || write_timing.seconds[i] < write_timing.best)
+                    write_timing.best = write_timing.seconds[i];
+            }
+
+            for (i=0; i<repetitions && error == READSTAT_OK; i++) {
+                double start = bench_now();
+                error = bench_read(target, buffer, threads, &read_ctx);
+                read_timing.seconds[i] = bench_now() - start;
+                if (i == 0 || read_timing.seconds[i] < read_timing.best)
+                    read_timing.best = read_timing.seconds[i];
+                if (error == READSTAT_OK && read_ctx.rows != rows) {
+                    fprintf(stderr, "%s: read %ld rows, expected %ld\n", name, read_ctx.rows, rows);
+                    error = READSTAT_ERROR_ROW_COUNT_MISMATCH;
+                }
+            }
+
+            printf("%s\n    {\"name\": \"%s\", \"format\": \"%s\", \"mix\": \"%s\", ",
+                    first ? "" : ",", name, target->name, mix->name);
+            first = 0;
+
+            if (error != READSTAT_OK) {
+                printf("\"error\": \"%s\"}", readstat_error_message(error));
+                failed = 1;
+                continue;
+            }
+
+            printf("\"bytes\": %lu, ", (unsigned long)buffer->used);
+            bench_print_timing("write", &write_timing, repetitions, rows, buffer->used);
+            printf(", ");
+            bench_print_timing("read", &read_timing, repetitions, rows, buffer->used);
+            printf("}");
+        }
+    }
+
+    printf("\n  ]\n}\n");
+
+    buffer_free(buffer);
+
+    return failed;
+}
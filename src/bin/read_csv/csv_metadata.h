@@ -1,4 +1,12 @@
 
+/* Backing storage for the strings and missing values of a column's variable */
+typedef struct csv_column_s {
+    char name[300];
+    char format[256];
+    char label[1024];
+    readstat_missingness_t missingness;
+} csv_column_t;
+
 typedef struct csv_metadata {
     int pass;
     long rows;
@@ -11,6 +19,7 @@ typedef struct csv_metadata {
     readstat_callbacks_t handle;
     void *user_ctx;
     readstat_variable_t *variables;
+    csv_column_t *column_data;
     int* is_date;
     struct json_metadata *json_md;
     rs_read_module_t *output_module;
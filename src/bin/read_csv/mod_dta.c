@@ -35,7 +35,7 @@ static double get_dta_days_from_token(const char *js, jsmntok_t* token) {
 }
 
 static char dta_add_missing_date(readstat_variable_t* var, double v) {
-    int idx = var->missingness.missing_ranges_count;
+    int idx = var->missingness->missing_ranges_count;
     char tagg = 'a' + idx;
     if (tagg > 'z') {
         fprintf(stderr, "%s:%d missing tag reached %c, aborting ...\n", __FILE__, __LINE__, tagg);
@@ -50,14 +50,14 @@ static char dta_add_missing_date(readstat_variable_t* var, double v) {
             .i32_value = v
         }
     };
-    var->missingness.missing_ranges[(idx*2)] = value;
-    var->missingness.missing_ranges[(idx*2)+1] = value;
-    var->missingness.missing_ranges_count++;
+    var->missingness->missing_ranges[(idx*2)] = value;
+    var->missingness->missing_ranges[(idx*2)+1] = value;
+    var->missingness->missing_ranges_count++;
     return tagg;
 }
 
 static char dta_add_missing_double(readstat_variable_t* var, double v) {
-    int idx = var->missingness.missing_ranges_count;
+    int idx = var->missingness->missing_ranges_count;
     char tagg = 'a' + idx;
     if (tagg > 'z') {
         fprintf(stderr, "%s:%d missing tag reached %c, aborting ...\n", __FILE__, __LINE__, tagg);
@@ -72,9 +72,9 @@ static char dta_add_missing_double(readstat_variable_t* var, double v) {
             .double_value = v
         }
     };
-    var->missingness.missing_ranges[(idx*2)] = value;
-    var->missingness.missing_ranges[(idx*2)+1] = value;
-    var->missingness.missing_ranges_count++;
+    var->missingness->missing_ranges[(idx*2)] = value;
+    var->missingness->missing_ranges[(idx*2)+1] = value;
+    var->missingness->missing_ranges_count++;
     return tagg;
 }
 
@@ -165,7 +165,7 @@ void produce_missingness_dta(void *csv_metadata, const char* column) {
     struct csv_metadata *c = (struct csv_metadata *)csv_metadata;
     const char *js = c->json_md->js;
     readstat_variable_t* var = &c->variables[c->columns];
-    var->missingness.missing_ranges_count = 0;
+    var->missingness->missing_ranges_count = 0;
     
     jsmntok_t* missing = find_variable_property(js, c->json_md->tok, column, "missing");
     if (!missing) {
@@ -190,13 +190,14 @@ void produce_missingness_dta(void *csv_metadata, const char* column) {
 
 void produce_column_header_dta(void *csv_metadata, const char *column, readstat_variable_t* var) {
     struct csv_metadata *c = (struct csv_metadata *)csv_metadata;
+    csv_column_t* column_data = &c->column_data[c->columns];
     metadata_column_type_t coltype = column_type(c->json_md, column, c->output_format);
     if (coltype == METADATA_COLUMN_TYPE_DATE) {
-        snprintf(var->format, sizeof(var->format), "%s", "%td");
+        snprintf(column_data->format, sizeof(column_data->format), "%s", "%td");
         var->type = READSTAT_TYPE_INT32;
     } else if (coltype == METADATA_COLUMN_TYPE_NUMERIC) {
         var->type = READSTAT_TYPE_DOUBLE;
-        snprintf(var->format, sizeof(var->format), "%%9.%df", get_decimals(c->json_md, column));
+        snprintf(column_data->format, sizeof(column_data->format), "%%9.%df", get_decimals(c->json_md, column));
     } else if (coltype == METADATA_COLUMN_TYPE_STRING) {
         var->type = READSTAT_TYPE_STRING;
     }
@@ -100,7 +100,7 @@ void produce_missingness_sav(void *csv_metadata, const char* column) {
     struct csv_metadata *c = (struct csv_metadata *)csv_metadata;
     const char *js = c->json_md->js;
     readstat_variable_t* var = &c->variables[c->columns];
-    var->missingness.missing_ranges_count = 0;
+    var->missingness->missing_ranges_count = 0;
     
     jsmntok_t* missing = find_variable_property(js, c->json_md->tok, column, "missing");
     if (!missing) {
@@ -125,13 +125,14 @@ void produce_missingness_sav(void *csv_metadata, const char* column) {
 
 void produce_column_header_sav(void *csv_metadata, const char *column, readstat_variable_t* var) {
     struct csv_metadata *c = (struct csv_metadata *)csv_metadata;
+    csv_column_t* column_data = &c->column_data[c->columns];
     metadata_column_type_t coltype = column_type(c->json_md, column, c->output_format);
     if (coltype == METADATA_COLUMN_TYPE_DATE) {
         var->type = READSTAT_TYPE_DOUBLE;
-        snprintf(var->format, sizeof(var->format), "%s", "EDATE40");
+        snprintf(column_data->format, sizeof(column_data->format), "%s", "EDATE40");
     } else if (coltype == METADATA_COLUMN_TYPE_NUMERIC) {
         var->type = READSTAT_TYPE_DOUBLE;
-        snprintf(var->format, sizeof(var->format), "F8.%d", get_decimals(c->json_md, column));
+        snprintf(column_data->format, sizeof(column_data->format), "F8.%d", get_decimals(c->json_md, column));
     } else if (coltype == METADATA_COLUMN_TYPE_STRING) {
         var->type = READSTAT_TYPE_STRING;
     }
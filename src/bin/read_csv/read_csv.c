@@ -31,7 +31,13 @@ rs_read_module_t *rs_read_module_for_filename(rs_read_module_t *modules, long mo
 static void produce_column_header(struct csv_metadata *c, void *s, size_t len) {
     char* column = (char*)s;
     readstat_variable_t* var = &c->variables[c->columns];
+    csv_column_t* column_data = &c->column_data[c->columns];
     memset(var, 0, sizeof(readstat_variable_t));
+    memset(column_data, 0, sizeof(csv_column_t));
+    var->name = column_data->name;
+    var->format = column_data->format;
+    var->label = column_data->label;
+    var->missingness = &column_data->missingness;
     metadata_column_type_t coltype = column_type(c->json_md, column, c->output_format);
     c->is_date[c->columns] = coltype == METADATA_COLUMN_TYPE_DATE;
 
@@ -50,8 +56,8 @@ static void produce_column_header(struct csv_metadata *c, void *s, size_t len) {
     }
     
     var->index = c->columns;
-    copy_variable_property(c->json_md, column, "label", var->label, sizeof(var->label));
-    snprintf(var->name, sizeof(var->name), "%.*s", (int)len, column);
+    copy_variable_property(c->json_md, column, "label", column_data->label, sizeof(column_data->label));
+    snprintf(column_data->name, sizeof(column_data->name), "%.*s", (int)len, column);
 
     if (c->output_module->missingness) {
         c->output_module->missingness(c, column);
@@ -70,7 +76,15 @@ static void csv_metadata_cell(void *s, size_t len, void *data)
     struct csv_metadata *c = (struct csv_metadata *)data;
     if (c->rows == 0) {
         c->variables = realloc(c->variables, (c->columns+1) * sizeof(readstat_variable_t));
+        c->column_data = realloc(c->column_data, (c->columns+1) * sizeof(csv_column_t));
         c->is_date = realloc(c->is_date, (c->columns+1) * sizeof(int));
+        /* The column data may have moved */
+        for (long i=0; i<c->columns; i++) {
+            c->variables[i].name = c->column_data[i].name;
+            c->variables[i].format = c->column_data[i].format;
+            c->variables[i].label = c->column_data[i].label;
+            c->variables[i].missingness = &c->column_data[i].missingness;
+        }
         produce_column_header(c, s, len);
     } else if (c->rows >= 1 && c->handle.value && c->output_module->csv_value) {
         c->output_module->csv_value(c, s, len);
@@ -176,6 +190,10 @@ cleanup:
         free(md->variables);
         md->variables = NULL;
     }
+    if (md->column_data) {
+        free(md->column_data);
+        md->column_data = NULL;
+    }
     if (md->is_date) {
         free(md->is_date);
         md->is_date = NULL;
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -13,6 +14,8 @@
 #include "write/module.h"
 #include "write/mod_readstat.h"
 #include "write/mod_csv.h"
+#include "write/mod_arrow.h"
+#include "write/mod_parquet.h"
 
 #if HAVE_CSVREADER
 #include "read_csv/json_metadata.h"
@@ -26,6 +29,8 @@
 #endif
 
 #include "util/file_format.h"
+#include "util/quote_and_escape.h"
+#include "util/worker_pool.h"
 
 typedef struct rs_ctx_s {
     rs_module_t *module;
@@ -33,6 +38,8 @@ typedef struct rs_ctx_s {
     const char  *error_filename;
     long         row_count;
     long         var_count;
+    long         row_offset;
+    long         row_limit;
 } rs_ctx_t;
 
 rs_module_t *rs_module_for_filename(rs_module_t *modules, long module_count, const char *filename) {
@@ -45,10 +52,21 @@ rs_module_t *rs_module_for_filename(rs_module_t *modules, long module_count, con
     return NULL;
 }
 
-int can_write(rs_module_t *modules, long modules_count, char *filename) {
+int can_write(rs_module_t *modules, long modules_count, const char *filename) {
     return (rs_module_for_filename(modules, modules_count, filename) != NULL);
 }
 
+static int can_convert(rs_module_t *modules, long modules_count, const char *input_filename,
+        const char *catalog_filename, const char *output_filename) {
+    if (!can_write(modules, modules_count, output_filename))
+        return 0;
+    if (catalog_filename == NULL)
+        return can_read(input_filename);
+
+    return (is_dictionary(catalog_filename) ||
+            (can_read(input_filename) && (is_json(catalog_filename) || is_catalog(catalog_filename))));
+}
+
 static void handle_error(const char *msg, void *ctx) {
     fprintf(stderr, "%s\n", msg);
 }
@@ -142,9 +160,9 @@ static void print_version() {
 #endif
 
 #if HAVE_XLSXWRITER
-#define OUTPUT_FORMATS INPUT_FORMATS "|csv|xlsx"
+#define OUTPUT_FORMATS INPUT_FORMATS "|csv|arrow|feather|parquet|xlsx"
 #else
-#define OUTPUT_FORMATS INPUT_FORMATS "|csv"
+#define OUTPUT_FORMATS INPUT_FORMATS "|csv|arrow|feather|parquet"
 #endif
 
 static void print_usage(const char *cmd) {
@@ -159,6 +177,20 @@ static void print_usage(const char *cmd) {
     fprintf(stdout, "\n  Convert a file:\n");
     fprintf(stdout, "\n     %s input.(" INPUT_FORMATS ") output.(" OUTPUT_FORMATS ")\n", cmd);
 
+    fprintf(stdout, "\n  Convert a file to Arrow or Parquet, writing record batches or row groups of a given number of rows\n"
+                    "  (default 65536 for Arrow, 131072 for Parquet):\n");
+    fprintf(stdout, "\n     %s -b rows input.(" INPUT_FORMATS ") output.(arrow|feather|parquet)\n", cmd);
+
+    fprintf(stdout, "\n  Convert a file into N files by row range (output.part-0000.csv and so on), on a pool of worker threads:\n");
+    fprintf(stdout, "\n     %s [-j workers] input.(" INPUT_FORMATS ") output.(" OUTPUT_FORMATS ") --shards N\n", cmd);
+
+    fprintf(stdout, "\n  Convert many files on a pool of worker threads (default: one per processor), listed one per line\n"
+                    "  as input<TAB>output or input<TAB>catalog<TAB>output (use - to read the list from standard in),\n"
+                    "  or given as inputs to be written beside the originals with a new extension. A JSON summary\n"
+                    "  of each conversion is written to standard out:\n");
+    fprintf(stdout, "\n     %s [-j workers] -m manifest.txt\n", cmd);
+    fprintf(stdout, "\n     %s [-j workers] -t (" OUTPUT_FORMATS ") input.(" INPUT_FORMATS ") ...\n", cmd);
+
 #if HAVE_CSVREADER
     fprintf(stdout, "\n  Convert a CSV file with column metadata stored in a separate JSON file (see extract_metadata):\n");
     fprintf(stdout, "\n     %s input.csv metadata.json output.(" OUTPUT_FORMATS ")\n", cmd);
@@ -172,7 +204,7 @@ static void print_usage(const char *cmd) {
 #if HAVE_ZLIB
             "|zsav"
 #endif
-            "|csv"
+            "|csv|arrow|feather|parquet"
 #if HAVE_XLSXWRITER
             "|xlsx"
 #endif
@@ -308,6 +340,10 @@ static readstat_error_t parse_binary_file(const char *input_filename,
     readstat_set_note_handler(pass2_parser, &handle_note);
     readstat_set_variable_handler(pass2_parser, &handle_variable);
     readstat_set_value_handler(pass2_parser, &handle_value);
+    if (rs_ctx->row_limit > 0) {
+        readstat_set_row_offset(pass2_parser, rs_ctx->row_offset);
+        readstat_set_row_limit(pass2_parser, rs_ctx->row_limit);
+    }
 
     error = parse_file(pass2_parser, input_filename, input_format, rs_ctx);
     rs_ctx->error_filename = input_filename;
@@ -323,25 +359,42 @@ cleanup:
     return error;
 }
 
-static int convert_file(const char *input_filename, const char *catalog_filename, const char *output_filename,
-        rs_module_t *modules, int modules_count, int force) {
+typedef struct rs_convert_result_s {
+    readstat_error_t    error;
+    const char         *error_filename;
+    int                 file_exists;
+    long                var_count;
+    long                row_count;
+    double              seconds;
+} rs_convert_result_t;
+
+/* Converts rows [row_offset, row_offset + row_limit) of a binary input file,
+ * or every row if row_limit is 0 */
+static void convert_file_with_result(const char *input_filename, const char *catalog_filename,
+        const char *output_filename, rs_module_t *modules, int modules_count,
+        const rs_mod_options_t *options, int force, long row_offset, long row_limit,
+        rs_convert_result_t *result) {
     readstat_error_t error = READSTAT_OK;
     struct timeval start_time, end_time;
     rs_module_t *module = rs_module_for_filename(modules, modules_count, output_filename);
     rs_ctx_t *rs_ctx = calloc(1, sizeof(rs_ctx_t));
     void *module_ctx = NULL;
-    int file_exists = 0;
     struct stat filestat;
 
+    memset(result, 0, sizeof(rs_convert_result_t));
+    rs_ctx->row_offset = row_offset;
+    rs_ctx->row_limit = row_limit;
+
     gettimeofday(&start_time, NULL);
 
     if (!force && stat(output_filename, &filestat) == 0) {
         error = READSTAT_ERROR_OPEN;
-        file_exists = 1;
+        result->file_exists = 1;
+        rs_ctx->error_filename = output_filename;
         goto cleanup;
     }
     
-    module_ctx = module->init(output_filename);
+    module_ctx = module->init(output_filename, options);
 
     if (module_ctx == NULL) {
         error = READSTAT_ERROR_OPEN;
@@ -362,33 +415,581 @@ static int convert_file(const char *input_filename, const char *catalog_filename
         error = parse_binary_file(input_filename, catalog_filename, rs_ctx);
     }
 
+cleanup:
+    if (module->finish) {
+        /* A module that failed partway aborts the parse, so its own error
+         * says more than the abort */
+        readstat_error_t finish_error = module->finish(rs_ctx->module_ctx);
+        if (finish_error != READSTAT_OK && (error == READSTAT_OK || error == READSTAT_ERROR_USER_ABORT)) {
+            error = finish_error;
+            if (error == READSTAT_ERROR_WRITE)
+                rs_ctx->error_filename = output_filename;
+        }
+    }
+
     gettimeofday(&end_time, NULL);
 
-    fprintf(stderr, "Converted %ld variables and %ld rows in %.2lf seconds\n",
-            rs_ctx->var_count, rs_ctx->row_count, 
-            (end_time.tv_sec + 1e-6 * end_time.tv_usec) -
-            (start_time.tv_sec + 1e-6 * start_time.tv_usec));
+    result->error = error;
+    result->error_filename = rs_ctx->error_filename;
+    result->var_count = rs_ctx->var_count;
+    result->row_count = rs_ctx->row_count;
+    result->seconds = (end_time.tv_sec + 1e-6 * end_time.tv_usec) -
+        (start_time.tv_sec + 1e-6 * start_time.tv_usec);
+
+    free(rs_ctx);
+
+    if (error != READSTAT_OK && !result->file_exists)
+        unlink(output_filename);
+}
+
+static int convert_file(const char *input_filename, const char *catalog_filename, const char *output_filename,
+        rs_module_t *modules, int modules_count, const rs_mod_options_t *options, int force) {
+    rs_convert_result_t result;
+
+    convert_file_with_result(input_filename, catalog_filename, output_filename,
+            modules, modules_count, options, force, 0, 0, &result);
+
+    if (result.file_exists) {
+        fprintf(stderr, "Error opening %s: File exists (Use -f to overwrite)\n", output_filename);
+        return 1;
+    }
+
+    if (result.error_filename != output_filename) {
+        fprintf(stderr, "Converted %ld variables and %ld rows in %.2lf seconds\n",
+                result.var_count, result.row_count, result.seconds);
+    }
+
+    if (result.error != READSTAT_OK) {
+        fprintf(stderr, "Error processing %s: %s\n", result.error_filename, readstat_error_message(result.error));
+        return 1;
+    }
+
+    return 0;
+}
+
+typedef struct rs_batch_job_s {
+    char                   *input_filename;
+    char                   *catalog_filename;
+    char                   *output_filename;
+    int                     is_supported;
+    rs_convert_result_t     result;
+} rs_batch_job_t;
+
+typedef struct rs_batch_s {
+    rs_batch_job_t         *jobs;
+    long                    jobs_count;
+    long                    jobs_capacity;
+    rs_module_t            *modules;
+    int                     modules_count;
+    const rs_mod_options_t *options;
+    int                     force;
+} rs_batch_t;
+
+static char *rs_strdup(const char *string, size_t len) {
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, string, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+static int batch_add_job(rs_batch_t *batch, const char *input_filename,
+        const char *catalog_filename, const char *output_filename) {
+    rs_batch_job_t *job = NULL;
+
+    if (batch->jobs_count == batch->jobs_capacity) {
+        long capacity = batch->jobs_capacity ? 2 * batch->jobs_capacity : 64;
+        rs_batch_job_t *jobs = realloc(batch->jobs, capacity * sizeof(rs_batch_job_t));
+        if (jobs == NULL)
+            return -1;
+        batch->jobs = jobs;
+        batch->jobs_capacity = capacity;
+    }
+
+    job = &batch->jobs[batch->jobs_count++];
+    memset(job, 0, sizeof(rs_batch_job_t));
+    job->input_filename = rs_strdup(input_filename, strlen(input_filename));
+    job->output_filename = rs_strdup(output_filename, strlen(output_filename));
+    if (catalog_filename)
+        job->catalog_filename = rs_strdup(catalog_filename, strlen(catalog_filename));
+    if (job->input_filename == NULL || job->output_filename == NULL ||
+            (catalog_filename && job->catalog_filename == NULL))
+        return -1;
+
+    job->is_supported = can_convert(batch->modules, batch->modules_count,
+            input_filename, catalog_filename, output_filename);
+
+    return 0;
+}
+
+/* Each line of the manifest is input<TAB>output or input<TAB>catalog<TAB>output;
+ * blank lines and lines starting with # are skipped */
+static int batch_read_manifest(rs_batch_t *batch, const char *manifest_filename) {
+    FILE *file = strcmp(manifest_filename, "-") == 0 ? stdin : fopen(manifest_filename, "r");
+    char *line = NULL;
+    size_t line_capacity = 0;
+    long line_number = 0;
+    int retval = 0;
+
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s: %s\n", manifest_filename, strerror(errno));
+        return -1;
+    }
+
+    while (!feof(file)) {
+        char *fields[3] = { NULL };
+        int fields_count = 0;
+        size_t len = 0;
+        char *field = NULL;
+
+        /* Read a whole line, however long */
+        do {
+            if (line_capacity - len < 2) {
+                size_t capacity = line_capacity ? 2 * line_capacity : 1024;
+                char *new_line = realloc(line, capacity);
+                if (new_line == NULL) {
+                    retval = -1;
+                    goto cleanup;
+                }
+                line = new_line;
+                line_capacity = capacity;
+            }
+            if (fgets(line + len, line_capacity - len, file) == NULL)
+                break;
+            len += strlen(line + len);
+        } while (len && line[len-1] != '\n');
+
+        if (ferror(file)) {
+            fprintf(stderr, "Error reading %s: %s\n", manifest_filename, strerror(errno));
+            retval = -1;
+            goto cleanup;
+        }
+
+        line_number++;
+        while (len && (line[len-1] == '\n' || line[len-1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        field = line;
+        while (field && fields_count < 3) {
+            fields[fields_count++] = field;
+            if ((field = strchr(field, '\t')))
+                *field++ = '\0';
+        }
+        if (field || fields_count < 2) {
+            fprintf(stderr, "Error reading %s: line %ld should be input<TAB>output or input<TAB>catalog<TAB>output\n",
+                    manifest_filename, line_number);
+            retval = -1;
+            goto cleanup;
+        }
+
+        if (batch_add_job(batch, fields[0], fields_count == 3 ? fields[1] : NULL, fields[fields_count-1]) != 0) {
+            retval = -1;
+            goto cleanup;
+        }
+    }
 
 cleanup:
-    if (module->finish) {
-        module->finish(rs_ctx->module_ctx);
+    if (file != stdin)
+        fclose(file);
+    free(line);
+
+    return retval;
+}
+
+/* Writes each input to a file of the same name with the extension replaced */
+static int batch_add_inputs(rs_batch_t *batch, const char *extension, char **inputs, int inputs_count) {
+    int i;
+
+    if (extension[0] == '.')
+        extension++;
+
+    for (i=0; i<inputs_count; i++) {
+        const char *input_filename = inputs[i];
+        const char *dot = strrchr(input_filename, '.');
+        const char *slash = strrchr(input_filename, '/');
+        size_t stem_len = (dot && (!slash || dot > slash)) ? (size_t)(dot - input_filename) : strlen(input_filename);
+        char *output_filename = malloc(stem_len + 1 + strlen(extension) + 1);
+        int retval = 0;
+
+        if (output_filename == NULL)
+            return -1;
+
+        memcpy(output_filename, input_filename, stem_len);
+        output_filename[stem_len] = '.';
+        strcpy(&output_filename[stem_len + 1], extension);
+
+        retval = batch_add_job(batch, input_filename, NULL, output_filename);
+        free(output_filename);
+        if (retval != 0)
+            return -1;
     }
 
-    free(rs_ctx);
+    return 0;
+}
 
-    if (error != READSTAT_OK) {
-        if (file_exists) {
-            fprintf(stderr, "Error opening %s: File exists (Use -f to overwrite)\n", output_filename);
+static void batch_convert_job(void *ctx, int worker, long index) {
+    rs_batch_t *batch = (rs_batch_t *)ctx;
+    rs_batch_job_t *job = &batch->jobs[index];
+
+    if (!job->is_supported)
+        return;
+
+    convert_file_with_result(job->input_filename, job->catalog_filename, job->output_filename,
+            batch->modules, batch->modules_count, batch->options, batch->force, 0, 0, &job->result);
+}
+
+static void batch_print_string(const char *key, const char *value) {
+    char *quoted_value = quote_and_escape(value);
+    printf(", \"%s\": %s", key, quoted_value);
+    free(quoted_value);
+}
+
+/* One JSON object on standard out */
+static void batch_print_summary(rs_batch_t *batch, int workers, double seconds, long failed_count) {
+    long i;
+
+    printf("{\n  \"files\": [");
+    for (i=0; i<batch->jobs_count; i++) {
+        rs_batch_job_t *job = &batch->jobs[i];
+        rs_convert_result_t *result = &job->result;
+        char *quoted_input = quote_and_escape(job->input_filename);
+
+        printf("%s\n    {\"input\": %s", i ? "," : "", quoted_input);
+        free(quoted_input);
+
+        if (job->catalog_filename)
+            batch_print_string("catalog", job->catalog_filename);
+        batch_print_string("output", job->output_filename);
+
+        if (!job->is_supported) {
+            printf(", \"status\": \"error\"");
+            batch_print_string("error", "Unsupported input or output format");
+        } else if (result->error != READSTAT_OK) {
+            printf(", \"status\": \"error\"");
+            batch_print_string("error", result->file_exists ? "File exists (Use -f to overwrite)" :
+                    readstat_error_message(result->error));
+            if (result->error_filename)
+                batch_print_string("error_file", result->error_filename);
         } else {
-            fprintf(stderr, "Error processing %s: %s\n", rs_ctx->error_filename, readstat_error_message(error));
-            unlink(output_filename);
+            printf(", \"status\": \"ok\", \"variables\": %ld, \"rows\": %ld",
+                    result->var_count, result->row_count);
+        }
+        if (job->is_supported)
+            printf(", \"seconds\": %.3lf", result->seconds);
+        printf("}");
+    }
+    printf("%s],\n", batch->jobs_count ? "\n  " : "");
+    printf("  \"workers\": %d,\n", workers);
+    printf("  \"succeeded\": %ld,\n", batch->jobs_count - failed_count);
+    printf("  \"failed\": %ld,\n", failed_count);
+    printf("  \"seconds\": %.3lf\n}\n", seconds);
+}
+
+static int batch_compare_outputs(const void *a, const void *b) {
+    const rs_batch_job_t *job_a = *(const rs_batch_job_t **)a;
+    const rs_batch_job_t *job_b = *(const rs_batch_job_t **)b;
+    return strcmp(job_a->output_filename, job_b->output_filename);
+}
+
+/* Two jobs writing the same file at once would leave it corrupt, and a
+ * job writing to standard out would interleave with the JSON summary */
+static int batch_check_outputs(rs_batch_t *batch) {
+    rs_batch_job_t **sorted = NULL;
+    int retval = 0;
+    long i;
+
+    for (i=0; i<batch->jobs_count; i++) {
+        if (strcmp(batch->jobs[i].output_filename, "-") == 0) {
+            fprintf(stderr, "Error: %s can't be written to standard out in a batch\n",
+                    batch->jobs[i].input_filename);
+            retval = -1;
         }
+    }
+
+    if (retval != 0 || batch->jobs_count < 2)
+        return retval;
+
+    if ((sorted = malloc(batch->jobs_count * sizeof(rs_batch_job_t *))) == NULL) {
+        fprintf(stderr, "Error checking the batch: %s\n", strerror(ENOMEM));
+        return -1;
+    }
+    for (i=0; i<batch->jobs_count; i++)
+        sorted[i] = &batch->jobs[i];
+
+    qsort(sorted, batch->jobs_count, sizeof(rs_batch_job_t *), &batch_compare_outputs);
+
+    for (i=1; i<batch->jobs_count; i++) {
+        if (strcmp(sorted[i-1]->output_filename, sorted[i]->output_filename) == 0) {
+            fprintf(stderr, "Error: %s and %s would both be written to %s\n",
+                    sorted[i-1]->input_filename, sorted[i]->input_filename, sorted[i]->output_filename);
+            retval = -1;
+        }
+    }
+
+    free(sorted);
+    return retval;
+}
+
+static int convert_batch(rs_batch_t *batch, int workers) {
+    struct timeval start_time, end_time;
+    long failed_count = 0;
+    long i;
+
+    if (batch_check_outputs(batch) != 0)
         return 1;
+
+    if (workers > batch->jobs_count)
+        workers = batch->jobs_count;
+    if (workers < 1)
+        workers = 1;
+
+    gettimeofday(&start_time, NULL);
+
+    rs_worker_pool_run(workers, batch->jobs_count, &batch_convert_job, batch);
+
+    gettimeofday(&end_time, NULL);
+
+    for (i=0; i<batch->jobs_count; i++) {
+        if (!batch->jobs[i].is_supported || batch->jobs[i].result.error != READSTAT_OK)
+            failed_count++;
     }
 
-    return 0;
+    batch_print_summary(batch, workers,
+            (end_time.tv_sec + 1e-6 * end_time.tv_usec) - (start_time.tv_sec + 1e-6 * start_time.tv_usec),
+            failed_count);
+
+    return failed_count ? 1 : 0;
+}
+
+static void batch_free(rs_batch_t *batch) {
+    long i;
+    for (i=0; i<batch->jobs_count; i++) {
+        free(batch->jobs[i].input_filename);
+        free(batch->jobs[i].catalog_filename);
+        free(batch->jobs[i].output_filename);
+    }
+    free(batch->jobs);
+}
+
+
+typedef struct rs_shard_s {
+    char                   *output_filename;
+    long                    row_offset;
+    long                    row_limit;
+    rs_convert_result_t     result;
+} rs_shard_t;
+
+typedef struct rs_sharding_s {
+    const char             *input_filename;
+    const char             *catalog_filename;
+    rs_shard_t             *shards;
+    rs_module_t            *modules;
+    int                     modules_count;
+    const rs_mod_options_t *options;
+    int                     force;
+} rs_sharding_t;
+
+typedef struct rs_row_count_s {
+    long    row_count;
+    long    rows_seen;
+} rs_row_count_t;
+
+static int count_rows_metadata(readstat_metadata_t *metadata, void *ctx) {
+    rs_row_count_t *count = (rs_row_count_t *)ctx;
+    count->row_count = readstat_get_row_count(metadata);
+    if (count->row_count != -1 || readstat_get_var_count(metadata) == 0)
+        return READSTAT_HANDLER_ABORT;
+    return READSTAT_HANDLER_OK;
+}
+
+static int count_rows_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx) {
+    rs_row_count_t *count = (rs_row_count_t *)ctx;
+    if (readstat_variable_get_index(variable) == 0)
+        count->rows_seen++;
+    return READSTAT_HANDLER_OK;
+}
+
+/* Reads the row count from the file header, or counts the rows if the
+ * format doesn't record them */
+static readstat_error_t count_rows(const char *input_filename, long *out_row_count) {
+    readstat_parser_t *parser = readstat_parser_init();
+    rs_row_count_t count = { .row_count = -1 };
+    readstat_error_t error = READSTAT_OK;
+
+    readstat_set_error_handler(parser, &handle_error);
+    readstat_set_metadata_handler(parser, &count_rows_metadata);
+    readstat_set_value_handler(parser, &count_rows_value);
+
+    error = parse_file(parser, input_filename, readstat_format(input_filename), &count);
+    readstat_parser_free(parser);
+
+    if (error == READSTAT_ERROR_USER_ABORT)
+        error = READSTAT_OK;
+
+    *out_row_count = count.row_count == -1 ? count.rows_seen : count.row_count;
+    return error;
+}
+
+/* out.csv -> out.part-0007.csv */
+static char *shard_filename(const char *filename, int shard_index) {
+    const char *dot = strrchr(filename, '.');
+    const char *slash = strrchr(filename, '/');
+    size_t stem_len = (dot && (!slash || dot > slash)) ? (size_t)(dot - filename) : strlen(filename);
+    size_t len = strlen(filename) + sizeof(".part-") + 10;
+    char *shard = malloc(len);
+
+    if (shard)
+        snprintf(shard, len, "%.*s.part-%04d%s", (int)stem_len, filename, shard_index, filename + stem_len);
+
+    return shard;
+}
+
+/* An earlier run with more shards leaves out.part-NNNN files past the
+ * last one written now, which would be read back as part of the output */
+static int shard_exists(const char *filename, int shard_index) {
+    struct stat filestat;
+    char *shard = shard_filename(filename, shard_index);
+    int exists = (shard && stat(shard, &filestat) == 0);
+
+    free(shard);
+    return exists;
+}
+
+static void remove_stale_shards(const char *filename, int first_index) {
+    int i;
+    for (i=first_index; shard_exists(filename, i); i++) {
+        char *shard = shard_filename(filename, i);
+        if (shard == NULL || unlink(shard) != 0) {
+            fprintf(stderr, "Error removing stale shard %s: %s\n",
+                    shard ? shard : filename, strerror(shard ? errno : ENOMEM));
+            free(shard);
+            break;
+        }
+        free(shard);
+    }
+}
+
+static void shard_convert_job(void *ctx, int worker, long index) {
+    rs_sharding_t *sharding = (rs_sharding_t *)ctx;
+    rs_shard_t *shard = &sharding->shards[index];
+
+    convert_file_with_result(sharding->input_filename, sharding->catalog_filename, shard->output_filename,
+            sharding->modules, sharding->modules_count, sharding->options, sharding->force,
+            shard->row_offset, shard->row_limit, &shard->result);
+}
+
+/* Splits the output by row range into shards_count files, each written by
+ * its own worker with its own parser and output module */
+static int convert_file_sharded(const char *input_filename, const char *catalog_filename,
+        const char *output_filename, rs_module_t *modules, int modules_count,
+        const rs_mod_options_t *options, int force, int shards_count, int workers) {
+    struct timeval start_time, end_time;
+    rs_sharding_t sharding = {
+        .input_filename = input_filename,
+        .catalog_filename = catalog_filename,
+        .modules = modules,
+        .modules_count = modules_count,
+        .options = options,
+        .force = force
+    };
+    readstat_error_t error = READSTAT_OK;
+    struct stat filestat;
+    long row_count = 0, var_count = 0, rows_converted = 0;
+    int failed = 0;
+    int i;
+
+    if (strcmp(output_filename, "-") == 0 || is_json(catalog_filename) || is_dictionary(catalog_filename)) {
+        fprintf(stderr, "Error: Sharded output requires a binary input file and an output file\n");
+        return 1;
+    }
+
+    gettimeofday(&start_time, NULL);
+
+    if ((error = count_rows(input_filename, &row_count)) != READSTAT_OK) {
+        fprintf(stderr, "Error processing %s: %s\n", input_filename, readstat_error_message(error));
+        return 1;
+    }
+
+    if (shards_count > row_count)
+        shards_count = row_count;
+    if (shards_count < 1)
+        shards_count = 1;
+
+    if ((sharding.shards = calloc(shards_count, sizeof(rs_shard_t))) == NULL) {
+        fprintf(stderr, "Error: %s\n", readstat_error_message(READSTAT_ERROR_MALLOC));
+        return 1;
+    }
+
+    for (i=0; i<shards_count; i++) {
+        rs_shard_t *shard = &sharding.shards[i];
+        shard->row_offset = (long long)row_count * i / shards_count;
+        shard->row_limit = (long long)row_count * (i + 1) / shards_count - shard->row_offset;
+        if ((shard->output_filename = shard_filename(output_filename, i)) == NULL) {
+            fprintf(stderr, "Error: %s\n", readstat_error_message(READSTAT_ERROR_MALLOC));
+            failed = 1;
+            goto cleanup;
+        }
+        if (!force && stat(shard->output_filename, &filestat) == 0) {
+            fprintf(stderr, "Error opening %s: File exists (Use -f to overwrite)\n", shard->output_filename);
+            failed = 1;
+            goto cleanup;
+        }
+    }
+    if (!force && shard_exists(output_filename, shards_count)) {
+        char *stale = shard_filename(output_filename, shards_count);
+        fprintf(stderr, "Error: Stale shard %s exists from an earlier run (Use -f to remove)\n",
+                stale ? stale : output_filename);
+        free(stale);
+        failed = 1;
+        goto cleanup;
+    }
+
+    if (workers <= 0)
+        workers = rs_worker_pool_default_size();
+    if (workers > shards_count)
+        workers = shards_count;
+
+    rs_worker_pool_run(workers, shards_count, &shard_convert_job, &sharding);
+
+    gettimeofday(&end_time, NULL);
+
+    for (i=0; i<shards_count; i++) {
+        rs_convert_result_t *result = &sharding.shards[i].result;
+        if (result->error != READSTAT_OK) {
+            fprintf(stderr, "Error processing %s: %s\n", result->error_filename, readstat_error_message(result->error));
+            failed = 1;
+        }
+        if (result->var_count > var_count)
+            var_count = result->var_count;
+        rows_converted += result->row_count;
+    }
+
+    if (failed) {
+        for (i=0; i<shards_count; i++) {
+            if (sharding.shards[i].result.error == READSTAT_OK)
+                unlink(sharding.shards[i].output_filename);
+        }
+    } else {
+        remove_stale_shards(output_filename, shards_count);
+        fprintf(stderr, "Converted %ld variables and %ld rows into %d files in %.2lf seconds\n",
+                var_count, rows_converted, shards_count,
+                (end_time.tv_sec + 1e-6 * end_time.tv_usec) -
+                (start_time.tv_sec + 1e-6 * start_time.tv_usec));
+    }
+
+cleanup:
+    for (i=0; i<shards_count; i++) {
+        free(sharding.shards[i].output_filename);
+    }
+    free(sharding.shards);
+
+    return failed;
 }
 
+
 static int dump_metadata(readstat_metadata_t *metadata, void *ctx) {
     printf("Columns: %d\n", readstat_get_var_count(metadata));
     printf("Rows: %d\n", readstat_get_row_count(metadata));
@@ -454,9 +1055,16 @@ int main(int argc, char** argv) {
     char *output_filename = NULL;
 
     rs_module_t *modules = NULL;
-    long modules_count = 2;
+    long modules_count = 4;
     long module_index = 0;
+    rs_mod_options_t options = { 0 };
     int force = 0;
+    int workers = 0;
+    int shards_count = 0;
+    const char *manifest_filename = NULL;
+    const char *batch_extension = NULL;
+    rs_batch_t batch = { 0 };
+    int ret = -1;
 
 #if HAVE_XLSXWRITER
     modules_count++;
@@ -466,6 +1074,8 @@ int main(int argc, char** argv) {
 
     modules[module_index++] = rs_mod_readstat;
     modules[module_index++] = rs_mod_csv;
+    modules[module_index++] = rs_mod_arrow;
+    modules[module_index++] = rs_mod_parquet;
 
 #if HAVE_XLSXWRITER
     modules[module_index++] = rs_mod_xlsx;
@@ -481,24 +1091,64 @@ int main(int argc, char** argv) {
     }
     if (argc > 1) {
         int argpos = 1;
-        if (strcmp(argv[argpos], "-f") == 0) {
-            force = 1;
-            argpos++;
+        int i, j;
+
+        /* --shards may follow the file names */
+        for (i=1, j=1; i<argc; i++) {
+            if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+                shards_count = atoi(argv[++i]);
+            } else {
+                argv[j++] = argv[i];
+            }
+        }
+        argc = j;
+
+        while (argpos < argc) {
+            if (strcmp(argv[argpos], "-f") == 0) {
+                force = 1;
+                argpos++;
+            } else if (strcmp(argv[argpos], "-b") == 0 && argpos + 1 < argc) {
+                options.batch_size = atol(argv[argpos+1]);
+                argpos += 2;
+            } else if (strcmp(argv[argpos], "-j") == 0 && argpos + 1 < argc) {
+                workers = atoi(argv[argpos+1]);
+                argpos += 2;
+            } else if (strcmp(argv[argpos], "-m") == 0 && argpos + 1 < argc) {
+                manifest_filename = argv[argpos+1];
+                argpos += 2;
+            } else if (strcmp(argv[argpos], "-t") == 0 && argpos + 1 < argc) {
+                batch_extension = argv[argpos+1];
+                argpos += 2;
+            } else {
+                break;
+            }
+        }
+        if (manifest_filename || batch_extension) {
+            batch.modules = modules;
+            batch.modules_count = modules_count;
+            batch.options = &options;
+            batch.force = force;
+            if (workers <= 0)
+                workers = rs_worker_pool_default_size();
         }
-        if (argpos + 1 == argc) {
+        if (manifest_filename && !batch_extension && argpos == argc) {
+            ret = batch_read_manifest(&batch, manifest_filename) == 0 ? convert_batch(&batch, workers) : 1;
+        } else if (batch_extension && !manifest_filename && argpos < argc) {
+            ret = batch_add_inputs(&batch, batch_extension, &argv[argpos], argc - argpos) == 0 ?
+                convert_batch(&batch, workers) : 1;
+        } else if (manifest_filename || batch_extension) {
+            /* Print usage */
+        } else if (argpos + 1 == argc) {
             if (can_read(argv[argpos])) {
                 input_filename = argv[argpos];
             }
         } else if (argpos + 2 == argc) {
-            if (can_read(argv[argpos]) && can_write(modules, modules_count, argv[argpos+1])) {
+            if (can_convert(modules, modules_count, argv[argpos], NULL, argv[argpos+1])) {
                 input_filename = argv[argpos];
                 output_filename = argv[argpos+1];
             }
         } else if (argpos + 3 == argc) {
-            if (can_write(modules, modules_count, argv[argpos+2]) &&
-                    (is_dictionary(argv[argpos+1]) ||
-                     (can_read(argv[argpos]) && 
-                      (is_json(argv[argpos+1]) || is_catalog(argv[argpos+1]))))) {
+            if (can_convert(modules, modules_count, argv[argpos], argv[argpos+1], argv[argpos+2])) {
                 input_filename = argv[argpos];
                 catalog_filename = argv[argpos+1];
                 output_filename = argv[argpos+2];
@@ -506,16 +1156,21 @@ int main(int argc, char** argv) {
         }
     }
 
-    int ret;
-    if (output_filename) {
+    if (ret != -1) {
+        /* Batch conversion */
+    } else if (output_filename && shards_count > 1) {
+        ret = convert_file_sharded(input_filename, catalog_filename, output_filename,
+                modules, modules_count, &options, force, shards_count, workers);
+    } else if (output_filename) {
         ret = convert_file(input_filename, catalog_filename, output_filename,
-                modules, modules_count, force);
+                modules, modules_count, &options, force);
     } else if (input_filename) {
         ret = dump_file(input_filename); 
     } else {
         print_usage(argv[0]);
         ret = 1;
     }
+    batch_free(&batch);
     free(modules);
     return ret;
 }
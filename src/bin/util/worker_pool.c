@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "worker_pool.h"
+
+typedef struct rs_worker_pool_s {
+    rs_worker_job_t     job;
+    void               *job_ctx;
+    long                count;
+    long                next;
+#if HAVE_PTHREAD
+    pthread_mutex_t     lock;
+#endif
+} rs_worker_pool_t;
+
+typedef struct rs_worker_s {
+    rs_worker_pool_t   *pool;
+    int                 index;
+} rs_worker_t;
+
+static long rs_worker_pool_next(rs_worker_pool_t *pool) {
+    long index;
+#if HAVE_PTHREAD
+    pthread_mutex_lock(&pool->lock);
+#endif
+    index = pool->next < pool->count ? pool->next++ : -1;
+#if HAVE_PTHREAD
+    pthread_mutex_unlock(&pool->lock);
+#endif
+    return index;
+}
+
+static void *rs_worker_run(void *arg) {
+    rs_worker_t *worker = (rs_worker_t *)arg;
+    rs_worker_pool_t *pool = worker->pool;
+    long index;
+
+    while ((index = rs_worker_pool_next(pool)) != -1) {
+        pool->job(pool->job_ctx, worker->index, index);
+    }
+    return NULL;
+}
+
+void rs_worker_pool_run(int workers, long count, rs_worker_job_t job, void *job_ctx) {
+    rs_worker_pool_t pool = { .job = job, .job_ctx = job_ctx, .count = count };
+    rs_worker_t worker_ctx[RS_WORKER_POOL_MAX_WORKERS];
+    int i;
+
+    if (count <= 0)
+        return;
+
+#if HAVE_PTHREAD
+    pthread_t threads[RS_WORKER_POOL_MAX_WORKERS];
+    int started[RS_WORKER_POOL_MAX_WORKERS];
+
+    if (workers > RS_WORKER_POOL_MAX_WORKERS)
+        workers = RS_WORKER_POOL_MAX_WORKERS;
+    if (workers > count)
+        workers = count;
+#else
+    workers = 1;
+#endif
+    if (workers < 1)
+        workers = 1;
+
+    for (i=0; i<workers; i++) {
+        worker_ctx[i].pool = &pool;
+        worker_ctx[i].index = i;
+    }
+
+#if HAVE_PTHREAD
+    pthread_mutex_init(&pool.lock, NULL);
+    for (i=1; i<workers; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, &rs_worker_run, &worker_ctx[i]) == 0);
+    }
+    rs_worker_run(&worker_ctx[0]);
+    for (i=1; i<workers; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+#else
+    rs_worker_run(&worker_ctx[0]);
+#endif
+}
+
+int rs_worker_pool_default_size(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > RS_WORKER_POOL_MAX_WORKERS)
+        return RS_WORKER_POOL_MAX_WORKERS;
+    if (count > 0)
+        return count;
+#endif
+    return 1;
+}
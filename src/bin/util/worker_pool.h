@@ -0,0 +1,17 @@
+#ifndef __WORKER_POOL_H
+#define __WORKER_POOL_H
+
+#define RS_WORKER_POOL_MAX_WORKERS  256
+
+typedef void (*rs_worker_job_t)(void *job_ctx, int worker, long index);
+
+/* Calls job(job_ctx, worker, i) for each i in [0, count) on up to
+ * `workers' threads, handing out indexes one at a time so that slow jobs
+ * don't hold up a fixed share of the work. Runs everything on the calling
+ * thread if the program was built without pthreads. */
+void rs_worker_pool_run(int workers, long count, rs_worker_job_t job, void *job_ctx);
+
+/* The number of online processors, or 1 if unknown */
+int rs_worker_pool_default_size(void);
+
+#endif
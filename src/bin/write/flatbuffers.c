@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "flatbuffers.h"
+
+static unsigned char *fb_reserve(fb_builder_t *b, size_t len) {
+    if (b->error)
+        return NULL;
+
+    if (b->used + len > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity : 1024;
+        unsigned char *bytes = NULL;
+        while (capacity < b->used + len)
+            capacity *= 2;
+        if ((bytes = realloc(b->bytes, capacity)) == NULL) {
+            b->error = 1;
+            return NULL;
+        }
+        b->bytes = bytes;
+        b->capacity = capacity;
+    }
+
+    unsigned char *dst = &b->bytes[b->used];
+    memset(dst, 0, len);
+    b->used += len;
+    return dst;
+}
+
+static void fb_put(unsigned char *dst, uint64_t value, int size) {
+    int i;
+    for (i=0; i<size; i++) {
+        dst[i] = (value >> (8*i)) & 0xFF;
+    }
+}
+
+/* Pads so that used + `skew' is a multiple of `alignment' */
+static void fb_align(fb_builder_t *b, size_t alignment, size_t skew) {
+    size_t misalignment = (b->used + skew) % alignment;
+    if (misalignment)
+        fb_reserve(b, alignment - misalignment);
+}
+
+void fb_pad(fb_builder_t *b, size_t alignment) {
+    fb_align(b, alignment, 0);
+}
+
+void fb_builder_reset(fb_builder_t *b) {
+    b->used = 0;
+    b->error = 0;
+}
+
+void fb_builder_free(fb_builder_t *b) {
+    free(b->bytes);
+    memset(b, 0, sizeof(fb_builder_t));
+}
+
+size_t fb_begin(fb_builder_t *b) {
+    fb_builder_reset(b);
+    fb_reserve(b, 4);
+    return 0;
+}
+
+void fb_table_scalar(fb_table_t *t, int field, int size, uint64_t value) {
+    if (field >= t->field_count)
+        t->field_count = field + 1;
+    t->size[field] = size;
+    t->value[field] = value;
+    t->is_offset[field] = 0;
+}
+
+void fb_table_offset(fb_table_t *t, int field) {
+    if (field >= t->field_count)
+        t->field_count = field + 1;
+    t->size[field] = 4;
+    t->value[field] = 0;
+    t->is_offset[field] = 1;
+}
+
+size_t fb_write_table(fb_builder_t *b, fb_table_t *t) {
+    uint16_t field_offsets[FB_MAX_FIELDS];
+    size_t vtable_len = 4 + 2 * t->field_count;
+    size_t vtable_pos, table_pos;
+    uint16_t table_len = 4;
+    int size, i, has_wide = 0;
+
+    /* Widest fields first so that each lands on its natural alignment */
+    for (size=8; size>=1; size/=2) {
+        for (i=0; i<t->field_count; i++) {
+            if (t->size[i] != size)
+                continue;
+            if (size == 8)
+                has_wide = 1;
+            field_offsets[i] = table_len;
+            table_len += size;
+        }
+    }
+    for (i=0; i<t->field_count; i++) {
+        if (t->size[i] == 0)
+            field_offsets[i] = 0;
+    }
+    if (has_wide && table_len % 8 == 4)
+        table_len += 4;
+
+    fb_align(b, 2, 0);
+    vtable_pos = b->used;
+    unsigned char *vtable = fb_reserve(b, vtable_len);
+    if (vtable == NULL)
+        return 0;
+
+    fb_put(&vtable[0], vtable_len, 2);
+    fb_put(&vtable[2], table_len, 2);
+    for (i=0; i<t->field_count; i++) {
+        fb_put(&vtable[4+2*i], field_offsets[i], 2);
+    }
+
+    fb_align(b, has_wide ? 8 : 4, has_wide ? 4 : 0);
+    table_pos = b->used;
+    unsigned char *table = fb_reserve(b, table_len);
+    if (table == NULL)
+        return 0;
+
+    fb_put(&table[0], table_pos - vtable_pos, 4);
+    for (i=0; i<t->field_count; i++) {
+        if (t->size[i] == 0)
+            continue;
+        t->slot[i] = table_pos + field_offsets[i];
+        if (!t->is_offset[i])
+            fb_put(&table[field_offsets[i]], t->value[i], t->size[i]);
+    }
+
+    return table_pos;
+}
+
+size_t fb_write_string(fb_builder_t *b, const char *string) {
+    size_t len = strlen(string);
+    fb_align(b, 4, 0);
+    size_t pos = b->used;
+    unsigned char *dst = fb_reserve(b, 4 + len + 1);
+    if (dst == NULL)
+        return 0;
+
+    fb_put(dst, len, 4);
+    memcpy(&dst[4], string, len);
+    return pos;
+}
+
+size_t fb_write_offset_vector(fb_builder_t *b, long count) {
+    fb_align(b, 4, 0);
+    size_t pos = b->used;
+    unsigned char *dst = fb_reserve(b, 4 + 4 * count);
+    if (dst == NULL)
+        return 0;
+
+    fb_put(dst, count, 4);
+    return pos;
+}
+
+size_t fb_write_struct_vector(fb_builder_t *b, const int64_t *words,
+        int words_per_struct, long count) {
+    long i;
+    fb_align(b, 8, 4);
+    size_t pos = b->used;
+    unsigned char *dst = fb_reserve(b, 4 + 8 * words_per_struct * count);
+    if (dst == NULL)
+        return 0;
+
+    fb_put(dst, count, 4);
+    for (i=0; i<words_per_struct * count; i++) {
+        fb_put(&dst[4+8*i], (uint64_t)words[i], 8);
+    }
+    return pos;
+}
+
+void fb_patch(fb_builder_t *b, size_t slot, size_t target) {
+    if (b->error)
+        return;
+    fb_put(&b->bytes[slot], target - slot, 4);
+}
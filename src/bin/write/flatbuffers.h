@@ -0,0 +1,53 @@
+//
+//  flatbuffers.h - A minimal FlatBuffers builder for the Arrow IPC writer
+//
+//  Objects are laid out front to back: a table reserves 4-byte slots for
+//  its offset fields, and each child written afterwards is linked to its
+//  slot with fb_patch(). Everything is little-endian and aligned to the
+//  natural size of its scalars.
+//
+
+#define FB_MAX_FIELDS  8
+
+typedef struct fb_builder_s {
+    unsigned char  *bytes;
+    size_t          used;
+    size_t          capacity;
+    int             error;
+} fb_builder_t;
+
+typedef struct fb_table_s {
+    int         field_count;
+    int         size[FB_MAX_FIELDS];
+    uint64_t    value[FB_MAX_FIELDS];
+    int         is_offset[FB_MAX_FIELDS];
+    size_t      slot[FB_MAX_FIELDS];
+} fb_table_t;
+
+void fb_builder_reset(fb_builder_t *b);
+void fb_builder_free(fb_builder_t *b);
+
+/* Reserves the root offset; returns its slot */
+size_t fb_begin(fb_builder_t *b);
+
+/* Declares field `field' of a table as a scalar of `size' bytes, or as an
+ * offset to be patched once the child is written */
+void fb_table_scalar(fb_table_t *t, int field, int size, uint64_t value);
+void fb_table_offset(fb_table_t *t, int field);
+
+/* Writes a table and its vtable, filling in t->slot for offset fields;
+ * returns the table's position */
+size_t fb_write_table(fb_builder_t *b, fb_table_t *t);
+size_t fb_write_string(fb_builder_t *b, const char *string);
+
+/* A vector of `count' offsets; the slot of element i is at pos + 4 + 4*i */
+size_t fb_write_offset_vector(fb_builder_t *b, long count);
+
+/* A vector of `count' structs made of `words_per_struct' 64-bit words */
+size_t fb_write_struct_vector(fb_builder_t *b, const int64_t *words,
+        int words_per_struct, long count);
+
+void fb_patch(fb_builder_t *b, size_t slot, size_t target);
+
+/* Zero-pads the buffer to a multiple of `alignment' */
+void fb_pad(fb_builder_t *b, size_t alignment);
@@ -0,0 +1,292 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "format_double.h"
+
+/* Shortest round-trip formatting after Loitsch's Grisu2 ("Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010).
+ * The output always reads back as the same value; in rare cases it is one
+ * digit longer than the shortest possible. */
+
+typedef struct diyfp_s {
+    uint64_t f;
+    int      e;
+} diyfp_t;
+
+/* 10^k for k = -348, -340, ..., 340, as normalized 64-bit significands
+ * and binary exponents */
+static const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+    -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369,
+    -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77,
+    -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216,
+    242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508,
+    534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800,
+    827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t pow10_table[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static diyfp_t diyfp_mul(diyfp_t x, diyfp_t y) {
+    const uint64_t M32 = 0xFFFFFFFFULL;
+    uint64_t a = x.f >> 32, b = x.f & M32;
+    uint64_t c = y.f >> 32, d = y.f & M32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += 1ULL << 31; /* round */
+    diyfp_t r = { ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64 };
+    return r;
+}
+
+static diyfp_t diyfp_normalize(diyfp_t x) {
+    while (!(x.f & (1ULL << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+static diyfp_t cached_power(int e, int *K) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+
+    unsigned int index = (unsigned int)((k >> 3) + 1);
+    *K = -(-348 + (int)(index << 3));
+
+    diyfp_t r = { cached_powers_f[index], cached_powers_e[index] };
+    return r;
+}
+
+static int count_digits(uint32_t n) {
+    int digits = 1;
+    while (digits < 10 && n >= pow10_table[digits])
+        digits++;
+    return digits;
+}
+
+static void grisu_round(char *buffer, int len, uint64_t delta, uint64_t rest,
+        uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+            (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int digit_gen(diyfp_t W, diyfp_t Mp, uint64_t delta, char *buffer, int *K) {
+    const diyfp_t one = { 1ULL << -Mp.e, Mp.e };
+    const uint64_t wp_w = Mp.f - W.f;
+    uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+    uint64_t p2 = Mp.f & (one.f - 1);
+    int kappa = count_digits(p1);
+    int len = 0;
+
+    while (kappa > 0) {
+        uint32_t d = p1 / pow10_table[kappa-1];
+        p1 %= pow10_table[kappa-1];
+        if (d || len)
+            buffer[len++] = '0' + d;
+        kappa--;
+
+        uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+        if (tmp <= delta) {
+            *K += kappa;
+            grisu_round(buffer, len, delta, tmp, pow10_table[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+
+    while (1) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || len)
+            buffer[len++] = '0' + d;
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            int index = -kappa;
+            *K += kappa;
+            grisu_round(buffer, len, delta, p2, one.f, wp_w * (index < 20 ? pow10_table[index] : 0));
+            return len;
+        }
+    }
+}
+
+/* Writes the digits of f * 2^e to `buffer' and returns how many there are;
+ * the value is then digits * 10^K. `hidden_bit' is the implicit leading bit
+ * of the source format. */
+static int grisu2(uint64_t f, int e, uint64_t hidden_bit, char *buffer, int *K) {
+    diyfp_t v = { f, e };
+    diyfp_t pl = { (f << 1) + 1, e - 1 };
+    diyfp_t mi;
+
+    pl = diyfp_normalize(pl);
+    if (f == hidden_bit) {
+        mi.f = (f << 2) - 1;
+        mi.e = e - 2;
+    } else {
+        mi.f = (f << 1) - 1;
+        mi.e = e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    diyfp_t c_mk = cached_power(pl.e, K);
+    diyfp_t W = diyfp_mul(diyfp_normalize(v), c_mk);
+    diyfp_t Wp = diyfp_mul(pl, c_mk);
+    diyfp_t Wm = diyfp_mul(mi, c_mk);
+    Wm.f++;
+    Wp.f--;
+
+    return digit_gen(W, Wp, Wp.f - Wm.f, buffer, K);
+}
+
+static char *write_exponent(int K, char *buffer) {
+    *buffer++ = 'e';
+    if (K < 0) {
+        *buffer++ = '-';
+        K = -K;
+    } else {
+        *buffer++ = '+';
+    }
+
+    if (K >= 100) {
+        *buffer++ = '0' + K / 100;
+        K %= 100;
+    }
+    *buffer++ = '0' + K / 10;
+    *buffer++ = '0' + K % 10;
+
+    return buffer;
+}
+
+/* Lays out `len' digits worth digits * 10^k: plain notation for magnitudes
+ * in [1e-6, 1e21), exponent notation otherwise */
+static char *prettify(char *buffer, int len, int k) {
+    const int kk = len + k;
+    int i;
+
+    if (0 <= k && kk <= 21) {
+        for (i=len; i<kk; i++)
+            buffer[i] = '0';
+        return &buffer[kk];
+    }
+    if (0 < kk && kk <= 21) {
+        memmove(&buffer[kk + 1], &buffer[kk], len - kk);
+        buffer[kk] = '.';
+        return &buffer[len + 1];
+    }
+    if (-6 < kk && kk <= 0) {
+        const int offset = 2 - kk;
+        memmove(&buffer[offset], &buffer[0], len);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        for (i=2; i<offset; i++)
+            buffer[i] = '0';
+        return &buffer[len + offset];
+    }
+    if (len == 1) {
+        return write_exponent(kk - 1, &buffer[1]);
+    }
+    memmove(&buffer[2], &buffer[1], len - 1);
+    buffer[1] = '.';
+    return write_exponent(kk - 1, &buffer[len + 1]);
+}
+
+static int format_special(double value, char *buf) {
+    const char *s = "inf";
+    if (isnan(value)) {
+        s = "nan";
+    } else if (value < 0) {
+        s = "-inf";
+    }
+    strcpy(buf, s);
+    return strlen(s);
+}
+
+static int format_finite(uint64_t bits, int mantissa_bits, int exponent_bits, char *buf) {
+    uint64_t sign_bit = 1ULL << (mantissa_bits + exponent_bits);
+    int exponent_bias = (1 << (exponent_bits - 1)) - 1;
+    uint64_t hidden_bit = 1ULL << mantissa_bits;
+    char *p = buf;
+    int K = 0, len, e;
+
+    if (bits & sign_bit) {
+        *p++ = '-';
+        bits &= ~sign_bit;
+    }
+
+    if (bits == 0) {
+        *p++ = '0';
+        *p = '\0';
+        return p - buf;
+    }
+
+    uint64_t f = bits & (hidden_bit - 1);
+    int biased_e = (int)(bits >> mantissa_bits);
+    if (biased_e) {
+        f += hidden_bit;
+        e = biased_e - exponent_bias - mantissa_bits;
+    } else {
+        e = 1 - exponent_bias - mantissa_bits;
+    }
+
+    len = grisu2(f, e, hidden_bit, p, &K);
+    p = prettify(p, len, K);
+    *p = '\0';
+
+    return p - buf;
+}
+
+int format_double(double value, char *buf) {
+    uint64_t bits;
+    if (!isfinite(value))
+        return format_special(value, buf);
+
+    memcpy(&bits, &value, sizeof(double));
+    return format_finite(bits, 52, 11, buf);
+}
+
+int format_float(float value, char *buf) {
+    uint32_t bits;
+    if (!isfinite(value))
+        return format_special(value, buf);
+
+    memcpy(&bits, &value, sizeof(float));
+    return format_finite(bits, 23, 8, buf);
+}
@@ -0,0 +1,13 @@
+#ifndef __FORMAT_DOUBLE_H
+#define __FORMAT_DOUBLE_H
+
+/* Room for a sign, 17 digits, a decimal point, padding zeros or an
+ * exponent, and the terminating NUL */
+#define FORMAT_DOUBLE_BUFFER_LEN 32
+
+/* Writes the shortest string that reads back as exactly `value', and
+ * returns its length. */
+int format_double(double value, char *buf);
+int format_float(float value, char *buf);
+
+#endif
@@ -0,0 +1,930 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../readstat.h"
+#include "../../CKHashTable.h"
+#include "module_util.h"
+#include "module.h"
+#include "flatbuffers.h"
+#include "format_double.h"
+
+/* Writes the Arrow IPC file format (a.k.a. Feather V2), uncompressed.
+ * Labelled variables become dictionary-encoded UTF-8 columns whose entries
+ * are the value labels, followed by the plain values of anything unlabelled;
+ * entries first seen after the initial dictionary are sent as deltas. */
+
+#define ARROW_DEFAULT_BATCH_SIZE    65536
+#define ARROW_ALIGNMENT             8
+
+#define ARROW_METADATA_V5           4
+
+#define ARROW_HEADER_SCHEMA         1
+#define ARROW_HEADER_DICTIONARY     2
+#define ARROW_HEADER_RECORD_BATCH   3
+
+#define ARROW_TYPE_INT              2
+#define ARROW_TYPE_FLOATING_POINT   3
+#define ARROW_TYPE_UTF8             5
+
+#define ARROW_PRECISION_SINGLE      1
+#define ARROW_PRECISION_DOUBLE      2
+
+static const char arrow_magic[8] = "ARROW1\0";
+
+typedef struct arrow_buffer_s {
+    unsigned char  *bytes;
+    size_t          used;
+    size_t          capacity;
+} arrow_buffer_t;
+
+typedef struct arrow_label_set_s {
+    ck_hash_table_t    *numeric_labels;
+    ck_hash_table_t    *string_labels;
+    char              **labels;
+    long                labels_count;
+    long                labels_capacity;
+} arrow_label_set_t;
+
+typedef struct arrow_dictionary_s {
+    ck_hash_table_t    *index;
+    char              **entries;
+    long                entries_count;
+    long                entries_capacity;
+    long                written_count;
+    long                empty_entry;
+    int                 written;
+} arrow_dictionary_t;
+
+typedef struct arrow_column_s {
+    char               *name;
+    char               *label;
+    char               *val_labels;
+    readstat_type_t     type;
+    arrow_label_set_t  *label_set;
+    arrow_dictionary_t *dictionary;
+    arrow_buffer_t      validity;
+    arrow_buffer_t      offsets;
+    arrow_buffer_t      data;
+    long                null_count;
+} arrow_column_t;
+
+/* A buffer of a message body */
+typedef struct arrow_part_s {
+    const void     *bytes;
+    size_t          len;
+} arrow_part_t;
+
+/* Footer blocks: offset, metadata length, body length */
+typedef struct arrow_blocks_s {
+    int64_t        *words;
+    long            count;
+    long            capacity;
+} arrow_blocks_t;
+
+typedef struct mod_arrow_ctx_s {
+    FILE               *out_file;
+    int64_t             offset;
+    long                batch_size;
+    long                var_count;
+    char               *file_label;
+
+    arrow_column_t     *columns;
+    long                columns_count;
+
+    ck_hash_table_t    *label_set_dict;
+    arrow_label_set_t **label_sets;
+    long                label_sets_count;
+    long                label_sets_capacity;
+
+    long                rows_in_batch;
+    int                 started;
+    int                 error;
+
+    fb_builder_t        builder;
+    arrow_buffer_t      scratch_offsets;
+    arrow_buffer_t      scratch_data;
+    arrow_blocks_t      dictionary_blocks;
+    arrow_blocks_t      record_blocks;
+} mod_arrow_ctx_t;
+
+static int accept_file(const char *filename);
+static void *ctx_init(const char *filename, const rs_mod_options_t *options);
+static readstat_error_t finish_file(void *ctx);
+static int handle_metadata(readstat_metadata_t *metadata, void *ctx);
+static int handle_value_label(const char *val_labels, readstat_value_t value,
+                              const char *label, void *ctx);
+static int handle_variable(int index, readstat_variable_t *variable,
+                           const char *val_labels, void *ctx);
+static int handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx);
+
+rs_module_t rs_mod_arrow = {
+    .accept = accept_file,
+    .init = ctx_init,
+    .finish = finish_file,
+    .handle = {
+        .metadata = handle_metadata,
+        .value_label = handle_value_label,
+        .variable = handle_variable,
+        .value = handle_value
+    }
+};
+
+static int machine_is_little_endian() {
+    int test_byte_order = 1;
+    return ((char *)&test_byte_order)[0];
+}
+
+static char *arrow_strdup(const char *string) {
+    size_t len = strlen(string) + 1;
+    char *copy = malloc(len);
+    if (copy)
+        memcpy(copy, string, len);
+    return copy;
+}
+
+static void *arrow_grow(void *array, long *capacity, long needed, size_t elem_size) {
+    if (needed <= *capacity)
+        return array;
+
+    long new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    void *new_array = realloc(array, new_capacity * elem_size);
+    if (new_array)
+        *capacity = new_capacity;
+    return new_array;
+}
+
+static int arrow_buffer_append(arrow_buffer_t *buffer, const void *bytes, size_t len) {
+    if (len == 0)
+        return 0;
+    if (buffer->used + len > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+        unsigned char *new_bytes = NULL;
+        while (capacity < buffer->used + len)
+            capacity *= 2;
+        if ((new_bytes = realloc(buffer->bytes, capacity)) == NULL)
+            return -1;
+        buffer->bytes = new_bytes;
+        buffer->capacity = capacity;
+    }
+    memcpy(&buffer->bytes[buffer->used], bytes, len);
+    buffer->used += len;
+    return 0;
+}
+
+static void arrow_buffer_free(arrow_buffer_t *buffer) {
+    free(buffer->bytes);
+    memset(buffer, 0, sizeof(arrow_buffer_t));
+}
+
+static int arrow_blocks_append(arrow_blocks_t *blocks, int64_t offset, int64_t metadata_len, int64_t body_len) {
+    int64_t *words = arrow_grow(blocks->words, &blocks->capacity, 3 * (blocks->count + 1), sizeof(int64_t));
+    if (words == NULL)
+        return -1;
+    blocks->words = words;
+    words[3*blocks->count+0] = offset;
+    words[3*blocks->count+1] = metadata_len;
+    words[3*blocks->count+2] = body_len;
+    blocks->count++;
+    return 0;
+}
+
+static size_t arrow_type_width(readstat_type_t type) {
+    if (type == READSTAT_TYPE_INT8)
+        return 1;
+    if (type == READSTAT_TYPE_INT16)
+        return 2;
+    if (type == READSTAT_TYPE_INT32 || type == READSTAT_TYPE_FLOAT)
+        return 4;
+    if (type == READSTAT_TYPE_DOUBLE)
+        return 8;
+    return 0;
+}
+
+static arrow_label_set_t *arrow_label_set_init() {
+    arrow_label_set_t *label_set = calloc(1, sizeof(arrow_label_set_t));
+    label_set->numeric_labels = ck_hash_table_init(64);
+    label_set->string_labels = ck_hash_table_init(64);
+    return label_set;
+}
+
+static void arrow_label_set_free(arrow_label_set_t *label_set) {
+    long i;
+    for (i=0; i<label_set->labels_count; i++) {
+        free(label_set->labels[i]);
+    }
+    free(label_set->labels);
+    ck_hash_table_free(label_set->numeric_labels);
+    ck_hash_table_free(label_set->string_labels);
+    free(label_set);
+}
+
+static arrow_dictionary_t *arrow_dictionary_init() {
+    arrow_dictionary_t *dictionary = calloc(1, sizeof(arrow_dictionary_t));
+    dictionary->index = ck_hash_table_init(64);
+    return dictionary;
+}
+
+static void arrow_dictionary_free(arrow_dictionary_t *dictionary) {
+    long i;
+    for (i=0; i<dictionary->entries_count; i++) {
+        free(dictionary->entries[i]);
+    }
+    free(dictionary->entries);
+    ck_hash_table_free(dictionary->index);
+    free(dictionary);
+}
+
+/* Returns the index of `entry', adding it if needed, or -1 on allocation failure */
+static long arrow_dictionary_index(arrow_dictionary_t *dictionary, const char *entry) {
+    const void *found = NULL;
+    long i;
+
+    if (entry[0] == '\0') {
+        if (dictionary->empty_entry)
+            return dictionary->empty_entry - 1;
+    } else if ((found = ck_str_hash_lookup(entry, dictionary->index))) {
+        return (intptr_t)found - 1;
+    }
+
+    char **entries = arrow_grow(dictionary->entries, &dictionary->entries_capacity,
+            dictionary->entries_count + 1, sizeof(char *));
+    if (entries == NULL)
+        return -1;
+    dictionary->entries = entries;
+
+    i = dictionary->entries_count;
+    if ((entries[i] = arrow_strdup(entry)) == NULL)
+        return -1;
+    dictionary->entries_count++;
+
+    if (entry[0] == '\0') {
+        dictionary->empty_entry = i + 1;
+    } else {
+        ck_str_hash_insert(entry, (const void *)(intptr_t)(i + 1), dictionary->index);
+    }
+
+    return i;
+}
+
+static int accept_file(const char *filename) {
+    return rs_ends_with(filename, ".arrow") || rs_ends_with(filename, ".feather");
+}
+
+static void *ctx_init(const char *filename, const rs_mod_options_t *options) {
+    mod_arrow_ctx_t *mod_ctx = calloc(1, sizeof(mod_arrow_ctx_t));
+    mod_ctx->out_file = fopen(filename, "wb");
+    if (mod_ctx->out_file == NULL) {
+        fprintf(stderr, "Error opening %s for writing: %s\n", filename, strerror(errno));
+        free(mod_ctx);
+        return NULL;
+    }
+    mod_ctx->batch_size = ARROW_DEFAULT_BATCH_SIZE;
+    if (options && options->batch_size > 0)
+        mod_ctx->batch_size = options->batch_size;
+    mod_ctx->label_set_dict = ck_hash_table_init(1024);
+    return mod_ctx;
+}
+
+static void arrow_write(mod_arrow_ctx_t *mod_ctx, const void *bytes, size_t len) {
+    if (mod_ctx->error || len == 0)
+        return;
+    if (fwrite(bytes, len, 1, mod_ctx->out_file) != 1) {
+        fprintf(stderr, "Error writing Arrow data: %s\n", strerror(errno));
+        mod_ctx->error = 1;
+        return;
+    }
+    mod_ctx->offset += len;
+}
+
+static void arrow_write_padding(mod_arrow_ctx_t *mod_ctx) {
+    static const char zeros[ARROW_ALIGNMENT] = { 0 };
+    size_t misalignment = mod_ctx->offset % ARROW_ALIGNMENT;
+    if (misalignment)
+        arrow_write(mod_ctx, zeros, ARROW_ALIGNMENT - misalignment);
+}
+
+static void arrow_write_int32(mod_arrow_ctx_t *mod_ctx, uint32_t value) {
+    unsigned char bytes[4] = {
+        value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF };
+    arrow_write(mod_ctx, bytes, sizeof(bytes));
+}
+
+static size_t arrow_padded_len(size_t len) {
+    return (len + ARROW_ALIGNMENT - 1) / ARROW_ALIGNMENT * ARROW_ALIGNMENT;
+}
+
+/* Fills in one Buffer struct (offset, length) per part; returns the body length */
+static int64_t arrow_body_layout(const arrow_part_t *parts, int parts_count, int64_t *words) {
+    int64_t offset = 0;
+    int i;
+    for (i=0; i<parts_count; i++) {
+        words[2*i+0] = offset;
+        words[2*i+1] = parts[i].len;
+        offset += arrow_padded_len(parts[i].len);
+    }
+    return offset;
+}
+
+/* Writes the encapsulated message in mod_ctx->builder followed by its body,
+ * and records its block in `blocks' if given */
+static void arrow_write_message(mod_arrow_ctx_t *mod_ctx, const arrow_part_t *parts, int parts_count,
+        arrow_blocks_t *blocks) {
+    fb_builder_t *b = &mod_ctx->builder;
+    int64_t offset = mod_ctx->offset;
+    int64_t body_len = 0;
+    int i;
+
+    if (b->error) {
+        fprintf(stderr, "Error building Arrow metadata: %s\n", strerror(ENOMEM));
+        mod_ctx->error = 1;
+        return;
+    }
+
+    /* The prefix and metadata together keep the body 8-byte aligned */
+    fb_pad(b, ARROW_ALIGNMENT);
+    arrow_write_int32(mod_ctx, 0xFFFFFFFF);
+    arrow_write_int32(mod_ctx, b->used);
+    arrow_write(mod_ctx, b->bytes, b->used);
+
+    for (i=0; i<parts_count; i++) {
+        arrow_write(mod_ctx, parts[i].bytes, parts[i].len);
+        arrow_write_padding(mod_ctx);
+        body_len += arrow_padded_len(parts[i].len);
+    }
+
+    if (blocks && !mod_ctx->error && arrow_blocks_append(blocks, offset, 8 + b->used, body_len) != 0) {
+        fprintf(stderr, "Error building Arrow footer: %s\n", strerror(ENOMEM));
+        mod_ctx->error = 1;
+    }
+}
+
+/* Builds a Message table and returns the slot for its header */
+static size_t arrow_begin_message(fb_builder_t *b, int header_type, int64_t body_len) {
+    fb_table_t message = { 0 };
+    size_t root = fb_begin(b);
+
+    fb_table_scalar(&message, 0, 2, ARROW_METADATA_V5);
+    fb_table_scalar(&message, 1, 1, header_type);
+    fb_table_offset(&message, 2);
+    fb_table_scalar(&message, 3, 8, body_len);
+
+    fb_patch(b, root, fb_write_table(b, &message));
+    return message.slot[2];
+}
+
+static void arrow_write_int_type(fb_builder_t *b, size_t slot, int bit_width) {
+    fb_table_t int_type = { 0 };
+    fb_table_scalar(&int_type, 0, 4, bit_width);
+    fb_table_scalar(&int_type, 1, 1, 1);
+    fb_patch(b, slot, fb_write_table(b, &int_type));
+}
+
+static void arrow_write_key_values(fb_builder_t *b, size_t slot, const char **keys, const char **values, int count) {
+    size_t vector = fb_write_offset_vector(b, count);
+    int i;
+    fb_patch(b, slot, vector);
+    for (i=0; i<count; i++) {
+        fb_table_t key_value = { 0 };
+        fb_table_offset(&key_value, 0);
+        fb_table_offset(&key_value, 1);
+        fb_patch(b, vector + 4 + 4 * i, fb_write_table(b, &key_value));
+        fb_patch(b, key_value.slot[0], fb_write_string(b, keys[i]));
+        fb_patch(b, key_value.slot[1], fb_write_string(b, values[i]));
+    }
+}
+
+static void arrow_write_field(mod_arrow_ctx_t *mod_ctx, size_t slot, long index) {
+    fb_builder_t *b = &mod_ctx->builder;
+    arrow_column_t *column = &mod_ctx->columns[index];
+    fb_table_t field = { 0 };
+    fb_table_t type = { 0 };
+    int type_type = ARROW_TYPE_UTF8;
+    int has_label = (column->label && column->label[0]);
+
+    if (column->dictionary == NULL) {
+        if (column->type == READSTAT_TYPE_FLOAT) {
+            type_type = ARROW_TYPE_FLOATING_POINT;
+            fb_table_scalar(&type, 0, 2, ARROW_PRECISION_SINGLE);
+        } else if (column->type == READSTAT_TYPE_DOUBLE) {
+            type_type = ARROW_TYPE_FLOATING_POINT;
+            fb_table_scalar(&type, 0, 2, ARROW_PRECISION_DOUBLE);
+        } else if (column->type != READSTAT_TYPE_STRING) {
+            type_type = ARROW_TYPE_INT;
+        }
+    }
+
+    fb_table_offset(&field, 0);
+    fb_table_scalar(&field, 1, 1, 1);
+    fb_table_scalar(&field, 2, 1, type_type);
+    fb_table_offset(&field, 3);
+    if (column->dictionary)
+        fb_table_offset(&field, 4);
+    fb_table_offset(&field, 5);
+    if (has_label)
+        fb_table_offset(&field, 6);
+
+    fb_patch(b, slot, fb_write_table(b, &field));
+    fb_patch(b, field.slot[0], fb_write_string(b, column->name ? column->name : ""));
+
+    if (type_type == ARROW_TYPE_INT) {
+        arrow_write_int_type(b, field.slot[3], 8 * arrow_type_width(column->type));
+    } else {
+        fb_patch(b, field.slot[3], fb_write_table(b, &type));
+    }
+
+    if (column->dictionary) {
+        fb_table_t encoding = { 0 };
+        fb_table_scalar(&encoding, 0, 8, index);
+        fb_table_offset(&encoding, 1);
+        fb_table_scalar(&encoding, 2, 1, 0);
+        fb_patch(b, field.slot[4], fb_write_table(b, &encoding));
+        arrow_write_int_type(b, encoding.slot[1], 32);
+    }
+
+    fb_patch(b, field.slot[5], fb_write_offset_vector(b, 0));
+
+    if (has_label) {
+        const char *key = "label";
+        const char *value = column->label;
+        arrow_write_key_values(b, field.slot[6], &key, &value, 1);
+    }
+}
+
+static void arrow_write_schema(mod_arrow_ctx_t *mod_ctx, size_t slot) {
+    fb_builder_t *b = &mod_ctx->builder;
+    fb_table_t schema = { 0 };
+    int has_label = (mod_ctx->file_label && mod_ctx->file_label[0]);
+    size_t fields;
+    long i;
+
+    fb_table_scalar(&schema, 0, 2, machine_is_little_endian() ? 0 : 1);
+    fb_table_offset(&schema, 1);
+    if (has_label)
+        fb_table_offset(&schema, 2);
+
+    fb_patch(b, slot, fb_write_table(b, &schema));
+
+    fields = fb_write_offset_vector(b, mod_ctx->columns_count);
+    fb_patch(b, schema.slot[1], fields);
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        arrow_write_field(mod_ctx, fields + 4 + 4 * i, i);
+    }
+
+    if (has_label) {
+        const char *key = "file_label";
+        const char *value = mod_ctx->file_label;
+        arrow_write_key_values(b, schema.slot[2], &key, &value, 1);
+    }
+}
+
+/* Builds a RecordBatch table with one FieldNode per (length, null count) pair */
+static void arrow_write_record_batch(fb_builder_t *b, size_t slot, long length,
+        const int64_t *nodes, long nodes_count, const int64_t *buffers, long buffers_count) {
+    fb_table_t record_batch = { 0 };
+
+    fb_table_scalar(&record_batch, 0, 8, length);
+    fb_table_offset(&record_batch, 1);
+    fb_table_offset(&record_batch, 2);
+
+    fb_patch(b, slot, fb_write_table(b, &record_batch));
+    fb_patch(b, record_batch.slot[1], fb_write_struct_vector(b, nodes, 2, nodes_count));
+    fb_patch(b, record_batch.slot[2], fb_write_struct_vector(b, buffers, 2, buffers_count));
+}
+
+static void arrow_write_dictionary(mod_arrow_ctx_t *mod_ctx, long index) {
+    arrow_dictionary_t *dictionary = mod_ctx->columns[index].dictionary;
+    arrow_buffer_t *offsets = &mod_ctx->scratch_offsets;
+    arrow_buffer_t *data = &mod_ctx->scratch_data;
+    long count = dictionary->entries_count - dictionary->written_count;
+    int32_t offset = 0;
+    long i;
+
+    offsets->used = 0;
+    data->used = 0;
+    if (arrow_buffer_append(offsets, &offset, sizeof(int32_t)) != 0)
+        goto malloc_error;
+    for (i=dictionary->written_count; i<dictionary->entries_count; i++) {
+        const char *entry = dictionary->entries[i];
+        size_t len = strlen(entry);
+        if (arrow_buffer_append(data, entry, len) != 0)
+            goto malloc_error;
+        offset = data->used;
+        if (arrow_buffer_append(offsets, &offset, sizeof(int32_t)) != 0)
+            goto malloc_error;
+    }
+
+    arrow_part_t parts[3] = {
+        { .bytes = NULL, .len = 0 },
+        { .bytes = offsets->bytes, .len = offsets->used },
+        { .bytes = data->bytes, .len = data->used }
+    };
+    int64_t buffers[6];
+    int64_t nodes[2] = { count, 0 };
+    int64_t body_len = arrow_body_layout(parts, 3, buffers);
+
+    fb_builder_t *b = &mod_ctx->builder;
+    fb_table_t dictionary_batch = { 0 };
+    size_t header = arrow_begin_message(b, ARROW_HEADER_DICTIONARY, body_len);
+
+    fb_table_scalar(&dictionary_batch, 0, 8, index);
+    fb_table_offset(&dictionary_batch, 1);
+    fb_table_scalar(&dictionary_batch, 2, 1, dictionary->written);
+    fb_patch(b, header, fb_write_table(b, &dictionary_batch));
+    arrow_write_record_batch(b, dictionary_batch.slot[1], count, nodes, 1, buffers, 3);
+
+    arrow_write_message(mod_ctx, parts, 3, &mod_ctx->dictionary_blocks);
+
+    dictionary->written_count = dictionary->entries_count;
+    dictionary->written = 1;
+    return;
+
+malloc_error:
+    fprintf(stderr, "Error building Arrow dictionary: %s\n", strerror(ENOMEM));
+    mod_ctx->error = 1;
+}
+
+static void arrow_write_dictionaries(mod_arrow_ctx_t *mod_ctx) {
+    long i;
+    for (i=0; i<mod_ctx->columns_count && !mod_ctx->error; i++) {
+        arrow_dictionary_t *dictionary = mod_ctx->columns[i].dictionary;
+        if (dictionary && (!dictionary->written || dictionary->written_count < dictionary->entries_count))
+            arrow_write_dictionary(mod_ctx, i);
+    }
+}
+
+static void arrow_reset_batch(mod_arrow_ctx_t *mod_ctx) {
+    long i;
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        arrow_column_t *column = &mod_ctx->columns[i];
+        memset(column->validity.bytes, 0, column->validity.used);
+        column->offsets.used = sizeof(int32_t);
+        column->data.used = 0;
+        column->null_count = 0;
+    }
+    mod_ctx->rows_in_batch = 0;
+}
+
+static void arrow_write_batch(mod_arrow_ctx_t *mod_ctx) {
+    long columns_count = mod_ctx->columns_count;
+    long rows = mod_ctx->rows_in_batch;
+    arrow_part_t *parts = calloc(3 * columns_count, sizeof(arrow_part_t));
+    int64_t *buffers = calloc(6 * columns_count, sizeof(int64_t));
+    int64_t *nodes = calloc(2 * columns_count, sizeof(int64_t));
+    int parts_count = 0;
+    long i;
+
+    if (parts == NULL || buffers == NULL || nodes == NULL) {
+        fprintf(stderr, "Error building Arrow record batch: %s\n", strerror(ENOMEM));
+        mod_ctx->error = 1;
+        goto cleanup;
+    }
+
+    arrow_write_dictionaries(mod_ctx);
+
+    for (i=0; i<columns_count; i++) {
+        arrow_column_t *column = &mod_ctx->columns[i];
+        nodes[2*i+0] = rows;
+        nodes[2*i+1] = column->null_count;
+
+        parts[parts_count].bytes = column->validity.bytes;
+        parts[parts_count].len = column->null_count ? (rows + 7) / 8 : 0;
+        parts_count++;
+
+        if (column->dictionary == NULL && column->type == READSTAT_TYPE_STRING) {
+            parts[parts_count].bytes = column->offsets.bytes;
+            parts[parts_count].len = column->offsets.used;
+            parts_count++;
+        }
+
+        parts[parts_count].bytes = column->data.bytes;
+        parts[parts_count].len = column->data.used;
+        parts_count++;
+    }
+
+    int64_t body_len = arrow_body_layout(parts, parts_count, buffers);
+    size_t header = arrow_begin_message(&mod_ctx->builder, ARROW_HEADER_RECORD_BATCH, body_len);
+    arrow_write_record_batch(&mod_ctx->builder, header, rows, nodes, columns_count, buffers, parts_count);
+    arrow_write_message(mod_ctx, parts, parts_count, &mod_ctx->record_blocks);
+
+cleanup:
+    free(parts);
+    free(buffers);
+    free(nodes);
+
+    arrow_reset_batch(mod_ctx);
+}
+
+static int arrow_begin(mod_arrow_ctx_t *mod_ctx) {
+    long i;
+
+    mod_ctx->started = 1;
+
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        arrow_column_t *column = &mod_ctx->columns[i];
+        size_t width = column->type == READSTAT_TYPE_STRING ? 0 : arrow_type_width(column->type);
+        int32_t zero = 0;
+
+        if (column->val_labels) {
+            column->label_set = (arrow_label_set_t *)ck_str_hash_lookup(column->val_labels, mod_ctx->label_set_dict);
+        }
+        if (column->label_set) {
+            long j;
+            column->dictionary = arrow_dictionary_init();
+            for (j=0; j<column->label_set->labels_count; j++) {
+                if (arrow_dictionary_index(column->dictionary, column->label_set->labels[j]) == -1)
+                    goto malloc_error;
+            }
+            width = sizeof(int32_t);
+        }
+
+        column->validity.bytes = calloc((mod_ctx->batch_size + 7) / 8, 1);
+        column->validity.used = column->validity.capacity = (mod_ctx->batch_size + 7) / 8;
+        if (column->validity.bytes == NULL)
+            goto malloc_error;
+
+        if (width && (column->data.bytes = malloc(width * mod_ctx->batch_size)) == NULL)
+            goto malloc_error;
+        column->data.capacity = width * mod_ctx->batch_size;
+
+        if (arrow_buffer_append(&column->offsets, &zero, sizeof(int32_t)) != 0)
+            goto malloc_error;
+    }
+
+    arrow_write(mod_ctx, arrow_magic, sizeof(arrow_magic));
+
+    arrow_write_schema(mod_ctx, arrow_begin_message(&mod_ctx->builder, ARROW_HEADER_SCHEMA, 0));
+    arrow_write_message(mod_ctx, NULL, 0, NULL);
+
+    return mod_ctx->error;
+
+malloc_error:
+    fprintf(stderr, "Error allocating Arrow column buffers: %s\n", strerror(ENOMEM));
+    mod_ctx->error = 1;
+    return mod_ctx->error;
+}
+
+static void arrow_write_footer(mod_arrow_ctx_t *mod_ctx) {
+    fb_builder_t *b = &mod_ctx->builder;
+    fb_table_t footer = { 0 };
+    size_t root = fb_begin(b);
+    int64_t footer_offset;
+
+    /* End-of-stream marker */
+    arrow_write_int32(mod_ctx, 0xFFFFFFFF);
+    arrow_write_int32(mod_ctx, 0);
+
+    fb_table_scalar(&footer, 0, 2, ARROW_METADATA_V5);
+    fb_table_offset(&footer, 1);
+    fb_table_offset(&footer, 2);
+    fb_table_offset(&footer, 3);
+
+    fb_patch(b, root, fb_write_table(b, &footer));
+    arrow_write_schema(mod_ctx, footer.slot[1]);
+    fb_patch(b, footer.slot[2], fb_write_struct_vector(b, mod_ctx->dictionary_blocks.words,
+                3, mod_ctx->dictionary_blocks.count));
+    fb_patch(b, footer.slot[3], fb_write_struct_vector(b, mod_ctx->record_blocks.words,
+                3, mod_ctx->record_blocks.count));
+
+    if (b->error) {
+        fprintf(stderr, "Error building Arrow footer: %s\n", strerror(ENOMEM));
+        mod_ctx->error = 1;
+        return;
+    }
+
+    footer_offset = mod_ctx->offset;
+    arrow_write(mod_ctx, b->bytes, b->used);
+    arrow_write_int32(mod_ctx, mod_ctx->offset - footer_offset);
+    arrow_write(mod_ctx, arrow_magic, 6);
+}
+
+static readstat_error_t finish_file(void *ctx) {
+    mod_arrow_ctx_t *mod_ctx = (mod_arrow_ctx_t *)ctx;
+    readstat_error_t error = READSTAT_OK;
+    long i;
+
+    if (mod_ctx == NULL)
+        return READSTAT_OK;
+
+    if (!mod_ctx->started)
+        arrow_begin(mod_ctx);
+    if (mod_ctx->rows_in_batch)
+        arrow_write_batch(mod_ctx);
+    arrow_write_dictionaries(mod_ctx);
+    if (!mod_ctx->error)
+        arrow_write_footer(mod_ctx);
+
+    fclose(mod_ctx->out_file);
+    error = mod_ctx->error ? READSTAT_ERROR_WRITE : READSTAT_OK;
+
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        arrow_column_t *column = &mod_ctx->columns[i];
+        free(column->name);
+        free(column->label);
+        free(column->val_labels);
+        if (column->dictionary)
+            arrow_dictionary_free(column->dictionary);
+        arrow_buffer_free(&column->validity);
+        arrow_buffer_free(&column->offsets);
+        arrow_buffer_free(&column->data);
+    }
+    free(mod_ctx->columns);
+
+    for (i=0; i<mod_ctx->label_sets_count; i++) {
+        arrow_label_set_free(mod_ctx->label_sets[i]);
+    }
+    free(mod_ctx->label_sets);
+    ck_hash_table_free(mod_ctx->label_set_dict);
+
+    fb_builder_free(&mod_ctx->builder);
+    arrow_buffer_free(&mod_ctx->scratch_offsets);
+    arrow_buffer_free(&mod_ctx->scratch_data);
+    free(mod_ctx->dictionary_blocks.words);
+    free(mod_ctx->record_blocks.words);
+    free(mod_ctx->file_label);
+    free(mod_ctx);
+    return error;
+}
+
+static int handle_metadata(readstat_metadata_t *metadata, void *ctx) {
+    mod_arrow_ctx_t *mod_ctx = (mod_arrow_ctx_t *)ctx;
+    const char *file_label = readstat_get_file_label(metadata);
+    mod_ctx->var_count = readstat_get_var_count(metadata);
+    if (file_label && mod_ctx->file_label == NULL)
+        mod_ctx->file_label = arrow_strdup(file_label);
+    return mod_ctx->var_count == 0;
+}
+
+static int handle_value_label(const char *val_labels, readstat_value_t value,
+                              const char *label, void *ctx) {
+    mod_arrow_ctx_t *mod_ctx = (mod_arrow_ctx_t *)ctx;
+    arrow_label_set_t *label_set = NULL;
+    char *label_copy = NULL;
+
+    if (readstat_value_is_tagged_missing(value) || readstat_value_is_system_missing(value))
+        return READSTAT_HANDLER_OK;
+
+    label_set = (arrow_label_set_t *)ck_str_hash_lookup(val_labels, mod_ctx->label_set_dict);
+    if (label_set == NULL) {
+        arrow_label_set_t **label_sets = arrow_grow(mod_ctx->label_sets, &mod_ctx->label_sets_capacity,
+                mod_ctx->label_sets_count + 1, sizeof(arrow_label_set_t *));
+        if (label_sets == NULL)
+            return READSTAT_HANDLER_ABORT;
+        mod_ctx->label_sets = label_sets;
+        label_set = arrow_label_set_init();
+        mod_ctx->label_sets[mod_ctx->label_sets_count++] = label_set;
+        ck_str_hash_insert(val_labels, label_set, mod_ctx->label_set_dict);
+    }
+
+    char **labels = arrow_grow(label_set->labels, &label_set->labels_capacity,
+            label_set->labels_count + 1, sizeof(char *));
+    if (labels == NULL || (label_copy = arrow_strdup(label)) == NULL)
+        return READSTAT_HANDLER_ABORT;
+    label_set->labels = labels;
+    label_set->labels[label_set->labels_count++] = label_copy;
+
+    if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        const char *string = readstat_string_value(value);
+        if (string && string[0])
+            ck_str_hash_insert(string, label_copy, label_set->string_labels);
+    } else {
+        ck_double_hash_insert(readstat_double_value(value), label_copy, label_set->numeric_labels);
+    }
+
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_variable(int index, readstat_variable_t *variable,
+                           const char *val_labels, void *ctx) {
+    mod_arrow_ctx_t *mod_ctx = (mod_arrow_ctx_t *)ctx;
+    const char *name = readstat_variable_get_name(variable);
+    const char *label = readstat_variable_get_label(variable);
+    arrow_column_t *column = NULL;
+
+    if (index >= mod_ctx->columns_count) {
+        arrow_column_t *columns = realloc(mod_ctx->columns, (index + 1) * sizeof(arrow_column_t));
+        if (columns == NULL)
+            return READSTAT_HANDLER_ABORT;
+        memset(&columns[mod_ctx->columns_count], 0,
+                (index + 1 - mod_ctx->columns_count) * sizeof(arrow_column_t));
+        mod_ctx->columns = columns;
+        mod_ctx->columns_count = index + 1;
+    }
+
+    column = &mod_ctx->columns[index];
+    column->type = readstat_variable_get_type(variable);
+    if (column->type == READSTAT_TYPE_STRING_REF)
+        column->type = READSTAT_TYPE_STRING;
+    column->name = name ? arrow_strdup(name) : NULL;
+    column->label = label ? arrow_strdup(label) : NULL;
+    column->val_labels = val_labels ? arrow_strdup(val_labels) : NULL;
+
+    return READSTAT_HANDLER_OK;
+}
+
+/* The dictionary entry for a labelled value: its label, or failing that the value itself */
+static const char *arrow_dictionary_entry(arrow_column_t *column, readstat_value_t value, char *buf) {
+    const char *label = NULL;
+
+    if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        const char *string = readstat_string_value(value);
+        if (string == NULL)
+            return "";
+        if (string[0])
+            label = ck_str_hash_lookup(string, column->label_set->string_labels);
+        return label ? label : string;
+    }
+
+    label = ck_double_hash_lookup(readstat_double_value(value), column->label_set->numeric_labels);
+    if (label)
+        return label;
+
+    format_double(readstat_double_value(value), buf);
+    return buf;
+}
+
+static int handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx) {
+    mod_arrow_ctx_t *mod_ctx = (mod_arrow_ctx_t *)ctx;
+    int var_index = readstat_variable_get_index(variable);
+    arrow_column_t *column = NULL;
+    long row = mod_ctx->rows_in_batch;
+
+    if (!mod_ctx->started && arrow_begin(mod_ctx) != 0)
+        return READSTAT_HANDLER_ABORT;
+
+    if (var_index >= mod_ctx->columns_count)
+        return READSTAT_HANDLER_ABORT;
+
+    column = &mod_ctx->columns[var_index];
+
+    if (readstat_value_is_system_missing(value) || readstat_value_is_tagged_missing(value)) {
+        column->null_count++;
+        if (column->dictionary || column->type != READSTAT_TYPE_STRING) {
+            static const char zeros[8] = { 0 };
+            size_t width = column->dictionary ? sizeof(int32_t) : arrow_type_width(column->type);
+            if (arrow_buffer_append(&column->data, zeros, width) != 0)
+                goto malloc_error;
+        }
+    } else {
+        column->validity.bytes[row / 8] |= (1 << (row % 8));
+        if (column->dictionary) {
+            char buf[FORMAT_DOUBLE_BUFFER_LEN];
+            int32_t index = arrow_dictionary_index(column->dictionary,
+                    arrow_dictionary_entry(column, value, buf));
+            if (index == -1 || arrow_buffer_append(&column->data, &index, sizeof(int32_t)) != 0)
+                goto malloc_error;
+        } else if (column->type == READSTAT_TYPE_STRING) {
+            const char *string = readstat_string_value(value);
+            if (string && arrow_buffer_append(&column->data, string, strlen(string)) != 0)
+                goto malloc_error;
+        } else if (column->type == READSTAT_TYPE_INT8) {
+            int8_t v = readstat_int8_value(value);
+            if (arrow_buffer_append(&column->data, &v, sizeof(int8_t)) != 0)
+                goto malloc_error;
+        } else if (column->type == READSTAT_TYPE_INT16) {
+            int16_t v = readstat_int16_value(value);
+            if (arrow_buffer_append(&column->data, &v, sizeof(int16_t)) != 0)
+                goto malloc_error;
+        } else if (column->type == READSTAT_TYPE_INT32) {
+            int32_t v = readstat_int32_value(value);
+            if (arrow_buffer_append(&column->data, &v, sizeof(int32_t)) != 0)
+                goto malloc_error;
+        } else if (column->type == READSTAT_TYPE_FLOAT) {
+            float v = readstat_float_value(value);
+            if (arrow_buffer_append(&column->data, &v, sizeof(float)) != 0)
+                goto malloc_error;
+        } else if (column->type == READSTAT_TYPE_DOUBLE) {
+            double v = readstat_double_value(value);
+            if (arrow_buffer_append(&column->data, &v, sizeof(double)) != 0)
+                goto malloc_error;
+        }
+    }
+
+    if (column->dictionary == NULL && column->type == READSTAT_TYPE_STRING) {
+        int32_t offset = column->data.used;
+        if (column->data.used > INT32_MAX) {
+            fprintf(stderr, "Error writing Arrow data: string column %s exceeds 2 GB in one batch "
+                    "(use a smaller batch size)\n", column->name);
+            return READSTAT_HANDLER_ABORT;
+        }
+        if (arrow_buffer_append(&column->offsets, &offset, sizeof(int32_t)) != 0)
+            goto malloc_error;
+    }
+
+    if (var_index == mod_ctx->columns_count - 1) {
+        if (++mod_ctx->rows_in_batch == mod_ctx->batch_size)
+            arrow_write_batch(mod_ctx);
+    }
+
+    return mod_ctx->error ? READSTAT_HANDLER_ABORT : READSTAT_HANDLER_OK;
+
+malloc_error:
+    fprintf(stderr, "Error allocating Arrow column buffers: %s\n", strerror(ENOMEM));
+    mod_ctx->error = 1;
+    return READSTAT_HANDLER_ABORT;
+}
@@ -0,0 +1,2 @@
+
+extern rs_module_t rs_mod_arrow;
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -9,16 +11,21 @@
 #include "module.h"
 #include "../util/readstat_dta_days.h"
 #include "../util/readstat_sav_date.h"
-#include "double_decimals.h"
+#include "format_double.h"
+
+#define CSV_BUFFER_SIZE 0x100000
 
 typedef struct mod_csv_ctx_s {
     FILE *out_file;
     long var_count;
+    char *buffer;
+    size_t buffer_used;
+    readstat_error_t error;
 } mod_csv_ctx_t;
 
 static int accept_file(const char *filename);
-static void *ctx_init(const char *filename);
-static void finish_file(void *ctx);
+static void *ctx_init(const char *filename, const rs_mod_options_t *options);
+static readstat_error_t finish_file(void *ctx);
 static int handle_metadata(readstat_metadata_t *metadata, void *ctx);
 static int handle_variable(int index, readstat_variable_t *variable,
                            const char *val_labels, void *ctx);
@@ -39,8 +46,8 @@ static int accept_file(const char *filename) {
     return strcmp(filename, "-") == 0 || rs_ends_with(filename, ".csv");
 }
 
-static void *ctx_init(const char *filename) {
-    mod_csv_ctx_t *mod_ctx = malloc(sizeof(mod_csv_ctx_t));
+static void *ctx_init(const char *filename, const rs_mod_options_t *options) {
+    mod_csv_ctx_t *mod_ctx = calloc(1, sizeof(mod_csv_ctx_t));
     if (strcmp(filename, "-") == 0) {
         mod_ctx->out_file = stdout;
     } else {
@@ -50,18 +57,108 @@ static void *ctx_init(const char *filename) {
         fprintf(stderr, "Error opening %s for writing: %s\n", filename, strerror(errno));
         return NULL;
     }
+    if ((mod_ctx->buffer = malloc(CSV_BUFFER_SIZE)) == NULL) {
+        fprintf(stderr, "Error allocating the output buffer for %s\n", filename);
+        if (mod_ctx->out_file != stdout)
+            fclose(mod_ctx->out_file);
+        free(mod_ctx);
+        return NULL;
+    }
     return mod_ctx;
 }
 
-static void finish_file(void *ctx) {
+/* After a failed write the rest of the output is dropped, and the handlers
+ * abort the parse */
+static void csv_fwrite(mod_csv_ctx_t *mod_ctx, const void *bytes, size_t len) {
+    if (mod_ctx->error != READSTAT_OK)
+        return;
+    if (fwrite(bytes, len, 1, mod_ctx->out_file) != 1) {
+        fprintf(stderr, "Error writing CSV data: %s\n", strerror(errno));
+        mod_ctx->error = READSTAT_ERROR_WRITE;
+    }
+}
+
+static void csv_flush(mod_csv_ctx_t *mod_ctx) {
+    if (mod_ctx->buffer_used) {
+        csv_fwrite(mod_ctx, mod_ctx->buffer, mod_ctx->buffer_used);
+        mod_ctx->buffer_used = 0;
+    }
+}
+
+/* Returns room for at least `len' bytes at the end of the buffer, or NULL if
+ * `len' is more than the buffer could ever hold */
+static char *csv_reserve(mod_csv_ctx_t *mod_ctx, size_t len) {
+    if (mod_ctx->buffer_used + len > CSV_BUFFER_SIZE)
+        csv_flush(mod_ctx);
+    if (len > CSV_BUFFER_SIZE)
+        return NULL;
+    return &mod_ctx->buffer[mod_ctx->buffer_used];
+}
+
+static void csv_write(mod_csv_ctx_t *mod_ctx, const char *bytes, size_t len) {
+    char *dst = csv_reserve(mod_ctx, len);
+    if (dst == NULL) {
+        csv_fwrite(mod_ctx, bytes, len);
+    } else {
+        memcpy(dst, bytes, len);
+        mod_ctx->buffer_used += len;
+    }
+}
+
+static void csv_write_char(mod_csv_ctx_t *mod_ctx, char c) {
+    if (mod_ctx->buffer_used == CSV_BUFFER_SIZE)
+        csv_flush(mod_ctx);
+    mod_ctx->buffer[mod_ctx->buffer_used++] = c;
+}
+
+static void csv_write_int(mod_csv_ctx_t *mod_ctx, int32_t value) {
+    char digits[16];
+    char *p = &digits[sizeof(digits)];
+    /* Work in unsigned so INT32_MIN negates cleanly */
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+
+    do {
+        *--p = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+        *--p = '-';
+
+    csv_write(mod_ctx, p, &digits[sizeof(digits)] - p);
+}
+
+static void csv_write_double(mod_csv_ctx_t *mod_ctx, double value) {
+    char *dst = csv_reserve(mod_ctx, FORMAT_DOUBLE_BUFFER_LEN);
+    mod_ctx->buffer_used += format_double(value, dst);
+}
+
+static void csv_write_float(mod_csv_ctx_t *mod_ctx, float value) {
+    char *dst = csv_reserve(mod_ctx, FORMAT_DOUBLE_BUFFER_LEN);
+    mod_ctx->buffer_used += format_float(value, dst);
+}
+
+static readstat_error_t finish_file(void *ctx) {
     mod_csv_ctx_t *mod_ctx = (mod_csv_ctx_t *)ctx;
+    readstat_error_t error = READSTAT_OK;
     if (mod_ctx) {
+        if (mod_ctx->out_file != NULL)
+            csv_flush(mod_ctx);
         if (mod_ctx->out_file == stdout) {
-            fflush(mod_ctx->out_file);
+            if (fflush(mod_ctx->out_file) != 0 && mod_ctx->error == READSTAT_OK) {
+                fprintf(stderr, "Error writing CSV data: %s\n", strerror(errno));
+                mod_ctx->error = READSTAT_ERROR_WRITE;
+            }
         } else if (mod_ctx->out_file != NULL) {
-            fclose(mod_ctx->out_file);
+            if (fclose(mod_ctx->out_file) != 0 && mod_ctx->error == READSTAT_OK) {
+                fprintf(stderr, "Error writing CSV data: %s\n", strerror(errno));
+                mod_ctx->error = READSTAT_ERROR_WRITE;
+            }
         }
+        error = mod_ctx->error;
+        free(mod_ctx->buffer);
+        free(mod_ctx);
     }
+    return error;
 }
 
 static int handle_metadata(readstat_metadata_t *metadata, void *ctx) {
@@ -71,18 +168,20 @@ static int handle_metadata(readstat_metadata_t *metadata, void *ctx) {
 }
 
 static void emit_escaped_string(mod_csv_ctx_t *mod_ctx, const char *string) {
-    if (string == NULL) {
-        fprintf(mod_ctx->out_file, "\"\"");
-    } else {
-        fprintf(mod_ctx->out_file, "\"");
-        const char *p = NULL;
-        while ((string = strchr(p = string, '"'))) {
-            fwrite(p, string - p, 1, mod_ctx->out_file);
-            fprintf(mod_ctx->out_file, "\"\"");
-            string++;
+    csv_write_char(mod_ctx, '"');
+    if (string) {
+        size_t len = strlen(string);
+        const char *quote = NULL;
+        while ((quote = memchr(string, '"', len))) {
+            size_t run = quote - string + 1;
+            csv_write(mod_ctx, string, run);
+            csv_write_char(mod_ctx, '"');
+            string += run;
+            len -= run;
         }
-        fprintf(mod_ctx->out_file, "%s\"", p);
+        csv_write(mod_ctx, string, len);
     }
+    csv_write_char(mod_ctx, '"');
 }
 
 static int handle_variable(int index, readstat_variable_t *variable,
@@ -90,13 +189,13 @@ static int handle_variable(int index, readstat_variable_t *variable,
     mod_csv_ctx_t *mod_ctx = (mod_csv_ctx_t *)ctx;
     const char *name = readstat_variable_get_name(variable);
     if (index > 0) {
-        fprintf(mod_ctx->out_file, ",");
+        csv_write_char(mod_ctx, ',');
     }
     emit_escaped_string(mod_ctx, name);
     if (index == mod_ctx->var_count - 1) {
-        fprintf(mod_ctx->out_file, "\n");
+        csv_write_char(mod_ctx, '\n');
     }
-    return 0;
+    return mod_ctx->error == READSTAT_OK ? READSTAT_HANDLER_OK : READSTAT_HANDLER_ABORT;
 }
 
 static int handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx) {
@@ -105,7 +204,7 @@ static int handle_value(int obs_index, readstat_variable_t *variable, readstat_v
     const char *format = readstat_variable_get_format(variable);
     int var_index = readstat_variable_get_index(variable);
     if (var_index > 0) {
-        fprintf(mod_ctx->out_file, ",");
+        csv_write_char(mod_ctx, ',');
     }
     if (readstat_value_is_system_missing(value)) {
         /* void */
@@ -114,42 +213,33 @@ static int handle_value(int obs_index, readstat_variable_t *variable, readstat_v
     } else if (type == READSTAT_TYPE_STRING) {
         emit_escaped_string(mod_ctx, readstat_string_value(value));
     } else if (type == READSTAT_TYPE_INT8) {
-        #ifdef __MINGW32__
-        __mingw_fprintf(mod_ctx->out_file, "%hhd", readstat_int8_value(value));
-        #else
-        fprintf(mod_ctx->out_file, "%hhd", readstat_int8_value(value));
-        #endif
+        csv_write_int(mod_ctx, readstat_int8_value(value));
     } else if (type == READSTAT_TYPE_INT16) {
-        fprintf(mod_ctx->out_file, "%hd", readstat_int16_value(value));
+        csv_write_int(mod_ctx, readstat_int16_value(value));
     } else if (type == READSTAT_TYPE_INT32 && format && 0 == strncmp("%td", format, strlen("%td"))) {
         int days = readstat_int32_value(value);
         char days_str[255];
         readstat_dta_days_string(days, days_str, sizeof(days_str)-1);
-        fprintf(mod_ctx->out_file, "%s", days_str);
+        csv_write(mod_ctx, days_str, strlen(days_str));
     } else if (type == READSTAT_TYPE_DOUBLE && format && 0 == strncmp("EDATE40", format, strlen("EDATE40"))) {
         double v = readstat_double_value(value);
         char date_str[255];
         char *s = readstat_sav_date_string(v, date_str, sizeof(date_str)-1);
         if (!s) {
             fprintf(stderr, "%s:%d Could not parse SPSS date double: %lf\n", __FILE__, __LINE__, v);
-            exit(EXIT_FAILURE);
+            mod_ctx->error = READSTAT_ERROR_BAD_TIMESTAMP_VALUE;
+            return READSTAT_HANDLER_ABORT;
         }
-        fprintf(mod_ctx->out_file, "%s", s);
+        csv_write(mod_ctx, s, strlen(s));
     } else if (type == READSTAT_TYPE_INT32) {
-        fprintf(mod_ctx->out_file, "%d", readstat_int32_value(value));
+        csv_write_int(mod_ctx, readstat_int32_value(value));
     } else if (type == READSTAT_TYPE_FLOAT) {
-        fprintf(mod_ctx->out_file, "%f", readstat_float_value(value));
+        csv_write_float(mod_ctx, readstat_float_value(value));
     } else if (type == READSTAT_TYPE_DOUBLE) {
-        double v = readstat_double_value(value);
-        int decimals = double_decimals(v);
-        if (decimals <= 6) {
-            fprintf(mod_ctx->out_file, "%lf", v);
-        } else {
-            fprintf(mod_ctx->out_file, "%.14f", v);
-        }
+        csv_write_double(mod_ctx, readstat_double_value(value));
     }
     if (var_index == mod_ctx->var_count - 1) {
-        fprintf(mod_ctx->out_file, "\n");
+        csv_write_char(mod_ctx, '\n');
     }
-    return 0;
+    return mod_ctx->error == READSTAT_OK ? READSTAT_HANDLER_OK : READSTAT_HANDLER_ABORT;
 }
@@ -0,0 +1,1016 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "../../readstat.h"
+#include "../../CKHashTable.h"
+#include "../util/quote_and_escape.h"
+#include "module_util.h"
+#include "module.h"
+#include "thrift_compact.h"
+#include "format_double.h"
+
+/* Writes Parquet files one row group at a time, with one dictionary page
+ * and one data page (format V1) per column chunk. A column chunk is
+ * dictionary-encoded when it has at most half as many distinct values as
+ * non-null values, or always if the variable is labelled, as long as the
+ * dictionary stays under PARQUET_DICTIONARY_MAX_SIZE. Pages are compressed
+ * with GZIP when zlib is available. */
+
+#define PARQUET_DEFAULT_ROW_GROUP_SIZE  131072
+#define PARQUET_DICTIONARY_MAX_SIZE     0x100000
+#define PARQUET_DICTIONARY_MAX_ENTRIES  32768
+#define PARQUET_HASH_TABLE_SIZE         1024
+
+#define PARQUET_TYPE_INT32              1
+#define PARQUET_TYPE_FLOAT              4
+#define PARQUET_TYPE_DOUBLE             5
+#define PARQUET_TYPE_BYTE_ARRAY         6
+
+#define PARQUET_CONVERTED_UTF8          0
+#define PARQUET_CONVERTED_INT_8         15
+#define PARQUET_CONVERTED_INT_16        16
+
+#define PARQUET_REPETITION_OPTIONAL     1
+
+#define PARQUET_ENCODING_PLAIN          0
+#define PARQUET_ENCODING_RLE            3
+#define PARQUET_ENCODING_RLE_DICTIONARY 8
+
+#define PARQUET_CODEC_UNCOMPRESSED      0
+#define PARQUET_CODEC_GZIP              2
+
+#define PARQUET_PAGE_DATA               0
+#define PARQUET_PAGE_DICTIONARY         2
+
+static const char parquet_magic[4] = { 'P', 'A', 'R', '1' };
+
+typedef struct parquet_buffer_s {
+    unsigned char  *bytes;
+    size_t          used;
+    size_t          capacity;
+} parquet_buffer_t;
+
+typedef struct parquet_label_set_s {
+    char           *name;
+    char          **values;
+    char          **labels;
+    long            labels_count;
+    long            labels_capacity;
+} parquet_label_set_t;
+
+typedef struct parquet_chunk_s {
+    int64_t     file_offset;
+    int64_t     dictionary_page_offset;
+    int64_t     data_page_offset;
+    int64_t     uncompressed_size;
+    int64_t     compressed_size;
+    int         is_dictionary;
+} parquet_chunk_t;
+
+typedef struct parquet_row_group_s {
+    parquet_chunk_t    *chunks;
+    int64_t             rows_count;
+    int64_t             total_byte_size;
+} parquet_row_group_t;
+
+typedef struct parquet_column_s {
+    char               *name;
+    char               *label;
+    char               *val_labels;
+    readstat_type_t     type;
+    int                 physical_type;
+    size_t              width;
+    parquet_buffer_t    values;
+    parquet_buffer_t    defined;
+    long                null_count;
+} parquet_column_t;
+
+typedef struct mod_parquet_ctx_s {
+    FILE                   *out_file;
+    int64_t                 offset;
+    long                    row_group_size;
+    char                   *file_label;
+
+    parquet_column_t       *columns;
+    long                    columns_count;
+
+    parquet_label_set_t    *label_sets;
+    long                    label_sets_count;
+    long                    label_sets_capacity;
+
+    parquet_row_group_t    *row_groups;
+    long                    row_groups_count;
+    long                    row_groups_capacity;
+
+    long                    rows_in_group;
+    int64_t                 rows_count;
+    int                     error;
+
+    ck_hash_table_t        *dictionary_index;
+    uint32_t               *indices;
+    parquet_buffer_t        dictionary;
+    parquet_buffer_t        page;
+    parquet_buffer_t        compressed;
+    tc_writer_t             thrift;
+#if HAVE_ZLIB
+    z_stream                stream;
+    int                     stream_ready;
+#endif
+} mod_parquet_ctx_t;
+
+static int accept_file(const char *filename);
+static void *ctx_init(const char *filename, const rs_mod_options_t *options);
+static readstat_error_t finish_file(void *ctx);
+static int handle_metadata(readstat_metadata_t *metadata, void *ctx);
+static int handle_value_label(const char *val_labels, readstat_value_t value,
+                              const char *label, void *ctx);
+static int handle_variable(int index, readstat_variable_t *variable,
+                           const char *val_labels, void *ctx);
+static int handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx);
+
+rs_module_t rs_mod_parquet = {
+    .accept = accept_file,
+    .init = ctx_init,
+    .finish = finish_file,
+    .handle = {
+        .metadata = handle_metadata,
+        .value_label = handle_value_label,
+        .variable = handle_variable,
+        .value = handle_value
+    }
+};
+
+static char *parquet_strdup(const char *string) {
+    size_t len = strlen(string) + 1;
+    char *copy = malloc(len);
+    if (copy)
+        memcpy(copy, string, len);
+    return copy;
+}
+
+static void *parquet_grow(void *array, long *capacity, long needed, size_t elem_size) {
+    if (needed <= *capacity)
+        return array;
+
+    long new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    void *new_array = realloc(array, new_capacity * elem_size);
+    if (new_array)
+        *capacity = new_capacity;
+    return new_array;
+}
+
+static int parquet_buffer_reserve(parquet_buffer_t *buffer, size_t len) {
+    if (buffer->used + len > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+        unsigned char *new_bytes = NULL;
+        while (capacity < buffer->used + len)
+            capacity *= 2;
+        if ((new_bytes = realloc(buffer->bytes, capacity)) == NULL)
+            return -1;
+        buffer->bytes = new_bytes;
+        buffer->capacity = capacity;
+    }
+    return 0;
+}
+
+static int parquet_buffer_append(parquet_buffer_t *buffer, const void *bytes, size_t len) {
+    if (len == 0)
+        return 0;
+    if (parquet_buffer_reserve(buffer, len) != 0)
+        return -1;
+    memcpy(&buffer->bytes[buffer->used], bytes, len);
+    buffer->used += len;
+    return 0;
+}
+
+static int parquet_buffer_append_byte(parquet_buffer_t *buffer, unsigned char byte) {
+    return parquet_buffer_append(buffer, &byte, 1);
+}
+
+static void parquet_buffer_free(parquet_buffer_t *buffer) {
+    free(buffer->bytes);
+    memset(buffer, 0, sizeof(parquet_buffer_t));
+}
+
+static void parquet_put_uint32(unsigned char *dst, uint32_t value) {
+    dst[0] = value & 0xFF;
+    dst[1] = (value >> 8) & 0xFF;
+    dst[2] = (value >> 16) & 0xFF;
+    dst[3] = (value >> 24) & 0xFF;
+}
+
+static uint32_t parquet_get_uint32(const unsigned char *src) {
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static void parquet_put_uint64(unsigned char *dst, uint64_t value) {
+    parquet_put_uint32(dst, value & 0xFFFFFFFF);
+    parquet_put_uint32(dst + 4, value >> 32);
+}
+
+static uint64_t parquet_get_uint64(const unsigned char *src) {
+    return parquet_get_uint32(src) | ((uint64_t)parquet_get_uint32(src + 4) << 32);
+}
+
+static int parquet_append_varint(parquet_buffer_t *buffer, uint64_t value) {
+    unsigned char bytes[10];
+    int len = 0;
+    while (value >= 0x80) {
+        bytes[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    bytes[len++] = value;
+    return parquet_buffer_append(buffer, bytes, len);
+}
+
+static inline uint32_t parquet_level(const void *values, int value_size, long i) {
+    return value_size == 1 ? ((const uint8_t *)values)[i] : ((const uint32_t *)values)[i];
+}
+
+static long parquet_run_length(const void *values, int value_size, long start, long count) {
+    uint32_t value = parquet_level(values, value_size, start);
+    long i = start + 1;
+    while (i < count && parquet_level(values, value_size, i) == value)
+        i++;
+    return i - start;
+}
+
+/* The RLE / bit-packing hybrid: runs of 8 or more equal values are
+ * run-length encoded, and everything in between is bit-packed in groups
+ * of 8, zero-padded at the very end */
+static int parquet_rle_encode(parquet_buffer_t *out, const void *values, int value_size,
+        long count, int bit_width) {
+    int value_bytes = (bit_width + 7) / 8;
+    long i = 0;
+
+    while (i < count) {
+        long run = parquet_run_length(values, value_size, i, count);
+        if (run >= 8) {
+            uint32_t value = parquet_level(values, value_size, i);
+            unsigned char bytes[4];
+            int j;
+            for (j=0; j<value_bytes; j++) {
+                bytes[j] = (value >> (8*j)) & 0xFF;
+            }
+            if (parquet_append_varint(out, (uint64_t)run << 1) != 0 ||
+                    parquet_buffer_append(out, bytes, value_bytes) != 0)
+                return -1;
+            i += run;
+            continue;
+        }
+
+        long start = i;
+        do {
+            i += 8;
+        } while (i < count && parquet_run_length(values, value_size, i, count) < 8);
+
+        long groups = (i - start) / 8;
+        uint64_t bits = 0;
+        int bits_used = 0;
+        long j;
+        if (parquet_append_varint(out, ((uint64_t)groups << 1) | 1) != 0 ||
+                parquet_buffer_reserve(out, groups * bit_width) != 0)
+            return -1;
+        for (j=start; j<i; j++) {
+            uint32_t value = j < count ? parquet_level(values, value_size, j) : 0;
+            bits |= (uint64_t)value << bits_used;
+            bits_used += bit_width;
+            while (bits_used >= 8) {
+                out->bytes[out->used++] = bits & 0xFF;
+                bits >>= 8;
+                bits_used -= 8;
+            }
+        }
+    }
+    return 0;
+}
+
+static int parquet_bit_width(long max_value) {
+    int bit_width = 1;
+    while (bit_width < 32 && (max_value >> bit_width))
+        bit_width++;
+    return bit_width;
+}
+
+static int accept_file(const char *filename) {
+    return rs_ends_with(filename, ".parquet");
+}
+
+static void *ctx_init(const char *filename, const rs_mod_options_t *options) {
+    mod_parquet_ctx_t *mod_ctx = calloc(1, sizeof(mod_parquet_ctx_t));
+    mod_ctx->out_file = fopen(filename, "wb");
+    if (mod_ctx->out_file == NULL) {
+        fprintf(stderr, "Error opening %s for writing: %s\n", filename, strerror(errno));
+        free(mod_ctx);
+        return NULL;
+    }
+    mod_ctx->row_group_size = PARQUET_DEFAULT_ROW_GROUP_SIZE;
+    if (options && options->batch_size > 0)
+        mod_ctx->row_group_size = options->batch_size;
+    mod_ctx->dictionary_index = ck_hash_table_init(PARQUET_HASH_TABLE_SIZE);
+#if HAVE_ZLIB
+    mod_ctx->stream_ready = (deflateInit2(&mod_ctx->stream, Z_DEFAULT_COMPRESSION,
+                Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+#endif
+    return mod_ctx;
+}
+
+static void parquet_write(mod_parquet_ctx_t *mod_ctx, const void *bytes, size_t len) {
+    if (mod_ctx->error || len == 0)
+        return;
+    if (fwrite(bytes, len, 1, mod_ctx->out_file) != 1) {
+        fprintf(stderr, "Error writing Parquet data: %s\n", strerror(errno));
+        mod_ctx->error = 1;
+        return;
+    }
+    mod_ctx->offset += len;
+}
+
+static void parquet_malloc_error(mod_parquet_ctx_t *mod_ctx) {
+    if (!mod_ctx->error)
+        fprintf(stderr, "Error building Parquet data: %s\n", strerror(ENOMEM));
+    mod_ctx->error = 1;
+}
+
+/* Compresses and writes mod_ctx->page behind its header, adding the bytes
+ * written to *uncompressed_size and *compressed_size */
+static void parquet_write_page(mod_parquet_ctx_t *mod_ctx, int page_type, long values_count,
+        int encoding, int64_t *uncompressed_size, int64_t *compressed_size) {
+    tc_writer_t *w = &mod_ctx->thrift;
+    parquet_buffer_t *body = &mod_ctx->page;
+
+    if (body->used > INT32_MAX) {
+        fprintf(stderr, "Error writing Parquet data: page exceeds 2 GB (use a smaller row group size)\n");
+        mod_ctx->error = 1;
+        return;
+    }
+
+#if HAVE_ZLIB
+    if (mod_ctx->stream_ready) {
+        z_stream *stream = &mod_ctx->stream;
+        uLong bound = 0;
+
+        /* deflateBound() is only accurate on a freshly reset stream */
+        deflateReset(stream);
+        bound = deflateBound(stream, body->used);
+        mod_ctx->compressed.used = 0;
+        if (parquet_buffer_reserve(&mod_ctx->compressed, bound) != 0) {
+            parquet_malloc_error(mod_ctx);
+            return;
+        }
+        stream->next_in = body->bytes;
+        stream->avail_in = body->used;
+        stream->next_out = mod_ctx->compressed.bytes;
+        stream->avail_out = bound;
+        if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+            fprintf(stderr, "Error compressing Parquet page: %s\n", stream->msg ? stream->msg : "deflate failed");
+            mod_ctx->error = 1;
+            return;
+        }
+        mod_ctx->compressed.used = stream->total_out;
+        body = &mod_ctx->compressed;
+    }
+#endif
+
+    tc_writer_reset(w);
+    tc_struct_begin(w);
+    tc_field_i32(w, 1, page_type);
+    tc_field_i32(w, 2, mod_ctx->page.used);
+    tc_field_i32(w, 3, body->used);
+    if (page_type == PARQUET_PAGE_DATA) {
+        tc_field_struct_begin(w, 5);
+        tc_field_i32(w, 1, values_count);
+        tc_field_i32(w, 2, encoding);
+        tc_field_i32(w, 3, PARQUET_ENCODING_RLE);
+        tc_field_i32(w, 4, PARQUET_ENCODING_RLE);
+        tc_struct_end(w);
+    } else {
+        tc_field_struct_begin(w, 7);
+        tc_field_i32(w, 1, values_count);
+        tc_field_i32(w, 2, encoding);
+        tc_struct_end(w);
+    }
+    tc_struct_end(w);
+
+    if (w->error) {
+        parquet_malloc_error(mod_ctx);
+        return;
+    }
+
+    parquet_write(mod_ctx, w->bytes, w->used);
+    parquet_write(mod_ctx, body->bytes, body->used);
+
+    *uncompressed_size += w->used + mod_ctx->page.used;
+    *compressed_size += w->used + body->used;
+}
+
+/* Fills mod_ctx->indices and mod_ctx->dictionary with the column's distinct
+ * values; returns the number of entries, or -1 if the column shouldn't be
+ * dictionary-encoded */
+static long parquet_build_dictionary(mod_parquet_ctx_t *mod_ctx, parquet_column_t *column) {
+    parquet_buffer_t *values = &column->values;
+    long non_null_count = column->defined.used - column->null_count;
+    long max_entries = column->val_labels ? PARQUET_DICTIONARY_MAX_ENTRIES : non_null_count / 2;
+    long entries_count = 0;
+    long empty_entry = 0;
+    size_t pos = 0;
+    long i;
+
+    if (non_null_count == 0)
+        return -1;
+
+    if (max_entries > PARQUET_DICTIONARY_MAX_ENTRIES)
+        max_entries = PARQUET_DICTIONARY_MAX_ENTRIES;
+
+    if (mod_ctx->dictionary_index->capacity > PARQUET_HASH_TABLE_SIZE) {
+        ck_hash_table_free(mod_ctx->dictionary_index);
+        mod_ctx->dictionary_index = ck_hash_table_init(PARQUET_HASH_TABLE_SIZE);
+    } else {
+        ck_hash_table_wipe(mod_ctx->dictionary_index);
+    }
+    mod_ctx->dictionary.used = 0;
+
+    for (i=0; i<non_null_count; i++) {
+        const unsigned char *value = &values->bytes[pos];
+        size_t value_len = column->width;
+        const void *found = NULL;
+        long index = -1;
+
+        if (column->physical_type == PARQUET_TYPE_BYTE_ARRAY) {
+            const char *key = (const char *)&value[4];
+            uint32_t len = parquet_get_uint32(value);
+            value_len = 4 + len;
+            if (len == 0) {
+                if (empty_entry)
+                    index = empty_entry - 1;
+                else
+                    empty_entry = entries_count + 1;
+            } else {
+                if ((found = ck_str_n_hash_lookup(key, len, mod_ctx->dictionary_index))) {
+                    index = (intptr_t)found - 1;
+                } else {
+                    ck_str_n_hash_insert(key, len, (const void *)(intptr_t)(entries_count + 1), mod_ctx->dictionary_index);
+                }
+            }
+        } else {
+            double key = 0.0;
+            if (column->physical_type == PARQUET_TYPE_DOUBLE) {
+                uint64_t bits = parquet_get_uint64(value);
+                memcpy(&key, &bits, sizeof(double));
+            } else if (column->physical_type == PARQUET_TYPE_FLOAT) {
+                uint32_t bits = parquet_get_uint32(value);
+                float f;
+                memcpy(&f, &bits, sizeof(float));
+                key = f;
+            } else {
+                key = (int32_t)parquet_get_uint32(value);
+            }
+            if ((found = ck_double_hash_lookup(key, mod_ctx->dictionary_index))) {
+                index = (intptr_t)found - 1;
+            } else {
+                ck_double_hash_insert(key, (const void *)(intptr_t)(entries_count + 1), mod_ctx->dictionary_index);
+            }
+        }
+
+        if (index == -1) {
+            index = entries_count++;
+            if (entries_count > max_entries ||
+                    mod_ctx->dictionary.used + value_len > PARQUET_DICTIONARY_MAX_SIZE)
+                return -1;
+            if (parquet_buffer_append(&mod_ctx->dictionary, value, value_len) != 0)
+                return -1;
+        }
+
+        mod_ctx->indices[i] = index;
+        pos += value_len;
+    }
+
+    return entries_count;
+}
+
+static void parquet_write_chunk(mod_parquet_ctx_t *mod_ctx, parquet_column_t *column, parquet_chunk_t *chunk) {
+    parquet_buffer_t *page = &mod_ctx->page;
+    long rows_count = column->defined.used;
+    long entries_count = parquet_build_dictionary(mod_ctx, column);
+    unsigned char length[4];
+
+    memset(chunk, 0, sizeof(parquet_chunk_t));
+    chunk->file_offset = mod_ctx->offset;
+    chunk->is_dictionary = (entries_count != -1);
+
+    if (chunk->is_dictionary) {
+        chunk->dictionary_page_offset = mod_ctx->offset;
+        page->used = 0;
+        if (parquet_buffer_append(page, mod_ctx->dictionary.bytes, mod_ctx->dictionary.used) != 0)
+            goto malloc_error;
+        parquet_write_page(mod_ctx, PARQUET_PAGE_DICTIONARY, entries_count, PARQUET_ENCODING_PLAIN,
+                &chunk->uncompressed_size, &chunk->compressed_size);
+    }
+
+    /* Definition levels, prefixed by their length */
+    page->used = 0;
+    if (parquet_buffer_append(page, length, sizeof(length)) != 0 ||
+            parquet_rle_encode(page, column->defined.bytes, 1, rows_count, 1) != 0)
+        goto malloc_error;
+    parquet_put_uint32(page->bytes, page->used - sizeof(length));
+
+    if (chunk->is_dictionary) {
+        int bit_width = parquet_bit_width(entries_count - 1);
+        if (parquet_buffer_append_byte(page, bit_width) != 0 ||
+                parquet_rle_encode(page, mod_ctx->indices, sizeof(uint32_t),
+                    rows_count - column->null_count, bit_width) != 0)
+            goto malloc_error;
+    } else {
+        if (parquet_buffer_append(page, column->values.bytes, column->values.used) != 0)
+            goto malloc_error;
+    }
+
+    chunk->data_page_offset = mod_ctx->offset;
+    parquet_write_page(mod_ctx, PARQUET_PAGE_DATA, rows_count,
+            chunk->is_dictionary ? PARQUET_ENCODING_RLE_DICTIONARY : PARQUET_ENCODING_PLAIN,
+            &chunk->uncompressed_size, &chunk->compressed_size);
+    return;
+
+malloc_error:
+    parquet_malloc_error(mod_ctx);
+}
+
+static void parquet_write_row_group(mod_parquet_ctx_t *mod_ctx) {
+    parquet_row_group_t *row_groups = NULL;
+    parquet_row_group_t *row_group = NULL;
+    long i;
+
+    if (mod_ctx->error)
+        return;
+
+    row_groups = parquet_grow(mod_ctx->row_groups, &mod_ctx->row_groups_capacity,
+            mod_ctx->row_groups_count + 1, sizeof(parquet_row_group_t));
+    if (row_groups == NULL)
+        goto malloc_error;
+    mod_ctx->row_groups = row_groups;
+
+    row_group = &row_groups[mod_ctx->row_groups_count];
+    memset(row_group, 0, sizeof(parquet_row_group_t));
+    if ((row_group->chunks = calloc(mod_ctx->columns_count, sizeof(parquet_chunk_t))) == NULL)
+        goto malloc_error;
+    mod_ctx->row_groups_count++;
+
+    row_group->rows_count = mod_ctx->rows_in_group;
+    for (i=0; i<mod_ctx->columns_count && !mod_ctx->error; i++) {
+        parquet_column_t *column = &mod_ctx->columns[i];
+        parquet_write_chunk(mod_ctx, column, &row_group->chunks[i]);
+        row_group->total_byte_size += row_group->chunks[i].uncompressed_size;
+
+        column->values.used = 0;
+        column->defined.used = 0;
+        column->null_count = 0;
+    }
+
+    mod_ctx->rows_in_group = 0;
+    return;
+
+malloc_error:
+    parquet_malloc_error(mod_ctx);
+}
+
+static int parquet_begin(mod_parquet_ctx_t *mod_ctx) {
+    long i;
+
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        parquet_column_t *column = &mod_ctx->columns[i];
+        if (column->type == READSTAT_TYPE_STRING) {
+            column->physical_type = PARQUET_TYPE_BYTE_ARRAY;
+        } else if (column->type == READSTAT_TYPE_FLOAT) {
+            column->physical_type = PARQUET_TYPE_FLOAT;
+            column->width = sizeof(float);
+        } else if (column->type == READSTAT_TYPE_DOUBLE) {
+            column->physical_type = PARQUET_TYPE_DOUBLE;
+            column->width = sizeof(double);
+        } else {
+            column->physical_type = PARQUET_TYPE_INT32;
+            column->width = sizeof(int32_t);
+        }
+
+        if (parquet_buffer_reserve(&column->defined, mod_ctx->row_group_size) != 0)
+            goto malloc_error;
+        if (column->width && parquet_buffer_reserve(&column->values, column->width * mod_ctx->row_group_size) != 0)
+            goto malloc_error;
+    }
+
+    if ((mod_ctx->indices = malloc(mod_ctx->row_group_size * sizeof(uint32_t))) == NULL)
+        goto malloc_error;
+
+    parquet_write(mod_ctx, parquet_magic, sizeof(parquet_magic));
+    return mod_ctx->error;
+
+malloc_error:
+    parquet_malloc_error(mod_ctx);
+    return mod_ctx->error;
+}
+
+static void parquet_format_value_label(parquet_buffer_t *json, const char *value, const char *label, int first) {
+    char *quoted_value = quote_and_escape(value);
+    char *quoted_label = quote_and_escape(label);
+    if (!first)
+        parquet_buffer_append(json, ", ", 2);
+    parquet_buffer_append(json, quoted_value, strlen(quoted_value));
+    parquet_buffer_append(json, ": ", 2);
+    parquet_buffer_append(json, quoted_label, strlen(quoted_label));
+    free(quoted_value);
+    free(quoted_label);
+}
+
+static parquet_label_set_t *parquet_label_set(mod_parquet_ctx_t *mod_ctx, const char *name) {
+    long i;
+    for (i=0; i<mod_ctx->label_sets_count; i++) {
+        if (strcmp(mod_ctx->label_sets[i].name, name) == 0)
+            return &mod_ctx->label_sets[i];
+    }
+    return NULL;
+}
+
+/* Variable labels as {"name": "label", ...} and value labels as
+ * {"name": {"value": "label", ...}, ...} */
+static int parquet_label_metadata(mod_parquet_ctx_t *mod_ctx, parquet_buffer_t *variable_labels,
+        parquet_buffer_t *value_labels) {
+    int first_variable_label = 1, first_value_labels = 1;
+    long i, j;
+
+    parquet_buffer_append_byte(variable_labels, '{');
+    parquet_buffer_append_byte(value_labels, '{');
+
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        parquet_column_t *column = &mod_ctx->columns[i];
+        parquet_label_set_t *label_set = NULL;
+        const char *name = column->name ? column->name : "";
+
+        if (column->label && column->label[0]) {
+            parquet_format_value_label(variable_labels, name, column->label, first_variable_label);
+            first_variable_label = 0;
+        }
+
+        if (column->val_labels && (label_set = parquet_label_set(mod_ctx, column->val_labels))) {
+            char *quoted_name = quote_and_escape(name);
+            if (!first_value_labels)
+                parquet_buffer_append(value_labels, ", ", 2);
+            parquet_buffer_append(value_labels, quoted_name, strlen(quoted_name));
+            parquet_buffer_append(value_labels, ": {", 3);
+            for (j=0; j<label_set->labels_count; j++) {
+                parquet_format_value_label(value_labels, label_set->values[j], label_set->labels[j], j == 0);
+            }
+            parquet_buffer_append_byte(value_labels, '}');
+            first_value_labels = 0;
+            free(quoted_name);
+        }
+    }
+
+    if (parquet_buffer_append(variable_labels, "}", 2) != 0 ||
+            parquet_buffer_append(value_labels, "}", 2) != 0)
+        return -1;
+
+    return 0;
+}
+
+static void parquet_write_column_metadata(tc_writer_t *w, parquet_column_t *column, parquet_chunk_t *chunk,
+        int64_t rows_count, int codec) {
+    tc_struct_begin(w);
+    tc_field_i64(w, 2, chunk->file_offset);
+    tc_field_struct_begin(w, 3);
+
+    tc_field_i32(w, 1, column->physical_type);
+    if (chunk->is_dictionary) {
+        tc_field_list_begin(w, 2, TC_TYPE_I32, 3);
+        tc_i32(w, PARQUET_ENCODING_PLAIN);
+        tc_i32(w, PARQUET_ENCODING_RLE);
+        tc_i32(w, PARQUET_ENCODING_RLE_DICTIONARY);
+    } else {
+        tc_field_list_begin(w, 2, TC_TYPE_I32, 2);
+        tc_i32(w, PARQUET_ENCODING_PLAIN);
+        tc_i32(w, PARQUET_ENCODING_RLE);
+    }
+    tc_field_list_begin(w, 3, TC_TYPE_BINARY, 1);
+    tc_string(w, column->name ? column->name : "");
+    tc_field_i32(w, 4, codec);
+    tc_field_i64(w, 5, rows_count);
+    tc_field_i64(w, 6, chunk->uncompressed_size);
+    tc_field_i64(w, 7, chunk->compressed_size);
+    tc_field_i64(w, 9, chunk->data_page_offset);
+    if (chunk->is_dictionary)
+        tc_field_i64(w, 11, chunk->dictionary_page_offset);
+
+    tc_struct_end(w);
+    tc_struct_end(w);
+}
+
+static void parquet_write_footer(mod_parquet_ctx_t *mod_ctx) {
+    tc_writer_t *w = &mod_ctx->thrift;
+    parquet_buffer_t variable_labels = { 0 };
+    parquet_buffer_t value_labels = { 0 };
+    int codec = PARQUET_CODEC_UNCOMPRESSED;
+    int has_file_label = (mod_ctx->file_label && mod_ctx->file_label[0]);
+    unsigned char length[4];
+    long i, j;
+
+#if HAVE_ZLIB
+    if (mod_ctx->stream_ready)
+        codec = PARQUET_CODEC_GZIP;
+#endif
+
+    if (parquet_label_metadata(mod_ctx, &variable_labels, &value_labels) != 0)
+        goto malloc_error;
+
+    tc_writer_reset(w);
+    tc_struct_begin(w);
+    tc_field_i32(w, 1, 1);
+
+    tc_field_list_begin(w, 2, TC_TYPE_STRUCT, mod_ctx->columns_count + 1);
+    tc_struct_begin(w);
+    tc_field_string(w, 4, "schema");
+    tc_field_i32(w, 5, mod_ctx->columns_count);
+    tc_struct_end(w);
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        parquet_column_t *column = &mod_ctx->columns[i];
+        tc_struct_begin(w);
+        tc_field_i32(w, 1, column->physical_type);
+        tc_field_i32(w, 3, PARQUET_REPETITION_OPTIONAL);
+        tc_field_string(w, 4, column->name ? column->name : "");
+        if (column->type == READSTAT_TYPE_STRING) {
+            tc_field_i32(w, 6, PARQUET_CONVERTED_UTF8);
+        } else if (column->type == READSTAT_TYPE_INT8) {
+            tc_field_i32(w, 6, PARQUET_CONVERTED_INT_8);
+        } else if (column->type == READSTAT_TYPE_INT16) {
+            tc_field_i32(w, 6, PARQUET_CONVERTED_INT_16);
+        }
+        tc_struct_end(w);
+    }
+
+    tc_field_i64(w, 3, mod_ctx->rows_count);
+
+    tc_field_list_begin(w, 4, TC_TYPE_STRUCT, mod_ctx->row_groups_count);
+    for (i=0; i<mod_ctx->row_groups_count; i++) {
+        parquet_row_group_t *row_group = &mod_ctx->row_groups[i];
+        tc_struct_begin(w);
+        tc_field_list_begin(w, 1, TC_TYPE_STRUCT, mod_ctx->columns_count);
+        for (j=0; j<mod_ctx->columns_count; j++) {
+            parquet_write_column_metadata(w, &mod_ctx->columns[j], &row_group->chunks[j],
+                    row_group->rows_count, codec);
+        }
+        tc_field_i64(w, 2, row_group->total_byte_size);
+        tc_field_i64(w, 3, row_group->rows_count);
+        tc_struct_end(w);
+    }
+
+    tc_field_list_begin(w, 5, TC_TYPE_STRUCT, has_file_label ? 3 : 2);
+    tc_struct_begin(w);
+    tc_field_string(w, 1, "readstat:variable_labels");
+    tc_field_string(w, 2, (char *)variable_labels.bytes);
+    tc_struct_end(w);
+    tc_struct_begin(w);
+    tc_field_string(w, 1, "readstat:value_labels");
+    tc_field_string(w, 2, (char *)value_labels.bytes);
+    tc_struct_end(w);
+    if (has_file_label) {
+        tc_struct_begin(w);
+        tc_field_string(w, 1, "readstat:file_label");
+        tc_field_string(w, 2, mod_ctx->file_label);
+        tc_struct_end(w);
+    }
+
+    tc_field_string(w, 6, "ReadStat version " READSTAT_VERSION);
+    tc_struct_end(w);
+
+    if (w->error)
+        goto malloc_error;
+
+    parquet_write(mod_ctx, w->bytes, w->used);
+    parquet_put_uint32(length, w->used);
+    parquet_write(mod_ctx, length, sizeof(length));
+    parquet_write(mod_ctx, parquet_magic, sizeof(parquet_magic));
+
+    parquet_buffer_free(&variable_labels);
+    parquet_buffer_free(&value_labels);
+    return;
+
+malloc_error:
+    parquet_buffer_free(&variable_labels);
+    parquet_buffer_free(&value_labels);
+    parquet_malloc_error(mod_ctx);
+}
+
+static readstat_error_t finish_file(void *ctx) {
+    mod_parquet_ctx_t *mod_ctx = (mod_parquet_ctx_t *)ctx;
+    readstat_error_t error = READSTAT_OK;
+    long i, j;
+
+    if (mod_ctx == NULL)
+        return READSTAT_OK;
+
+    if (mod_ctx->indices == NULL)
+        parquet_begin(mod_ctx);
+    if (mod_ctx->rows_in_group)
+        parquet_write_row_group(mod_ctx);
+    if (!mod_ctx->error)
+        parquet_write_footer(mod_ctx);
+
+    fclose(mod_ctx->out_file);
+    error = mod_ctx->error ? READSTAT_ERROR_WRITE : READSTAT_OK;
+
+    for (i=0; i<mod_ctx->columns_count; i++) {
+        parquet_column_t *column = &mod_ctx->columns[i];
+        free(column->name);
+        free(column->label);
+        free(column->val_labels);
+        parquet_buffer_free(&column->values);
+        parquet_buffer_free(&column->defined);
+    }
+    free(mod_ctx->columns);
+
+    for (i=0; i<mod_ctx->label_sets_count; i++) {
+        parquet_label_set_t *label_set = &mod_ctx->label_sets[i];
+        for (j=0; j<label_set->labels_count; j++) {
+            free(label_set->values[j]);
+            free(label_set->labels[j]);
+        }
+        free(label_set->values);
+        free(label_set->labels);
+        free(label_set->name);
+    }
+    free(mod_ctx->label_sets);
+
+    for (i=0; i<mod_ctx->row_groups_count; i++) {
+        free(mod_ctx->row_groups[i].chunks);
+    }
+    free(mod_ctx->row_groups);
+
+#if HAVE_ZLIB
+    if (mod_ctx->stream_ready)
+        deflateEnd(&mod_ctx->stream);
+#endif
+    ck_hash_table_free(mod_ctx->dictionary_index);
+    free(mod_ctx->indices);
+    parquet_buffer_free(&mod_ctx->dictionary);
+    parquet_buffer_free(&mod_ctx->page);
+    parquet_buffer_free(&mod_ctx->compressed);
+    tc_writer_free(&mod_ctx->thrift);
+    free(mod_ctx->file_label);
+    free(mod_ctx);
+    return error;
+}
+
+static int handle_metadata(readstat_metadata_t *metadata, void *ctx) {
+    mod_parquet_ctx_t *mod_ctx = (mod_parquet_ctx_t *)ctx;
+    const char *file_label = readstat_get_file_label(metadata);
+    if (file_label && mod_ctx->file_label == NULL)
+        mod_ctx->file_label = parquet_strdup(file_label);
+    return readstat_get_var_count(metadata) == 0;
+}
+
+static int handle_value_label(const char *val_labels, readstat_value_t value,
+                              const char *label, void *ctx) {
+    mod_parquet_ctx_t *mod_ctx = (mod_parquet_ctx_t *)ctx;
+    parquet_label_set_t *label_set = parquet_label_set(mod_ctx, val_labels);
+    char buf[FORMAT_DOUBLE_BUFFER_LEN];
+    const char *value_string = buf;
+
+    if (readstat_value_is_system_missing(value))
+        return READSTAT_HANDLER_OK;
+
+    if (label_set == NULL) {
+        parquet_label_set_t *label_sets = parquet_grow(mod_ctx->label_sets, &mod_ctx->label_sets_capacity,
+                mod_ctx->label_sets_count + 1, sizeof(parquet_label_set_t));
+        if (label_sets == NULL)
+            return READSTAT_HANDLER_ABORT;
+        mod_ctx->label_sets = label_sets;
+        label_set = &label_sets[mod_ctx->label_sets_count++];
+        memset(label_set, 0, sizeof(parquet_label_set_t));
+        if ((label_set->name = parquet_strdup(val_labels)) == NULL)
+            return READSTAT_HANDLER_ABORT;
+    }
+
+    if (readstat_value_is_tagged_missing(value)) {
+        snprintf(buf, sizeof(buf), ".%c", readstat_value_tag(value));
+    } else if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        value_string = readstat_string_value(value);
+        if (value_string == NULL)
+            value_string = "";
+    } else {
+        format_double(readstat_double_value(value), buf);
+    }
+
+    long capacity = label_set->labels_capacity;
+    char **values = parquet_grow(label_set->values, &capacity,
+            label_set->labels_count + 1, sizeof(char *));
+    if (values == NULL)
+        return READSTAT_HANDLER_ABORT;
+    label_set->values = values;
+
+    char **labels = parquet_grow(label_set->labels, &label_set->labels_capacity,
+            label_set->labels_count + 1, sizeof(char *));
+    if (labels == NULL)
+        return READSTAT_HANDLER_ABORT;
+    label_set->labels = labels;
+
+    values[label_set->labels_count] = parquet_strdup(value_string);
+    labels[label_set->labels_count] = parquet_strdup(label);
+    label_set->labels_count++;
+
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_variable(int index, readstat_variable_t *variable,
+                           const char *val_labels, void *ctx) {
+    mod_parquet_ctx_t *mod_ctx = (mod_parquet_ctx_t *)ctx;
+    const char *name = readstat_variable_get_name(variable);
+    const char *label = readstat_variable_get_label(variable);
+    parquet_column_t *column = NULL;
+
+    if (index >= mod_ctx->columns_count) {
+        parquet_column_t *columns = realloc(mod_ctx->columns, (index + 1) * sizeof(parquet_column_t));
+        if (columns == NULL)
+            return READSTAT_HANDLER_ABORT;
+        memset(&columns[mod_ctx->columns_count], 0,
+                (index + 1 - mod_ctx->columns_count) * sizeof(parquet_column_t));
+        mod_ctx->columns = columns;
+        mod_ctx->columns_count = index + 1;
+    }
+
+    column = &mod_ctx->columns[index];
+    column->type = readstat_variable_get_type(variable);
+    if (column->type == READSTAT_TYPE_STRING_REF)
+        column->type = READSTAT_TYPE_STRING;
+    column->name = name ? parquet_strdup(name) : NULL;
+    column->label = label ? parquet_strdup(label) : NULL;
+    column->val_labels = val_labels ? parquet_strdup(val_labels) : NULL;
+
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx) {
+    mod_parquet_ctx_t *mod_ctx = (mod_parquet_ctx_t *)ctx;
+    int var_index = readstat_variable_get_index(variable);
+    parquet_column_t *column = NULL;
+    int is_null = 0;
+    int failed = 0;
+
+    if (mod_ctx->indices == NULL && parquet_begin(mod_ctx) != 0)
+        return READSTAT_HANDLER_ABORT;
+
+    if (var_index >= mod_ctx->columns_count)
+        return READSTAT_HANDLER_ABORT;
+
+    column = &mod_ctx->columns[var_index];
+    is_null = (readstat_value_is_system_missing(value) || readstat_value_is_tagged_missing(value));
+
+    if (is_null) {
+        column->null_count++;
+    } else if (column->physical_type == PARQUET_TYPE_BYTE_ARRAY) {
+        const char *string = readstat_string_value(value);
+        size_t len = string ? strlen(string) : 0;
+        unsigned char prefix[4];
+        parquet_put_uint32(prefix, len);
+        failed = (parquet_buffer_append(&column->values, prefix, sizeof(prefix)) != 0 ||
+                parquet_buffer_append(&column->values, string, len) != 0);
+    } else if (column->physical_type == PARQUET_TYPE_INT32) {
+        /* PLAIN is little-endian whatever the host */
+        unsigned char bytes[4];
+        parquet_put_uint32(bytes, (uint32_t)readstat_int32_value(value));
+        failed = parquet_buffer_append(&column->values, bytes, sizeof(bytes));
+    } else if (column->physical_type == PARQUET_TYPE_FLOAT) {
+        float v = readstat_float_value(value);
+        uint32_t bits;
+        unsigned char bytes[4];
+        memcpy(&bits, &v, sizeof(float));
+        parquet_put_uint32(bytes, bits);
+        failed = parquet_buffer_append(&column->values, bytes, sizeof(bytes));
+    } else if (column->physical_type == PARQUET_TYPE_DOUBLE) {
+        double v = readstat_double_value(value);
+        uint64_t bits;
+        unsigned char bytes[8];
+        memcpy(&bits, &v, sizeof(double));
+        parquet_put_uint64(bytes, bits);
+        failed = parquet_buffer_append(&column->values, bytes, sizeof(bytes));
+    }
+
+    if (failed || parquet_buffer_append_byte(&column->defined, !is_null) != 0) {
+        parquet_malloc_error(mod_ctx);
+        return READSTAT_HANDLER_ABORT;
+    }
+
+    if (var_index == mod_ctx->columns_count - 1) {
+        mod_ctx->rows_count++;
+        if (++mod_ctx->rows_in_group == mod_ctx->row_group_size)
+            parquet_write_row_group(mod_ctx);
+    }
+
+    return mod_ctx->error ? READSTAT_HANDLER_ABORT : READSTAT_HANDLER_OK;
+}
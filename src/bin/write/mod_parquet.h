@@ -0,0 +1 @@
+extern rs_module_t rs_mod_parquet;
@@ -30,8 +30,8 @@ typedef struct mod_readstat_ctx_s {
 static ssize_t write_data(const void *bytes, size_t len, void *ctx);
 
 static int accept_file(const char *filename);
-static void *ctx_init(const char *filename);
-static void finish_file(void *ctx);
+static void *ctx_init(const char *filename, const rs_mod_options_t *options);
+static readstat_error_t finish_file(void *ctx);
 
 static int handle_fweight(readstat_variable_t *variable, void *ctx);
 static int handle_metadata(readstat_metadata_t *metadata, void *ctx);
@@ -70,7 +70,7 @@ static int accept_file(const char *filename) {
             rs_ends_with(filename, ".xpt"));
 }
 
-static void *ctx_init(const char *filename) {
+static void *ctx_init(const char *filename, const rs_mod_options_t *options) {
     mod_readstat_ctx_t *mod_ctx = malloc(sizeof(mod_readstat_ctx_t));
     mod_ctx->label_set_dict = ck_hash_table_init(1024);
     mod_ctx->is_sav = rs_ends_with(filename, ".sav");
@@ -92,7 +92,7 @@ static void *ctx_init(const char *filename) {
     return mod_ctx;
 }
 
-void finish_file(void *ctx) {
+readstat_error_t finish_file(void *ctx) {
     mod_readstat_ctx_t *mod_ctx = (mod_readstat_ctx_t *)ctx;
     if (mod_ctx) {
         if (mod_ctx->out_fd != -1)
@@ -103,6 +103,7 @@ void finish_file(void *ctx) {
             readstat_writer_free(mod_ctx->writer);
         free(mod_ctx);
     }
+    return READSTAT_OK;
 }
 
 static int handle_fweight(readstat_variable_t *variable, void *ctx) {
@@ -20,8 +20,8 @@ typedef struct mod_xlsx_ctx_s {
 } mod_xlsx_ctx_t;
 
 static int accept_file(const char *filename);
-static void *ctx_init(const char *filename);
-static void finish_file(void *ctx);
+static void *ctx_init(const char *filename, const rs_mod_options_t *options);
+static readstat_error_t finish_file(void *ctx);
 static int handle_variable(int index, readstat_variable_t *variable,
                            const char *val_labels, void *ctx);
 static int handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx);
@@ -40,7 +40,7 @@ static int accept_file(const char *filename) {
     return rs_ends_with(filename, ".xlsx");
 }
 
-static void *ctx_init(const char *filename) {
+static void *ctx_init(const char *filename, const rs_mod_options_t *options) {
     mod_xlsx_ctx_t *mod_ctx = malloc(sizeof(mod_xlsx_ctx_t));
     mod_ctx->workbook = workbook_new(filename);
     mod_ctx->worksheet = workbook_add_worksheet(mod_ctx->workbook, "Data");
@@ -55,7 +55,7 @@ static void *ctx_init(const char *filename) {
     return mod_ctx;
 }
 
-static void finish_file(void *ctx) {
+static readstat_error_t finish_file(void *ctx) {
     mod_xlsx_ctx_t *mod_ctx = (mod_xlsx_ctx_t *)ctx;
     if (mod_ctx) {
         if (mod_ctx->row_count > MIN_ROWS_TO_SPLIT) {
@@ -64,6 +64,7 @@ static void finish_file(void *ctx) {
         workbook_close(mod_ctx->workbook);
         free(mod_ctx);
     }
+    return READSTAT_OK;
 }
 
 static int handle_variable(int index, readstat_variable_t *variable,
@@ -1,6 +1,10 @@
+typedef struct rs_mod_options_s {
+    long    batch_size; /* Rows per record batch or row group; 0 for the module's default */
+} rs_mod_options_t;
+
 typedef int (*rs_mod_will_write_file)(const char *filename);
-typedef void * (*rs_mod_ctx_init)(const char *filename);
-typedef void (*rs_mod_finish_file)(void *ctx);
+typedef void * (*rs_mod_ctx_init)(const char *filename, const rs_mod_options_t *options);
+typedef readstat_error_t (*rs_mod_finish_file)(void *ctx);
 
 typedef struct rs_module_s {
     rs_mod_will_write_file  accept;
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "thrift_compact.h"
+
+static void tc_write(tc_writer_t *w, const void *bytes, size_t len) {
+    if (w->error)
+        return;
+
+    if (w->used + len > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity : 1024;
+        unsigned char *new_bytes = NULL;
+        while (capacity < w->used + len)
+            capacity *= 2;
+        if ((new_bytes = realloc(w->bytes, capacity)) == NULL) {
+            w->error = 1;
+            return;
+        }
+        w->bytes = new_bytes;
+        w->capacity = capacity;
+    }
+    memcpy(&w->bytes[w->used], bytes, len);
+    w->used += len;
+}
+
+static void tc_varint(tc_writer_t *w, uint64_t value) {
+    unsigned char bytes[10];
+    int len = 0;
+    while (value >= 0x80) {
+        bytes[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    bytes[len++] = value;
+    tc_write(w, bytes, len);
+}
+
+static uint64_t tc_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static void tc_field_header(tc_writer_t *w, int field, int type) {
+    int delta = field - w->last_field[w->depth];
+    if (delta > 0 && delta <= 15) {
+        unsigned char byte = (delta << 4) | type;
+        tc_write(w, &byte, 1);
+    } else {
+        unsigned char byte = type;
+        tc_write(w, &byte, 1);
+        tc_varint(w, tc_zigzag(field));
+    }
+    w->last_field[w->depth] = field;
+}
+
+void tc_writer_reset(tc_writer_t *w) {
+    w->used = 0;
+    w->error = 0;
+    w->depth = 0;
+    w->last_field[0] = 0;
+}
+
+void tc_writer_free(tc_writer_t *w) {
+    free(w->bytes);
+    memset(w, 0, sizeof(tc_writer_t));
+}
+
+void tc_struct_begin(tc_writer_t *w) {
+    if (w->depth + 1 >= TC_MAX_DEPTH) {
+        w->error = 1;
+        return;
+    }
+    w->last_field[++w->depth] = 0;
+}
+
+void tc_struct_end(tc_writer_t *w) {
+    unsigned char stop = 0;
+    tc_write(w, &stop, 1);
+    if (w->depth > 0)
+        w->depth--;
+}
+
+void tc_field_i32(tc_writer_t *w, int field, int32_t value) {
+    tc_field_header(w, field, TC_TYPE_I32);
+    tc_varint(w, tc_zigzag(value));
+}
+
+void tc_field_i64(tc_writer_t *w, int field, int64_t value) {
+    tc_field_header(w, field, TC_TYPE_I64);
+    tc_varint(w, tc_zigzag(value));
+}
+
+void tc_field_bool(tc_writer_t *w, int field, int value) {
+    tc_field_header(w, field, value ? TC_TYPE_BOOLEAN_TRUE : TC_TYPE_BOOLEAN_FALSE);
+}
+
+void tc_field_string(tc_writer_t *w, int field, const char *string) {
+    tc_field_header(w, field, TC_TYPE_BINARY);
+    tc_string(w, string);
+}
+
+void tc_field_struct_begin(tc_writer_t *w, int field) {
+    tc_field_header(w, field, TC_TYPE_STRUCT);
+    tc_struct_begin(w);
+}
+
+void tc_field_list_begin(tc_writer_t *w, int field, int element_type, long count) {
+    tc_field_header(w, field, TC_TYPE_LIST);
+    if (count < 15) {
+        unsigned char byte = (count << 4) | element_type;
+        tc_write(w, &byte, 1);
+    } else {
+        unsigned char byte = 0xF0 | element_type;
+        tc_write(w, &byte, 1);
+        tc_varint(w, count);
+    }
+}
+
+void tc_i32(tc_writer_t *w, int32_t value) {
+    tc_varint(w, tc_zigzag(value));
+}
+
+void tc_string(tc_writer_t *w, const char *string) {
+    size_t len = strlen(string);
+    tc_varint(w, len);
+    tc_write(w, string, len);
+}
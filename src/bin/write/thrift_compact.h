@@ -0,0 +1,41 @@
+//
+//  thrift_compact.h - A minimal Thrift compact protocol writer for the
+//  Parquet writer
+//
+
+#define TC_MAX_DEPTH    16
+
+#define TC_TYPE_BOOLEAN_TRUE    1
+#define TC_TYPE_BOOLEAN_FALSE   2
+#define TC_TYPE_I32             5
+#define TC_TYPE_I64             6
+#define TC_TYPE_BINARY          8
+#define TC_TYPE_LIST            9
+#define TC_TYPE_STRUCT         12
+
+typedef struct tc_writer_s {
+    unsigned char  *bytes;
+    size_t          used;
+    size_t          capacity;
+    int             error;
+    int             depth;
+    int             last_field[TC_MAX_DEPTH];
+} tc_writer_t;
+
+void tc_writer_reset(tc_writer_t *w);
+void tc_writer_free(tc_writer_t *w);
+
+/* A struct at the top level or as a list element */
+void tc_struct_begin(tc_writer_t *w);
+void tc_struct_end(tc_writer_t *w);
+
+void tc_field_i32(tc_writer_t *w, int field, int32_t value);
+void tc_field_i64(tc_writer_t *w, int field, int64_t value);
+void tc_field_bool(tc_writer_t *w, int field, int value);
+void tc_field_string(tc_writer_t *w, int field, const char *string);
+void tc_field_struct_begin(tc_writer_t *w, int field);
+void tc_field_list_begin(tc_writer_t *w, int field, int element_type, long count);
+
+/* List elements */
+void tc_i32(tc_writer_t *w, int32_t value);
+void tc_string(tc_writer_t *w, const char *string);
@@ -1,9 +1,33 @@
 #include <stdlib.h>
 
 #include "../readstat.h"
+#include "../readstat_iconv.h"
+#include "../CKHashTable.h"
+#include "../spss/readstat_spss.h"
+#include "../spss/readstat_por.h"
 #include "../spss/readstat_por_parse.h"
 
 int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
-    readstat_por_parse_double((const char *)Data, Size, NULL, NULL, NULL);
+    uint16_t byte2unicode[256] = { 0 };
+    uint8_t byte2base30[256];
+    double slow_value = 0.0, fast_value = 0.0;
+    int i;
+
+    for (i=0x20; i<0x7F; i++) {
+        byte2unicode[i] = i;
+    }
+    por_build_base30_lookup(byte2base30, byte2unicode);
+
+    ssize_t slow_len = readstat_por_parse_double((const char *)Data, Size, &slow_value, NULL, NULL);
+    ssize_t fast_len = por_parse_base30_double(Data, Size, byte2base30, &fast_value);
+
+    /* The fast parser must agree with the Ragel machine whenever it succeeds */
+    if (fast_len != -1) {
+        if (slow_len != fast_len)
+            abort();
+        if (memcmp(&slow_value, &fast_value, sizeof(double)) != 0 &&
+                !(isnan(slow_value) && isnan(fast_value)))
+            abort();
+    }
     return 0;
 }
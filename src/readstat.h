@@ -104,11 +104,27 @@ typedef enum readstat_error_e {
     READSTAT_ERROR_TOO_FEW_COLUMNS,
     READSTAT_ERROR_TOO_MANY_COLUMNS,
     READSTAT_ERROR_NAME_IS_ZERO_LENGTH,
-    READSTAT_ERROR_BAD_TIMESTAMP_VALUE
+    READSTAT_ERROR_BAD_TIMESTAMP_VALUE,
+    READSTAT_ERROR_ALLOCATION_TOO_LARGE,
+    READSTAT_ERROR_MEMORY_LIMIT_EXCEEDED
 } readstat_error_t;
 
 const char *readstat_error_message(readstat_error_t error_code);
 
+typedef void *(*readstat_malloc_handler)(size_t len);
+typedef void *(*readstat_realloc_handler)(void *ptr, size_t len);
+typedef void (*readstat_free_handler)(void *ptr);
+
+// Replaces the system allocator for the buffers, tables and arenas that parsers
+// and writers allocate while they run, e.g. to account for their memory or to
+// use a per-thread heap. A NULL handler restores the system one. Not thread-safe:
+// call it before any parser or writer is in use.
+void readstat_set_allocator(readstat_malloc_handler malloc_handler,
+        readstat_realloc_handler realloc_handler, readstat_free_handler free_handler);
+
+// Default for readstat_set_max_allocation() and readstat_writer_set_max_allocation()
+#define READSTAT_DEFAULT_MAX_ALLOCATION 0xFFF000
+
 typedef struct readstat_metadata_s {
     int64_t     row_count;
     int64_t     var_count;
@@ -148,6 +164,8 @@ typedef struct readstat_value_s {
     char                    tag;
     unsigned int            is_system_missing:1;
     unsigned int            is_tagged_missing:1;
+    unsigned int            is_defined_missing:1;   // set by the SAV and POR readers
+    unsigned int            is_dictionary_encoded:1;    // see readstat_set_string_dictionary_limit()
 } readstat_value_t;
 
 /* Internal data structures */
@@ -174,24 +192,45 @@ typedef struct readstat_label_set_s {
     void                       *variables;
     long                        variables_count;
     long                        variables_capacity;
+
+    struct readstat_arena_s    *arena;
+
+    // Set by the parser under readstat_set_value_label_lookup(); NULL otherwise
+    struct readstat_label_lookup_s *lookup;
 } readstat_label_set_t;
 
 typedef struct readstat_missingness_s {
     readstat_value_t missing_ranges[32];
     long             missing_ranges_count;
+
+    // The same rules as SPSS allows them -- up to three discrete values and at
+    // most one numeric range -- filled in by the SAV and POR readers and
+    // checked in place of missing_ranges when is_compiled is set
+    int              is_compiled;
+    int              discrete_count;
+    double           discrete_doubles[3];
+    const char      *discrete_strings[3];
+    int              has_range;
+    double           range_lo;
+    double           range_hi;
 } readstat_missingness_t;
 
+struct readstat_arena_s;
+
+// Variables are allocated from an arena that lives as long as the parse (or
+// the writer). The strings are never NULL: unset ones point to "". Missing
+// value definitions are allocated only for variables that have them.
 typedef struct readstat_variable_s {
     readstat_type_t         type;
     int                     index;
-    char                    name[300];
-    char                    format[256];
-    char                    label[1024];
+    const char             *name;
+    const char             *format;
+    const char             *label;
     readstat_label_set_t   *label_set;
     off_t                   offset;
     size_t                  storage_width;
     size_t                  user_width;
-    readstat_missingness_t  missingness;
+    readstat_missingness_t *missingness;
     readstat_measure_t      measure;
     readstat_alignment_t    alignment;
     int                     display_width;
@@ -218,6 +257,7 @@ typedef struct readstat_schema_s {
     int                     entry_count;
     char                    field_delimiter;
     readstat_schema_entry_t *entries;
+    struct readstat_arena_s *arena;
 } readstat_schema_t;
 
 /* Value accessors */
@@ -239,7 +279,9 @@ readstat_type_class_t readstat_value_type_class(readstat_value_t value);
  *       readstat_variable_get_missing_range_lo()
  *       readstat_variable_get_missing_range_hi()
  *
- * Note that "ranges" include individual values where lo == hi.
+ * Note that "ranges" include individual values where lo == hi. Values read
+ * from SPSS files arrive with is_defined_missing already set when the rules
+ * match, so readstat_value_is_defined_missing() is a single test for them.
  *
  * readstat_value_is_missing() is equivalent to:
  *
@@ -251,6 +293,10 @@ int readstat_value_is_missing(readstat_value_t value, readstat_variable_t *varia
 int readstat_value_is_system_missing(readstat_value_t value);
 int readstat_value_is_tagged_missing(readstat_value_t value);
 int readstat_value_is_defined_missing(readstat_value_t value, readstat_variable_t *variable);
+
+/* The code of a string from the column's dictionary, or -1 if the string
+ * didn't come from one; see readstat_set_string_dictionary_limit() */
+int readstat_value_dictionary_code(readstat_value_t value);
 char readstat_value_tag(readstat_value_t value);
 
 char readstat_int8_value(readstat_value_t value);
@@ -279,6 +325,11 @@ int readstat_variable_get_missing_ranges_count(const readstat_variable_t *variab
 readstat_value_t readstat_variable_get_missing_range_lo(const readstat_variable_t *variable, int i);
 readstat_value_t readstat_variable_get_missing_range_hi(const readstat_variable_t *variable, int i);
 
+// The label for `value' in the variable's value label set, or NULL. Needs
+// readstat_set_value_label_lookup(); works from the value handler, and after
+// the parse until the parser starts another.
+const char *readstat_lookup_value_label(const readstat_variable_t *variable, readstat_value_t value);
+
 /* Callbacks should return 0 (aka READSTAT_HANDLER_OK) on success and 1 (aka READSTAT_HANDLER_ABORT) to abort. */
 /* If the variable handler returns READSTAT_HANDLER_SKIP_VARIABLE, the value handler will not be called on
  * the associated variable. (Note that subsequent variables will retain their original index values.)
@@ -294,6 +345,10 @@ typedef int (*readstat_value_label_handler)(const char *val_labels,
         readstat_value_t value, const char *label, void *ctx);
 typedef void (*readstat_error_handler)(const char *error_message, void *ctx);
 typedef int (*readstat_progress_handler)(double progress, void *ctx);
+typedef int (*readstat_dictionary_entry_handler)(readstat_variable_t *variable,
+        int code, const char *string, void *ctx);
+typedef int (*readstat_string_view_handler)(int obs_index, readstat_variable_t *variable,
+        const char *string, size_t len, void *ctx);
 
 #if defined _WIN32 || defined __CYGWIN__
 typedef _off64_t readstat_off_t;
@@ -334,8 +389,37 @@ typedef struct readstat_callbacks_s {
     readstat_value_label_handler   value_label;
     readstat_error_handler         error;
     readstat_progress_handler      progress;
+    readstat_dictionary_entry_handler dictionary_entry;
+    readstat_string_view_handler   string_view;
 } readstat_callbacks_t;
 
+// Counters for a single parse; see readstat_parser_get_stats()
+typedef struct readstat_parser_stats_s {
+    uint64_t                bytes_read;
+    uint64_t                read_calls;
+    uint64_t                seek_calls;
+    uint64_t                pages_processed;        // SAS7BDAT/SAS7BCAT pages and ZSAV blocks
+    uint64_t                rows_decoded;
+    uint64_t                rows_skipped;           // because of readstat_set_row_offset()
+    uint64_t                string_conversions;
+    uint64_t                iconv_calls;
+    uint64_t                bytes_decompressed;
+    double                  decompression_seconds;
+    double                  conversion_seconds;     // time spent in iconv
+    double                  callback_seconds;       // time spent in the handlers
+    size_t                  peak_buffer_size;       // largest single buffer allocated
+    size_t                  peak_memory_used;       // most memory held at once
+} readstat_parser_stats_t;
+
+typedef enum readstat_value_label_lookup_e {
+    READSTAT_VALUE_LABEL_LOOKUP_NONE,
+    READSTAT_VALUE_LABEL_LOOKUP_INDEX,      // readstat_lookup_value_label()
+    READSTAT_VALUE_LABEL_LOOKUP_SUBSTITUTE  // ...and labelled values arrive as their labels
+} readstat_value_label_lookup_t;
+
+struct readstat_label_index_s;
+struct readstat_reuse_s;
+
 typedef struct readstat_parser_s {
     readstat_callbacks_t    handlers;
     readstat_io_t          *io;
@@ -343,6 +427,19 @@ typedef struct readstat_parser_s {
     const char             *output_encoding;
     long                    row_limit;
     long                    row_offset;
+    int                     thread_count;
+    int                     prefetch_depth;
+    long                    progress_interval_bytes;
+    long                    progress_interval_ms;
+    size_t                  max_allocation;
+    size_t                  memory_limit;
+    readstat_value_label_lookup_t value_label_lookup;
+    int                     string_dictionary_limit;
+    struct readstat_label_index_s *label_index;
+    int                     context_reuse;
+    struct readstat_reuse_s *reuse;
+    int                     collect_stats;
+    readstat_parser_stats_t stats;
 } readstat_parser_t;
 
 readstat_parser_t *readstat_parser_init(void);
@@ -357,6 +454,16 @@ readstat_error_t readstat_set_value_handler(readstat_parser_t *parser, readstat_
 readstat_error_t readstat_set_value_label_handler(readstat_parser_t *parser, readstat_value_label_handler value_label_handler);
 readstat_error_t readstat_set_error_handler(readstat_parser_t *parser, readstat_error_handler error_handler);
 readstat_error_t readstat_set_progress_handler(readstat_parser_t *parser, readstat_progress_handler progress_handler);
+readstat_error_t readstat_set_dictionary_entry_handler(readstat_parser_t *parser, readstat_dictionary_entry_handler dictionary_entry_handler);
+
+// String cells go to this handler, if set, instead of the value handler (which
+// is still needed for the data to be read at all). `string' has trailing
+// spaces removed, is `len' bytes long and is NOT NUL-terminated; it's valid
+// only during the call. When the file is already in the handler encoding it
+// points straight into the file's page or record buffer. Covers DTA, SAV,
+// SAS7BDAT and text files, except for DTA strLs; other formats keep using the
+// value handler.
+readstat_error_t readstat_set_string_view_handler(readstat_parser_t *parser, readstat_string_view_handler string_view_handler);
 
 readstat_error_t readstat_set_open_handler(readstat_parser_t *parser, readstat_open_handler open_handler);
 readstat_error_t readstat_set_close_handler(readstat_parser_t *parser, readstat_close_handler close_handler);
@@ -376,6 +483,76 @@ readstat_error_t readstat_set_handler_character_encoding(readstat_parser_t *pars
 readstat_error_t readstat_set_row_limit(readstat_parser_t *parser, long row_limit);
 readstat_error_t readstat_set_row_offset(readstat_parser_t *parser, long row_offset);
 
+// Decode fixed-width records (DTA, XPORT, uncompressed SAV) on up to `thread_count'
+// threads. Values are still passed to the value handler one at a time, in
+// row order, on the calling thread. Defaults to 1.
+readstat_error_t readstat_set_thread_count(readstat_parser_t *parser, int thread_count);
+
+// Read data pages and records ahead of the parser on a background thread,
+// keeping up to `depth' (at most 8) 1 MB blocks in flight. Useful when reads
+// are slow, e.g. on network filesystems. Defaults to 0 (off).
+readstat_error_t readstat_set_prefetch_depth(readstat_parser_t *parser, int depth);
+
+// Call the progress handler only after at least `bytes' more of the file have
+// been read and at least `milliseconds' have passed since the last call. The
+// first update of a parse is always delivered. Pass 0 to ignore either limit.
+// Defaults to 0 and 0 (every update).
+readstat_error_t readstat_set_progress_interval(readstat_parser_t *parser, long bytes, long milliseconds);
+
+// Fail the parse with READSTAT_ERROR_ALLOCATION_TOO_LARGE if it needs a single
+// buffer bigger than `max_len' bytes. The default of ~16 MB guards against
+// malformed files; raise it for very wide rows or big compressed blocks in
+// files you trust. Pass 0 for no limit.
+readstat_error_t readstat_set_max_allocation(readstat_parser_t *parser, size_t max_len);
+
+// Fail the parse with READSTAT_ERROR_MEMORY_LIMIT_EXCEEDED if the memory it
+// holds at any one time would exceed `limit' bytes. Only the library's own
+// allocations are counted, not the handlers'. Defaults to 0 (no limit).
+readstat_error_t readstat_set_memory_limit(readstat_parser_t *parser, size_t limit);
+
+// Keep the value labels in a hash table keyed by set name and value, and point
+// each labelled variable's label_set at its set, for readstat_lookup_value_label().
+// Labels are read before the data, even where the file puts them after it.
+// Each parse sees only its own file's labels, except that a SAS7BDAT file
+// parsed right after a SAS7BCAT file with the same parser gets the catalog's,
+// as a text file does the labels of the schema read before it.
+// With READSTAT_VALUE_LABEL_LOOKUP_SUBSTITUTE, the value handler gets a
+// READSTAT_TYPE_STRING value holding the label in place of any labelled value.
+// Defaults to READSTAT_VALUE_LABEL_LOOKUP_NONE.
+readstat_error_t readstat_set_value_label_lookup(readstat_parser_t *parser, readstat_value_label_lookup_t mode);
+
+// Convert each distinct string in a column only once (DTA, SAV and SAS7BDAT
+// files). The value handler gets strings that stay valid for the whole parse,
+// numbered per column by readstat_value_dictionary_code(), and the dictionary
+// entry handler is told about each new string before its first use. A column
+// with more than `max_entries' distinct strings goes back to plain strings
+// from then on. Defaults to 0 (off).
+readstat_error_t readstat_set_string_dictionary_limit(readstat_parser_t *parser, int max_entries);
+
+// Keep the format context, arena and buffers of each parse for the next one
+// with this parser, instead of allocating them afresh, and read files of up
+// to 1 MB into a kept buffer in a single read. Meant for parsing many small
+// files one after another (DTA and SAV files; other formats ignore it). What
+// a parse hands to the handlers stays valid only during that parse, as
+// before. What is kept counts towards the memory limit and peak_memory_used
+// of each later parse. Turning it off releases what has been kept. Defaults
+// to 0 (off).
+readstat_error_t readstat_set_context_reuse(readstat_parser_t *parser, int enabled);
+
+// Also count string conversions and iconv calls for readstat_parser_get_stats(),
+// and time the handlers, iconv and decompression. This wraps the handlers in
+// timing proxies and so costs a little on every value. Defaults to 0 (off).
+readstat_error_t readstat_set_collect_stats(readstat_parser_t *parser, int enabled);
+
+// Copies out the counters for the most recent parse with this parser, or for
+// the parse in progress if called from a handler. Timers on per-value paths
+// (handlers, iconv, SAS and SAV row decompression) time a random sample of
+// calls and scale up. Time spent on worker threads is summed across threads.
+// string_conversions, iconv_calls and the timers are zero unless
+// readstat_set_collect_stats() was on for the parse; the rest are always
+// counted.
+readstat_error_t readstat_parser_get_stats(readstat_parser_t *parser, readstat_parser_stats_t *stats);
+
 /* Parse binary / portable files */
 readstat_error_t readstat_parse_dta(readstat_parser_t *parser, const char *path, void *user_ctx);
 readstat_error_t readstat_parse_sav(readstat_parser_t *parser, const char *path, void *user_ctx);
@@ -461,6 +638,7 @@ typedef struct readstat_writer_s {
     readstat_variable_t       **variables;
     long                        variables_count;
     long                        variables_capacity;
+    struct readstat_arena_s    *arena;
 
     readstat_label_set_t      **label_sets;
     long                        label_sets_count;
@@ -485,6 +663,7 @@ typedef struct readstat_writer_s {
 
     readstat_writer_callbacks_t callbacks;
     readstat_error_handler      error_handler;
+    size_t                      max_allocation;
 
     void                       *module_ctx;
     void                       *user_ctx;
@@ -511,6 +690,7 @@ void readstat_label_tagged_value(readstat_label_set_t *label_set, char tag, cons
 // Now define your variables. Note that `storage_width' is used for:
 // * READSTAT_TYPE_STRING variables in all formats
 // * READSTAT_TYPE_DOUBLE variables, but only in the SAS XPORT format (valid values 3-8, defaults to 8)
+// Returns NULL, without adding the variable, if out of memory.
 readstat_variable_t *readstat_add_variable(readstat_writer_t *writer, const char *name, readstat_type_t type, 
         size_t storage_width);
 void readstat_variable_set_label(readstat_variable_t *variable, const char *label);
@@ -564,6 +744,10 @@ readstat_error_t readstat_writer_set_compression(readstat_writer_t *writer,
 readstat_error_t readstat_writer_set_error_handler(readstat_writer_t *writer, 
         readstat_error_handler error_handler);
 
+// Largest row or compression buffer the writer may allocate; see
+// readstat_set_max_allocation(). Pass 0 for no limit.
+readstat_error_t readstat_writer_set_max_allocation(readstat_writer_t *writer, size_t max_len);
+
 // Call one of these at any time before the first invocation of readstat_begin_row
 readstat_error_t readstat_begin_writing_dta(readstat_writer_t *writer, void *user_ctx, long row_count);
 readstat_error_t readstat_begin_writing_por(readstat_writer_t *writer, void *user_ctx, long row_count);
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "readstat.h"
+#include "readstat_malloc.h"
+#include "readstat_arena.h"
+
+#define ARENA_CHUNK_SIZE        0x10000
+#define ARENA_ALIGNMENT         16
+#define ARENA_INTERN_MIN_SLOTS  256
+
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *next;
+    size_t                size;
+    size_t                used;
+    unsigned char        *data;
+} arena_chunk_t;
+
+struct readstat_arena_s {
+    arena_chunk_t  *chunks;
+
+    /* Open-addressed set of interned strings */
+    const char    **interned;
+    size_t          interned_count;
+    size_t          interned_capacity;
+    int             interning_disabled;
+};
+
+static arena_chunk_t *arena_add_chunk(readstat_arena_t *arena, size_t size) {
+    arena_chunk_t *chunk = NULL;
+    size_t header_len = (sizeof(arena_chunk_t) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    if ((chunk = readstat_malloc(header_len + size)) == NULL)
+        return NULL;
+
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->data = (unsigned char *)chunk + header_len;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+
+    return chunk;
+}
+
+/* Strings are packed with `align' 1; everything else uses ARENA_ALIGNMENT */
+static void *arena_alloc(readstat_arena_t *arena, size_t len, size_t align) {
+    arena_chunk_t *chunk = arena->chunks;
+    void *ptr = NULL;
+
+    if (len > ARENA_CHUNK_SIZE / 4) {
+        /* Big allocations get a chunk of their own, behind the current one
+         * so that its free space isn't wasted */
+        arena_chunk_t *big = NULL;
+        if ((big = arena_add_chunk(arena, len)) == NULL)
+            return NULL;
+        big->used = len;
+        if (chunk) {
+            arena->chunks = chunk;
+            big->next = chunk->next;
+            chunk->next = big;
+        }
+        return big->data;
+    }
+
+    if (chunk) {
+        chunk->used = (chunk->used + align - 1) & ~(align - 1);
+        if (chunk->used > chunk->size)
+            chunk->used = chunk->size;
+    }
+
+    if (chunk == NULL || chunk->size - chunk->used < len) {
+        if ((chunk = arena_add_chunk(arena, ARENA_CHUNK_SIZE)) == NULL)
+            return NULL;
+    }
+
+    ptr = &chunk->data[chunk->used];
+    chunk->used += len;
+    return ptr;
+}
+
+readstat_arena_t *readstat_arena_init(void) {
+    return readstat_calloc(1, sizeof(readstat_arena_t));
+}
+
+void readstat_arena_free(readstat_arena_t *arena) {
+    if (arena == NULL)
+        return;
+
+    arena_chunk_t *chunk = arena->chunks;
+    while (chunk) {
+        arena_chunk_t *next = chunk->next;
+        readstat_free(chunk);
+        chunk = next;
+    }
+    readstat_free(arena->interned);
+    readstat_free(arena);
+}
+
+void readstat_arena_reset(readstat_arena_t *arena) {
+    arena_chunk_t *chunk = arena->chunks;
+    arena_chunk_t *keep = NULL;
+
+    while (chunk) {
+        arena_chunk_t *next = chunk->next;
+        if (keep == NULL && chunk->size == ARENA_CHUNK_SIZE) {
+            keep = chunk;
+        } else {
+            readstat_free(chunk);
+        }
+        chunk = next;
+    }
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arena->chunks = keep;
+
+    if (arena->interned_count)
+        memset(arena->interned, 0, arena->interned_capacity * sizeof(const char *));
+    arena->interned_count = 0;
+    arena->interning_disabled = 0;
+}
+
+void *readstat_arena_alloc(readstat_arena_t *arena, size_t len) {
+    if (len == 0)
+        return NULL;
+    return arena_alloc(arena, len, ARENA_ALIGNMENT);
+}
+
+void *readstat_arena_calloc(readstat_arena_t *arena, size_t count, size_t size) {
+    void *ptr = NULL;
+    if (count == 0 || size == 0 || count > SIZE_MAX / size)
+        return NULL;
+    if ((ptr = arena_alloc(arena, count * size, ARENA_ALIGNMENT)) == NULL)
+        return NULL;
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+static uint64_t arena_hash(const char *str, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+    for (i=0; i<len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int arena_grow_interned(readstat_arena_t *arena) {
+    size_t capacity = arena->interned_capacity ? 2 * arena->interned_capacity : ARENA_INTERN_MIN_SLOTS;
+    const char **interned = NULL;
+    size_t i;
+
+    if ((interned = readstat_calloc(capacity, sizeof(const char *))) == NULL)
+        return -1;
+
+    for (i=0; i<arena->interned_capacity; i++) {
+        const char *str = arena->interned[i];
+        if (str) {
+            size_t slot = arena_hash(str, strlen(str)) & (capacity - 1);
+            while (interned[slot])
+                slot = (slot + 1) & (capacity - 1);
+            interned[slot] = str;
+        }
+    }
+
+    readstat_free(arena->interned);
+    arena->interned = interned;
+    arena->interned_capacity = capacity;
+    return 0;
+}
+
+const char *readstat_arena_intern(readstat_arena_t *arena, const char *str, size_t len) {
+    const char *end = memchr(str, '\0', len);
+    char *copy = NULL;
+    size_t slot = 0;
+
+    if (end)
+        len = end - str;
+    if (len == 0)
+        return "";
+
+    if (!arena->interning_disabled && 2 * (arena->interned_count + 1) > arena->interned_capacity) {
+        /* Past the allocation limit, keep going without sharing copies */
+        if (arena_grow_interned(arena) == -1)
+            arena->interning_disabled = 1;
+    }
+
+    if (!arena->interning_disabled) {
+        slot = arena_hash(str, len) & (arena->interned_capacity - 1);
+        while (arena->interned[slot]) {
+            const char *candidate = arena->interned[slot];
+            if (strncmp(candidate, str, len) == 0 && candidate[len] == '\0')
+                return candidate;
+            slot = (slot + 1) & (arena->interned_capacity - 1);
+        }
+    }
+
+    if ((copy = arena_alloc(arena, len + 1, 1)) == NULL)
+        return NULL;
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    if (!arena->interning_disabled) {
+        arena->interned[slot] = copy;
+        arena->interned_count++;
+    }
+
+    return copy;
+}
+
+readstat_variable_t *readstat_arena_variable(readstat_arena_t *arena) {
+    readstat_variable_t *variable = readstat_arena_calloc(arena, 1, sizeof(readstat_variable_t));
+    if (variable) {
+        variable->name = "";
+        variable->format = "";
+        variable->label = "";
+    }
+    return variable;
+}
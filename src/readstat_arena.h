@@ -0,0 +1,29 @@
+//
+//  readstat_arena.h - Allocation for objects that live as long as a parse
+//  (or a writer), released all at once
+//
+
+typedef struct readstat_arena_s readstat_arena_t;
+
+readstat_arena_t *readstat_arena_init(void);
+
+/* Releases everything allocated from the arena at once */
+void readstat_arena_free(readstat_arena_t *arena);
+
+/* Releases everything allocated from the arena, but keeps one chunk (and the
+ * intern table) for what's allocated next */
+void readstat_arena_reset(readstat_arena_t *arena);
+
+/* Memory aligned for any type; NULL if out of memory */
+void *readstat_arena_alloc(readstat_arena_t *arena, size_t len);
+
+/* Zeroed memory, aligned for any type; NULL if out of memory */
+void *readstat_arena_calloc(readstat_arena_t *arena, size_t count, size_t size);
+
+/* A NUL-terminated copy of the first `len' bytes of `str', stopping early at a
+ * NUL. Equal strings share one copy, and the empty string is a static "".
+ * NULL if out of memory. */
+const char *readstat_arena_intern(readstat_arena_t *arena, const char *str, size_t len);
+
+/* A variable with empty name, format and label */
+readstat_variable_t *readstat_arena_variable(readstat_arena_t *arena);
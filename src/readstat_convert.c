@@ -3,29 +3,56 @@
 #include "readstat.h"
 #include "readstat_iconv.h"
 #include "readstat_convert.h"
+#include "readstat_label_index.h"
+#include "readstat_stats.h"
 
-readstat_error_t readstat_convert(char *dst, size_t dst_len, const char *src, size_t src_len, iconv_t converter) {
-    /* strip off spaces from the input because the programs use ASCII space
-     * padding even with non-ASCII encoding. */
+/* Strips off spaces from the input because the programs use ASCII space
+ * padding even with non-ASCII encoding. Stops at the first NUL, which would
+ * end a copy anyway and has to end a view. */
+static size_t readstat_convert_trimmed_len(const char *src, size_t src_len) {
+    const char *nul = memchr(src, '\0', src_len);
+    if (nul)
+        src_len = nul - src;
     while (src_len && src[src_len-1] == ' ') {
         src_len--;
     }
+    return src_len;
+}
+
+static readstat_error_t readstat_iconv(readstat_stats_session_t *session, char *dst, size_t dst_len,
+        const char *src, size_t src_len, iconv_t converter, size_t *out_len) {
+    size_t dst_left = dst_len - 1;
+    char *dst_end = dst;
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CONVERSION, 1);
+    size_t status = iconv(converter, (readstat_iconv_inbuf_t)&src, &src_len, &dst_end, &dst_left);
+    readstat_stats_timer_stop(&timer);
+    if (session)
+        session->stats->iconv_calls++;
+    if (status == (size_t)-1) {
+        if (errno == E2BIG) {
+            return READSTAT_ERROR_CONVERT_LONG_STRING;
+        } else if (errno == EILSEQ) {
+            return READSTAT_ERROR_CONVERT_BAD_STRING;
+        } else if (errno != EINVAL) { /* EINVAL indicates improper truncation; accept it */
+            return READSTAT_ERROR_CONVERT;
+        }
+    }
+    *out_len = dst_len - dst_left - 1;
+    dst[*out_len] = '\0';
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_convert(char *dst, size_t dst_len, const char *src, size_t src_len, iconv_t converter) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    size_t len = 0;
+    if (session)
+        session->stats->string_conversions++;
+    src_len = readstat_convert_trimmed_len(src, src_len);
     if (dst_len == 0) {
         return READSTAT_ERROR_CONVERT_LONG_STRING;
     } else if (converter) {
-        size_t dst_left = dst_len - 1;
-        char *dst_end = dst;
-        size_t status = iconv(converter, (readstat_iconv_inbuf_t)&src, &src_len, &dst_end, &dst_left);
-        if (status == (size_t)-1) {
-            if (errno == E2BIG) {
-                return READSTAT_ERROR_CONVERT_LONG_STRING;
-            } else if (errno == EILSEQ) {
-                return READSTAT_ERROR_CONVERT_BAD_STRING;
-            } else if (errno != EINVAL) { /* EINVAL indicates improper truncation; accept it */
-                return READSTAT_ERROR_CONVERT;
-            }
-        }
-        dst[dst_len - dst_left - 1] = '\0';
+        return readstat_iconv(session, dst, dst_len, src, src_len, converter, &len);
     } else if (src_len + 1 > dst_len) {
         return READSTAT_ERROR_CONVERT_LONG_STRING;
     } else {
@@ -34,3 +61,21 @@ readstat_error_t readstat_convert(char *dst, size_t dst_len, const char *src, si
     }
     return READSTAT_OK;
 }
+
+readstat_error_t readstat_convert_view(char *dst, size_t dst_len, const char *src, size_t src_len,
+        iconv_t converter, const char **out_string, size_t *out_len) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_error_t retval = READSTAT_OK;
+    if (session)
+        session->stats->string_conversions++;
+    src_len = readstat_convert_trimmed_len(src, src_len);
+    if (converter == NULL) {
+        *out_string = src;
+        *out_len = src_len;
+    } else if (dst_len == 0) {
+        retval = READSTAT_ERROR_CONVERT_LONG_STRING;
+    } else if ((retval = readstat_iconv(session, dst, dst_len, src, src_len, converter, out_len)) == READSTAT_OK) {
+        *out_string = dst;
+    }
+    return retval;
+}
@@ -1,2 +1,7 @@
-
 readstat_error_t readstat_convert(char *dst, size_t dst_len, const char *src, size_t src_len, iconv_t converter);
+
+/* Like readstat_convert(), but without a converter points *out_string into
+ * `src' rather than copying it. The result isn't NUL-terminated in that case;
+ * *out_len is its length either way. */
+readstat_error_t readstat_convert_view(char *dst, size_t dst_len, const char *src, size_t src_len,
+        iconv_t converter, const char **out_string, size_t *out_len);
@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "readstat.h"
+#include "readstat_iconv.h"
+#include "readstat_convert.h"
+#include "readstat_malloc.h"
+#include "readstat_arena.h"
+#include "readstat_dictionary.h"
+#include "CKHashTable.h"
+
+/* Values point at `string', so the code sits just before it */
+typedef struct dictionary_entry_s {
+    int32_t     code;
+    char        string[1];
+} dictionary_entry_t;
+
+typedef struct dictionary_column_s {
+    ck_hash_table_t    *entries;    /* raw bytes, trailing spaces trimmed -> string */
+    const char         *empty;      /* CKHashTable keys can't be empty */
+    int                 count;
+    int                 overflowed;
+} dictionary_column_t;
+
+struct readstat_string_dictionary_s {
+    readstat_arena_t                   *arena;
+    dictionary_column_t                *columns;
+    int                                 column_count;
+    int                                 max_entries;
+    readstat_dictionary_entry_handler   handler;
+    void                               *user_ctx;
+};
+
+readstat_string_dictionary_t *readstat_string_dictionary_init(readstat_arena_t *arena,
+        int column_count, int max_entries, readstat_dictionary_entry_handler handler, void *user_ctx) {
+    readstat_string_dictionary_t *dictionary = NULL;
+    if ((dictionary = readstat_calloc(1, sizeof(readstat_string_dictionary_t))) == NULL)
+        return NULL;
+
+    if (column_count > 0 &&
+            (dictionary->columns = readstat_calloc(column_count, sizeof(dictionary_column_t))) == NULL) {
+        readstat_free(dictionary);
+        return NULL;
+    }
+
+    dictionary->arena = arena;
+    dictionary->column_count = column_count;
+    dictionary->max_entries = max_entries;
+    dictionary->handler = handler;
+    dictionary->user_ctx = user_ctx;
+    return dictionary;
+}
+
+void readstat_string_dictionary_free(readstat_string_dictionary_t *dictionary) {
+    int i;
+    if (dictionary == NULL)
+        return;
+
+    for (i=0; i<dictionary->column_count; i++) {
+        if (dictionary->columns[i].entries)
+            ck_hash_table_free(dictionary->columns[i].entries);
+    }
+    if (dictionary->columns)
+        readstat_free(dictionary->columns);
+    readstat_free(dictionary);
+}
+
+static readstat_error_t dictionary_add(readstat_string_dictionary_t *dictionary,
+        dictionary_column_t *column, readstat_variable_t *variable,
+        const char *src, size_t src_len, const char *converted, const char **out_string) {
+    size_t len = strlen(converted);
+    dictionary_entry_t *entry = NULL;
+
+    if ((entry = readstat_arena_alloc(dictionary->arena,
+                    offsetof(dictionary_entry_t, string) + len + 1)) == NULL)
+        return READSTAT_ERROR_MALLOC;
+
+    entry->code = column->count;
+    memcpy(entry->string, converted, len + 1);
+
+    if (src_len == 0) {
+        column->empty = entry->string;
+    } else {
+        if (column->entries == NULL && (column->entries = ck_hash_table_init(16)) == NULL)
+            return READSTAT_ERROR_MALLOC;
+        if (!ck_str_n_hash_insert(src, src_len, entry->string, column->entries))
+            return READSTAT_ERROR_MALLOC;
+    }
+    column->count++;
+    *out_string = entry->string;
+
+    if (dictionary->handler &&
+            dictionary->handler(variable, entry->code, entry->string, dictionary->user_ctx) != READSTAT_HANDLER_OK)
+        return READSTAT_ERROR_USER_ABORT;
+
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_string_dictionary_convert(readstat_string_dictionary_t *dictionary,
+        readstat_variable_t *variable, const char *src, size_t src_len, iconv_t converter,
+        char *buf, size_t buf_len, readstat_value_t *value) {
+    readstat_error_t retval = READSTAT_OK;
+    dictionary_column_t *column = NULL;
+    const char *string = NULL;
+
+    if (variable->index >= 0 && variable->index < dictionary->column_count)
+        column = &dictionary->columns[variable->index];
+
+    if (column == NULL || column->overflowed)
+        goto convert;
+
+    /* Keyed the way readstat_convert() sees the input */
+    while (src_len && src[src_len-1] == ' ') {
+        src_len--;
+    }
+
+    if (src_len == 0) {
+        string = column->empty;
+    } else if (column->entries) {
+        string = ck_str_n_hash_lookup(src, src_len, column->entries);
+    }
+
+    if (string == NULL) {
+        if (column->count == dictionary->max_entries) {
+            /* Entries handed out so far stay in the arena */
+            if (column->entries) {
+                ck_hash_table_free(column->entries);
+                column->entries = NULL;
+            }
+            column->overflowed = 1;
+            goto convert;
+        }
+        if ((retval = readstat_convert(buf, buf_len, src, src_len, converter)) != READSTAT_OK)
+            goto cleanup;
+        if ((retval = dictionary_add(dictionary, column, variable, src, src_len, buf, &string)) != READSTAT_OK)
+            goto cleanup;
+    }
+
+    value->v.string_value = string;
+    value->is_dictionary_encoded = 1;
+    goto cleanup;
+
+convert:
+    if ((retval = readstat_convert(buf, buf_len, src, src_len, converter)) != READSTAT_OK)
+        goto cleanup;
+    value->v.string_value = buf;
+
+cleanup:
+    return retval;
+}
+
+int readstat_value_dictionary_code(readstat_value_t value) {
+    const dictionary_entry_t *entry = NULL;
+    if (!value.is_dictionary_encoded || value.v.string_value == NULL)
+        return -1;
+
+    entry = (const dictionary_entry_t *)(value.v.string_value - offsetof(dictionary_entry_t, string));
+    return entry->code;
+}
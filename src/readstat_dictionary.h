@@ -0,0 +1,22 @@
+//
+//  readstat_dictionary.h - Per-column dictionaries of converted strings, so
+//  that each distinct string in a column is converted only once
+//
+
+struct readstat_arena_s;
+
+typedef struct readstat_string_dictionary_s readstat_string_dictionary_t;
+
+/* Entries come from `arena' and stay valid as long as it does. Columns are
+ * numbered by variable index; a column gives up on its dictionary after
+ * `max_entries' distinct strings. NULL if out of memory. */
+readstat_string_dictionary_t *readstat_string_dictionary_init(struct readstat_arena_s *arena,
+        int column_count, int max_entries, readstat_dictionary_entry_handler handler, void *user_ctx);
+void readstat_string_dictionary_free(readstat_string_dictionary_t *dictionary);
+
+/* Drop-in for readstat_convert() on string cells: sets the string of `value'
+ * to the column's entry for `src', converting and reporting new entries to the
+ * handler, or to `buf' converted as usual once the column has too many. */
+readstat_error_t readstat_string_dictionary_convert(readstat_string_dictionary_t *dictionary,
+        readstat_variable_t *variable, const char *src, size_t src_len, iconv_t converter,
+        char *buf, size_t buf_len, readstat_value_t *value);
@@ -122,5 +122,11 @@ const char *readstat_error_message(readstat_error_t error_code) {
     if (error_code == READSTAT_ERROR_BAD_TIMESTAMP_VALUE)
         return "The provided file timestamp is invalid";
 
+    if (error_code == READSTAT_ERROR_ALLOCATION_TOO_LARGE)
+        return "A buffer would have exceeded the maximum allocation size";
+
+    if (error_code == READSTAT_ERROR_MEMORY_LIMIT_EXCEEDED)
+        return "The memory limit was exceeded";
+
     return "Unknown error";
 }
@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "readstat.h"
+#include "readstat_malloc.h"
+#include "readstat_io_cache.h"
+
+struct readstat_io_cache_s {
+    readstat_io_t       io;
+    readstat_io_t      *source;
+    size_t              block_size;
+    readstat_off_t      position;
+
+    /* buffer[0] is at offset `start' in the file, and the source is
+     * positioned at start + len */
+    unsigned char      *buffer;
+    size_t              len;
+    size_t              capacity;
+    readstat_off_t      start;
+    int                 eof;
+};
+
+/* Appends up to one block to the buffer. Returns the number of bytes added,
+ * or -1 on error. */
+static ssize_t io_cache_fill(readstat_io_cache_t *cache) {
+    size_t done = 0;
+
+    if (cache->eof)
+        return 0;
+
+    if (cache->len + cache->block_size > cache->capacity) {
+        size_t capacity = 2 * cache->capacity;
+        if (capacity < cache->len + cache->block_size)
+            capacity = cache->len + cache->block_size;
+        if ((cache->buffer = readstat_realloc(cache->buffer, capacity)) == NULL) {
+            /* Too big to keep, and readstat_realloc() has freed it: drop what
+             * has been read so far (this is only called once it has all been
+             * consumed) and carry on with a single block */
+            cache->start += cache->len;
+            cache->len = 0;
+            capacity = cache->block_size;
+            if ((cache->buffer = readstat_malloc(capacity)) == NULL) {
+                cache->capacity = 0;
+                return -1;
+            }
+        }
+        cache->capacity = capacity;
+    }
+
+    while (done < cache->block_size) {
+        ssize_t bytes_read = cache->source->read(&cache->buffer[cache->len + done],
+                cache->block_size - done, cache->source->io_ctx);
+        if (bytes_read == -1)
+            return -1;
+        if (bytes_read == 0) {
+            cache->eof = 1;
+            break;
+        }
+        done += bytes_read;
+    }
+    cache->len += done;
+
+    return done;
+}
+
+static ssize_t io_cache_read_handler(void *buf, size_t nbyte, void *io_ctx) {
+    readstat_io_cache_t *cache = (readstat_io_cache_t *)io_ctx;
+    size_t done = 0;
+
+    while (done < nbyte) {
+        readstat_off_t end = cache->start + cache->len;
+        size_t avail = 0, n = 0;
+
+        if (cache->position >= end) {
+            ssize_t filled = io_cache_fill(cache);
+            if (filled == -1)
+                return done ? done : -1;
+            if (filled == 0)
+                break;
+            continue;
+        }
+
+        avail = end - cache->position;
+        n = nbyte - done < avail ? nbyte - done : avail;
+        memcpy((char *)buf + done, &cache->buffer[cache->position - cache->start], n);
+        cache->position += n;
+        done += n;
+    }
+
+    return done;
+}
+
+static readstat_off_t io_cache_seek_handler(readstat_off_t offset,
+        readstat_io_flags_t whence, void *io_ctx) {
+    readstat_io_cache_t *cache = (readstat_io_cache_t *)io_ctx;
+    readstat_off_t target = -1;
+
+    if (whence == READSTAT_SEEK_SET) {
+        target = offset;
+    } else if (whence == READSTAT_SEEK_CUR) {
+        target = cache->position + offset;
+    } else if (whence == READSTAT_SEEK_END) {
+        target = cache->source->seek(offset, READSTAT_SEEK_END, cache->source->io_ctx);
+        if (target == -1)
+            return -1;
+        if (cache->source->seek(cache->start + cache->len, READSTAT_SEEK_SET,
+                    cache->source->io_ctx) == -1)
+            return -1;
+    }
+
+    if (target < 0)
+        return -1;
+
+    if (target < cache->start) {
+        /* Behind the cached region: start over from the target */
+        if (cache->source->seek(target, READSTAT_SEEK_SET, cache->source->io_ctx) == -1)
+            return -1;
+        cache->start = target;
+        cache->len = 0;
+        cache->eof = 0;
+    } else {
+        while (target > cache->start + cache->len) {
+            ssize_t filled = io_cache_fill(cache);
+            if (filled == -1)
+                return -1;
+            if (filled == 0)
+                break;
+        }
+    }
+
+    cache->position = target;
+    return target;
+}
+
+static readstat_error_t io_cache_update_handler(long file_size,
+        readstat_progress_handler progress_handler, void *user_ctx, void *io_ctx) {
+    readstat_io_cache_t *cache = (readstat_io_cache_t *)io_ctx;
+    if (!progress_handler)
+        return READSTAT_OK;
+
+    if (progress_handler(1.0 * cache->position / file_size, user_ctx))
+        return READSTAT_ERROR_USER_ABORT;
+
+    return READSTAT_OK;
+}
+
+static int io_cache_close_handler(void *io_ctx) {
+    readstat_io_cache_t *cache = (readstat_io_cache_t *)io_ctx;
+    return cache->source->close(cache->source->io_ctx);
+}
+
+readstat_error_t readstat_io_cache_init(readstat_io_cache_t **out_cache, readstat_io_t **io,
+        size_t block_size) {
+    readstat_io_cache_t *cache = *out_cache;
+    readstat_io_t *source = *io;
+    readstat_off_t position = -1;
+
+    if ((position = source->seek(0, READSTAT_SEEK_CUR, source->io_ctx)) == -1)
+        return READSTAT_ERROR_SEEK;
+
+    if (cache == NULL && (cache = calloc(1, sizeof(readstat_io_cache_t))) == NULL)
+        return READSTAT_ERROR_MALLOC;
+
+    cache->source = source;
+    cache->block_size = block_size;
+    cache->position = position;
+    cache->start = position;
+    cache->len = 0;
+    cache->eof = 0;
+
+    cache->io = *source;
+    cache->io.open = NULL;
+    cache->io.close = &io_cache_close_handler;
+    cache->io.seek = &io_cache_seek_handler;
+    cache->io.read = &io_cache_read_handler;
+    cache->io.update = &io_cache_update_handler;
+    cache->io.io_ctx = cache;
+    cache->io.io_ctx_needs_free = 0;
+
+    *io = &cache->io;
+    *out_cache = cache;
+
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_io_cache_release(readstat_io_cache_t *cache, readstat_io_t **io) {
+    readstat_error_t retval = READSTAT_OK;
+
+    if (cache->position != cache->start + cache->len &&
+            cache->source->seek(cache->position, READSTAT_SEEK_SET, cache->source->io_ctx) == -1)
+        retval = READSTAT_ERROR_SEEK;
+
+    *io = cache->source;
+    cache->source = NULL;
+
+    return retval;
+}
+
+readstat_error_t readstat_io_cache_free(readstat_io_cache_t *cache, readstat_io_t **io) {
+    readstat_error_t retval = READSTAT_OK;
+    if (cache == NULL)
+        return READSTAT_OK;
+
+    if (cache->source)
+        retval = readstat_io_cache_release(cache, io);
+
+    readstat_free(cache->buffer);
+    free(cache);
+
+    return retval;
+}
@@ -0,0 +1,23 @@
+//
+//  readstat_io_cache.h - Keeping a region of the file in memory
+//
+
+typedef struct readstat_io_cache_s readstat_io_cache_t;
+
+/* Swaps *io for a proxy that reads from the current position of *io in
+ * blocks of `block_size' bytes and keeps everything it has read, so that
+ * small reads are copied out of memory and seeking back into the region and
+ * reading it again costs no I/O. Forward seeks read up to the target. Meant
+ * for headers and dictionaries that are walked more than once; the whole
+ * region stays in memory until readstat_io_cache_free(). If *out_cache isn't
+ * NULL, it's a cache from readstat_io_cache_release() whose buffer is reused. */
+readstat_error_t readstat_io_cache_init(readstat_io_cache_t **out_cache, readstat_io_t **io,
+        size_t block_size);
+
+/* Positions the underlying reader at the proxy's current offset, and puts the
+ * original reader back in *io, but keeps the cache for readstat_io_cache_init() */
+readstat_error_t readstat_io_cache_release(readstat_io_cache_t *cache, readstat_io_t **io);
+
+/* readstat_io_cache_release(), unless that's been done already, then frees the
+ * cache; `io' isn't used in that case */
+readstat_error_t readstat_io_cache_free(readstat_io_cache_t *cache, readstat_io_t **io);
@@ -22,6 +22,7 @@
 int unistd_open_handler(const char *path, void *io_ctx) {
     int fd = open(path, UNISTD_OPEN_OPTIONS);
     ((unistd_io_ctx_t*) io_ctx)->fd = fd;
+    ((unistd_io_ctx_t*) io_ctx)->offset = 0;
     return fd;
 }
 
@@ -35,12 +36,15 @@ int unistd_close_handler(void *io_ctx) {
 
 readstat_off_t unistd_seek_handler(readstat_off_t offset,
         readstat_io_flags_t whence, void *io_ctx) {
+    unistd_io_ctx_t *ctx = (unistd_io_ctx_t*) io_ctx;
     int flag = 0;
     switch(whence) {
         case READSTAT_SEEK_SET:
             flag = SEEK_SET;
             break;
         case READSTAT_SEEK_CUR:
+            if (offset == 0)
+                return ctx->offset;
             flag = SEEK_CUR;
             break;
         case READSTAT_SEEK_END:
@@ -49,13 +53,17 @@ readstat_off_t unistd_seek_handler(readstat_off_t offset,
         default:
             return -1;
     }
-    int fd = ((unistd_io_ctx_t*) io_ctx)->fd;
-    return lseek(fd, offset, flag);
+    readstat_off_t newpos = lseek(ctx->fd, offset, flag);
+    if (newpos != -1)
+        ctx->offset = newpos;
+    return newpos;
 }
 
 ssize_t unistd_read_handler(void *buf, size_t nbyte, void *io_ctx) {
-    int fd = ((unistd_io_ctx_t*) io_ctx)->fd;
-    ssize_t out = read(fd, buf, nbyte);
+    unistd_io_ctx_t *ctx = (unistd_io_ctx_t*) io_ctx;
+    ssize_t out = read(ctx->fd, buf, nbyte);
+    if (out > 0)
+        ctx->offset += out;
     return out;
 }
 
@@ -65,11 +73,7 @@ readstat_error_t unistd_update_handler(long file_size,
     if (!progress_handler)
         return READSTAT_OK;
 
-    int fd = ((unistd_io_ctx_t*) io_ctx)->fd;
-    long current_offset = lseek(fd, 0, SEEK_CUR);
-
-    if (current_offset == -1)
-        return READSTAT_ERROR_SEEK;
+    long current_offset = ((unistd_io_ctx_t*) io_ctx)->offset;
 
     if (progress_handler(1.0 * current_offset / file_size, user_ctx))
         return READSTAT_ERROR_USER_ABORT;
@@ -1,6 +1,7 @@
 
 typedef struct unistd_io_ctx_s {
     int               fd;
+    readstat_off_t    offset;   // tracked so that progress updates need no lseek()
 } unistd_io_ctx_t;
 
 int unistd_open_handler(const char *path, void *io_ctx);
@@ -0,0 +1,414 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "readstat.h"
+#include "readstat_arena.h"
+#include "readstat_label_index.h"
+#include "CKHashTable.h"
+
+/* Numbers are keyed by their value as a double (8 bytes), and tagged and
+ * system missing values by their tag or '\0' (1 byte), so one table holds
+ * both. Strings have their own table; the empty string can't be a CKHashTable
+ * key, so its label is kept on the side. */
+typedef struct readstat_label_lookup_s {
+    ck_hash_table_t                 *numbers;
+    ck_hash_table_t                 *strings;
+    const char                      *empty_string_label;
+    uint64_t                         parse;
+    struct readstat_label_lookup_s  *next;
+} readstat_label_lookup_t;
+
+struct readstat_label_index_s {
+    readstat_arena_t        *arena;
+    ck_hash_table_t         *sets;
+    readstat_label_lookup_t *lookups;
+    uint64_t                 parse;
+    int                      carry;
+    readstat_label_index_scope_t *scope;
+};
+
+static void label_index_free_lookups(readstat_label_index_t *index) {
+    readstat_label_lookup_t *lookup = NULL;
+    for (lookup = index->lookups; lookup; lookup = lookup->next) {
+        if (lookup->numbers)
+            ck_hash_table_free(lookup->numbers);
+        if (lookup->strings)
+            ck_hash_table_free(lookup->strings);
+    }
+    index->lookups = NULL;
+}
+
+void readstat_label_index_free(readstat_label_index_t *index) {
+    if (index == NULL)
+        return;
+
+    label_index_free_lookups(index);
+    if (index->sets)
+        ck_hash_table_free(index->sets);
+    if (index->arena)
+        readstat_arena_free(index->arena);
+    free(index);
+}
+
+static readstat_label_index_t *label_index_get(readstat_parser_t *parser) {
+    readstat_label_index_t *index = parser->label_index;
+    if (index)
+        return index;
+
+    if ((index = calloc(1, sizeof(readstat_label_index_t))) == NULL)
+        return NULL;
+
+    if ((index->arena = readstat_arena_init()) == NULL ||
+            (index->sets = ck_hash_table_init(16)) == NULL) {
+        readstat_label_index_free(index);
+        return NULL;
+    }
+
+    parser->label_index = index;
+    return index;
+}
+
+/* Drops every set, keeping the memory for the next ones */
+static void label_index_reset(readstat_label_index_t *index) {
+    label_index_free_lookups(index);
+    ck_hash_table_wipe(index->sets);
+    readstat_arena_reset(index->arena);
+    index->carry = 0;
+}
+
+static readstat_label_set_t *label_index_set(readstat_label_index_t *index, const char *name) {
+    readstat_label_set_t *label_set = (readstat_label_set_t *)ck_str_hash_lookup(name, index->sets);
+    if (label_set)
+        return label_set;
+
+    if ((label_set = readstat_arena_calloc(index->arena, 1, sizeof(readstat_label_set_t))) == NULL)
+        return NULL;
+    if ((label_set->lookup = readstat_arena_calloc(index->arena, 1, sizeof(readstat_label_lookup_t))) == NULL)
+        return NULL;
+
+    snprintf(label_set->name, sizeof(label_set->name), "%s", name);
+    label_set->lookup->parse = index->parse;
+    label_set->lookup->next = index->lookups;
+    index->lookups = label_set->lookup;
+
+    if (!ck_str_hash_insert(label_set->name, label_set, index->sets))
+        return NULL;
+
+    return label_set;
+}
+
+/* Empties a set left by an earlier parse, so that this one sees only its own
+ * labels */
+static void label_index_renew(readstat_label_index_t *index, readstat_label_set_t *label_set) {
+    readstat_label_lookup_t *lookup = label_set->lookup;
+    if (lookup->parse == index->parse)
+        return;
+
+    if (lookup->numbers)
+        ck_hash_table_wipe(lookup->numbers);
+    if (lookup->strings)
+        ck_hash_table_wipe(lookup->strings);
+    lookup->empty_string_label = NULL;
+    lookup->parse = index->parse;
+    label_set->type = READSTAT_TYPE_STRING;
+    label_set->value_labels_count = 0;
+}
+
+/* Where a numeric or missing value goes in the `numbers' table */
+static size_t label_lookup_number_key(readstat_value_t value, char *key) {
+    double number = 0.0;
+    if (readstat_value_is_tagged_missing(value)) {
+        key[0] = readstat_value_tag(value);
+        return 1;
+    }
+    number = readstat_double_value(value);
+    if (isnan(number)) {
+        key[0] = '\0';
+        return 1;
+    }
+    if (number == 0.0)
+        number = 0.0; /* -0 */
+    memcpy(key, &number, sizeof(double));
+    return sizeof(double);
+}
+
+readstat_error_t readstat_label_index_add(readstat_parser_t *parser, const char *val_labels,
+        readstat_value_t value, const char *label) {
+    readstat_error_t retval = READSTAT_OK;
+    readstat_label_index_t *index = NULL;
+    readstat_label_set_t *label_set = NULL;
+    readstat_label_lookup_t *lookup = NULL;
+    const char *interned = NULL;
+
+    if (val_labels == NULL || val_labels[0] == '\0' || label == NULL)
+        goto cleanup;
+
+    if ((index = label_index_get(parser)) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
+
+    /* A schema's labels, read between parses, replace what the last parse
+     * left, but add to a catalog's or another schema's */
+    if (index->scope == NULL && !index->carry) {
+        label_index_reset(index);
+        index->carry = 1;
+    }
+
+    if ((label_set = label_index_set(index, val_labels)) == NULL ||
+            (interned = readstat_arena_intern(index->arena, label, strlen(label))) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
+
+    label_index_renew(index, label_set);
+    lookup = label_set->lookup;
+
+    /* Counted, but not kept in value_labels */
+    if (label_set->value_labels_count++ == 0)
+        label_set->type = value.type;
+
+    if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        const char *string = readstat_string_value(value);
+        if (string == NULL || string[0] == '\0') {
+            lookup->empty_string_label = interned;
+            goto cleanup;
+        }
+        if (lookup->strings == NULL && (lookup->strings = ck_hash_table_init(16)) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
+        if (!ck_str_hash_insert(string, interned, lookup->strings))
+            retval = READSTAT_ERROR_MALLOC;
+    } else {
+        char key[sizeof(double)];
+        if (lookup->numbers == NULL && (lookup->numbers = ck_hash_table_init(16)) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
+        if (!ck_str_n_hash_insert(key, label_lookup_number_key(value, key), interned, lookup->numbers))
+            retval = READSTAT_ERROR_MALLOC;
+    }
+
+cleanup:
+    return retval;
+}
+
+readstat_error_t readstat_label_index_bind(readstat_parser_t *parser, readstat_variable_t *variable,
+        const char *val_labels) {
+    readstat_label_index_t *index = NULL;
+
+    if (val_labels == NULL || val_labels[0] == '\0')
+        return READSTAT_OK;
+
+    if ((index = label_index_get(parser)) == NULL ||
+            (variable->label_set = label_index_set(index, val_labels)) == NULL)
+        return READSTAT_ERROR_MALLOC;
+
+    label_index_renew(index, variable->label_set);
+    return READSTAT_OK;
+}
+
+/* Handler proxies, which find the scope through their ctx */
+static int label_index_handle_metadata(readstat_metadata_t *metadata, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    return scope->handlers.metadata(metadata, scope->user_ctx);
+}
+
+static int label_index_handle_note(int note_index, const char *note, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    return scope->handlers.note(note_index, note, scope->user_ctx);
+}
+
+/* Keeps the first error behind an abort, as some formats carry on past
+ * aborted value labels */
+static int label_index_abort(readstat_label_index_scope_t *scope, readstat_error_t error) {
+    if (scope->error == READSTAT_OK)
+        scope->error = error;
+    return READSTAT_HANDLER_ABORT;
+}
+
+static int label_index_handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    readstat_error_t error = readstat_label_index_bind(scope->parser, variable, val_labels);
+    if (error != READSTAT_OK)
+        return label_index_abort(scope, error);
+    if (scope->handlers.variable == NULL)
+        return READSTAT_HANDLER_OK;
+    return scope->handlers.variable(index, variable, val_labels, scope->user_ctx);
+}
+
+static int label_index_handle_fweight(readstat_variable_t *variable, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    return scope->handlers.fweight(variable, scope->user_ctx);
+}
+
+static int label_index_handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    if (scope->parser->value_label_lookup == READSTAT_VALUE_LABEL_LOOKUP_SUBSTITUTE) {
+        const char *label = readstat_lookup_value_label(variable, value);
+        if (label) {
+            memset(&value, 0, sizeof(readstat_value_t));
+            value.type = READSTAT_TYPE_STRING;
+            value.v.string_value = label;
+        }
+    }
+    return scope->handlers.value(obs_index, variable, value, scope->user_ctx);
+}
+
+static int label_index_handle_value_label(const char *val_labels, readstat_value_t value,
+        const char *label, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    readstat_error_t error = readstat_label_index_add(scope->parser, val_labels, value, label);
+    if (error != READSTAT_OK)
+        return label_index_abort(scope, error);
+    if (scope->handlers.value_label == NULL)
+        return READSTAT_HANDLER_OK;
+    return scope->handlers.value_label(val_labels, value, label, scope->user_ctx);
+}
+
+static void label_index_handle_error(const char *error_message, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    scope->handlers.error(error_message, scope->user_ctx);
+}
+
+static int label_index_handle_progress(double progress, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    return scope->handlers.progress(progress, scope->user_ctx);
+}
+
+static int label_index_handle_dictionary_entry(readstat_variable_t *variable, int code,
+        const char *string, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    return scope->handlers.dictionary_entry(variable, code, string, scope->user_ctx);
+}
+
+static int label_index_handle_string_view(int obs_index, readstat_variable_t *variable,
+        const char *string, size_t len, void *ctx) {
+    readstat_label_index_scope_t *scope = (readstat_label_index_scope_t *)ctx;
+    return scope->handlers.string_view(obs_index, variable, string, len, scope->user_ctx);
+}
+
+/* The handlers of a parse started from a handler of the outer one: where the
+ * outer proxies are still in place, which would take the outer user_ctx, the
+ * handlers they stand in for */
+static void label_index_unwrap(readstat_callbacks_t *handlers, const readstat_label_index_scope_t *outer) {
+    const readstat_callbacks_t *proxies = &outer->parser->handlers;
+    *handlers = *proxies;
+    if (proxies->metadata == &label_index_handle_metadata)
+        handlers->metadata = outer->handlers.metadata;
+    if (proxies->note == &label_index_handle_note)
+        handlers->note = outer->handlers.note;
+    if (proxies->variable == &label_index_handle_variable)
+        handlers->variable = outer->handlers.variable;
+    if (proxies->fweight == &label_index_handle_fweight)
+        handlers->fweight = outer->handlers.fweight;
+    if (proxies->value == &label_index_handle_value)
+        handlers->value = outer->handlers.value;
+    if (proxies->value_label == &label_index_handle_value_label)
+        handlers->value_label = outer->handlers.value_label;
+    if (proxies->error == &label_index_handle_error)
+        handlers->error = outer->handlers.error;
+    if (proxies->progress == &label_index_handle_progress)
+        handlers->progress = outer->handlers.progress;
+    if (proxies->dictionary_entry == &label_index_handle_dictionary_entry)
+        handlers->dictionary_entry = outer->handlers.dictionary_entry;
+    if (proxies->string_view == &label_index_handle_string_view)
+        handlers->string_view = outer->handlers.string_view;
+}
+
+readstat_error_t readstat_label_index_begin_parse(readstat_label_index_scope_t *scope,
+        readstat_parser_t *parser, readstat_label_index_parse_t kind, void *user_ctx) {
+    readstat_label_index_t *index = NULL;
+    readstat_callbacks_t *handlers = &parser->handlers;
+    readstat_callbacks_t unwrapped;
+
+    memset(scope, 0, sizeof(readstat_label_index_scope_t));
+    scope->parse_ctx = user_ctx;
+
+    if (parser->value_label_lookup == READSTAT_VALUE_LABEL_LOOKUP_NONE)
+        return READSTAT_OK;
+
+    if ((index = label_index_get(parser)) == NULL)
+        return READSTAT_ERROR_MALLOC;
+
+    if (index->scope) {
+        /* Sets from the outer parse look empty until this one fills them */
+        index->parse++;
+        label_index_unwrap(&unwrapped, index->scope);
+        handlers = &unwrapped;
+    } else if (!(kind == READSTAT_LABEL_INDEX_PARSE_DATA && index->carry)) {
+        label_index_reset(index);
+    }
+
+    scope->parser = parser;
+    scope->kind = kind;
+    scope->installed = 1;
+    scope->user_ctx = user_ctx;
+    scope->parse_ctx = scope;
+    scope->handlers = *handlers;
+    scope->saved_handlers = parser->handlers;
+    scope->outer = index->scope;
+    index->scope = scope;
+
+    /* The index sees every variable and label, handled or not */
+    parser->handlers.variable = &label_index_handle_variable;
+    parser->handlers.value_label = &label_index_handle_value_label;
+
+    parser->handlers.metadata = handlers->metadata ? &label_index_handle_metadata : NULL;
+    parser->handlers.note = handlers->note ? &label_index_handle_note : NULL;
+    parser->handlers.fweight = handlers->fweight ? &label_index_handle_fweight : NULL;
+    parser->handlers.value = handlers->value ? &label_index_handle_value : NULL;
+    parser->handlers.error = handlers->error ? &label_index_handle_error : NULL;
+    parser->handlers.progress = handlers->progress ? &label_index_handle_progress : NULL;
+    parser->handlers.dictionary_entry = handlers->dictionary_entry ? &label_index_handle_dictionary_entry : NULL;
+    parser->handlers.string_view = handlers->string_view ? &label_index_handle_string_view : NULL;
+
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_label_index_end_parse(readstat_label_index_scope_t *scope, readstat_error_t retval) {
+    readstat_label_index_t *index = NULL;
+
+    if (!scope->installed)
+        return retval;
+
+    index = scope->parser->label_index;
+    scope->parser->handlers = scope->saved_handlers;
+    index->scope = scope->outer;
+    if (index->scope == NULL)
+        index->carry = (scope->kind == READSTAT_LABEL_INDEX_PARSE_CATALOG);
+    scope->installed = 0;
+
+    if (scope->error != READSTAT_OK)
+        return scope->error;
+    return retval;
+}
+
+const char *readstat_lookup_value_label(const readstat_variable_t *variable, readstat_value_t value) {
+    readstat_label_lookup_t *lookup = NULL;
+
+    if (variable == NULL || variable->label_set == NULL ||
+            (lookup = variable->label_set->lookup) == NULL)
+        return NULL;
+
+    if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        const char *string = value.v.string_value;
+        if (string == NULL || string[0] == '\0')
+            return lookup->empty_string_label;
+        if (lookup->strings == NULL)
+            return NULL;
+        return ck_str_hash_lookup(string, lookup->strings);
+    }
+
+    if (lookup->numbers == NULL)
+        return NULL;
+
+    char key[sizeof(double)];
+    return ck_str_n_hash_lookup(key, label_lookup_number_key(value, key), lookup->numbers);
+}
@@ -0,0 +1,54 @@
+//
+//  readstat_label_index.h - Value labels collected while parsing, for
+//  readstat_lookup_value_label()
+//
+
+typedef struct readstat_label_index_s readstat_label_index_t;
+
+void readstat_label_index_free(readstat_label_index_t *index);
+
+/* What a parse makes of the sets left by whatever came before it */
+typedef enum readstat_label_index_parse_e {
+    READSTAT_LABEL_INDEX_PARSE_OWN,     /* Starts from an empty index */
+    READSTAT_LABEL_INDEX_PARSE_CATALOG, /* Starts from an empty index, and leaves its sets to the next parse */
+    READSTAT_LABEL_INDEX_PARSE_DATA     /* Starts from a catalog's or a schema's sets, if they came just before */
+} readstat_label_index_parse_t;
+
+/* Feeds the index from the handlers for the length of a parse. The parse is
+ * run with `parse_ctx' for its user_ctx, which is the scope itself when the
+ * parser looks labels up: proxies for the handlers find the index, and the
+ * handlers and user_ctx they stand in for, through it. */
+typedef struct readstat_label_index_scope_s {
+    readstat_parser_t                   *parser;
+    readstat_label_index_parse_t         kind;
+    int                                  installed;
+    readstat_error_t                     error;
+    void                                *user_ctx;
+    void                                *parse_ctx;
+    readstat_callbacks_t                 handlers;
+    readstat_callbacks_t                 saved_handlers;
+    struct readstat_label_index_scope_s *outer;
+} readstat_label_index_scope_t;
+
+/* The index lives as long as the parser, so that a SAS catalog's labels apply
+ * to the data file parsed after it, and a schema's to the text file. Otherwise
+ * each parse starts from scratch, releasing what earlier parses left. A parse
+ * started from a handler of another shares its index, with the sets it reads
+ * replacing the outer parse's. Does nothing but set `parse_ctx' to `user_ctx'
+ * without readstat_set_value_label_lookup(). */
+readstat_error_t readstat_label_index_begin_parse(readstat_label_index_scope_t *scope,
+        readstat_parser_t *parser, readstat_label_index_parse_t kind, void *user_ctx);
+
+/* Puts the handlers back, and returns `retval', or the error behind a handler
+ * abort that the scope made itself, e.g. when the index ran out of memory */
+readstat_error_t readstat_label_index_end_parse(readstat_label_index_scope_t *scope, readstat_error_t retval);
+
+/* Records a label for the set named `val_labels'. Outside of a parse, as for
+ * a schema, starts a catalog of its own for the next parse. */
+readstat_error_t readstat_label_index_add(readstat_parser_t *parser, const char *val_labels,
+        readstat_value_t value, const char *label);
+
+/* Points the variable at the set named `val_labels', which may not have been
+ * read yet. Does nothing if `val_labels' is NULL or empty. */
+readstat_error_t readstat_label_index_bind(readstat_parser_t *parser, readstat_variable_t *variable,
+        const char *val_labels);
@@ -1,32 +1,277 @@
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 
-#define MAX_MALLOC_SIZE 0xFFF000
-/* ~16 MB. Needs to be at least 0x3FF00, i.e. the default ~4MB block size used
- * in compressed SPSS (ZSAV) files. The purpose here is to prevent massive
- * allocations in the event of a malformed file or a bug in the library. */
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "readstat.h"
+#include "readstat_malloc.h"
+
+/* Outside of a parse or a writer's data setup, allocations are capped at
+ * READSTAT_DEFAULT_MAX_ALLOCATION (~16 MB). Needs to be at least 0x3FF00,
+ * i.e. the default ~4MB block size used in compressed SPSS (ZSAV) files. The
+ * purpose here is to prevent massive allocations in the event of a malformed
+ * file or a bug in the library. */
+
+/* Every block starts with its length and the serial number of the scope it's
+ * charged to, so that frees can be credited back */
+typedef struct malloc_header_s {
+    size_t      len;
+    uint64_t    serial;
+} malloc_header_t;
+
+#define MALLOC_HEADER_LEN ((sizeof(malloc_header_t) + 15) & ~(size_t)15)
+
+static readstat_malloc_handler  malloc_handler = &malloc;
+static readstat_realloc_handler realloc_handler = &realloc;
+static readstat_free_handler    free_handler = &free;
+
+#if HAVE_PTHREAD
+static pthread_key_t   malloc_scope_key;
+static pthread_once_t  malloc_scope_key_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t malloc_scope_serial_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t malloc_scope_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t        malloc_scope_serial;
+
+static void malloc_scope_key_init(void) {
+    pthread_key_create(&malloc_scope_key, NULL);
+}
+
+static readstat_malloc_scope_t *malloc_scope_current(void) {
+    pthread_once(&malloc_scope_key_once, &malloc_scope_key_init);
+    return pthread_getspecific(malloc_scope_key);
+}
+
+static void malloc_scope_set_current(readstat_malloc_scope_t *scope) {
+    pthread_once(&malloc_scope_key_once, &malloc_scope_key_init);
+    pthread_setspecific(malloc_scope_key, scope);
+}
+
+static uint64_t malloc_scope_next_serial(void) {
+    uint64_t serial = 0;
+    pthread_mutex_lock(&malloc_scope_serial_lock);
+    serial = ++malloc_scope_serial;
+    pthread_mutex_unlock(&malloc_scope_serial_lock);
+    return serial;
+}
+
+/* `shared' only leaves or returns to 0 while the owner is the scope's only
+ * thread, so whether to lock can be decided unlocked */
+static int malloc_scope_lock(readstat_malloc_scope_t *scope) {
+    if (scope == NULL || !scope->shared)
+        return 0;
+    pthread_mutex_lock(&malloc_scope_shared_lock);
+    return 1;
+}
+
+static void malloc_scope_unlock(int locked) {
+    if (locked)
+        pthread_mutex_unlock(&malloc_scope_shared_lock);
+}
+#else
+static readstat_malloc_scope_t *malloc_scope_current_scope;
+static uint64_t                 malloc_scope_serial;
+
+static readstat_malloc_scope_t *malloc_scope_current(void) {
+    return malloc_scope_current_scope;
+}
+
+static void malloc_scope_set_current(readstat_malloc_scope_t *scope) {
+    malloc_scope_current_scope = scope;
+}
+
+static uint64_t malloc_scope_next_serial(void) {
+    return ++malloc_scope_serial;
+}
+
+static int malloc_scope_lock(readstat_malloc_scope_t *scope) {
+    return 0;
+}
+
+static void malloc_scope_unlock(int locked) {
+}
+#endif
+
+void readstat_set_allocator(readstat_malloc_handler new_malloc_handler,
+        readstat_realloc_handler new_realloc_handler, readstat_free_handler new_free_handler) {
+    malloc_handler = new_malloc_handler ? new_malloc_handler : &malloc;
+    realloc_handler = new_realloc_handler ? new_realloc_handler : &realloc;
+    free_handler = new_free_handler ? new_free_handler : &free;
+}
+
+void readstat_malloc_scope_begin(readstat_malloc_scope_t *scope, size_t max_allocation, size_t memory_limit) {
+    memset(scope, 0, sizeof(readstat_malloc_scope_t));
+    scope->max_allocation = max_allocation;
+    scope->memory_limit = memory_limit;
+    scope->serial = malloc_scope_next_serial();
+    scope->previous = malloc_scope_current();
+    malloc_scope_set_current(scope);
+}
+
+readstat_error_t readstat_malloc_scope_end(readstat_malloc_scope_t *scope, readstat_error_t retval) {
+    malloc_scope_set_current(scope->previous);
+
+    /* Callers only see a NULL pointer, and may report it as anything */
+    if (retval != READSTAT_OK && scope->error != READSTAT_OK)
+        return scope->error;
+
+    return retval;
+}
+
+readstat_malloc_scope_t *readstat_malloc_scope_current(void) {
+    return malloc_scope_current();
+}
+
+void readstat_malloc_scope_share(readstat_malloc_scope_t *scope) {
+    int locked = 0;
+    if (scope == NULL)
+        return;
+
+    locked = malloc_scope_lock(scope);
+    scope->shared++;
+    malloc_scope_unlock(locked);
+}
+
+void readstat_malloc_scope_unshare(readstat_malloc_scope_t *scope) {
+    int locked = 0;
+    if (scope == NULL)
+        return;
+
+    locked = malloc_scope_lock(scope);
+    scope->shared--;
+    malloc_scope_unlock(locked);
+}
+
+readstat_malloc_scope_t *readstat_malloc_scope_attach(readstat_malloc_scope_t *scope) {
+    readstat_malloc_scope_t *previous = malloc_scope_current();
+    malloc_scope_set_current(scope);
+    return previous;
+}
+
+void readstat_malloc_scope_detach(readstat_malloc_scope_t *previous) {
+    malloc_scope_set_current(previous);
+}
+
+/* Blocks charged to a scope that has since ended aren't counted anywhere */
+static readstat_malloc_scope_t *malloc_scope_for_serial(uint64_t serial) {
+    readstat_malloc_scope_t *scope = malloc_scope_current();
+    while (scope && scope->serial != serial)
+        scope = scope->previous;
+    return scope;
+}
+
+static int malloc_scope_reserve(readstat_malloc_scope_t *scope, size_t len) {
+    size_t max_allocation = scope ? scope->max_allocation : READSTAT_DEFAULT_MAX_ALLOCATION;
+    int retval = 0, locked = 0;
+
+    if (scope == NULL)
+        return (max_allocation && len > max_allocation) ? -1 : 0;
+
+    locked = malloc_scope_lock(scope);
+    if (max_allocation && len > max_allocation) {
+        scope->error = READSTAT_ERROR_ALLOCATION_TOO_LARGE;
+        retval = -1;
+    } else if (scope->memory_limit && (scope->memory_used > scope->memory_limit ||
+                len > scope->memory_limit - scope->memory_used)) {
+        scope->error = READSTAT_ERROR_MEMORY_LIMIT_EXCEEDED;
+        retval = -1;
+    } else {
+        scope->memory_used += len;
+        if (scope->memory_used > scope->peak_memory_used)
+            scope->peak_memory_used = scope->memory_used;
+        if (len > scope->peak_allocation)
+            scope->peak_allocation = len;
+    }
+    malloc_scope_unlock(locked);
+
+    return retval;
+}
+
+static void malloc_scope_release(readstat_malloc_scope_t *scope, size_t len) {
+    int locked = 0;
+    if (scope == NULL)
+        return;
+
+    locked = malloc_scope_lock(scope);
+    scope->memory_used -= len;
+    malloc_scope_unlock(locked);
+}
 
 void *readstat_malloc(size_t len) {
-    if (len > MAX_MALLOC_SIZE || len == 0) {
+    readstat_malloc_scope_t *scope = malloc_scope_current();
+    malloc_header_t *header = NULL;
+
+    if (len == 0) {
+        return NULL;
+    }
+    if (malloc_scope_reserve(scope, len) == -1) {
+        return NULL;
+    }
+    if (len > SIZE_MAX - MALLOC_HEADER_LEN ||
+            (header = malloc_handler(MALLOC_HEADER_LEN + len)) == NULL) {
+        malloc_scope_release(scope, len);
         return NULL;
     }
-    return malloc(len);
+
+    header->len = len;
+    header->serial = scope ? scope->serial : 0;
+    return (char *)header + MALLOC_HEADER_LEN;
 }
 
 void *readstat_calloc(size_t count, size_t size) {
-    if (count > MAX_MALLOC_SIZE || size > MAX_MALLOC_SIZE || count * size > MAX_MALLOC_SIZE) {
+    void *ptr = NULL;
+    if (count == 0 || size == 0) {
         return NULL;
     }
-    if (count == 0 || size == 0) {
+    /* An overflowing request is too large under any limit */
+    if ((ptr = readstat_malloc(count > SIZE_MAX / size ? SIZE_MAX : count * size)) == NULL) {
         return NULL;
     }
-    return calloc(count, size);
+    memset(ptr, 0, count * size);
+    return ptr;
 }
 
 void *readstat_realloc(void *ptr, size_t len) {
-    if (len > MAX_MALLOC_SIZE || len == 0) {
-        if (ptr)
-            free(ptr);
+    readstat_malloc_scope_t *scope = NULL;
+    malloc_header_t *header = NULL;
+    malloc_header_t *new_header = NULL;
+    size_t old_len = 0;
+
+    if (ptr == NULL) {
+        return readstat_malloc(len);
+    }
+
+    header = (malloc_header_t *)((char *)ptr - MALLOC_HEADER_LEN);
+    old_len = header->len;
+
+    /* The block is charged to the current scope from here on */
+    malloc_scope_release(malloc_scope_for_serial(header->serial), old_len);
+    scope = malloc_scope_current();
+
+    if (len == 0 || malloc_scope_reserve(scope, len) == -1) {
+        free_handler(header);
+        return NULL;
+    }
+    if (len > SIZE_MAX - MALLOC_HEADER_LEN ||
+            (new_header = realloc_handler(header, MALLOC_HEADER_LEN + len)) == NULL) {
+        malloc_scope_release(scope, len);
+        free_handler(header);
         return NULL;
     }
-    return realloc(ptr, len);
+
+    new_header->len = len;
+    new_header->serial = scope ? scope->serial : 0;
+    return (char *)new_header + MALLOC_HEADER_LEN;
+}
+
+void readstat_free(void *ptr) {
+    malloc_header_t *header = NULL;
+    if (ptr == NULL)
+        return;
+
+    header = (malloc_header_t *)((char *)ptr - MALLOC_HEADER_LEN);
+    malloc_scope_release(malloc_scope_for_serial(header->serial), header->len);
+    free_handler(header);
 }
@@ -1,4 +1,43 @@
 
 void *readstat_malloc(size_t size);
 void *readstat_calloc(size_t count, size_t size);
+
+/* Unlike realloc(), frees `ptr' when it fails, so `ptr = readstat_realloc(ptr, len)'
+ * doesn't leak */
 void *readstat_realloc(void *ptr, size_t len);
+
+/* For memory from the functions above, which may come from the allocator
+ * given to readstat_set_allocator() */
+void readstat_free(void *ptr);
+
+/* Limits for the allocations made on this thread between begin and end, e.g.
+ * by a single parse. A max_allocation or memory_limit of 0 means no limit. */
+typedef struct readstat_malloc_scope_s {
+    size_t                          max_allocation;
+    size_t                          memory_limit;
+    size_t                          memory_used;
+    size_t                          peak_memory_used;
+    size_t                          peak_allocation;
+    uint64_t                        serial;
+    readstat_error_t                error;
+    int                             shared;
+    struct readstat_malloc_scope_s *previous;
+} readstat_malloc_scope_t;
+
+void readstat_malloc_scope_begin(readstat_malloc_scope_t *scope, size_t max_allocation, size_t memory_limit);
+
+/* Returns `retval', or the limit that was hit if the scope failed because of one */
+readstat_error_t readstat_malloc_scope_end(readstat_malloc_scope_t *scope, readstat_error_t retval);
+
+/* The scope allocations on this thread are charged to, or NULL */
+readstat_malloc_scope_t *readstat_malloc_scope_current(void);
+
+/* Threads started on behalf of a scope's owner charge their allocations to
+ * it between attach and detach. The owner shares the scope before starting
+ * them and unshares it once they have all been joined. */
+void readstat_malloc_scope_share(readstat_malloc_scope_t *scope);
+void readstat_malloc_scope_unshare(readstat_malloc_scope_t *scope);
+
+/* Returns what to hand to readstat_malloc_scope_detach() */
+readstat_malloc_scope_t *readstat_malloc_scope_attach(readstat_malloc_scope_t *scope);
+void readstat_malloc_scope_detach(readstat_malloc_scope_t *previous);
@@ -0,0 +1,8 @@
+//
+//  readstat_missingness.h - Defined missing values checked against the
+//  compiled form of a variable's rules
+//
+
+/* Whether `value' falls in the compiled rules; `missingness' must have
+ * is_compiled set */
+int readstat_missingness_contains(const readstat_missingness_t *missingness, readstat_value_t value);
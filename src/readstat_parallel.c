@@ -0,0 +1,212 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "readstat.h"
+#include "readstat_iconv.h"
+#include "readstat_malloc.h"
+#include "readstat_parallel.h"
+#include "readstat_label_index.h"
+#include "readstat_stats.h"
+
+typedef struct parallel_range_s {
+    readstat_parallel_job_t job;
+    void                   *job_ctx;
+    int                     worker;
+    long                    start;
+    long                    end;
+    long                    failed_index;
+    readstat_error_t        error;
+    readstat_stats_session_t *parent_stats;
+    readstat_parser_stats_t stats;
+    readstat_malloc_scope_t *scope;
+} parallel_range_t;
+
+static void *parallel_range_run(void *arg) {
+    parallel_range_t *range = (parallel_range_t *)arg;
+    readstat_stats_session_t stats_session;
+    readstat_malloc_scope_t *previous_scope = readstat_malloc_scope_attach(range->scope);
+    if (range->parent_stats)
+        readstat_stats_attach(&stats_session, range->parent_stats, &range->stats);
+    range->error = range->job(range->job_ctx, range->worker,
+            range->start, range->end, &range->failed_index);
+    if (range->parent_stats)
+        readstat_stats_detach(&stats_session);
+    readstat_malloc_scope_detach(previous_scope);
+    return NULL;
+}
+
+readstat_error_t readstat_parallel_for(int thread_count, long count,
+        readstat_parallel_job_t job, void *job_ctx, long *out_failed_index) {
+    parallel_range_t ranges[READSTAT_PARALLEL_MAX_THREADS];
+    readstat_malloc_scope_t *scope = readstat_malloc_scope_current();
+    int i;
+
+    if (count <= 0)
+        return READSTAT_OK;
+
+#if HAVE_PTHREAD
+    pthread_t threads[READSTAT_PARALLEL_MAX_THREADS];
+    int started[READSTAT_PARALLEL_MAX_THREADS];
+
+    if (thread_count > READSTAT_PARALLEL_MAX_THREADS)
+        thread_count = READSTAT_PARALLEL_MAX_THREADS;
+    if (thread_count > count)
+        thread_count = count;
+#else
+    thread_count = 1;
+#endif
+    if (thread_count < 1)
+        thread_count = 1;
+
+    for (i=0; i<thread_count; i++) {
+        parallel_range_t *range = &ranges[i];
+        range->job = job;
+        range->job_ctx = job_ctx;
+        range->worker = i;
+        range->start = count * i / thread_count;
+        range->end = count * (i + 1) / thread_count;
+        range->failed_index = -1;
+        range->error = READSTAT_OK;
+        range->parent_stats = readstat_stats_current();
+        memset(&range->stats, 0, sizeof(readstat_parser_stats_t));
+        range->scope = scope;
+    }
+
+#if HAVE_PTHREAD
+    if (thread_count > 1)
+        readstat_malloc_scope_share(scope);
+    for (i=1; i<thread_count; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, &parallel_range_run, &ranges[i]) == 0);
+    }
+    parallel_range_run(&ranges[0]);
+    for (i=1; i<thread_count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            parallel_range_run(&ranges[i]);
+        }
+    }
+    if (thread_count > 1)
+        readstat_malloc_scope_unshare(scope);
+#else
+    parallel_range_run(&ranges[0]);
+#endif
+
+    for (i=0; i<thread_count; i++) {
+        if (ranges[i].parent_stats)
+            readstat_stats_merge(ranges[i].parent_stats->stats, &ranges[i].stats);
+    }
+
+    for (i=0; i<thread_count; i++) {
+        if (ranges[i].error != READSTAT_OK) {
+            if (out_failed_index)
+                *out_failed_index = ranges[i].failed_index;
+            return ranges[i].error;
+        }
+    }
+
+    return READSTAT_OK;
+}
+
+ssize_t readstat_parallel_read_chunk(readstat_io_t *io, void *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t bytes_read = io->read((char *)buf + done, len - done, io->io_ctx);
+        if (bytes_read == -1)
+            return -1;
+        if (bytes_read == 0)
+            break;
+        done += bytes_read;
+    }
+    return done;
+}
+
+readstat_value_batch_t *readstat_value_batch_init(int value_count, size_t string_len,
+        size_t record_len, long max_rows) {
+    readstat_value_batch_t *batch = NULL;
+    size_t values_len = value_count * sizeof(readstat_value_t);
+    long row_capacity = max_rows;
+
+    if (record_len && row_capacity > READSTAT_PARALLEL_CHUNK_SIZE / record_len)
+        row_capacity = READSTAT_PARALLEL_CHUNK_SIZE / record_len;
+    if (values_len && row_capacity > 2 * READSTAT_PARALLEL_CHUNK_SIZE / values_len)
+        row_capacity = 2 * READSTAT_PARALLEL_CHUNK_SIZE / values_len;
+    if (string_len && row_capacity > 2 * READSTAT_PARALLEL_CHUNK_SIZE / string_len)
+        row_capacity = 2 * READSTAT_PARALLEL_CHUNK_SIZE / string_len;
+
+    if (row_capacity < 1 || value_count < 1)
+        return NULL;
+
+    if ((batch = calloc(1, sizeof(readstat_value_batch_t))) == NULL)
+        return NULL;
+
+    batch->row_capacity = row_capacity;
+    batch->value_count = value_count;
+    batch->string_len = string_len;
+
+    if ((batch->values = readstat_malloc(row_capacity * values_len)) == NULL)
+        goto error;
+
+    if ((batch->value_counts = readstat_calloc(row_capacity, sizeof(int))) == NULL)
+        goto error;
+
+    if (string_len && (batch->strings = readstat_malloc(row_capacity * string_len)) == NULL)
+        goto error;
+
+    return batch;
+
+error:
+    readstat_value_batch_free(batch);
+    return NULL;
+}
+
+void readstat_value_batch_free(readstat_value_batch_t *batch) {
+    if (batch) {
+        if (batch->values)
+            readstat_free(batch->values);
+        if (batch->value_counts)
+            readstat_free(batch->value_counts);
+        if (batch->strings)
+            readstat_free(batch->strings);
+        free(batch);
+    }
+}
+
+readstat_error_t readstat_parallel_converters_init(iconv_t **out_converters, int thread_count,
+        iconv_t converter, const char *to_encoding, const char *from_encoding) {
+    iconv_t *converters = NULL;
+    int i;
+
+    if ((converters = calloc(thread_count, sizeof(iconv_t))) == NULL)
+        return READSTAT_ERROR_MALLOC;
+
+    converters[0] = converter;
+    for (i=1; i<thread_count && i<READSTAT_PARALLEL_MAX_THREADS && converter; i++) {
+        converters[i] = iconv_open(to_encoding, from_encoding);
+        if (converters[i] == (iconv_t)-1) {
+            converters[i] = NULL;
+            readstat_parallel_converters_free(converters, thread_count);
+            return READSTAT_ERROR_UNSUPPORTED_CHARSET;
+        }
+    }
+
+    *out_converters = converters;
+    return READSTAT_OK;
+}
+
+void readstat_parallel_converters_free(iconv_t *converters, int thread_count) {
+    int i;
+    if (converters == NULL)
+        return;
+
+    for (i=1; i<thread_count; i++) {
+        if (converters[i])
+            iconv_close(converters[i]);
+    }
+    free(converters);
+}
@@ -0,0 +1,57 @@
+//
+//  readstat_parallel.h - Decoding fixed-width records on worker threads
+//
+
+/* Raw bytes read per chunk when decoding records in parallel */
+#define READSTAT_PARALLEL_CHUNK_SIZE  0x400000
+#define READSTAT_PARALLEL_MAX_THREADS 64
+
+/* Decodes items [start, end) on behalf of worker number `worker'. On failure,
+ * stores the index of the item that failed in *out_failed_index. */
+typedef readstat_error_t (*readstat_parallel_job_t)(void *job_ctx, int worker,
+        long start, long end, long *out_failed_index);
+
+/* Splits [0, count) into contiguous ranges and runs them on up to
+ * `thread_count' threads. If a job fails, returns the error of the failing
+ * item with the lowest index and stores that index in *out_failed_index;
+ * every item below it was decoded successfully. Runs serially when the
+ * library is built without thread support. */
+readstat_error_t readstat_parallel_for(int thread_count, long count,
+        readstat_parallel_job_t job, void *job_ctx, long *out_failed_index);
+
+/* Reads a chunk of records, calling the read handler until `len' bytes have
+ * arrived or it returns 0: a handler may return less than it was asked for
+ * well before the end of the file. Returns the number of bytes read, or -1 if
+ * the handler failed. */
+ssize_t readstat_parallel_read_chunk(readstat_io_t *io, void *buf, size_t len);
+
+/* Decoded values for a run of consecutive rows. Each row has room for
+ * `value_count' values, of which the first value_counts[row] were decoded,
+ * and `string_len' bytes of converted string storage. */
+typedef struct readstat_value_batch_s {
+    readstat_value_t   *values;
+    int                *value_counts;
+    char               *strings;
+    long                row_capacity;
+    int                 value_count;
+    size_t              string_len;
+} readstat_value_batch_t;
+
+readstat_value_batch_t *readstat_value_batch_init(int value_count, size_t string_len,
+        size_t record_len, long max_rows);
+void readstat_value_batch_free(readstat_value_batch_t *batch);
+
+static inline readstat_value_t *readstat_value_batch_row(readstat_value_batch_t *batch, long row) {
+    return &batch->values[row * batch->value_count];
+}
+
+static inline char *readstat_value_batch_strings(readstat_value_batch_t *batch, long row) {
+    return &batch->strings[row * batch->string_len];
+}
+
+/* One converter per worker; iconv_t objects carry state and can't be shared.
+ * Worker 0 borrows `converter'; the rest are opened from the same encodings.
+ * If `converter' is NULL, every worker gets NULL. */
+readstat_error_t readstat_parallel_converters_init(iconv_t **out_converters, int thread_count,
+        iconv_t converter, const char *to_encoding, const char *from_encoding);
+void readstat_parallel_converters_free(iconv_t *converters, int thread_count);
@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include "readstat.h"
 #include "readstat_io_unistd.h"
+#include "readstat_label_index.h"
+#include "readstat_malloc.h"
+#include "readstat_reuse.h"
 
 readstat_parser_t *readstat_parser_init() {
     readstat_parser_t *parser = calloc(1, sizeof(readstat_parser_t));
@@ -11,6 +14,8 @@ readstat_parser_t *readstat_parser_init() {
         return NULL;
     }
     parser->output_encoding = "UTF-8";
+    parser->thread_count = 1;
+    parser->max_allocation = READSTAT_DEFAULT_MAX_ALLOCATION;
     return parser;
 }
 
@@ -20,6 +25,8 @@ void readstat_parser_free(readstat_parser_t *parser) {
             readstat_set_io_ctx(parser, NULL);
             free(parser->io);
         }
+        readstat_label_index_free(parser->label_index);
+        readstat_reuse_free(parser->reuse);
         free(parser);
     }
 }
@@ -59,6 +66,16 @@ readstat_error_t readstat_set_progress_handler(readstat_parser_t *parser, readst
     return READSTAT_OK;
 }
 
+readstat_error_t readstat_set_dictionary_entry_handler(readstat_parser_t *parser, readstat_dictionary_entry_handler dictionary_entry_handler) {
+    parser->handlers.dictionary_entry = dictionary_entry_handler;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_string_view_handler(readstat_parser_t *parser, readstat_string_view_handler string_view_handler) {
+    parser->handlers.string_view = string_view_handler;
+    return READSTAT_OK;
+}
+
 readstat_error_t readstat_set_fweight_handler(readstat_parser_t *parser, readstat_fweight_handler fweight_handler) {
     parser->handlers.fweight = fweight_handler;
     return READSTAT_OK;
@@ -119,3 +136,58 @@ readstat_error_t readstat_set_row_offset(readstat_parser_t *parser, long row_off
     parser->row_offset = row_offset;
     return READSTAT_OK;
 }
+
+readstat_error_t readstat_set_thread_count(readstat_parser_t *parser, int thread_count) {
+    parser->thread_count = thread_count;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_prefetch_depth(readstat_parser_t *parser, int depth) {
+    parser->prefetch_depth = depth;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_progress_interval(readstat_parser_t *parser, long bytes, long milliseconds) {
+    parser->progress_interval_bytes = bytes;
+    parser->progress_interval_ms = milliseconds;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_max_allocation(readstat_parser_t *parser, size_t max_len) {
+    parser->max_allocation = max_len;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_memory_limit(readstat_parser_t *parser, size_t limit) {
+    parser->memory_limit = limit;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_value_label_lookup(readstat_parser_t *parser, readstat_value_label_lookup_t mode) {
+    parser->value_label_lookup = mode;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_string_dictionary_limit(readstat_parser_t *parser, int max_entries) {
+    parser->string_dictionary_limit = max_entries;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_context_reuse(readstat_parser_t *parser, int enabled) {
+    parser->context_reuse = enabled;
+    if (!enabled) {
+        readstat_reuse_free(parser->reuse);
+        parser->reuse = NULL;
+    }
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_set_collect_stats(readstat_parser_t *parser, int enabled) {
+    parser->collect_stats = enabled;
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_parser_get_stats(readstat_parser_t *parser, readstat_parser_stats_t *stats) {
+    *stats = parser->stats;
+    return READSTAT_OK;
+}
@@ -0,0 +1,359 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "readstat.h"
+#include "readstat_malloc.h"
+#include "readstat_prefetch.h"
+
+#if HAVE_PTHREAD
+
+struct readstat_prefetch_s {
+    readstat_io_t       io;
+    readstat_io_t      *source;
+    int                 depth;
+    size_t              block_size;
+    readstat_off_t      position;
+
+    unsigned char      *buffers;
+    size_t             *lengths;
+    int                 head;
+    int                 filled;
+    size_t              head_used;
+    int                 eof;
+    int                 read_error;
+    int                 stop;
+    int                 running;
+    int                 paused;
+    readstat_off_t      resume_offset;
+
+    readstat_malloc_scope_t *scope;
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      can_read;
+    pthread_cond_t      can_fill;
+};
+
+static ssize_t prefetch_read_block(readstat_io_t *source, unsigned char *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t bytes_read = source->read(buf + done, len - done, source->io_ctx);
+        if (bytes_read == -1)
+            return -1;
+        if (bytes_read == 0)
+            break;
+        done += bytes_read;
+    }
+    return done;
+}
+
+static void *prefetch_run(void *arg) {
+    readstat_prefetch_t *pf = (readstat_prefetch_t *)arg;
+    readstat_malloc_scope_t *previous_scope = readstat_malloc_scope_attach(pf->scope);
+
+    pthread_mutex_lock(&pf->lock);
+    while (!pf->stop && !pf->eof) {
+        int tail;
+        ssize_t len;
+
+        while (!pf->stop && pf->filled == pf->depth)
+            pthread_cond_wait(&pf->can_fill, &pf->lock);
+        if (pf->stop)
+            break;
+
+        tail = (pf->head + pf->filled) % pf->depth;
+        pthread_mutex_unlock(&pf->lock);
+
+        /* The consumer doesn't touch unfilled slots, so read unlocked */
+        len = prefetch_read_block(pf->source, &pf->buffers[tail * pf->block_size], pf->block_size);
+
+        pthread_mutex_lock(&pf->lock);
+        if (len == -1) {
+            pf->read_error = 1;
+            pf->eof = 1;
+        } else {
+            if (len > 0) {
+                pf->lengths[tail] = len;
+                pf->filled++;
+            }
+            if (len < pf->block_size)
+                pf->eof = 1;
+        }
+        pthread_cond_signal(&pf->can_read);
+    }
+    pthread_mutex_unlock(&pf->lock);
+
+    readstat_malloc_scope_detach(previous_scope);
+    return NULL;
+}
+
+/* Carries on filling the ring from where the underlying reader is */
+static void prefetch_spawn(readstat_prefetch_t *pf) {
+    pf->stop = 0;
+    readstat_malloc_scope_share(pf->scope);
+    pf->running = (pthread_create(&pf->thread, NULL, &prefetch_run, pf) == 0);
+    if (!pf->running)
+        readstat_malloc_scope_unshare(pf->scope);
+}
+
+static void prefetch_start(readstat_prefetch_t *pf) {
+    pf->head = 0;
+    pf->filled = 0;
+    pf->head_used = 0;
+    pf->eof = 0;
+    pf->read_error = 0;
+    prefetch_spawn(pf);
+}
+
+static void prefetch_stop(readstat_prefetch_t *pf) {
+    if (!pf->running)
+        return;
+
+    pthread_mutex_lock(&pf->lock);
+    pf->stop = 1;
+    pthread_cond_signal(&pf->can_fill);
+    pthread_mutex_unlock(&pf->lock);
+
+    pthread_join(pf->thread, NULL);
+    pf->running = 0;
+    readstat_malloc_scope_unshare(pf->scope);
+}
+
+/* Copies (or, with a NULL dst, discards) up to `len' bytes from the ring.
+ * With `wait' unset, only consumes what has already been read. Call locked. */
+static size_t prefetch_consume(readstat_prefetch_t *pf, unsigned char *dst, size_t len, int wait) {
+    size_t done = 0;
+    while (done < len) {
+        size_t avail, n;
+
+        while (wait && pf->filled == 0 && !pf->eof)
+            pthread_cond_wait(&pf->can_read, &pf->lock);
+        if (pf->filled == 0)
+            break;
+
+        avail = pf->lengths[pf->head] - pf->head_used;
+        n = len - done < avail ? len - done : avail;
+        if (dst)
+            memcpy(dst + done, &pf->buffers[pf->head * pf->block_size + pf->head_used], n);
+
+        pf->head_used += n;
+        done += n;
+        if (pf->head_used == pf->lengths[pf->head]) {
+            pf->head = (pf->head + 1) % pf->depth;
+            pf->head_used = 0;
+            pf->filled--;
+            pthread_cond_signal(&pf->can_fill);
+        }
+    }
+    pf->position += done;
+    return done;
+}
+
+static ssize_t prefetch_read_handler(void *buf, size_t nbyte, void *io_ctx) {
+    readstat_prefetch_t *pf = (readstat_prefetch_t *)io_ctx;
+    ssize_t bytes_read = 0;
+
+    if (readstat_prefetch_resume(pf) != READSTAT_OK)
+        return -1;
+
+    if (!pf->running) {
+        bytes_read = pf->source->read(buf, nbyte, pf->source->io_ctx);
+        if (bytes_read > 0)
+            pf->position += bytes_read;
+        return bytes_read;
+    }
+
+    pthread_mutex_lock(&pf->lock);
+    bytes_read = prefetch_consume(pf, buf, nbyte, 1);
+    if (bytes_read == 0 && nbyte > 0 && pf->read_error)
+        bytes_read = -1;
+    pthread_mutex_unlock(&pf->lock);
+
+    return bytes_read;
+}
+
+static readstat_off_t prefetch_seek_handler(readstat_off_t offset,
+        readstat_io_flags_t whence, void *io_ctx) {
+    readstat_prefetch_t *pf = (readstat_prefetch_t *)io_ctx;
+    readstat_off_t target = -1;
+    readstat_off_t newpos = -1;
+
+    if (whence == READSTAT_SEEK_SET) {
+        target = offset;
+    } else if (whence == READSTAT_SEEK_CUR) {
+        target = pf->position + offset;
+    }
+
+    if (target == pf->position)
+        return pf->position;
+
+    if (readstat_prefetch_resume(pf) != READSTAT_OK)
+        return -1;
+
+    if (pf->running && target > pf->position) {
+        size_t skip = target - pf->position;
+        pthread_mutex_lock(&pf->lock);
+        skip -= prefetch_consume(pf, NULL, skip, 0);
+        pthread_mutex_unlock(&pf->lock);
+        if (skip == 0)
+            return pf->position;
+    }
+
+    prefetch_stop(pf);
+    if (target == -1) {
+        newpos = pf->source->seek(offset, whence, pf->source->io_ctx);
+    } else {
+        newpos = pf->source->seek(target, READSTAT_SEEK_SET, pf->source->io_ctx);
+    }
+    if (newpos == -1)
+        return -1;
+
+    pf->position = newpos;
+    prefetch_start(pf);
+
+    return newpos;
+}
+
+static readstat_error_t prefetch_update_handler(long file_size,
+        readstat_progress_handler progress_handler, void *user_ctx, void *io_ctx) {
+    readstat_prefetch_t *pf = (readstat_prefetch_t *)io_ctx;
+    if (!progress_handler)
+        return READSTAT_OK;
+
+    if (progress_handler(1.0 * pf->position / file_size, user_ctx))
+        return READSTAT_ERROR_USER_ABORT;
+
+    return READSTAT_OK;
+}
+
+static int prefetch_close_handler(void *io_ctx) {
+    readstat_prefetch_t *pf = (readstat_prefetch_t *)io_ctx;
+    prefetch_stop(pf);
+    return pf->source->close(pf->source->io_ctx);
+}
+
+readstat_error_t readstat_prefetch_init(readstat_prefetch_t **out_prefetch, readstat_io_t **io,
+        int depth, size_t block_size) {
+    readstat_prefetch_t *pf = NULL;
+    readstat_io_t *source = *io;
+    readstat_off_t position = -1;
+
+    *out_prefetch = NULL;
+
+    if (depth < 1 || block_size == 0)
+        return READSTAT_OK;
+
+    if (depth > READSTAT_PREFETCH_MAX_DEPTH)
+        depth = READSTAT_PREFETCH_MAX_DEPTH;
+
+    if ((position = source->seek(0, READSTAT_SEEK_CUR, source->io_ctx)) == -1)
+        return READSTAT_ERROR_SEEK;
+
+    if ((pf = calloc(1, sizeof(readstat_prefetch_t))) == NULL)
+        return READSTAT_ERROR_MALLOC;
+
+    pf->source = source;
+    pf->depth = depth;
+    pf->block_size = block_size;
+    pf->position = position;
+    pf->scope = readstat_malloc_scope_current();
+
+    pf->buffers = readstat_malloc(depth * block_size);
+    pf->lengths = readstat_calloc(depth, sizeof(size_t));
+    if (pf->buffers == NULL || pf->lengths == NULL) {
+        readstat_free(pf->buffers);
+        readstat_free(pf->lengths);
+        free(pf);
+        return READSTAT_ERROR_MALLOC;
+    }
+
+    pthread_mutex_init(&pf->lock, NULL);
+    pthread_cond_init(&pf->can_read, NULL);
+    pthread_cond_init(&pf->can_fill, NULL);
+
+    pf->io = *source;
+    pf->io.open = NULL;
+    pf->io.close = &prefetch_close_handler;
+    pf->io.seek = &prefetch_seek_handler;
+    pf->io.read = &prefetch_read_handler;
+    pf->io.update = &prefetch_update_handler;
+    pf->io.io_ctx = pf;
+    pf->io.io_ctx_needs_free = 0;
+
+    prefetch_start(pf);
+
+    *io = &pf->io;
+    *out_prefetch = pf;
+
+    return READSTAT_OK;
+}
+
+readstat_io_t *readstat_prefetch_pause(readstat_prefetch_t *pf) {
+    if (!pf->paused) {
+        prefetch_stop(pf);
+        pf->resume_offset = pf->source->seek(0, READSTAT_SEEK_CUR, pf->source->io_ctx);
+        pf->paused = 1;
+    }
+    return pf->source;
+}
+
+readstat_error_t readstat_prefetch_resume(readstat_prefetch_t *pf) {
+    if (!pf->paused)
+        return READSTAT_OK;
+
+    if (pf->resume_offset == -1 ||
+            pf->source->seek(pf->resume_offset, READSTAT_SEEK_SET, pf->source->io_ctx) == -1)
+        return READSTAT_ERROR_SEEK;
+
+    pf->paused = 0;
+    prefetch_spawn(pf);
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_prefetch_free(readstat_prefetch_t *pf, readstat_io_t **io) {
+    readstat_error_t retval = READSTAT_OK;
+    if (pf == NULL)
+        return READSTAT_OK;
+
+    prefetch_stop(pf);
+
+    if (pf->source->seek(pf->position, READSTAT_SEEK_SET, pf->source->io_ctx) == -1)
+        retval = READSTAT_ERROR_SEEK;
+
+    *io = pf->source;
+
+    pthread_mutex_destroy(&pf->lock);
+    pthread_cond_destroy(&pf->can_read);
+    pthread_cond_destroy(&pf->can_fill);
+    readstat_free(pf->buffers);
+    readstat_free(pf->lengths);
+    free(pf);
+
+    return retval;
+}
+
+#else
+
+readstat_error_t readstat_prefetch_init(readstat_prefetch_t **out_prefetch, readstat_io_t **io,
+        int depth, size_t block_size) {
+    *out_prefetch = NULL;
+    return READSTAT_OK;
+}
+
+readstat_io_t *readstat_prefetch_pause(readstat_prefetch_t *pf) {
+    return NULL;
+}
+
+readstat_error_t readstat_prefetch_resume(readstat_prefetch_t *pf) {
+    return READSTAT_OK;
+}
+
+readstat_error_t readstat_prefetch_free(readstat_prefetch_t *pf, readstat_io_t **io) {
+    return READSTAT_OK;
+}
+
+#endif
@@ -0,0 +1,29 @@
+//
+//  readstat_prefetch.h - Reading ahead on a background thread
+//
+
+/* Bytes requested from the underlying reader per ring slot */
+#define READSTAT_PREFETCH_BLOCK_SIZE  0x100000
+#define READSTAT_PREFETCH_MAX_DEPTH   8
+
+typedef struct readstat_prefetch_s readstat_prefetch_t;
+
+/* Starts a thread that reads ahead of the current position of *io into a
+ * ring of `depth' buffers of `block_size' bytes each, and swaps *io for a
+ * proxy that reads from the ring. Seeks outside the buffered data restart
+ * the thread at the new position. `depth' is capped at
+ * READSTAT_PREFETCH_MAX_DEPTH. Leaves *io alone and sets *out_prefetch to
+ * NULL if `depth' is less than 1 or the library has no thread support. */
+readstat_error_t readstat_prefetch_init(readstat_prefetch_t **out_prefetch, readstat_io_t **io,
+        int depth, size_t block_size);
+
+/* Stops the thread, keeping what it has read, and hands back the underlying
+ * reader for reads elsewhere in the file. The next read or seek through the
+ * proxy, or readstat_prefetch_resume(), puts the underlying reader back and
+ * starts the thread again. Pausing a paused prefetch does nothing. */
+readstat_io_t *readstat_prefetch_pause(readstat_prefetch_t *prefetch);
+readstat_error_t readstat_prefetch_resume(readstat_prefetch_t *prefetch);
+
+/* Stops the thread, positions the underlying reader at the proxy's current
+ * offset, and puts the original reader back in *io. */
+readstat_error_t readstat_prefetch_free(readstat_prefetch_t *prefetch, readstat_io_t **io);
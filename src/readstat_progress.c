@@ -0,0 +1,58 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <sys/time.h>
+
+#include "readstat.h"
+#include "readstat_progress.h"
+
+static double progress_clock(void) {
+#if defined CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+#endif
+}
+
+void readstat_progress_init(readstat_progress_t *progress, readstat_parser_t *parser) {
+    progress->interval_bytes = parser->progress_interval_bytes;
+    progress->interval_ms = parser->progress_interval_ms;
+    progress->last_offset = 0;
+    progress->last_time = 0.0;
+    progress->reported = 0;
+}
+
+int readstat_progress_due(readstat_progress_t *progress, readstat_io_t *io) {
+    readstat_off_t offset = 0;
+    double now = 0.0;
+
+    if (progress->interval_bytes <= 0 && progress->interval_ms <= 0)
+        return 1;
+
+    if (progress->interval_ms > 0) {
+        now = progress_clock();
+        if (progress->reported && now - progress->last_time < 1e-3 * progress->interval_ms)
+            return 0;
+    }
+
+    if (progress->interval_bytes > 0) {
+        offset = io->seek(0, READSTAT_SEEK_CUR, io->io_ctx);
+        if (progress->reported && offset != -1 &&
+                offset - progress->last_offset < progress->interval_bytes)
+            return 0;
+    }
+
+    progress->last_time = now;
+    progress->last_offset = offset;
+    progress->reported = 1;
+
+    return 1;
+}
+
+void readstat_progress_reset(readstat_progress_t *progress) {
+    progress->reported = 0;
+}
@@ -0,0 +1,27 @@
+//
+//  readstat_progress.h - Throttling calls to the progress handler
+//
+
+#ifndef INCLUDE_READSTAT_PROGRESS_H
+#define INCLUDE_READSTAT_PROGRESS_H
+
+typedef struct readstat_progress_s {
+    long            interval_bytes;
+    long            interval_ms;
+    readstat_off_t  last_offset;
+    double          last_time;
+    int             reported;
+} readstat_progress_t;
+
+void readstat_progress_init(readstat_progress_t *progress, readstat_parser_t *parser);
+
+/* Returns 1 if the progress handler should be called now, and if so starts a
+ * new interval. The position is taken from io->seek(0, READSTAT_SEEK_CUR),
+ * which the built-in readers answer without a system call, and only when a
+ * byte interval is set. */
+int readstat_progress_due(readstat_progress_t *progress, readstat_io_t *io);
+
+/* Makes the next call to readstat_progress_due() return 1 */
+void readstat_progress_reset(readstat_progress_t *progress);
+
+#endif
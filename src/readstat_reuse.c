@@ -0,0 +1,112 @@
+#include <stdlib.h>
+
+#include "readstat.h"
+#include "readstat_malloc.h"
+#include "readstat_io_cache.h"
+#include "readstat_reuse.h"
+
+struct readstat_reuse_s {
+    void                       *contexts[READSTAT_REUSE_SLOT_COUNT];
+    readstat_reuse_callback     free_contexts[READSTAT_REUSE_SLOT_COUNT];
+
+    readstat_io_cache_t        *file;
+    int                         file_in_use;
+
+    /* Every parse charges its memory to the same scope serial, so blocks
+     * kept by one parse are credited back when a later one frees them */
+    uint64_t                    scope_serial;
+    size_t                      memory_held;
+};
+
+void readstat_reuse_free(readstat_reuse_t *reuse) {
+    int i;
+    if (reuse == NULL)
+        return;
+
+    for (i=0; i<READSTAT_REUSE_SLOT_COUNT; i++) {
+        if (reuse->contexts[i])
+            reuse->free_contexts[i](reuse->contexts[i]);
+    }
+    if (reuse->file)
+        readstat_io_cache_free(reuse->file, NULL);
+    free(reuse);
+}
+
+static readstat_reuse_t *reuse_get(readstat_parser_t *parser) {
+    if (!parser->context_reuse)
+        return NULL;
+
+    if (parser->reuse == NULL)
+        parser->reuse = calloc(1, sizeof(readstat_reuse_t));
+
+    return parser->reuse;
+}
+
+void readstat_reuse_scope_begin(readstat_parser_t *parser, readstat_malloc_scope_t *scope) {
+    readstat_reuse_t *reuse = reuse_get(parser);
+    if (reuse == NULL)
+        return;
+
+    if (reuse->scope_serial) {
+        scope->serial = reuse->scope_serial;
+        scope->memory_used = reuse->memory_held;
+        scope->peak_memory_used = reuse->memory_held;
+    } else {
+        reuse->scope_serial = scope->serial;
+    }
+}
+
+void readstat_reuse_scope_end(readstat_parser_t *parser, readstat_malloc_scope_t *scope) {
+    readstat_reuse_t *reuse = parser->reuse;
+    if (reuse && reuse->scope_serial == scope->serial)
+        reuse->memory_held = scope->memory_used;
+}
+
+void *readstat_reuse_take(readstat_parser_t *parser, readstat_reuse_slot_t slot) {
+    readstat_reuse_t *reuse = parser->reuse;
+    void *ctx = NULL;
+    if (reuse) {
+        ctx = reuse->contexts[slot];
+        reuse->contexts[slot] = NULL;
+    }
+    return ctx;
+}
+
+void readstat_reuse_keep(readstat_parser_t *parser, readstat_reuse_slot_t slot, void *ctx,
+        readstat_reuse_callback reset_ctx, readstat_reuse_callback free_ctx) {
+    readstat_reuse_t *reuse = reuse_get(parser);
+
+    if (reuse == NULL || reuse->contexts[slot]) {
+        free_ctx(ctx);
+        return;
+    }
+
+    reset_ctx(ctx);
+    reuse->contexts[slot] = ctx;
+    reuse->free_contexts[slot] = free_ctx;
+}
+
+readstat_error_t readstat_reuse_io_begin(readstat_parser_t *parser, readstat_io_t **io,
+        readstat_off_t file_size) {
+    readstat_reuse_t *reuse = reuse_get(parser);
+    readstat_error_t retval = READSTAT_OK;
+
+    if (reuse == NULL || reuse->file_in_use ||
+            file_size <= 0 || file_size > READSTAT_REUSE_MAX_FILE_SIZE)
+        return READSTAT_OK;
+
+    if ((retval = readstat_io_cache_init(&reuse->file, io, file_size)) == READSTAT_OK)
+        reuse->file_in_use = 1;
+
+    return retval;
+}
+
+readstat_error_t readstat_reuse_io_end(readstat_parser_t *parser, readstat_io_t **io) {
+    readstat_reuse_t *reuse = parser->reuse;
+
+    if (reuse == NULL || !reuse->file_in_use)
+        return READSTAT_OK;
+
+    reuse->file_in_use = 0;
+    return readstat_io_cache_release(reuse->file, io);
+}
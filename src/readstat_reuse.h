@@ -0,0 +1,45 @@
+//
+//  readstat_reuse.h - What a parser keeps from one parse for the next under
+//  readstat_set_context_reuse()
+//
+
+/* Files up to this size are read into memory in one go */
+#define READSTAT_REUSE_MAX_FILE_SIZE    0x100000
+
+typedef enum readstat_reuse_slot_e {
+    READSTAT_REUSE_SLOT_DTA,
+    READSTAT_REUSE_SLOT_SAV,
+    READSTAT_REUSE_SLOT_COUNT
+} readstat_reuse_slot_t;
+
+typedef void (*readstat_reuse_callback)(void *ctx);
+
+typedef struct readstat_reuse_s readstat_reuse_t;
+
+void readstat_reuse_free(readstat_reuse_t *reuse);
+
+/* Charges `scope', just begun for a parse, with the memory kept from earlier
+ * parses, so that it counts towards the limit and the peak and is credited
+ * back when this parse frees it. Does nothing if reuse is off. */
+void readstat_reuse_scope_begin(readstat_parser_t *parser, readstat_malloc_scope_t *scope);
+
+/* Remembers what `scope' still holds for the next parse */
+void readstat_reuse_scope_end(readstat_parser_t *parser, readstat_malloc_scope_t *scope);
+
+/* The format context kept in `slot' by an earlier parse, which the caller now
+ * owns, or NULL */
+void *readstat_reuse_take(readstat_parser_t *parser, readstat_reuse_slot_t slot);
+
+/* Resets `ctx' and keeps it in `slot' for the next parse if reuse is on;
+ * frees it otherwise */
+void readstat_reuse_keep(readstat_parser_t *parser, readstat_reuse_slot_t slot, void *ctx,
+        readstat_reuse_callback reset_ctx, readstat_reuse_callback free_ctx);
+
+/* If reuse is on and the file is small, swaps *io for a proxy that reads the
+ * rest of the file into a buffer kept between parses on the first read. Does
+ * nothing otherwise. */
+readstat_error_t readstat_reuse_io_begin(readstat_parser_t *parser, readstat_io_t **io,
+        readstat_off_t file_size);
+
+/* Puts the original reader back in *io if readstat_reuse_io_begin() swapped it */
+readstat_error_t readstat_reuse_io_end(readstat_parser_t *parser, readstat_io_t **io);
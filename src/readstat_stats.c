@@ -0,0 +1,392 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "readstat.h"
+#include "readstat_malloc.h"
+#include "readstat_label_index.h"
+#include "readstat_stats.h"
+#include "readstat_reuse.h"
+
+/* Parses collecting stats on any thread. While there are none, which is
+ * the case unless some parse has asked for stats, readstat_stats_current()
+ * skips the thread-specific lookup. Worker sessions leave the count alone:
+ * they only live while their parent's parse holds it above zero, so the
+ * workers read it without racing a write. */
+static long stats_sessions_count;
+
+#if HAVE_PTHREAD
+static pthread_key_t   stats_session_key;
+static pthread_once_t  stats_session_key_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t stats_sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void stats_session_key_init(void) {
+    pthread_key_create(&stats_session_key, NULL);
+}
+
+static void stats_sessions_add(long delta) {
+    pthread_mutex_lock(&stats_sessions_lock);
+    stats_sessions_count += delta;
+    pthread_mutex_unlock(&stats_sessions_lock);
+}
+
+static readstat_stats_session_t *stats_get_current(void) {
+    pthread_once(&stats_session_key_once, &stats_session_key_init);
+    return pthread_getspecific(stats_session_key);
+}
+
+static void stats_set_current(readstat_stats_session_t *session) {
+    pthread_once(&stats_session_key_once, &stats_session_key_init);
+    pthread_setspecific(stats_session_key, session);
+}
+#else
+static readstat_stats_session_t *stats_current_session;
+
+static void stats_sessions_add(long delta) {
+    stats_sessions_count += delta;
+}
+
+static readstat_stats_session_t *stats_get_current(void) {
+    return stats_current_session;
+}
+
+static void stats_set_current(readstat_stats_session_t *session) {
+    stats_current_session = session;
+}
+#endif
+
+readstat_stats_session_t *readstat_stats_current(void) {
+    if (stats_sessions_count == 0)
+        return NULL;
+    return stats_get_current();
+}
+
+static double stats_clock(void) {
+#if defined CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+#endif
+}
+
+static void stats_push(readstat_stats_session_t *session, readstat_parser_stats_t *stats,
+        readstat_parser_t *parser) {
+    session->stats = stats;
+    session->parser = parser;
+    session->installed = 1;
+    session->previous = stats_get_current();
+    /* Any odd seed will do; it only needs to differ between threads */
+    session->sample_state = ((uint64_t)(uintptr_t)session << 1) | 1;
+    stats_set_current(session);
+}
+
+static void stats_pop(readstat_stats_session_t *session) {
+    stats_set_current(session->previous);
+    session->installed = 0;
+}
+
+void readstat_stats_timer_start(readstat_stats_timer_t *timer, readstat_stats_session_t *session,
+        readstat_stats_timer_kind_t kind, int sampled) {
+    timer->session = session;
+    timer->kind = kind;
+    timer->start = 0.0;
+    timer->scale = 0.0;
+
+    if (session == NULL)
+        return;
+
+    if (sampled) {
+        uint64_t x = session->sample_state;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        session->sample_state = x;
+        if ((x >> 32) % READSTAT_STATS_SAMPLE_INTERVAL)
+            return;
+        timer->scale = READSTAT_STATS_SAMPLE_INTERVAL;
+    } else {
+        timer->scale = 1.0;
+    }
+    timer->start = stats_clock();
+}
+
+void readstat_stats_timer_stop(readstat_stats_timer_t *timer) {
+    readstat_parser_stats_t *stats = NULL;
+    double elapsed = 0.0;
+
+    if (timer->scale == 0.0)
+        return;
+
+    stats = timer->session->stats;
+    elapsed = timer->scale * (stats_clock() - timer->start);
+
+    switch (timer->kind) {
+        case READSTAT_STATS_TIMER_DECOMPRESSION:
+            stats->decompression_seconds += elapsed;
+            break;
+        case READSTAT_STATS_TIMER_CONVERSION:
+            stats->conversion_seconds += elapsed;
+            break;
+        case READSTAT_STATS_TIMER_CALLBACK:
+            stats->callback_seconds += elapsed;
+            break;
+    }
+}
+
+/* Counting I/O proxy, installed for every parse; may be driven from the
+ * prefetch thread, which only touches the I/O counters */
+static int stats_open_handler(const char *path, void *io_ctx) {
+    readstat_stats_session_t *session = (readstat_stats_session_t *)io_ctx;
+    return session->io->open(path, session->io->io_ctx);
+}
+
+static int stats_close_handler(void *io_ctx) {
+    readstat_stats_session_t *session = (readstat_stats_session_t *)io_ctx;
+    return session->io->close(session->io->io_ctx);
+}
+
+static readstat_off_t stats_seek_handler(readstat_off_t offset, readstat_io_flags_t whence, void *io_ctx) {
+    readstat_stats_session_t *session = (readstat_stats_session_t *)io_ctx;
+    /* Asking for the current position isn't counted as a seek */
+    if (offset != 0 || whence != READSTAT_SEEK_CUR)
+        session->stats->seek_calls++;
+    return session->io->seek(offset, whence, session->io->io_ctx);
+}
+
+static ssize_t stats_read_handler(void *buf, size_t nbyte, void *io_ctx) {
+    readstat_stats_session_t *session = (readstat_stats_session_t *)io_ctx;
+    ssize_t bytes_read = session->io->read(buf, nbyte, session->io->io_ctx);
+    session->stats->read_calls++;
+    if (bytes_read > 0)
+        session->stats->bytes_read += bytes_read;
+    return bytes_read;
+}
+
+static readstat_error_t stats_update_handler(long file_size, readstat_progress_handler progress_handler,
+        void *user_ctx, void *io_ctx) {
+    readstat_stats_session_t *session = (readstat_stats_session_t *)io_ctx;
+    return session->io->update(file_size, progress_handler, user_ctx, session->io->io_ctx);
+}
+
+/* Timed handlers; user_ctx is passed through untouched */
+static int stats_handle_metadata(readstat_metadata_t *metadata, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 0);
+    int retval = session->handlers.metadata(metadata, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_note(int note_index, const char *note, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 0);
+    int retval = session->handlers.note(note_index, note, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 0);
+    int retval = session->handlers.variable(index, variable, val_labels, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_fweight(readstat_variable_t *variable, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 0);
+    int retval = session->handlers.fweight(variable, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 1);
+    int retval = session->handlers.value(obs_index, variable, value, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_value_label(const char *val_labels, readstat_value_t value,
+        const char *label, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 1);
+    int retval = session->handlers.value_label(val_labels, value, label, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_dictionary_entry(readstat_variable_t *variable, int code,
+        const char *string, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 0);
+    int retval = session->handlers.dictionary_entry(variable, code, string, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_string_view(int obs_index, readstat_variable_t *variable,
+        const char *string, size_t len, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 1);
+    int retval = session->handlers.string_view(obs_index, variable, string, len, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+static int stats_handle_progress(double progress, void *ctx) {
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_CALLBACK, 0);
+    int retval = session->handlers.progress(progress, ctx);
+    readstat_stats_timer_stop(&timer);
+    return retval;
+}
+
+void readstat_stats_begin(readstat_stats_session_t *session, readstat_parser_t *parser) {
+    readstat_stats_session_t *current = NULL;
+
+    memset(session, 0, sizeof(readstat_stats_session_t));
+    memset(&parser->stats, 0, sizeof(readstat_parser_stats_t));
+    session->stats = &parser->stats;
+    session->saved_handlers = parser->handlers;
+    session->saved_io = parser->io;
+
+    /* A handler may start another parse with the same parser, whose I/O has
+     * already been swapped */
+    if (parser->io->read == &stats_read_handler) {
+        session->io = ((readstat_stats_session_t *)parser->io->io_ctx)->io;
+    } else {
+        session->io = parser->io;
+    }
+
+    session->proxy_io.open = &stats_open_handler;
+    session->proxy_io.close = &stats_close_handler;
+    session->proxy_io.seek = &stats_seek_handler;
+    session->proxy_io.read = &stats_read_handler;
+    session->proxy_io.update = &stats_update_handler;
+    session->proxy_io.io_ctx = session;
+    parser->io = &session->proxy_io;
+
+    /* Keep the default parse free of handler proxies and thread-specific
+     * lookups */
+    if (!parser->collect_stats)
+        return;
+
+    /* As with the I/O, a parse started from a handler finds the outer
+     * parse's proxies in place */
+    current = readstat_stats_current();
+    if (current && current->parser == parser) {
+        session->handlers = current->handlers;
+    } else {
+        session->handlers = parser->handlers;
+    }
+
+    stats_sessions_add(1);
+    stats_push(session, &parser->stats, parser);
+
+    if (session->handlers.metadata)
+        parser->handlers.metadata = &stats_handle_metadata;
+    if (session->handlers.note)
+        parser->handlers.note = &stats_handle_note;
+    if (session->handlers.variable)
+        parser->handlers.variable = &stats_handle_variable;
+    if (session->handlers.fweight)
+        parser->handlers.fweight = &stats_handle_fweight;
+    if (session->handlers.value)
+        parser->handlers.value = &stats_handle_value;
+    if (session->handlers.value_label)
+        parser->handlers.value_label = &stats_handle_value_label;
+    if (session->handlers.progress)
+        parser->handlers.progress = &stats_handle_progress;
+    if (session->handlers.dictionary_entry)
+        parser->handlers.dictionary_entry = &stats_handle_dictionary_entry;
+    if (session->handlers.string_view)
+        parser->handlers.string_view = &stats_handle_string_view;
+}
+
+void readstat_stats_end(readstat_stats_session_t *session, readstat_parser_t *parser) {
+    parser->handlers = session->saved_handlers;
+    parser->io = session->saved_io;
+
+    if (session->installed) {
+        stats_pop(session);
+        stats_sessions_add(-1);
+    }
+}
+
+readstat_error_t readstat_stats_parse(readstat_parser_t *parser, readstat_stats_parse_t parse,
+        readstat_label_index_parse_t labels, const char *path, void *user_ctx) {
+    readstat_stats_session_t session;
+    readstat_malloc_scope_t scope;
+    readstat_label_index_scope_t label_scope;
+    readstat_error_t retval = READSTAT_OK;
+
+    readstat_stats_begin(&session, parser);
+    readstat_malloc_scope_begin(&scope, parser->max_allocation, parser->memory_limit);
+    readstat_reuse_scope_begin(parser, &scope);
+    if ((retval = readstat_label_index_begin_parse(&label_scope, parser, labels, user_ctx)) == READSTAT_OK)
+        retval = parse(parser, path, label_scope.parse_ctx);
+    retval = readstat_label_index_end_parse(&label_scope, retval);
+    retval = readstat_malloc_scope_end(&scope, retval);
+    readstat_reuse_scope_end(parser, &scope);
+    parser->stats.peak_memory_used = scope.peak_memory_used;
+    parser->stats.peak_buffer_size = scope.peak_allocation;
+    readstat_stats_end(&session, parser);
+
+    return retval;
+}
+
+void readstat_stats_attach(readstat_stats_session_t *session, readstat_stats_session_t *parent,
+        readstat_parser_stats_t *stats) {
+    memset(session, 0, sizeof(readstat_stats_session_t));
+    if (parent)
+        session->handlers = parent->handlers;
+    stats_push(session, stats, NULL);
+}
+
+void readstat_stats_detach(readstat_stats_session_t *session) {
+    stats_pop(session);
+}
+
+void readstat_stats_merge(readstat_parser_stats_t *into, const readstat_parser_stats_t *from) {
+    into->bytes_read += from->bytes_read;
+    into->read_calls += from->read_calls;
+    into->seek_calls += from->seek_calls;
+    into->pages_processed += from->pages_processed;
+    into->rows_decoded += from->rows_decoded;
+    into->rows_skipped += from->rows_skipped;
+    into->string_conversions += from->string_conversions;
+    into->iconv_calls += from->iconv_calls;
+    into->bytes_decompressed += from->bytes_decompressed;
+    into->decompression_seconds += from->decompression_seconds;
+    into->conversion_seconds += from->conversion_seconds;
+    into->callback_seconds += from->callback_seconds;
+    if (from->peak_buffer_size > into->peak_buffer_size)
+        into->peak_buffer_size = from->peak_buffer_size;
+    if (from->peak_memory_used > into->peak_memory_used)
+        into->peak_memory_used = from->peak_memory_used;
+}
@@ -0,0 +1,71 @@
+//
+//  readstat_stats.h - Per-parse counters behind readstat_parser_get_stats()
+//
+
+/* Timers on per-value paths time about one call in this many */
+#define READSTAT_STATS_SAMPLE_INTERVAL 16
+
+typedef enum readstat_stats_timer_kind_e {
+    READSTAT_STATS_TIMER_DECOMPRESSION,
+    READSTAT_STATS_TIMER_CONVERSION,
+    READSTAT_STATS_TIMER_CALLBACK
+} readstat_stats_timer_kind_t;
+
+/* Every parse counts its I/O through a proxy that finds the session through
+ * its io_ctx, and the readers count rows, pages and decompressed bytes in
+ * their own contexts. With readstat_set_collect_stats(), the session is also
+ * installed for the duration of the parse, and looked up by thread so that
+ * helpers like readstat_convert() can count without a context argument, and
+ * the handlers are timed. Worker threads get their own session, merged into
+ * the parent's when the workers finish. */
+typedef struct readstat_stats_session_s {
+    readstat_parser_stats_t         *stats;
+    readstat_parser_t               *parser;
+    int                              installed;
+    readstat_callbacks_t             handlers;
+    readstat_io_t                   *io;
+    readstat_callbacks_t             saved_handlers;
+    readstat_io_t                   *saved_io;
+    readstat_io_t                    proxy_io;
+    uint64_t                         sample_state;
+    struct readstat_stats_session_s *previous;
+} readstat_stats_session_t;
+
+typedef struct readstat_stats_timer_s {
+    readstat_stats_session_t    *session;
+    readstat_stats_timer_kind_t  kind;
+    double                       start;
+    double                       scale;
+} readstat_stats_timer_t;
+
+typedef readstat_error_t (*readstat_stats_parse_t)(readstat_parser_t *parser,
+        const char *path, void *user_ctx);
+
+/* Zeroes the parser's counters and swaps its I/O for a counting proxy. With
+ * readstat_set_collect_stats(), also swaps its handlers for timing proxies
+ * and makes the session current on this thread. */
+void readstat_stats_begin(readstat_stats_session_t *session, readstat_parser_t *parser);
+void readstat_stats_end(readstat_stats_session_t *session, readstat_parser_t *parser);
+
+/* Runs `parse' between readstat_stats_begin() and readstat_stats_end(), under
+ * the parser's allocation limits, with `labels' saying what the label index
+ * keeps from earlier parses */
+readstat_error_t readstat_stats_parse(readstat_parser_t *parser, readstat_stats_parse_t parse,
+        readstat_label_index_parse_t labels, const char *path, void *user_ctx);
+
+/* For worker threads: counts into `stats' until detached, calling the
+ * handlers of `parent' (which may be NULL) */
+void readstat_stats_attach(readstat_stats_session_t *session, readstat_stats_session_t *parent,
+        readstat_parser_stats_t *stats);
+void readstat_stats_detach(readstat_stats_session_t *session);
+void readstat_stats_merge(readstat_parser_stats_t *into, const readstat_parser_stats_t *from);
+
+/* The session of the parse running on this thread, or NULL */
+readstat_stats_session_t *readstat_stats_current(void);
+
+/* Sampled timers are started on a random subset of calls and weighted to
+ * make up for the rest; unsampled ones time every call. Both are no-ops
+ * when `session' is NULL. */
+void readstat_stats_timer_start(readstat_stats_timer_t *timer, readstat_stats_session_t *session,
+        readstat_stats_timer_kind_t kind, int sampled);
+void readstat_stats_timer_stop(readstat_stats_timer_t *timer);
@@ -1,5 +1,6 @@
 
 #include "readstat.h"
+#include "readstat_missingness.h"
 
 readstat_type_class_t readstat_type_class(readstat_type_t type) {
     if (type == READSTAT_TYPE_STRING || type == READSTAT_TYPE_STRING_REF)
@@ -67,10 +68,39 @@ static int readstat_string_is_defined_missing(const char *string, readstat_varia
     return 0;
 }
 
+int readstat_missingness_contains(const readstat_missingness_t *missingness, readstat_value_t value) {
+    int i;
+    if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        const char *string = readstat_string_value(value);
+        if (string == NULL)
+            return 0;
+        for (i=0; i<missingness->discrete_count; i++) {
+            if (strcmp(string, missingness->discrete_strings[i]) == 0)
+                return 1;
+        }
+        return 0;
+    }
+
+    double fp_value = readstat_double_value(value);
+    if (missingness->has_range && fp_value >= missingness->range_lo && fp_value <= missingness->range_hi)
+        return 1;
+    for (i=0; i<missingness->discrete_count; i++) {
+        if (fp_value == missingness->discrete_doubles[i])
+            return 1;
+    }
+    return 0;
+}
+
 int readstat_value_is_defined_missing(readstat_value_t value, readstat_variable_t *variable) {
+    if (value.is_defined_missing)
+        return 1;
+
     if (readstat_value_type_class(value) != readstat_variable_get_type_class(variable))
         return 0;
 
+    if (variable->missingness && variable->missingness->is_compiled)
+        return readstat_missingness_contains(variable->missingness, value);
+
     if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING)
         return readstat_string_is_defined_missing(readstat_string_value(value), variable);
 
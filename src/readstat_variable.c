@@ -74,33 +74,46 @@ int readstat_variable_get_display_width(const readstat_variable_t *variable) {
 }
 
 int readstat_variable_get_missing_ranges_count(const readstat_variable_t *variable) {
-    return variable->missingness.missing_ranges_count;
+    if (variable->missingness == NULL)
+        return 0;
+
+    return variable->missingness->missing_ranges_count;
 }
 
 readstat_value_t readstat_variable_get_missing_range_lo(const readstat_variable_t *variable, int i) {
-    if (i < variable->missingness.missing_ranges_count &&
-            2*i+1 < sizeof(variable->missingness.missing_ranges)/sizeof(variable->missingness.missing_ranges[0])) {
-        return variable->missingness.missing_ranges[2*i];
+    const readstat_missingness_t *missingness = variable->missingness;
+    if (missingness && i < missingness->missing_ranges_count &&
+            2*i+1 < sizeof(missingness->missing_ranges)/sizeof(missingness->missing_ranges[0])) {
+        return missingness->missing_ranges[2*i];
     }
 
     return make_blank_value();
 }
 
 readstat_value_t readstat_variable_get_missing_range_hi(const readstat_variable_t *variable, int i) {
-    if (i < variable->missingness.missing_ranges_count &&
-            2*i+1 < sizeof(variable->missingness.missing_ranges)/sizeof(variable->missingness.missing_ranges[0])) {
-        return variable->missingness.missing_ranges[2*i+1];
+    const readstat_missingness_t *missingness = variable->missingness;
+    if (missingness && i < missingness->missing_ranges_count &&
+            2*i+1 < sizeof(missingness->missing_ranges)/sizeof(missingness->missing_ranges[0])) {
+        return missingness->missing_ranges[2*i+1];
     }
 
     return make_blank_value();
 }
 
+/* Variables made by the writer get their missing values from the heap, and
+ * readstat_writer_free() releases them */
 static readstat_error_t readstat_variable_add_missing_value_range(readstat_variable_t *variable, readstat_value_t lo, readstat_value_t hi) {
-    int i = readstat_variable_get_missing_ranges_count(variable);
-    if (2*i < sizeof(variable->missingness.missing_ranges)/sizeof(variable->missingness.missing_ranges[0])) {
-        variable->missingness.missing_ranges[2*i] = lo;
-        variable->missingness.missing_ranges[2*i+1] = hi;
-        variable->missingness.missing_ranges_count++;
+    readstat_missingness_t *missingness = variable->missingness;
+    if (missingness == NULL) {
+        if ((missingness = calloc(1, sizeof(readstat_missingness_t))) == NULL)
+            return READSTAT_ERROR_MALLOC;
+        variable->missingness = missingness;
+    }
+    int i = missingness->missing_ranges_count;
+    if (2*i < sizeof(missingness->missing_ranges)/sizeof(missingness->missing_ranges[0])) {
+        missingness->missing_ranges[2*i] = lo;
+        missingness->missing_ranges[2*i+1] = hi;
+        missingness->missing_ranges_count++;
         return READSTAT_OK;
     }
     return READSTAT_ERROR_TOO_MANY_MISSING_VALUE_DEFINITIONS;
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <time.h>
 #include "readstat.h"
+#include "readstat_malloc.h"
+#include "readstat_arena.h"
 #include "readstat_writer.h"
 
 #define VARIABLES_INITIAL_CAPACITY    50
@@ -11,6 +13,11 @@
 #define STRING_REFS_INITIAL_CAPACITY 100
 #define LABEL_SET_VARIABLES_INITIAL_CAPACITY 2
 
+/* Longest names, formats and labels kept, in bytes */
+#define VARIABLE_NAME_MAX_LEN         299
+#define VARIABLE_FORMAT_MAX_LEN       255
+#define VARIABLE_LABEL_MAX_LEN       1023
+
 static readstat_error_t readstat_write_row_default_callback(void *writer_ctx, void *bytes, size_t len) {
     return readstat_write_bytes((readstat_writer_t *)writer_ctx, bytes, len);
 }
@@ -40,6 +47,7 @@ readstat_writer_t *readstat_writer_init() {
 
     writer->variables = calloc(VARIABLES_INITIAL_CAPACITY, sizeof(readstat_variable_t *));
     writer->variables_capacity = VARIABLES_INITIAL_CAPACITY;
+    writer->arena = readstat_arena_init();
 
     writer->label_sets = calloc(LABEL_SETS_INITIAL_CAPACITY, sizeof(readstat_label_set_t *));
     writer->label_sets_capacity = LABEL_SETS_INITIAL_CAPACITY;
@@ -52,34 +60,60 @@ readstat_writer_t *readstat_writer_init() {
 
     writer->timestamp = time(NULL);
     writer->is_64bit = 1;
+    writer->max_allocation = READSTAT_DEFAULT_MAX_ALLOCATION;
     writer->callbacks.write_row = &readstat_write_row_default_callback;
 
     return writer;
 }
 
+/* The variable itself and its name live in the writer's arena. Labels and
+ * formats can be replaced, so they're on the heap, like missing values. */
 static void readstat_variable_free(readstat_variable_t *variable) {
-    free(variable);
+    if (variable->label[0])
+        free((char *)variable->label);
+    if (variable->format[0])
+        free((char *)variable->format);
+    free(variable->missingness);
+}
+
+/* `value' may be, or point into, `old_value', so it's copied before the old
+ * value is freed */
+static const char *readstat_variable_copy_string(const char *old_value, const char *value, size_t max_len) {
+    char *copy = NULL;
+    size_t len = 0;
+
+    if (value == old_value)
+        return old_value;
+
+    if (value && (len = strlen(value)) > 0) {
+        if (len > max_len)
+            len = max_len;
+        if ((copy = malloc(len + 1)) != NULL) {
+            memcpy(copy, value, len);
+            copy[len] = '\0';
+        }
+    }
+
+    if (old_value[0])
+        free((char *)old_value);
+
+    return copy ? copy : "";
 }
 
+/* Label sets, their labels and string keys live in the writer's arena;
+ * only the arrays that grow are on the heap. */
 static void readstat_label_set_free(readstat_label_set_t *label_set) {
-    int i;
-    for (i=0; i<label_set->value_labels_count; i++) {
-        readstat_value_label_t *value_label = readstat_get_value_label(label_set, i);
-        if (value_label->label)
-            free(value_label->label);
-        if (value_label->string_key)
-            free(value_label->string_key);
-    }
     free(label_set->value_labels);
     free(label_set->variables);
-    free(label_set);
 }
 
-static void readstat_copy_label(readstat_value_label_t *value_label, const char *label) {
+static void readstat_copy_label(readstat_label_set_t *label_set,
+        readstat_value_label_t *value_label, const char *label) {
     if (label && strlen(label)) {
         value_label->label_len = strlen(label);
-        value_label->label = malloc(value_label->label_len);
-        memcpy(value_label->label, label, value_label->label_len);
+        value_label->label = (char *)readstat_arena_intern(label_set->arena, label, value_label->label_len);
+        if (value_label->label == NULL)
+            value_label->label_len = 0;
     }
 }
 
@@ -91,7 +125,7 @@ static readstat_value_label_t *readstat_add_value_label(readstat_label_set_t *la
     }
     readstat_value_label_t *new_value_label = &label_set->value_labels[label_set->value_labels_count++];
     memset(new_value_label, 0, sizeof(readstat_value_label_t));
-    readstat_copy_label(new_value_label, label);
+    readstat_copy_label(label_set, new_value_label, label);
     return new_value_label;
 }
 
@@ -117,10 +151,14 @@ readstat_error_t readstat_validate_metadata(readstat_writer_t *writer) {
 
 static readstat_error_t readstat_begin_writing_data(readstat_writer_t *writer) {
     readstat_error_t retval = READSTAT_OK;
+    readstat_malloc_scope_t scope;
 
     size_t row_len = 0;
     int i;
 
+    /* The row and any compression buffers are sized here */
+    readstat_malloc_scope_begin(&scope, writer->max_allocation, 0);
+
     retval = readstat_validate_metadata(writer);
     if (retval != READSTAT_OK)
         goto cleanup;
@@ -139,13 +177,16 @@ static readstat_error_t readstat_begin_writing_data(readstat_writer_t *writer) {
         }
     }
     writer->row_len = row_len;
-    writer->row = malloc(writer->row_len);
+    if (row_len && (writer->row = readstat_malloc(writer->row_len)) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
     if (writer->callbacks.begin_data) {
         retval = writer->callbacks.begin_data(writer);
     }
 
 cleanup:
-    return retval;
+    return readstat_malloc_scope_end(&scope, retval);
 }
 
 void readstat_writer_free(readstat_writer_t *writer) {
@@ -166,6 +207,7 @@ void readstat_writer_free(readstat_writer_t *writer) {
             }
             free(writer->label_sets);
         }
+        readstat_arena_free(writer->arena);
         if (writer->notes) {
             for (i=0; i<writer->notes_count; i++) {
                 free(writer->notes[i]);
@@ -179,7 +221,7 @@ void readstat_writer_free(readstat_writer_t *writer) {
             free(writer->string_refs);
         }
         if (writer->row) {
-            free(writer->row);
+            readstat_free(writer->row);
         }
         free(writer);
     }
@@ -292,10 +334,13 @@ readstat_label_set_t *readstat_add_label_set(readstat_writer_t *writer, readstat
         writer->label_sets = realloc(writer->label_sets, 
                 writer->label_sets_capacity * sizeof(readstat_label_set_t *));
     }
-    readstat_label_set_t *new_label_set = calloc(1, sizeof(readstat_label_set_t));
+    readstat_label_set_t *new_label_set = readstat_arena_calloc(writer->arena, 1, sizeof(readstat_label_set_t));
+    if (new_label_set == NULL)
+        return NULL;
     
     writer->label_sets[writer->label_sets_count++] = new_label_set;
 
+    new_label_set->arena = writer->arena;
     new_label_set->type = type;
     snprintf(new_label_set->name, sizeof(new_label_set->name), "%s", name);
 
@@ -351,8 +396,10 @@ void readstat_label_string_value(readstat_label_set_t *label_set, const char *va
     readstat_value_label_t *new_value_label = readstat_add_value_label(label_set, label);
     if (value && strlen(value)) {
         new_value_label->string_key_len = strlen(value);
-        new_value_label->string_key = malloc(new_value_label->string_key_len);
-        memcpy(new_value_label->string_key, value, new_value_label->string_key_len);
+        new_value_label->string_key = (char *)readstat_arena_intern(label_set->arena,
+                value, new_value_label->string_key_len);
+        if (new_value_label->string_key == NULL)
+            new_value_label->string_key_len = 0;
     }
 }
 
@@ -367,7 +414,17 @@ readstat_variable_t *readstat_add_variable(readstat_writer_t *writer, const char
         writer->variables = realloc(writer->variables,
                 writer->variables_capacity * sizeof(readstat_variable_t *));
     }
-    readstat_variable_t *new_variable = calloc(1, sizeof(readstat_variable_t));
+    readstat_variable_t *new_variable = readstat_arena_variable(writer->arena);
+    if (new_variable == NULL)
+        return NULL;
+
+    if (name) {
+        size_t name_len = strlen(name);
+        if (name_len > VARIABLE_NAME_MAX_LEN)
+            name_len = VARIABLE_NAME_MAX_LEN;
+        if ((new_variable->name = readstat_arena_intern(writer->arena, name, name_len)) == NULL)
+            return NULL;
+    }
 
     new_variable->index = writer->variables_count++;
     
@@ -383,10 +440,6 @@ readstat_variable_t *readstat_add_variable(readstat_writer_t *writer, const char
     }
     new_variable->measure = READSTAT_MEASURE_UNKNOWN;
 
-    if (name) {
-        snprintf(new_variable->name, sizeof(new_variable->name), "%s", name);
-    }
-
     return new_variable;
 }
 
@@ -417,19 +470,11 @@ void readstat_add_note(readstat_writer_t *writer, const char *note) {
 }
 
 void readstat_variable_set_label(readstat_variable_t *variable, const char *label) {
-    if (label) {
-        snprintf(variable->label, sizeof(variable->label), "%s", label);
-    } else {
-        memset(variable->label, '\0', sizeof(variable->label));
-    }
+    variable->label = readstat_variable_copy_string(variable->label, label, VARIABLE_LABEL_MAX_LEN);
 }
 
 void readstat_variable_set_format(readstat_variable_t *variable, const char *format) {
-    if (format) {
-        snprintf(variable->format, sizeof(variable->format), "%s", format);
-    } else {
-        memset(variable->format, '\0', sizeof(variable->format));
-    }
+    variable->format = readstat_variable_copy_string(variable->format, format, VARIABLE_FORMAT_MAX_LEN);
 }
 
 void readstat_variable_set_measure(readstat_variable_t *variable, readstat_measure_t measure) {
@@ -515,6 +560,11 @@ readstat_error_t readstat_writer_set_error_handler(readstat_writer_t *writer,
     return READSTAT_OK;
 }
 
+readstat_error_t readstat_writer_set_max_allocation(readstat_writer_t *writer, size_t max_len) {
+    writer->max_allocation = max_len;
+    return READSTAT_OK;
+}
+
 readstat_error_t readstat_begin_writing_file(readstat_writer_t *writer, void *user_ctx, long row_count) {
     writer->row_count = row_count;
     writer->user_ctx = user_ctx;
@@ -532,7 +582,8 @@ readstat_error_t readstat_begin_row(readstat_writer_t *writer) {
     if (writer->current_row == 0)
         retval = readstat_begin_writing_data(writer);
 
-    memset(writer->row, '\0', writer->row_len);
+    if (retval == READSTAT_OK)
+        memset(writer->row, '\0', writer->row_len);
     return retval;
 }
 
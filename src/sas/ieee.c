@@ -96,6 +96,57 @@ int cnxptiee(const void *from_bytes, int fromtype, void *to_bytes, int totype)
     return(0);
 }
 
+static inline uint64_t xpt2ieee_bits(uint64_t xport) {
+    /* Number of places to shift the IBM fraction down so that its leading
+     * 1 bit becomes the implicit IEEE bit, indexed by the top 3 bits of the
+     * fraction. See xpt2ieee() for the long-form explanation. */
+    static const uint64_t shifts[8] = { 0, 1, 2, 2, 3, 3, 3, 3 };
+
+    uint64_t sign = xport & UINT64_C(0x8000000000000000);
+    uint64_t fraction = xport & UINT64_C(0x00FFFFFFFFFFFFFF);
+    uint64_t shift = shifts[fraction >> 53];
+    uint64_t exponent = ((xport >> 56) & 0x7F) * 4 + shift + 1023 - 65 * 4;
+
+    if (fraction == 0) {
+        if (xport == 0)
+            return 0;
+        /* Missing value: first byte is the tag, the rest is zero */
+        return UINT64_C(0xFFFF000000000000) | ((~xport >> 16) & UINT64_C(0x0000FF0000000000));
+    }
+    if ((xport & UINT64_C(0x7FFFFFFFFFFFFFFF)) == UINT64_C(0x7FFFFFFFFFFFFFFF))
+        return sign | UINT64_C(0x7FF0000000000000);
+
+    return sign | (exponent << 52) |
+        ((fraction >> shift) & UINT64_C(0x000FFFFFFFFFFFFF));
+}
+
+int cnxptiee_batch(const void *from_bytes, size_t stride, double *to, size_t count) {
+    const unsigned char *from = (const unsigned char *)from_bytes;
+    /* Checked once per batch rather than cached, as workers convert
+     * batches concurrently */
+    int native = FLOATREP;
+    size_t i;
+
+    if (native != CN_TYPE_IEEEB && native != CN_TYPE_IEEEL) {
+        for (i=0; i<count; i++) {
+            if (cnxptiee(&from[i*stride], CN_TYPE_XPORT, &to[i], CN_TYPE_NATIVE) != 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    for (i=0; i<count; i++) {
+        const unsigned char *p = &from[i*stride];
+        uint64_t xport = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+            ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+            ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+            ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+        uint64_t ieee = xpt2ieee_bits(xport);
+        memcpy(&to[i], &ieee, sizeof(double));
+    }
+    return 0;
+}
+
 int get_native() {
     static unsigned char float_reps[][8] = {
         {0x41,0x10,0x00,0x00,0x00,0x00,0x00,0x00},
@@ -1,6 +1,13 @@
+#include <stddef.h>
+
 #define CN_TYPE_NATIVE 0
 #define CN_TYPE_XPORT 1
 #define CN_TYPE_IEEEB 2
 #define CN_TYPE_IEEEL 3
 
 int cnxptiee(const void *from_bytes, int fromtype, void *to_bytes, int totype);
+
+/* Convert `count' 8-byte XPORT (IBM) values, spaced `stride' bytes apart,
+ * into native doubles. Bit-for-bit equivalent to calling
+ * cnxptiee(from, CN_TYPE_XPORT, to, CN_TYPE_NATIVE) on each value. */
+int cnxptiee_batch(const void *from_bytes, size_t stride, double *to, size_t count);
@@ -7,6 +7,8 @@
 #include "../readstat_iconv.h"
 #include "../readstat_convert.h"
 #include "../readstat_malloc.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 
 #define SAS_CATALOG_FIRST_INDEX_PAGE 1
 #define SAS_CATALOG_USELESS_PAGES    3
@@ -15,6 +17,7 @@ typedef struct sas7bcat_ctx_s {
     readstat_metadata_handler      metadata_handler;
     readstat_value_label_handler   value_label_handler;
     void          *user_ctx;
+    readstat_parser_stats_t *stats;
     readstat_io_t *io;
     int            u64;
     int            pad1;
@@ -37,7 +40,7 @@ static void sas7bcat_ctx_free(sas7bcat_ctx_t *ctx) {
     if (ctx->converter)
         iconv_close(ctx->converter);
     if (ctx->block_pointers)
-        free(ctx->block_pointers);
+        readstat_free(ctx->block_pointers);
 
     free(ctx);
 }
@@ -134,7 +137,7 @@ static readstat_error_t sas7bcat_parse_value_labels(const char *value_start, siz
 
 cleanup:
     if (value_offset)
-        free(value_offset);
+        readstat_free(value_offset);
 
     return retval;
 }
@@ -358,7 +361,7 @@ cleanup:
     return retval;
 }
 
-readstat_error_t readstat_parse_sas7bcat(readstat_parser_t *parser, const char *path, void *user_ctx) {
+static readstat_error_t sas7bcat_parse(readstat_parser_t *parser, const char *path, void *user_ctx) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = parser->io;
     int64_t i;
@@ -368,13 +371,14 @@ readstat_error_t readstat_parse_sas7bcat(readstat_parser_t *parser, const char *
     sas7bcat_ctx_t *ctx = calloc(1, sizeof(sas7bcat_ctx_t));
     sas_header_info_t *hinfo = calloc(1, sizeof(sas_header_info_t));
 
-    ctx->block_pointers = malloc((ctx->block_pointers_capacity = 200) * sizeof(uint64_t));
+    ctx->block_pointers = readstat_malloc((ctx->block_pointers_capacity = 200) * sizeof(uint64_t));
 
     ctx->value_label_handler = parser->handlers.value_label;
     ctx->metadata_handler = parser->handlers.metadata;
     ctx->input_encoding = parser->input_encoding;
     ctx->output_encoding = parser->output_encoding;
     ctx->user_ctx = user_ctx;
+    ctx->stats = &parser->stats;
     ctx->io = io;
 
     if (io->open(path, io->io_ctx) == -1) {
@@ -464,6 +468,7 @@ readstat_error_t readstat_parse_sas7bcat(readstat_parser_t *parser, const char *
             retval = READSTAT_ERROR_READ;
             goto cleanup;
         }
+        ctx->stats->pages_processed++;
         if (memcmp(&page[16], "XLSR", sizeof("XLSR")-1) == 0) {
             retval = sas7bcat_augment_index(&page[16], ctx->page_size - 16, ctx);
             if (retval != READSTAT_OK)
@@ -498,9 +503,9 @@ readstat_error_t readstat_parse_sas7bcat(readstat_parser_t *parser, const char *
 cleanup:
     io->close(io->io_ctx);
     if (page)
-        free(page);
+        readstat_free(page);
     if (buffer)
-        free(buffer);
+        readstat_free(buffer);
     if (ctx)
         sas7bcat_ctx_free(ctx);
     if (hinfo)
@@ -508,3 +513,8 @@ cleanup:
 
     return retval;
 }
+
+readstat_error_t readstat_parse_sas7bcat(readstat_parser_t *parser, const char *path, void *user_ctx) {
+    return readstat_stats_parse(parser, &sas7bcat_parse,
+            READSTAT_LABEL_INDEX_PARSE_CATALOG, path, user_ctx);
+}
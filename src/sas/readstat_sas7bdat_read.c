@@ -7,9 +7,16 @@
 #include <inttypes.h>
 #include "readstat_sas.h"
 #include "readstat_sas_rle.h"
+#include "readstat_sas_rdc.h"
 #include "../readstat_iconv.h"
 #include "../readstat_convert.h"
 #include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_dictionary.h"
+#include "../readstat_prefetch.h"
+#include "../readstat_progress.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 
 #define SAS_COMPRESSION_SIGNATURE_RLE  "SASYZCRL"
 #define SAS_COMPRESSION_SIGNATURE_RDC  "SASYZCR2"
@@ -34,6 +41,8 @@ typedef struct subheader_pointer_s {
 
 typedef struct sas7bdat_ctx_s {
     readstat_callbacks_t handle;
+    readstat_progress_t  progress;
+    readstat_parser_stats_t *stats;
     int64_t              file_size;
 
     int            little_endian;
@@ -50,6 +59,8 @@ typedef struct sas7bdat_ctx_s {
     uint32_t        column_count;
     uint32_t        row_limit;
     uint32_t        row_offset;
+    int             prefetch_depth;
+    int             string_dictionary_limit;
 
     uint64_t        header_size;
     uint64_t        page_count;
@@ -77,10 +88,12 @@ typedef struct sas7bdat_ctx_s {
     col_info_t    *col_info;
 
     readstat_variable_t **variables;
+    readstat_arena_t     *arena;
 
     const char    *input_encoding;
     const char    *output_encoding;
     iconv_t        converter;
+    readstat_string_dictionary_t *dictionary;
 
     time_t         ctime;
     time_t         mtime;
@@ -92,41 +105,39 @@ typedef struct sas7bdat_ctx_s {
 } sas7bdat_ctx_t;
 
 static void sas7bdat_ctx_free(sas7bdat_ctx_t *ctx) {
-    int i;
     if (ctx->text_blobs) {
-        for (i=0; i<ctx->text_blob_count; i++) {
-            free(ctx->text_blobs[i]);
-        }
-        free(ctx->text_blobs);
-        free(ctx->text_blob_lengths);
-    }
-    if (ctx->variables) {
-        for (i=0; i<ctx->column_count; i++) {
-            if (ctx->variables[i])
-                free(ctx->variables[i]);
-        }
-        free(ctx->variables);
+        readstat_free(ctx->text_blobs);
+        readstat_free(ctx->text_blob_lengths);
     }
+    if (ctx->variables)
+        readstat_free(ctx->variables);
+    if (ctx->arena)
+        readstat_arena_free(ctx->arena);
     if (ctx->col_info)
-        free(ctx->col_info);
+        readstat_free(ctx->col_info);
 
     if (ctx->scratch_buffer)
-        free(ctx->scratch_buffer);
+        readstat_free(ctx->scratch_buffer);
 
     if (ctx->page)
-        free(ctx->page);
+        readstat_free(ctx->page);
 
     if (ctx->row)
-        free(ctx->row);
+        readstat_free(ctx->row);
 
     if (ctx->converter)
         iconv_close(ctx->converter);
 
+    if (ctx->dictionary)
+        readstat_string_dictionary_free(ctx->dictionary);
+
     free(ctx);
 }
 
 static readstat_error_t sas7bdat_update_progress(sas7bdat_ctx_t *ctx) {
     readstat_io_t *io = ctx->io;
+    if (!ctx->handle.progress || !readstat_progress_due(&ctx->progress, io))
+        return READSTAT_OK;
     return io->update(ctx->file_size, ctx->handle.progress, ctx->user_ctx, io->io_ctx);
 }
 
@@ -148,7 +159,7 @@ static readstat_error_t sas7bdat_parse_column_text_subheader(const char *subhead
         goto cleanup;
     }
 
-    if ((blob = readstat_malloc(len-signature_len)) == NULL) {
+    if ((blob = readstat_arena_alloc(ctx->arena, len-signature_len)) == NULL) {
         retval = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -385,8 +396,19 @@ static readstat_error_t sas7bdat_handle_data_value(readstat_variable_t *variable
     value.type = col_info->type;
 
     if (col_info->type == READSTAT_TYPE_STRING) {
-        retval = readstat_convert(ctx->scratch_buffer, ctx->scratch_buffer_len,
-                col_data, col_info->width, ctx->converter);
+        const char *string = NULL;
+        size_t len = 0;
+        if (ctx->handle.string_view) {
+            retval = readstat_convert_view(ctx->scratch_buffer, ctx->scratch_buffer_len,
+                    col_data, col_info->width, ctx->converter, &string, &len);
+        } else if (ctx->dictionary) {
+            retval = readstat_string_dictionary_convert(ctx->dictionary, variable, col_data, col_info->width,
+                    ctx->converter, ctx->scratch_buffer, ctx->scratch_buffer_len, &value);
+        } else {
+            retval = readstat_convert(ctx->scratch_buffer, ctx->scratch_buffer_len,
+                    col_data, col_info->width, ctx->converter);
+            value.v.string_value = ctx->scratch_buffer;
+        }
         if (retval != READSTAT_OK) {
             if (ctx->handle.error) {
                 snprintf(ctx->error_buf, sizeof(ctx->error_buf),
@@ -397,7 +419,11 @@ static readstat_error_t sas7bdat_handle_data_value(readstat_variable_t *variable
             goto cleanup;
         }
 
-        value.v.string_value = ctx->scratch_buffer;
+        if (ctx->handle.string_view) {
+            if (ctx->handle.string_view(ctx->parsed_row_count, variable, string, len, ctx->user_ctx) != READSTAT_HANDLER_OK)
+                retval = READSTAT_ERROR_USER_ABORT;
+            goto cleanup;
+        }
     } else if (col_info->type == READSTAT_TYPE_DOUBLE) {
         uint64_t  val = 0;
         double dval = NAN;
@@ -437,6 +463,7 @@ static readstat_error_t sas7bdat_parse_single_row(const char *data, sas7bdat_ctx
         return READSTAT_OK;
     if (ctx->row_offset) {
         ctx->row_offset--;
+        ctx->stats->rows_skipped++;
         return READSTAT_OK;
     }
 
@@ -467,6 +494,7 @@ static readstat_error_t sas7bdat_parse_single_row(const char *data, sas7bdat_ctx
         }
     }
     ctx->parsed_row_count++;
+    ctx->stats->rows_decoded++;
 
 cleanup:
     return retval;
@@ -492,90 +520,31 @@ cleanup:
 }
 
 static readstat_error_t sas7bdat_parse_subheader_rdc(const char *subheader, size_t len, sas7bdat_ctx_t *ctx) {
-    readstat_error_t retval = READSTAT_OK;
-    const unsigned char *input = (const unsigned char *)subheader;
-    char *buffer = malloc(ctx->row_length);
-    char *output = buffer;
-    while (input + 2 <= (const unsigned char *)subheader + len) {
-        int i;
-        unsigned short prefix = (input[0] << 8) + input[1];
-        input += 2;
-        for (i=0; i<16; i++) {
-            if ((prefix & (1 << (15 - i))) == 0) {
-                if (input + 1 > (const unsigned char *)subheader + len) {
-                    break;
-                }
-                if (output + 1 > buffer + ctx->row_length) {
-                    retval = READSTAT_ERROR_ROW_WIDTH_MISMATCH;
-                    goto cleanup;
-                }
-                *output++ = *input++;
-                continue;
-            }
+    if (ctx->row_limit == ctx->parsed_row_count)
+        return READSTAT_OK;
 
-            if (input + 2 > (const unsigned char *)subheader + len) {
-                retval = READSTAT_ERROR_PARSE;
-                goto cleanup;
-            }
+    readstat_error_t retval = READSTAT_OK;
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
+    ssize_t bytes_decompressed = 0;
 
-            unsigned char marker_byte = *input++;
-            unsigned char next_byte = *input++;
-            size_t insert_len = 0, copy_len = 0;
-            unsigned char insert_byte = 0x00;
-            size_t back_offset = 0;
-
-            if (marker_byte <= 0x0F) {
-                insert_len = 3 + marker_byte;
-                insert_byte = next_byte;
-            } else if ((marker_byte >> 4) == 1) {
-                if (input + 1 > (const unsigned char *)subheader + len) {
-                    retval = READSTAT_ERROR_PARSE;
-                    goto cleanup;
-                }
-                insert_len = 19 + (marker_byte & 0x0F) + next_byte * 16;
-                insert_byte = *input++;
-            } else if ((marker_byte >> 4) == 2) {
-                if (input + 1 > (const unsigned char *)subheader + len) {
-                    retval = READSTAT_ERROR_PARSE;
-                    goto cleanup;
-                }
-                copy_len = 16 + (*input++);
-                back_offset = 3 + (marker_byte & 0x0F) + next_byte * 16;
-            } else {
-                copy_len = (marker_byte >> 4);
-                back_offset = 3 + (marker_byte & 0x0F) + next_byte * 16;
-            }
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_DECOMPRESSION, 1);
+    bytes_decompressed = sas_rdc_decompress(ctx->row, ctx->row_length, subheader, len);
+    readstat_stats_timer_stop(&timer);
+    if (bytes_decompressed > 0)
+        ctx->stats->bytes_decompressed += bytes_decompressed;
 
-            if (insert_len) {
-                if (output + insert_len > buffer + ctx->row_length) {
-                    retval = READSTAT_ERROR_ROW_WIDTH_MISMATCH;
-                    goto cleanup;
-                }
-                memset(output, insert_byte, insert_len);
-                output += insert_len;
-            } else if (copy_len) {
-                if (output - buffer < back_offset || copy_len > back_offset) {
-                    retval = READSTAT_ERROR_PARSE;
-                    goto cleanup;
-                }
-                if (output + copy_len > buffer + ctx->row_length) {
-                    retval = READSTAT_ERROR_ROW_WIDTH_MISMATCH;
-                    goto cleanup;
-                }
-                memcpy(output, output - back_offset, copy_len);
-                output += copy_len;
-            }
-        }
+    if (bytes_decompressed == SAS_RDC_ERROR_MALFORMED) {
+        retval = READSTAT_ERROR_PARSE;
+        goto cleanup;
     }
-
-    if (output - buffer != ctx->row_length) {
+    if (bytes_decompressed != ctx->row_length) {
         retval = READSTAT_ERROR_ROW_WIDTH_MISMATCH;
         goto cleanup;
     }
-    retval = sas7bdat_parse_single_row(buffer, ctx);
-cleanup:
-    free(buffer);
+    retval = sas7bdat_parse_single_row(ctx->row, ctx);
 
+cleanup:
     return retval;
 }
 
@@ -584,9 +553,15 @@ static readstat_error_t sas7bdat_parse_subheader_rle(const char *subheader, size
         return READSTAT_OK;
 
     readstat_error_t retval = READSTAT_OK;
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
     ssize_t bytes_decompressed = 0;
 
+    readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_DECOMPRESSION, 1);
     bytes_decompressed = sas_rle_decompress(ctx->row, ctx->row_length, subheader, len);
+    readstat_stats_timer_stop(&timer);
+    if (bytes_decompressed > 0)
+        ctx->stats->bytes_decompressed += bytes_decompressed;
 
     if (bytes_decompressed != ctx->row_length) {
         retval = READSTAT_ERROR_ROW_WIDTH_MISMATCH;
@@ -662,7 +637,15 @@ static readstat_error_t sas7bdat_validate_column(col_info_t *col_info) {
 static readstat_variable_t *sas7bdat_init_variable(sas7bdat_ctx_t *ctx, int i, 
         int index_after_skipping, readstat_error_t *out_retval) {
     readstat_error_t retval = READSTAT_OK;
-    readstat_variable_t *variable = readstat_calloc(1, sizeof(readstat_variable_t));
+    readstat_variable_t *variable = NULL;
+    char name[300] = "";
+    char format[256] = "";
+    char label[1024] = "";
+
+    if ((variable = readstat_arena_variable(ctx->arena)) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
 
     variable->index = i;
     variable->index_after_skipping = index_after_skipping;
@@ -672,22 +655,27 @@ static readstat_variable_t *sas7bdat_init_variable(sas7bdat_ctx_t *ctx, int i,
     if ((retval = sas7bdat_validate_column(&ctx->col_info[i])) != READSTAT_OK) {
         goto cleanup;
     }
-    if ((retval = sas7bdat_copy_text_ref(variable->name, sizeof(variable->name), 
+    if ((retval = sas7bdat_copy_text_ref(name, sizeof(name), 
                     ctx->col_info[i].name_ref, ctx)) != READSTAT_OK) {
         goto cleanup;
     }
-    if ((retval = sas7bdat_copy_text_ref(variable->format, sizeof(variable->format), 
+    if ((retval = sas7bdat_copy_text_ref(format, sizeof(format), 
                     ctx->col_info[i].format_ref, ctx)) != READSTAT_OK) {
         goto cleanup;
     }
-    if ((retval = sas7bdat_copy_text_ref(variable->label, sizeof(variable->label), 
+    if ((retval = sas7bdat_copy_text_ref(label, sizeof(label), 
                     ctx->col_info[i].label_ref, ctx)) != READSTAT_OK) {
         goto cleanup;
     }
+    if ((variable->name = readstat_arena_intern(ctx->arena, name, sizeof(name))) == NULL ||
+            (variable->format = readstat_arena_intern(ctx->arena, format, sizeof(format))) == NULL ||
+            (variable->label = readstat_arena_intern(ctx->arena, label, sizeof(label))) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
 
 cleanup:
     if (retval != READSTAT_OK) {
-        free(variable);
         if (out_retval)
             *out_retval = retval;
 
@@ -695,7 +683,7 @@ cleanup:
             if (ctx->handle.error) {
                 snprintf(ctx->error_buf, sizeof(ctx->error_buf),
                         "ReadStat: Error converting variable #%d info to specified encoding: %s %s (%s)",
-                        i, variable->name, variable->format, variable->label);
+                        i, name, format, label);
                 ctx->handle.error(ctx->error_buf, ctx->user_ctx);
             }
         }
@@ -762,6 +750,13 @@ static readstat_error_t sas7bdat_submit_columns(sas7bdat_ctx_t *ctx, int compres
             index_after_skipping++;
         }
     }
+
+    if (retval == READSTAT_OK && ctx->handle.value && ctx->string_dictionary_limit > 0 &&
+            (ctx->dictionary = readstat_string_dictionary_init(ctx->arena, ctx->column_count,
+                    ctx->string_dictionary_limit, ctx->handle.dictionary_entry, ctx->user_ctx)) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
 cleanup:
     return retval;
 }
@@ -1115,9 +1110,16 @@ cleanup:
 
 static readstat_error_t sas7bdat_parse_all_pages_pass2(sas7bdat_ctx_t *ctx) {
     readstat_error_t retval = READSTAT_OK;
-    readstat_io_t *io = ctx->io;
+    readstat_prefetch_t *prefetch = NULL;
+    readstat_io_t *io = NULL;
     int64_t i;
 
+    if ((retval = readstat_prefetch_init(&prefetch, &ctx->io, ctx->prefetch_depth,
+                    READSTAT_PREFETCH_BLOCK_SIZE)) != READSTAT_OK)
+        goto cleanup;
+
+    io = ctx->io;
+
     for (i=0; i<ctx->page_count; i++) {
         if ((retval = sas7bdat_update_progress(ctx)) != READSTAT_OK) {
             goto cleanup;
@@ -1126,6 +1128,7 @@ static readstat_error_t sas7bdat_parse_all_pages_pass2(sas7bdat_ctx_t *ctx) {
             retval = READSTAT_ERROR_READ;
             goto cleanup;
         }
+        ctx->stats->pages_processed++;
 
         if ((retval = sas7bdat_parse_page_pass2(ctx->page, ctx->page_size, ctx)) != READSTAT_OK) {
             if (ctx->handle.error && retval != READSTAT_ERROR_USER_ABORT) {
@@ -1141,11 +1144,16 @@ static readstat_error_t sas7bdat_parse_all_pages_pass2(sas7bdat_ctx_t *ctx) {
             break;
     }
 cleanup:
+    if (prefetch) {
+        readstat_error_t prefetch_retval = readstat_prefetch_free(prefetch, &ctx->io);
+        if (retval == READSTAT_OK)
+            retval = prefetch_retval;
+    }
 
     return retval;
 }
 
-readstat_error_t readstat_parse_sas7bdat(readstat_parser_t *parser, const char *path, void *user_ctx) {
+static readstat_error_t sas7bdat_parse(readstat_parser_t *parser, const char *path, void *user_ctx) {
     int64_t last_examined_page_pass1 = 0;
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = parser->io;
@@ -1154,6 +1162,8 @@ readstat_error_t readstat_parse_sas7bdat(readstat_parser_t *parser, const char *
     sas_header_info_t  *hinfo = calloc(1, sizeof(sas_header_info_t));
 
     ctx->handle = parser->handlers;
+    ctx->stats = &parser->stats;
+    readstat_progress_init(&ctx->progress, parser);
     ctx->input_encoding = parser->input_encoding;
     ctx->output_encoding = parser->output_encoding;
     ctx->user_ctx = user_ctx;
@@ -1161,6 +1171,8 @@ readstat_error_t readstat_parse_sas7bdat(readstat_parser_t *parser, const char *
     ctx->row_limit = parser->row_limit;
     if (parser->row_offset > 0)
         ctx->row_offset = parser->row_offset;
+    ctx->prefetch_depth = parser->prefetch_depth;
+    ctx->string_dictionary_limit = parser->string_dictionary_limit;
 
     if (io->open(path, io->io_ctx) == -1) {
         retval = READSTAT_ERROR_OPEN;
@@ -1209,6 +1221,10 @@ readstat_error_t readstat_parse_sas7bdat(readstat_parser_t *parser, const char *
         retval = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
+    if ((ctx->arena = readstat_arena_init()) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
 
     if (ctx->input_encoding && ctx->output_encoding && strcmp(ctx->input_encoding, ctx->output_encoding) != 0) {
         iconv_t converter = iconv_open(ctx->output_encoding, ctx->input_encoding);
@@ -1260,6 +1276,7 @@ readstat_error_t readstat_parse_sas7bdat(readstat_parser_t *parser, const char *
         goto cleanup;
     }
 
+    readstat_progress_reset(&ctx->progress);
     if ((retval = sas7bdat_update_progress(ctx)) != READSTAT_OK) {
         goto cleanup;
     }
@@ -1284,3 +1301,8 @@ cleanup:
 
     return retval;
 }
+
+readstat_error_t readstat_parse_sas7bdat(readstat_parser_t *parser, const char *path, void *user_ctx) {
+    return readstat_stats_parse(parser, &sas7bdat_parse,
+            READSTAT_LABEL_INDEX_PARSE_DATA, path, user_ctx);
+}
@@ -0,0 +1,84 @@
+#include <sys/types.h>
+#include <string.h>
+
+#include "readstat_sas_rdc.h"
+
+/* Ross Data Compression: each 16-bit big-endian prefix describes the next
+ * 16 items, a clear bit being a literal byte and a set bit being a
+ * run-length insert or a back-reference into the output. Returns the
+ * number of bytes written, SAS_RDC_ERROR_OVERFLOW if the output would not
+ * fit in the buffer, or SAS_RDC_ERROR_MALFORMED if the input is bad. */
+ssize_t sas_rdc_decompress(void *output_buf, size_t output_len,
+        const void *input_buf, size_t input_len) {
+    unsigned char *buffer = (unsigned char *)output_buf;
+    unsigned char *output = buffer;
+    const unsigned char *input = (const unsigned char *)input_buf;
+    const unsigned char *input_end = input + input_len;
+
+    while (input + 2 <= input_end) {
+        int i;
+        unsigned short prefix = (input[0] << 8) + input[1];
+        input += 2;
+        for (i=0; i<16; i++) {
+            if ((prefix & (1 << (15 - i))) == 0) {
+                if (input + 1 > input_end) {
+                    break;
+                }
+                if (output + 1 > buffer + output_len) {
+                    return SAS_RDC_ERROR_OVERFLOW;
+                }
+                *output++ = *input++;
+                continue;
+            }
+
+            if (input + 2 > input_end) {
+                return SAS_RDC_ERROR_MALFORMED;
+            }
+
+            unsigned char marker_byte = *input++;
+            unsigned char next_byte = *input++;
+            size_t insert_len = 0, copy_len = 0;
+            unsigned char insert_byte = 0x00;
+            size_t back_offset = 0;
+
+            if (marker_byte <= 0x0F) {
+                insert_len = 3 + marker_byte;
+                insert_byte = next_byte;
+            } else if ((marker_byte >> 4) == 1) {
+                if (input + 1 > input_end) {
+                    return SAS_RDC_ERROR_MALFORMED;
+                }
+                insert_len = 19 + (marker_byte & 0x0F) + next_byte * 16;
+                insert_byte = *input++;
+            } else if ((marker_byte >> 4) == 2) {
+                if (input + 1 > input_end) {
+                    return SAS_RDC_ERROR_MALFORMED;
+                }
+                copy_len = 16 + (*input++);
+                back_offset = 3 + (marker_byte & 0x0F) + next_byte * 16;
+            } else {
+                copy_len = (marker_byte >> 4);
+                back_offset = 3 + (marker_byte & 0x0F) + next_byte * 16;
+            }
+
+            if (insert_len) {
+                if (output + insert_len > buffer + output_len) {
+                    return SAS_RDC_ERROR_OVERFLOW;
+                }
+                memset(output, insert_byte, insert_len);
+                output += insert_len;
+            } else if (copy_len) {
+                if (output - buffer < back_offset || copy_len > back_offset) {
+                    return SAS_RDC_ERROR_MALFORMED;
+                }
+                if (output + copy_len > buffer + output_len) {
+                    return SAS_RDC_ERROR_OVERFLOW;
+                }
+                memcpy(output, output - back_offset, copy_len);
+                output += copy_len;
+            }
+        }
+    }
+
+    return output - buffer;
+}
@@ -0,0 +1,6 @@
+
+#define SAS_RDC_ERROR_MALFORMED     -1
+#define SAS_RDC_ERROR_OVERFLOW      -2
+
+ssize_t sas_rdc_decompress(void *output_buf, size_t output_len,
+        const void *input_buf, size_t input_len);
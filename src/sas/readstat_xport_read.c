@@ -4,11 +4,17 @@
 #include <sys/types.h>
 #include <stdint.h>
 #include <time.h>
+#include <limits.h>
 
 #include "../readstat.h"
 #include "../readstat_iconv.h"
 #include "../readstat_convert.h"
 #include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_parallel.h"
+#include "../readstat_progress.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 #include "readstat_sas.h"
 #include "readstat_xport.h"
 #include "ieee.h"
@@ -17,6 +23,8 @@
 
 typedef struct xport_ctx_s {
     readstat_callbacks_t handle;
+    readstat_progress_t  progress;
+    readstat_parser_stats_t *stats;
     size_t         file_size;
     void          *user_ctx;
     const char    *input_encoding;
@@ -36,12 +44,21 @@ typedef struct xport_ctx_s {
     char           table_name[32*4+1];
 
     readstat_variable_t **variables;
+    readstat_arena_t     *arena;
+
+    unsigned char *xport_values;
+    double        *double_values;
+    char          *strings;
+    size_t         strings_len;
 
     int            version;
+    int            thread_count;
 } xport_ctx_t;
 
 static readstat_error_t xport_update_progress(xport_ctx_t *ctx) {
     readstat_io_t *io = ctx->io;
+    if (!ctx->handle.progress || !readstat_progress_due(&ctx->progress, io))
+        return READSTAT_OK;
     return io->update(ctx->file_size, ctx->handle.progress, ctx->user_ctx, io->io_ctx);
 }
 
@@ -51,14 +68,16 @@ static xport_ctx_t *xport_ctx_init() {
 }
 
 static void xport_ctx_free(xport_ctx_t *ctx) {
-    if (ctx->variables) {
-        int i;
-        for (i=0; i<ctx->var_count; i++) {
-            if (ctx->variables[i])
-                free(ctx->variables[i]);
-        }
-        free(ctx->variables);
-    }
+    if (ctx->variables)
+        readstat_free(ctx->variables);
+    if (ctx->arena)
+        readstat_arena_free(ctx->arena);
+    if (ctx->xport_values)
+        readstat_free(ctx->xport_values);
+    if (ctx->double_values)
+        readstat_free(ctx->double_values);
+    if (ctx->strings)
+        readstat_free(ctx->strings);
     if (ctx->converter) {
         iconv_close(ctx->converter);
     }
@@ -66,9 +85,20 @@ static void xport_ctx_free(xport_ctx_t *ctx) {
     free(ctx);
 }
 
+/* Reads until dst is full or the file ends, so that a short read means the
+ * end of the file and not just a read handler that returns less at a time */
 static ssize_t read_bytes(xport_ctx_t *ctx, void *dst, size_t dst_len) {
     readstat_io_t *io = (readstat_io_t *)ctx->io;
-    return io->read(dst, dst_len, io->io_ctx);
+    size_t done = 0;
+    while (done < dst_len) {
+        ssize_t bytes_read = io->read((char *)dst + done, dst_len - done, io->io_ctx);
+        if (bytes_read == -1)
+            return -1;
+        if (bytes_read == 0)
+            break;
+        done += bytes_read;
+    }
+    return done;
 }
 
 static readstat_error_t xport_skip_record(xport_ctx_t *ctx) {
@@ -278,6 +308,19 @@ static readstat_error_t xport_read_obs_header_record(xport_ctx_t *ctx) {
     return xport_expect_header_record(ctx, "OBS", "OBSV8");
 }
 
+/* Converts into `buf' and keeps an interned copy of the result */
+static readstat_error_t xport_convert_interned(xport_ctx_t *ctx, const char **dst,
+        char *buf, size_t buf_len, const char *src, size_t src_len) {
+    readstat_error_t retval = readstat_convert(buf, buf_len, src, src_len, ctx->converter);
+    if (retval != READSTAT_OK)
+        return retval;
+
+    if ((*dst = readstat_arena_intern(ctx->arena, buf, buf_len)) == NULL)
+        return READSTAT_ERROR_MALLOC;
+
+    return READSTAT_OK;
+}
+
 static readstat_error_t xport_construct_format(char *dst, size_t dst_len,
         const char *src, size_t src_len, int width, int decimals) {
     char format[4*src_len+1];
@@ -328,6 +371,8 @@ static readstat_error_t xport_read_labels_v8(xport_ctx_t *ctx, int label_count)
 
         char name[name_len+1];
         char label[label_len+1];
+        char name_buf[300];
+        char label_buf[1024];
         readstat_variable_t *variable = ctx->variables[index-1];
 
         if (read_bytes(ctx, name, name_len) != name_len ||
@@ -336,13 +381,13 @@ static readstat_error_t xport_read_labels_v8(xport_ctx_t *ctx, int label_count)
             goto cleanup;
         }
 
-        retval = readstat_convert(variable->name, sizeof(variable->name),
-                name, name_len, ctx->converter);
+        retval = xport_convert_interned(ctx, &variable->name, name_buf, sizeof(name_buf),
+                name, name_len);
         if (retval != READSTAT_OK)
             goto cleanup;
 
-        retval = readstat_convert(variable->label, sizeof(variable->label),
-                label, label_len, ctx->converter);
+        retval = xport_convert_interned(ctx, &variable->label, label_buf, sizeof(label_buf),
+                label, label_len);
         if (retval != READSTAT_OK)
             goto cleanup;
     }
@@ -393,6 +438,9 @@ static readstat_error_t xport_read_labels_v9(xport_ctx_t *ctx, int label_count)
         char format[format_len+1];
         char informat[informat_len+1];
         char label[label_len+1];
+        char name_buf[300];
+        char format_buf[256];
+        char label_buf[1024];
 
         readstat_variable_t *variable = ctx->variables[index-1];
 
@@ -404,20 +452,25 @@ static readstat_error_t xport_read_labels_v9(xport_ctx_t *ctx, int label_count)
             goto cleanup;
         }
 
-        retval = readstat_convert(variable->name, sizeof(variable->name),
-                name, name_len, ctx->converter);
+        retval = xport_convert_interned(ctx, &variable->name, name_buf, sizeof(name_buf),
+                name, name_len);
         if (retval != READSTAT_OK)
             goto cleanup;
 
-        retval = readstat_convert(variable->label, sizeof(variable->label),
-                label, label_len, ctx->converter);
+        retval = xport_convert_interned(ctx, &variable->label, label_buf, sizeof(label_buf),
+                label, label_len);
         if (retval != READSTAT_OK)
             goto cleanup;
 
-        retval = xport_construct_format(variable->format, sizeof(variable->format),
+        retval = xport_construct_format(format_buf, sizeof(format_buf),
                 format, format_len, variable->display_width, variable->decimals);
         if (retval != READSTAT_OK)
             goto cleanup;
+
+        if ((variable->format = readstat_arena_intern(ctx->arena, format_buf, sizeof(format_buf))) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
     }
 
     retval = xport_skip_rest_of_record(ctx);
@@ -444,7 +497,15 @@ static readstat_error_t xport_read_variables(xport_ctx_t *ctx) {
         }
         xport_namestr_bswap(&namestr);
 
-        readstat_variable_t *variable = calloc(1, sizeof(readstat_variable_t));
+        char name_buf[300];
+        char format_buf[256];
+        char label_buf[1024];
+        readstat_variable_t *variable = NULL;
+
+        if ((variable = readstat_arena_variable(ctx->arena)) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
 
         variable->index = i;
         variable->type = namestr.ntype == SAS_COLUMN_TYPE_CHR ? READSTAT_TYPE_STRING : READSTAT_TYPE_DOUBLE;
@@ -454,26 +515,31 @@ static readstat_error_t xport_read_variables(xport_ctx_t *ctx) {
         variable->alignment = namestr.nfj ? READSTAT_ALIGNMENT_RIGHT : READSTAT_ALIGNMENT_LEFT;
 
         if (ctx->version == 5) {
-            retval = readstat_convert(variable->name, sizeof(variable->name),
-                    namestr.nname, sizeof(namestr.nname), ctx->converter);
+            retval = xport_convert_interned(ctx, &variable->name, name_buf, sizeof(name_buf),
+                    namestr.nname, sizeof(namestr.nname));
         } else {
-            retval = readstat_convert(variable->name, sizeof(variable->name),
-                    namestr.longname, sizeof(namestr.longname), ctx->converter);
+            retval = xport_convert_interned(ctx, &variable->name, name_buf, sizeof(name_buf),
+                    namestr.longname, sizeof(namestr.longname));
         }
         if (retval != READSTAT_OK)
             goto cleanup;
 
-        retval = readstat_convert(variable->label, sizeof(variable->label),
-                namestr.nlabel, sizeof(namestr.nlabel), ctx->converter);
+        retval = xport_convert_interned(ctx, &variable->label, label_buf, sizeof(label_buf),
+                namestr.nlabel, sizeof(namestr.nlabel));
         if (retval != READSTAT_OK)
             goto cleanup;
 
-        retval = xport_construct_format(variable->format, sizeof(variable->format),
+        retval = xport_construct_format(format_buf, sizeof(format_buf),
                 namestr.nform, sizeof(namestr.nform),
                 variable->display_width, variable->decimals);
         if (retval != READSTAT_OK)
             goto cleanup;
 
+        if ((variable->format = readstat_arena_intern(ctx->arena, format_buf, sizeof(format_buf))) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
+
         ctx->variables[i] = variable;
     }
 
@@ -531,27 +597,68 @@ cleanup:
     return retval;
 }
 
-static readstat_error_t xport_process_row(xport_ctx_t *ctx, const char *row, size_t row_length) {
+/* Where xport_decode_row puts its output. With `values' unset, each value
+ * goes straight to the value handler; otherwise values are stored in `values'.
+ * Either way, string variable i is converted into its own slot of `strings'. */
+typedef struct xport_row_decoder_s {
+    iconv_t             converter;
+    unsigned char      *xport_values;
+    double             *double_values;
+    char               *strings;
+
+    readstat_value_t   *values;
+    int                 value_count;
+} xport_row_decoder_t;
+
+static readstat_error_t xport_convert_doubles(xport_ctx_t *ctx, const char *row,
+        xport_row_decoder_t *decoder) {
+    int i;
+    off_t pos = 0;
+    size_t count = 0;
+    for (i=0; i<ctx->var_count; i++) {
+        readstat_variable_t *variable = ctx->variables[i];
+        if (variable->type != READSTAT_TYPE_STRING &&
+                variable->storage_width <= XPORT_MAX_DOUBLE_SIZE &&
+                variable->storage_width >= XPORT_MIN_DOUBLE_SIZE) {
+            unsigned char *full_value = &decoder->xport_values[8*count++];
+            memcpy(full_value, &row[pos], variable->storage_width);
+            memset(&full_value[variable->storage_width], 0, 8 - variable->storage_width);
+        }
+        pos += variable->storage_width;
+    }
+    if (cnxptiee_batch(decoder->xport_values, 8, decoder->double_values, count) != 0)
+        return READSTAT_ERROR_CONVERT;
+
+    return READSTAT_OK;
+}
+
+static readstat_error_t xport_decode_row(xport_ctx_t *ctx, const char *row,
+        xport_row_decoder_t *decoder) {
     readstat_error_t retval = READSTAT_OK;
     int i;
     off_t pos = 0;
-    char *string = NULL;
+    size_t double_index = 0;
+    size_t string_offset = 0;
+
+    decoder->value_count = 0;
+
+    retval = xport_convert_doubles(ctx, row, decoder);
+    if (retval != READSTAT_OK)
+        goto cleanup;
+
     for (i=0; i<ctx->var_count; i++) {
         readstat_variable_t *variable = ctx->variables[i];
         readstat_value_t value = { .type = variable->type };
 
         if (variable->type == READSTAT_TYPE_STRING) {
-            string = readstat_realloc(string, 4*variable->storage_width+1);
-            if (string == NULL) {
-                retval = READSTAT_ERROR_MALLOC;
-                goto cleanup;
-            }
+            char *string = &decoder->strings[string_offset];
             retval = readstat_convert(string, 4*variable->storage_width+1,
-                    &row[pos], variable->storage_width, ctx->converter);
+                    &row[pos], variable->storage_width, decoder->converter);
             if (retval != READSTAT_OK)
                 goto cleanup;
 
             value.v.string_value = string;
+            string_offset += 4*variable->storage_width+1;
         } else {
             double dval = NAN;
             if (variable->storage_width <= XPORT_MAX_DOUBLE_SIZE &&
@@ -566,34 +673,214 @@ static readstat_error_t xport_process_row(xport_ctx_t *ctx, const char *row, siz
                         value.is_tagged_missing = 1;
                     }
                 } else {
-                    memcpy(full_value, &row[pos], variable->storage_width);
-                    int rc = cnxptiee(full_value, CN_TYPE_XPORT, &dval, CN_TYPE_NATIVE);
-                    if (rc != 0) {
-                        retval = READSTAT_ERROR_CONVERT;
-                        goto cleanup;
-                    }
+                    dval = decoder->double_values[double_index];
                 }
+                double_index++;
             }
 
             value.v.double_value = dval;
         }
         pos += variable->storage_width;
 
-        if (ctx->handle.value && !ctx->variables[i]->skip && !ctx->row_offset) {
+        if (decoder->values) {
+            decoder->values[i] = value;
+        } else if (ctx->handle.value && !ctx->variables[i]->skip && !ctx->row_offset) {
             if (ctx->handle.value(ctx->parsed_row_count, variable, value, ctx->user_ctx) != READSTAT_HANDLER_OK) {
                 retval = READSTAT_ERROR_USER_ABORT;
                 goto cleanup;
             }
         }
+        decoder->value_count = i + 1;
     }
+
+cleanup:
+    return retval;
+}
+
+static void xport_finish_row(xport_ctx_t *ctx) {
     if (ctx->row_offset) {
         ctx->row_offset--;
+        ctx->stats->rows_skipped++;
     } else {
         ctx->parsed_row_count++;
+        ctx->stats->rows_decoded++;
+    }
+}
+
+static readstat_error_t xport_process_row(xport_ctx_t *ctx, const char *row, size_t row_length) {
+    xport_row_decoder_t decoder = {
+        .converter = ctx->converter,
+        .xport_values = ctx->xport_values,
+        .double_values = ctx->double_values,
+        .strings = ctx->strings
+    };
+    readstat_error_t retval = xport_decode_row(ctx, row, &decoder);
+    if (retval == READSTAT_OK)
+        xport_finish_row(ctx);
+
+    return retval;
+}
+
+static int xport_row_is_blank(xport_ctx_t *ctx, const char *row) {
+    off_t pos = 0;
+    for (pos=0; pos<ctx->row_length; pos++) {
+        if (row[pos] != ' ')
+            return 0;
+    }
+    return 1;
+}
+
+typedef struct xport_parallel_ctx_s {
+    xport_ctx_t            *ctx;
+    const char             *buf;
+    readstat_value_batch_t *batch;
+    iconv_t                *converters;
+    unsigned char          *xport_values;
+    double                 *double_values;
+} xport_parallel_ctx_t;
+
+static readstat_error_t xport_decode_rows(void *job_ctx, int worker,
+        long start, long end, long *out_failed_index) {
+    xport_parallel_ctx_t *pctx = (xport_parallel_ctx_t *)job_ctx;
+    xport_ctx_t *ctx = pctx->ctx;
+    readstat_error_t retval = READSTAT_OK;
+    xport_row_decoder_t decoder = {
+        .converter = pctx->converters[worker],
+        .xport_values = &pctx->xport_values[8 * ctx->var_count * worker],
+        .double_values = &pctx->double_values[ctx->var_count * worker]
+    };
+    long i;
+
+    for (i=start; i<end; i++) {
+        decoder.values = readstat_value_batch_row(pctx->batch, i);
+        decoder.strings = readstat_value_batch_strings(pctx->batch, i);
+        retval = xport_decode_row(ctx, &pctx->buf[i * ctx->row_length], &decoder);
+        pctx->batch->value_counts[i] = decoder.value_count;
+        if (retval != READSTAT_OK) {
+            *out_failed_index = i;
+            break;
+        }
+    }
+
+    return retval;
+}
+
+static readstat_error_t xport_submit_values(xport_ctx_t *ctx, readstat_value_batch_t *batch, long row) {
+    readstat_value_t *values = readstat_value_batch_row(batch, row);
+    int i;
+    for (i=0; i<batch->value_counts[row]; i++) {
+        if (ctx->variables[i]->skip || ctx->row_offset)
+            continue;
+
+        if (ctx->handle.value(ctx->parsed_row_count, ctx->variables[i], values[i], ctx->user_ctx) != READSTAT_HANDLER_OK)
+            return READSTAT_ERROR_USER_ABORT;
+    }
+    return READSTAT_OK;
+}
+
+/* Reads the observations a chunk at a time and decodes each chunk's rows on
+ * ctx->thread_count threads, delivering values in row order. Blank rows at
+ * the end of a chunk are carried over as a count; whatever is still pending
+ * at the end of the member is padding and gets dropped. Sets *out_handled to
+ * 0 without consuming any input if the rows can't be batched. */
+static readstat_error_t xport_read_data_parallel(xport_ctx_t *ctx, const char *blank_row, int *out_handled) {
+    readstat_error_t retval = READSTAT_OK;
+    xport_parallel_ctx_t pctx = { .ctx = ctx };
+    char *buf = NULL;
+    long num_blank_rows = 0;
+
+    *out_handled = 0;
+
+    if ((pctx.batch = readstat_value_batch_init(ctx->var_count, ctx->strings_len,
+                    ctx->row_length, LONG_MAX)) == NULL)
+        goto cleanup;
+
+    if ((buf = readstat_malloc(pctx.batch->row_capacity * ctx->row_length)) == NULL)
+        goto cleanup;
+
+    pctx.xport_values = readstat_malloc(8 * ctx->var_count * ctx->thread_count);
+    pctx.double_values = readstat_malloc(sizeof(double) * ctx->var_count * ctx->thread_count);
+    if (pctx.xport_values == NULL || pctx.double_values == NULL)
+        goto cleanup;
+
+    if ((retval = readstat_parallel_converters_init(&pctx.converters, ctx->thread_count,
+                    ctx->converter, ctx->output_encoding, ctx->input_encoding)) != READSTAT_OK)
+        goto cleanup;
+
+    pctx.buf = buf;
+    *out_handled = 1;
+
+    while (1) {
+        ssize_t bytes_read = read_bytes(ctx, buf, pctx.batch->row_capacity * ctx->row_length);
+        long rows_read = 0, row_count = 0, failed_index = -1;
+        readstat_error_t decode_retval = READSTAT_OK;
+        long row;
+
+        if (bytes_read == -1) {
+            retval = READSTAT_ERROR_READ;
+            goto cleanup;
+        }
+
+        rows_read = bytes_read / ctx->row_length;
+
+        for (row_count=rows_read; row_count>0; row_count--) {
+            if (!xport_row_is_blank(ctx, &buf[(row_count-1) * ctx->row_length]))
+                break;
+        }
+
+        if (row_count) {
+            while (num_blank_rows) {
+                retval = xport_process_row(ctx, blank_row, ctx->row_length);
+                if (retval != READSTAT_OK)
+                    goto cleanup;
+
+                if (ctx->row_limit > 0 && ctx->parsed_row_count == ctx->row_limit)
+                    goto cleanup;
+
+                num_blank_rows--;
+            }
+
+            decode_retval = readstat_parallel_for(ctx->thread_count, row_count,
+                    &xport_decode_rows, &pctx, &failed_index);
+
+            for (row=0; row<row_count; row++) {
+                if ((retval = xport_submit_values(ctx, pctx.batch, row)) != READSTAT_OK)
+                    goto cleanup;
+
+                if (decode_retval != READSTAT_OK && row == failed_index) {
+                    retval = decode_retval;
+                    goto cleanup;
+                }
+
+                xport_finish_row(ctx);
+
+                if (ctx->row_limit > 0 && ctx->parsed_row_count == ctx->row_limit)
+                    goto cleanup;
+            }
+
+            retval = xport_update_progress(ctx);
+            if (retval != READSTAT_OK)
+                goto cleanup;
+        }
+
+        num_blank_rows += rows_read - row_count;
+
+        if (rows_read < pctx.batch->row_capacity)
+            break;
     }
 
 cleanup:
-    free(string);
+    if (pctx.converters)
+        readstat_parallel_converters_free(pctx.converters, ctx->thread_count);
+    if (pctx.batch)
+        readstat_value_batch_free(pctx.batch);
+    if (pctx.xport_values)
+        readstat_free(pctx.xport_values);
+    if (pctx.double_values)
+        readstat_free(pctx.double_values);
+    if (buf)
+        readstat_free(buf);
+
     return retval;
 }
 
@@ -608,13 +895,33 @@ static readstat_error_t xport_read_data(xport_ctx_t *ctx) {
     char *row = readstat_malloc(ctx->row_length);
     char *blank_row = readstat_malloc(ctx->row_length);
     int num_blank_rows = 0;
+    int i;
+
+    for (i=0; i<ctx->var_count; i++) {
+        if (ctx->variables[i]->type == READSTAT_TYPE_STRING)
+            ctx->strings_len += 4*ctx->variables[i]->storage_width+1;
+    }
+
+    ctx->xport_values = readstat_malloc(8 * ctx->var_count);
+    ctx->double_values = readstat_malloc(sizeof(double) * ctx->var_count);
+    if (ctx->strings_len)
+        ctx->strings = readstat_malloc(ctx->strings_len);
 
-    if (row == NULL || blank_row == NULL) {
+    if (row == NULL || blank_row == NULL ||
+            ctx->xport_values == NULL || ctx->double_values == NULL ||
+            (ctx->strings_len && ctx->strings == NULL)) {
         retval = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
 
     memset(blank_row, ' ', ctx->row_length);
+
+    if (ctx->thread_count > 1) {
+        int handled = 0;
+        if ((retval = xport_read_data_parallel(ctx, blank_row, &handled)) != READSTAT_OK || handled)
+            goto cleanup;
+    }
+
     while (1) {
         ssize_t bytes_read = read_bytes(ctx, row, ctx->row_length);
         if (bytes_read == -1) {
@@ -624,18 +931,7 @@ static readstat_error_t xport_read_data(xport_ctx_t *ctx) {
             break;
         }
 
-        off_t pos = 0;
-
-        int row_is_blank = 1;
-
-        for (pos=0; pos<ctx->row_length; pos++) {
-            if (row[pos] != ' ') {
-                row_is_blank = 0;
-                break;
-            }
-        }
-
-        if (row_is_blank) {
+        if (xport_row_is_blank(ctx, row)) {
             num_blank_rows++;
             continue;
         }
@@ -665,18 +961,20 @@ static readstat_error_t xport_read_data(xport_ctx_t *ctx) {
 
 cleanup:
     if (row)
-        free(row);
+        readstat_free(row);
     if (blank_row)
-        free(blank_row);
+        readstat_free(blank_row);
     return retval;
 }
 
-readstat_error_t readstat_parse_xport(readstat_parser_t *parser, const char *path, void *user_ctx) {
+static readstat_error_t xport_parse(readstat_parser_t *parser, const char *path, void *user_ctx) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = parser->io;
 
     xport_ctx_t *ctx = xport_ctx_init();
     ctx->handle = parser->handlers;
+    ctx->stats = &parser->stats;
+    readstat_progress_init(&ctx->progress, parser);
     ctx->input_encoding = parser->input_encoding;
     ctx->output_encoding = parser->output_encoding;
     ctx->user_ctx = user_ctx;
@@ -684,6 +982,12 @@ readstat_error_t readstat_parse_xport(readstat_parser_t *parser, const char *pat
     ctx->row_limit = parser->row_limit;
     if (parser->row_offset > 0)
         ctx->row_offset = parser->row_offset;
+    ctx->thread_count = parser->thread_count;
+
+    if ((ctx->arena = readstat_arena_init()) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
 
     if (io->open(path, io->io_ctx) == -1) {
         retval = READSTAT_ERROR_OPEN;
@@ -758,3 +1062,7 @@ cleanup:
     return retval;
 }
 
+readstat_error_t readstat_parse_xport(readstat_parser_t *parser, const char *path, void *user_ctx) {
+    return readstat_stats_parse(parser, &xport_parse,
+            READSTAT_LABEL_INDEX_PARSE_OWN, path, user_ctx);
+}
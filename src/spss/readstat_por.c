@@ -1,9 +1,12 @@
 #include <stdlib.h>
+#include <math.h>
 #include <iconv.h>
 
 #include "../readstat.h"
 #include "../CKHashTable.h"
 #include "../readstat_convert.h"
+#include "../readstat_malloc.h"
+#include "../readstat_arena.h"
 
 #include "readstat_spss.h"
 #include "readstat_por.h"
@@ -82,16 +85,12 @@ void por_ctx_free(por_ctx_t *ctx) {
             if (ctx->varinfo[i].label)
                 free(ctx->varinfo[i].label);
         }
-        free(ctx->varinfo);
-    }
-    if (ctx->variables) {
-        int i;
-        for (i=0; i<ctx->var_count; i++) {
-            if (ctx->variables[i])
-                free(ctx->variables[i]);
-        }
-        free(ctx->variables);
+        readstat_free(ctx->varinfo);
     }
+    if (ctx->variables)
+        readstat_free(ctx->variables);
+    if (ctx->arena)
+        readstat_arena_free(ctx->arena);
     if (ctx->var_dict)
         ck_hash_table_free(ctx->var_dict);
     if (ctx->converter)
@@ -99,6 +98,122 @@ void por_ctx_free(por_ctx_t *ctx) {
     free(ctx);
 }
 
+void por_build_base30_lookup(uint8_t byte2base30[256], const uint16_t byte2unicode[256]) {
+    int i;
+    for (i=0; i<256; i++) {
+        uint16_t codepoint = byte2unicode[i];
+        if (codepoint >= '0' && codepoint <= '9') {
+            byte2base30[i] = codepoint - '0';
+        } else if (codepoint >= 'A' && codepoint <= 'T') {
+            byte2base30[i] = 10 + codepoint - 'A';
+        } else if (codepoint == ' ') {
+            byte2base30[i] = POR_BASE30_SPACE;
+        } else if (codepoint == '-') {
+            byte2base30[i] = POR_BASE30_MINUS;
+        } else if (codepoint == '+') {
+            byte2base30[i] = POR_BASE30_PLUS;
+        } else if (codepoint == '.') {
+            byte2base30[i] = POR_BASE30_PERIOD;
+        } else if (codepoint == '/') {
+            byte2base30[i] = POR_BASE30_SLASH;
+        } else if (codepoint == '*') {
+            byte2base30[i] = POR_BASE30_ASTERISK;
+        } else {
+            byte2base30[i] = POR_BASE30_INVALID;
+        }
+    }
+}
+
+/* Parses a base-30 number directly from file bytes, accepting the same
+ * grammar and performing the same arithmetic as readstat_por_parse_double
+ * (which works on UTF-8 input). Returns the number of bytes consumed, or -1
+ * if the input doesn't parse, in which case the caller should fall back to
+ * the slow path for error reporting. */
+ssize_t por_parse_base30_double(const unsigned char *input, size_t input_len,
+        const uint8_t byte2base30[256], double *result) {
+    const unsigned char *p = input;
+    const unsigned char *pe = input + input_len;
+    double num = 0.0, frac = 0.0, exp = 0.0, denom = 30.0;
+    double val = 0.0;
+    int is_negative = 0, exp_is_negative = 0;
+    int has_integer = 0;
+    uint8_t c = POR_BASE30_INVALID;
+
+    while (p < pe && (c = byte2base30[*p]) == POR_BASE30_SPACE)
+        p++;
+
+    if (p == pe)
+        return -1;
+
+    if (c == POR_BASE30_ASTERISK) {
+        if (p + 1 == pe || byte2base30[p[1]] != POR_BASE30_PERIOD)
+            return -1;
+        if (result)
+            *result = NAN;
+        return p + 2 - input;
+    }
+
+    if (c == POR_BASE30_MINUS) {
+        is_negative = 1;
+        if (++p == pe)
+            return -1;
+        c = byte2base30[*p];
+    }
+
+    if (c < 30) {
+        has_integer = 1;
+        while (p < pe && (c = byte2base30[*p]) < 30) {
+            num = 30 * num + c;
+            p++;
+        }
+        if (p == pe)
+            return -1;
+    }
+
+    if (c == POR_BASE30_PERIOD) {
+        if (++p == pe || byte2base30[*p] >= 30)
+            return -1;
+        while (p < pe && (c = byte2base30[*p]) < 30) {
+            frac += c / denom;
+            denom *= 30.0;
+            p++;
+        }
+        if (p == pe)
+            return -1;
+    } else if (!has_integer) {
+        return -1;
+    }
+
+    if (has_integer && (c == POR_BASE30_PLUS || c == POR_BASE30_MINUS)) {
+        exp_is_negative = (c == POR_BASE30_MINUS);
+        if (++p == pe || byte2base30[*p] >= 30)
+            return -1;
+        while (p < pe && (c = byte2base30[*p]) < 30) {
+            exp = 30 * exp + c;
+            p++;
+        }
+        if (p == pe)
+            return -1;
+    }
+
+    if (c != POR_BASE30_SLASH)
+        return -1;
+
+    val = 1.0 * num + frac;
+    if (exp_is_negative)
+        exp *= -1;
+    if (exp) {
+        val *= pow(30.0, exp);
+    }
+    if (is_negative)
+        val *= -1;
+
+    if (result)
+        *result = val;
+
+    return p + 1 - input;
+}
+
 ssize_t por_utf8_encode(const unsigned char *input, size_t input_len, 
         char *output, size_t output_len, uint16_t lookup[256]) {
     int offset = 0;
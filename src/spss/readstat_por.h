@@ -1,9 +1,24 @@
 
+#include "../readstat_progress.h"
+
 extern int8_t   por_ascii_lookup[256];
 extern uint16_t por_unicode_lookup[256];
 
+/* Classes in por_ctx_t.byte2base30 for bytes that aren't base-30 digits */
+#define POR_BASE30_SPACE    30
+#define POR_BASE30_MINUS    31
+#define POR_BASE30_PLUS     32
+#define POR_BASE30_PERIOD   33
+#define POR_BASE30_SLASH    34
+#define POR_BASE30_ASTERISK 35
+#define POR_BASE30_INVALID  36
+
+#define POR_READ_BUFFER_SIZE 4096
+
 typedef struct por_ctx_s {
     readstat_callbacks_t    handle;
+    readstat_progress_t     progress;
+    readstat_parser_stats_t *stats;
     size_t                  file_size;
     void                   *user_ctx;
 
@@ -16,6 +31,10 @@ typedef struct por_ctx_s {
     char           fweight_name[9];
     char           file_label[21];
     uint16_t       byte2unicode[256];
+    uint8_t        byte2base30[256];
+    unsigned char  read_buffer[POR_READ_BUFFER_SIZE];
+    size_t         read_buffer_pos;
+    size_t         read_buffer_len;
     size_t         base30_precision;
     iconv_t        converter;
     unsigned char *string_buffer;
@@ -27,12 +46,17 @@ typedef struct por_ctx_s {
     int            row_limit;
     int            row_offset;
     readstat_variable_t **variables;
+    struct readstat_arena_s *arena;
     spss_varinfo_t *varinfo;
     ck_hash_table_t *var_dict;
 } por_ctx_t;
 
 por_ctx_t *por_ctx_init();
 void por_ctx_free(por_ctx_t *ctx);
+void por_build_base30_lookup(uint8_t byte2base30[256], const uint16_t byte2unicode[256]);
+ssize_t por_parse_base30_double(const unsigned char *input, size_t input_len,
+        const uint8_t byte2base30[256], double *result);
+ssize_t por_write_double_to_buffer(char *string, size_t buffer_len, double value, long precision);
 ssize_t por_utf8_encode(const unsigned char *input, size_t input_len, 
         char *output, size_t output_len, uint16_t lookup[256]);
 ssize_t por_utf8_decode(
@@ -15,6 +15,9 @@
 #include "../readstat_iconv.h"
 #include "../readstat_convert.h"
 #include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 #include "../CKHashTable.h"
 
 #include "readstat_por_parse.h"
@@ -40,12 +43,27 @@ static readstat_error_t read_string(por_ctx_t *ctx, char *data, size_t len);
 
 static readstat_error_t por_update_progress(por_ctx_t *ctx) {
     readstat_io_t *io = ctx->io;
+    if (!ctx->handle.progress || !readstat_progress_due(&ctx->progress, io))
+        return READSTAT_OK;
     return io->update(ctx->file_size, ctx->handle.progress, ctx->user_ctx, io->io_ctx);
 }
 
+static ssize_t read_raw_byte(por_ctx_t *ctx, char *byte) {
+    if (ctx->read_buffer_pos == ctx->read_buffer_len) {
+        readstat_io_t *io = ctx->io;
+        ssize_t bytes_read = io->read(ctx->read_buffer, sizeof(ctx->read_buffer), io->io_ctx);
+        if (bytes_read <= 0)
+            return bytes_read;
+
+        ctx->read_buffer_pos = 0;
+        ctx->read_buffer_len = bytes_read;
+    }
+    *byte = ctx->read_buffer[ctx->read_buffer_pos++];
+    return 1;
+}
+
 static ssize_t read_bytes(por_ctx_t *ctx, void *dst, size_t len) {
     char *dst_pos = (char *)dst;
-    readstat_io_t *io = ctx->io;
     char byte;
 
     while (dst_pos < (char *)dst + len) {
@@ -54,7 +72,7 @@ static ssize_t read_bytes(por_ctx_t *ctx, void *dst, size_t len) {
             ctx->num_spaces--;
             continue;
         }
-        ssize_t bytes_read = io->read(&byte, 1, io->io_ctx);
+        ssize_t bytes_read = read_raw_byte(ctx, &byte);
         if (bytes_read == 0) {
             break;
         }
@@ -63,7 +81,7 @@ static ssize_t read_bytes(por_ctx_t *ctx, void *dst, size_t len) {
         }
         if (byte == '\r' || byte == '\n') {
             if (byte == '\r') {
-                bytes_read = io->read(&byte, 1, io->io_ctx);
+                bytes_read = read_raw_byte(ctx, &byte);
                 if (bytes_read == 0 || bytes_read == -1 || byte != '\n')
                     return -1;
             }
@@ -111,7 +129,7 @@ static readstat_error_t read_double_with_peek(por_ctx_t *ctx, double *out_double
         return READSTAT_OK;
     }
     int64_t i=2;
-    while (i<sizeof(buffer) && ctx->byte2unicode[buffer[i-1]] != '/') {
+    while (i<sizeof(buffer) && ctx->byte2base30[buffer[i-1]] != POR_BASE30_SLASH) {
         bytes_read = read_bytes(ctx, &buffer[i], 1);
         if (bytes_read != 1)
             return READSTAT_ERROR_PARSE;
@@ -122,6 +140,9 @@ static readstat_error_t read_double_with_peek(por_ctx_t *ctx, double *out_double
         return READSTAT_ERROR_PARSE;
     }
 
+    if (por_parse_base30_double(buffer, i, ctx->byte2base30, &value) != -1)
+        goto cleanup;
+
     len = por_utf8_encode(buffer, i, utf8_buffer, sizeof(utf8_buffer), ctx->byte2unicode);
     if (len == -1) {
         if (ctx->handle.error) {
@@ -629,6 +650,7 @@ static readstat_error_t read_por_file_data(por_ctx_t *ctx) {
                 value.is_system_missing = isnan(value.v.double_value);
             }
             if (ctx->handle.value && !ctx->variables[i]->skip && !ctx->row_offset) {
+                spss_tag_defined_missing(&value, ctx->variables[i]);
                 if (ctx->handle.value(ctx->obs_count, ctx->variables[i], value, ctx->user_ctx) != READSTAT_HANDLER_OK) {
                     rs_retval = READSTAT_ERROR_USER_ABORT;
                     goto cleanup;
@@ -638,8 +660,10 @@ static readstat_error_t read_por_file_data(por_ctx_t *ctx) {
         }
         if (ctx->row_offset) {
             ctx->row_offset--;
+            ctx->stats->rows_skipped++;
         } else {
             ctx->obs_count++;
+            ctx->stats->rows_decoded++;
         }
 
         rs_retval = por_update_progress(ctx);
@@ -697,7 +721,12 @@ readstat_error_t handle_variables(por_ctx_t *ctx) {
         spss_varinfo_t *info = &ctx->varinfo[i];
         info->index = i;
 
-        ctx->variables[i] = spss_init_variable_for_info(info, index_after_skipping, ctx->converter);
+        ctx->variables[i] = spss_init_variable_for_info(info, index_after_skipping,
+                ctx->converter, ctx->arena);
+        if (ctx->variables[i] == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
 
         snprintf(label_name_buf, sizeof(label_name_buf), POR_LABEL_NAME_PREFIX "%d", info->labels_index);
 
@@ -736,7 +765,7 @@ cleanup:
     return retval;
 }
 
-readstat_error_t readstat_parse_por(readstat_parser_t *parser, const char *path, void *user_ctx) {
+static readstat_error_t por_parse(readstat_parser_t *parser, const char *path, void *user_ctx) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = parser->io;
     unsigned char reverse_lookup[256];
@@ -746,12 +775,19 @@ readstat_error_t readstat_parse_por(readstat_parser_t *parser, const char *path,
     por_ctx_t *ctx = por_ctx_init();
     
     ctx->handle = parser->handlers;
+    ctx->stats = &parser->stats;
+    readstat_progress_init(&ctx->progress, parser);
     ctx->user_ctx = user_ctx;
     ctx->io = io;
     ctx->row_limit = parser->row_limit;
     if (parser->row_offset > 0)
         ctx->row_offset = parser->row_offset;
 
+    if ((ctx->arena = readstat_arena_init()) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
+
     if (parser->output_encoding) {
         if (strcmp(parser->output_encoding, "UTF-8") != 0)
             ctx->converter = iconv_open(parser->output_encoding, "UTF-8");
@@ -806,6 +842,8 @@ readstat_error_t readstat_parse_por(readstat_parser_t *parser, const char *path,
 
     ctx->byte2unicode[reverse_lookup[64]] = por_unicode_lookup[64];
 
+    por_build_base30_lookup(ctx->byte2base30, ctx->byte2unicode);
+
     unsigned char check[8];
     char tr_check[8];
     
@@ -907,3 +945,8 @@ cleanup:
     
     return retval;
 }
+
+readstat_error_t readstat_parse_por(readstat_parser_t *parser, const char *path, void *user_ctx) {
+    return readstat_stats_parse(parser, &por_parse,
+            READSTAT_LABEL_INDEX_PARSE_OWN, path, user_ctx);
+}
@@ -82,7 +82,7 @@ static readstat_error_t por_write_tag(readstat_writer_t *writer, por_write_ctx_t
     return por_write_string_n(writer, ctx, string, 1);
 }
 
-static ssize_t por_write_double_to_buffer(char *string, size_t buffer_len, double value, long precision) {
+ssize_t por_write_double_to_buffer(char *string, size_t buffer_len, double value, long precision) {
     int offset = 0;
     if (isnan(value)) {
         string[offset++] = '*';
@@ -15,14 +15,15 @@
 #include "../readstat_bits.h"
 #include "../readstat_iconv.h"
 #include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_dictionary.h"
 
 #include "readstat_sav.h"
 
 #define SAV_VARINFO_INITIAL_CAPACITY  512
 
-sav_ctx_t *sav_ctx_init(sav_file_header_record_t *header, readstat_io_t *io) {
-    sav_ctx_t *ctx = readstat_calloc(1, sizeof(sav_ctx_t));
-    if (ctx == NULL) {
+sav_ctx_t *sav_ctx_init(sav_ctx_t *ctx, sav_file_header_record_t *header, readstat_io_t *io) {
+    if (ctx == NULL && (ctx = readstat_calloc(1, sizeof(sav_ctx_t))) == NULL) {
         return NULL;
     }
 
@@ -52,9 +53,15 @@ sav_ctx_t *sav_ctx_init(sav_file_header_record_t *header, readstat_io_t *io) {
     
     ctx->bias = ctx->bswap ? byteswap_double(header->bias) : header->bias;
     
-    ctx->varinfo_capacity = SAV_VARINFO_INITIAL_CAPACITY;
-    
-    if ((ctx->varinfo = readstat_calloc(ctx->varinfo_capacity, sizeof(spss_varinfo_t *))) == NULL) {
+    if (ctx->varinfo == NULL) {
+        ctx->varinfo_capacity = SAV_VARINFO_INITIAL_CAPACITY;
+        if ((ctx->varinfo = readstat_calloc(ctx->varinfo_capacity, sizeof(spss_varinfo_t *))) == NULL) {
+            sav_ctx_free(ctx);
+            return NULL;
+        }
+    }
+
+    if (ctx->arena == NULL && (ctx->arena = readstat_arena_init()) == NULL) {
         sav_ctx_free(ctx);
         return NULL;
     }
@@ -64,31 +71,44 @@ sav_ctx_t *sav_ctx_init(sav_file_header_record_t *header, readstat_io_t *io) {
     return ctx;
 }
 
-void sav_ctx_free(sav_ctx_t *ctx) {
+/* Everything but the varinfo array and the arena, and what's allocated from it */
+static void sav_ctx_release(sav_ctx_t *ctx) {
     if (ctx->varinfo) {
         int i;
         for (i=0; i<ctx->var_index; i++) {
             spss_varinfo_free(ctx->varinfo[i]);
         }
-        free(ctx->varinfo);
-    }
-    if (ctx->variables) {
-        int i;
-        for (i=0; i<ctx->var_count; i++) {
-            if (ctx->variables[i])
-                free(ctx->variables[i]);
-        }
-        free(ctx->variables);
     }
-    if (ctx->raw_string)
-        free(ctx->raw_string);
-    if (ctx->utf8_string)
-        free(ctx->utf8_string);
     if (ctx->converter)
         iconv_close(ctx->converter);
+    if (ctx->dictionary)
+        readstat_string_dictionary_free(ctx->dictionary);
     if (ctx->variable_display_values) {
-        free(ctx->variable_display_values);
+        readstat_free(ctx->variable_display_values);
     }
-    free(ctx);
+}
+
+void sav_ctx_reset(sav_ctx_t *ctx) {
+    spss_varinfo_t **varinfo = ctx->varinfo;
+    size_t varinfo_capacity = ctx->varinfo_capacity;
+    readstat_arena_t *arena = ctx->arena;
+
+    sav_ctx_release(ctx);
+    memset(ctx, 0, sizeof(sav_ctx_t));
+
+    if (arena)
+        readstat_arena_reset(arena);
+    ctx->arena = arena;
+    ctx->varinfo = varinfo;
+    ctx->varinfo_capacity = varinfo_capacity;
+}
+
+void sav_ctx_free(sav_ctx_t *ctx) {
+    sav_ctx_release(ctx);
+    if (ctx->varinfo)
+        readstat_free(ctx->varinfo);
+    if (ctx->arena)
+        readstat_arena_free(ctx->arena);
+    readstat_free(ctx);
 }
 
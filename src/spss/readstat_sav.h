@@ -3,6 +3,7 @@
 //
 
 #include "readstat_spss.h"
+#include "../readstat_progress.h"
 
 #pragma pack(push, 1)
 
@@ -65,6 +66,8 @@ typedef struct sav_dictionary_termination_record_s {
 
 typedef struct sav_ctx_s {
     readstat_callbacks_t  handle;
+    readstat_progress_t   progress;
+    readstat_parser_stats_t *stats;
     size_t                file_size;
     readstat_io_t        *io;
     void                 *user_ctx;
@@ -72,6 +75,7 @@ typedef struct sav_ctx_s {
     spss_varinfo_t      **varinfo;
     size_t                varinfo_capacity;
     readstat_variable_t **variables;
+    struct readstat_arena_s *arena;
 
     const char    *input_encoding;
     const char    *output_encoding;
@@ -80,6 +84,7 @@ typedef struct sav_ctx_s {
     uint32_t      *variable_display_values;
     size_t         variable_display_values_count;
     iconv_t        converter;
+    struct readstat_string_dictionary_s *dictionary;
     int            var_index;
     int            var_offset;
     int            var_count;
@@ -89,6 +94,8 @@ typedef struct sav_ctx_s {
     int            current_row;
     int            value_labels_count;
     int            fweight_index;
+    int            thread_count;
+    int            prefetch_depth;
 
     char          *raw_string;
     size_t         raw_string_len;
@@ -137,5 +144,9 @@ typedef struct sav_ctx_s {
 
 #define SAV_EIGHT_SPACES              "        "
 
-sav_ctx_t *sav_ctx_init(sav_file_header_record_t *header, readstat_io_t *io);
+/* `ctx' is one from sav_ctx_reset(), or NULL for a new one */
+sav_ctx_t *sav_ctx_init(sav_ctx_t *ctx, sav_file_header_record_t *header, readstat_io_t *io);
 void sav_ctx_free(sav_ctx_t *ctx);
+
+/* Empties a context for sav_ctx_init(), keeping its arena and varinfo array */
+void sav_ctx_reset(sav_ctx_t *ctx);
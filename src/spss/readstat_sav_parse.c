@@ -44,6 +44,8 @@ static varlookup_t *build_lookup_table(int var_count, sav_ctx_t *ctx) {
     int offset = 0;
     int i;
     spss_varinfo_t *last_info = NULL;
+    if (table == NULL)
+        return NULL;
     for (i=0; i<ctx->var_index; i++) {
         spss_varinfo_t *info = ctx->varinfo[i];
 
@@ -60,7 +62,7 @@ static varlookup_t *build_lookup_table(int var_count, sav_ctx_t *ctx) {
 }
 
 
-#line 64 "src/spss/readstat_sav_parse.c"
+#line 66 "src/spss/readstat_sav_parse.c"
 static const char _sav_long_variable_parse_actions[] = {
 	0, 1, 3, 1, 5, 2, 4, 1, 
 	3, 6, 2, 0
@@ -280,7 +282,7 @@ static const int sav_long_variable_parse_start = 1;
 static const int sav_long_variable_parse_en_main = 1;
 
 
-#line 64 "src/spss/readstat_sav_parse.rl"
+#line 66 "src/spss/readstat_sav_parse.rl"
 
 
 readstat_error_t sav_parse_long_variable_names_record(void *data, int count, sav_ctx_t *ctx) {
@@ -298,18 +300,20 @@ readstat_error_t sav_parse_long_variable_names_record(void *data, int count, sav
     unsigned char *pe = c_data + count;
 
     varlookup_t *table = build_lookup_table(var_count, ctx);
+    if (var_count && table == NULL)
+        return READSTAT_ERROR_MALLOC;
 
     unsigned char *eof = pe;
 
     int cs;
 
     
-#line 308 "src/spss/readstat_sav_parse.c"
+#line 312 "src/spss/readstat_sav_parse.c"
 	{
 	cs = sav_long_variable_parse_start;
 	}
 
-#line 313 "src/spss/readstat_sav_parse.c"
+#line 317 "src/spss/readstat_sav_parse.c"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -384,7 +388,7 @@ _match:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 87 "src/spss/readstat_sav_parse.rl"
+#line 91 "src/spss/readstat_sav_parse.rl"
 	{
             varlookup_t *found = bsearch(temp_key, table, var_count, sizeof(varlookup_t), &compare_key_varlookup);
             if (found) {
@@ -398,36 +402,36 @@ _match:
         }
 	break;
 	case 1:
-#line 99 "src/spss/readstat_sav_parse.rl"
+#line 103 "src/spss/readstat_sav_parse.rl"
 	{
             memcpy(temp_key, str_start, str_len);
             temp_key[str_len] = '\0';
         }
 	break;
 	case 2:
-#line 104 "src/spss/readstat_sav_parse.rl"
+#line 108 "src/spss/readstat_sav_parse.rl"
 	{
             memcpy(temp_val, str_start, str_len);
             temp_val[str_len] = '\0';
         }
 	break;
 	case 3:
-#line 111 "src/spss/readstat_sav_parse.rl"
+#line 115 "src/spss/readstat_sav_parse.rl"
 	{ str_start = p; }
 	break;
 	case 4:
-#line 111 "src/spss/readstat_sav_parse.rl"
+#line 115 "src/spss/readstat_sav_parse.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 5:
-#line 113 "src/spss/readstat_sav_parse.rl"
+#line 117 "src/spss/readstat_sav_parse.rl"
 	{ str_start = p; }
 	break;
 	case 6:
-#line 113 "src/spss/readstat_sav_parse.rl"
+#line 117 "src/spss/readstat_sav_parse.rl"
 	{ str_len = p - str_start; }
 	break;
-#line 431 "src/spss/readstat_sav_parse.c"
+#line 435 "src/spss/readstat_sav_parse.c"
 		}
 	}
 
@@ -444,7 +448,7 @@ _again:
 	while ( __nacts-- > 0 ) {
 		switch ( *__acts++ ) {
 	case 0:
-#line 87 "src/spss/readstat_sav_parse.rl"
+#line 91 "src/spss/readstat_sav_parse.rl"
 	{
             varlookup_t *found = bsearch(temp_key, table, var_count, sizeof(varlookup_t), &compare_key_varlookup);
             if (found) {
@@ -458,17 +462,17 @@ _again:
         }
 	break;
 	case 2:
-#line 104 "src/spss/readstat_sav_parse.rl"
+#line 108 "src/spss/readstat_sav_parse.rl"
 	{
             memcpy(temp_val, str_start, str_len);
             temp_val[str_len] = '\0';
         }
 	break;
 	case 6:
-#line 113 "src/spss/readstat_sav_parse.rl"
+#line 117 "src/spss/readstat_sav_parse.rl"
 	{ str_len = p - str_start; }
 	break;
-#line 472 "src/spss/readstat_sav_parse.c"
+#line 476 "src/spss/readstat_sav_parse.c"
 		}
 	}
 	}
@@ -476,7 +480,7 @@ _again:
 	_out: {}
 	}
 
-#line 121 "src/spss/readstat_sav_parse.rl"
+#line 125 "src/spss/readstat_sav_parse.rl"
 
 
     if (cs < 11|| p != pe) {
@@ -490,7 +494,7 @@ _again:
     
 
     if (table)
-        free(table);
+        readstat_free(table);
 
     /* suppress warning */
     (void)sav_long_variable_parse_en_main;
@@ -499,7 +503,7 @@ _again:
 }
 
 
-#line 503 "src/spss/readstat_sav_parse.c"
+#line 507 "src/spss/readstat_sav_parse.c"
 static const char _sav_very_long_string_parse_actions[] = {
 	0, 1, 0, 1, 2, 1, 3, 2, 
 	4, 1, 2, 5, 2
@@ -572,7 +576,7 @@ static const int sav_very_long_string_parse_start = 1;
 static const int sav_very_long_string_parse_en_main = 1;
 
 
-#line 146 "src/spss/readstat_sav_parse.rl"
+#line 150 "src/spss/readstat_sav_parse.rl"
 
 
 readstat_error_t sav_parse_very_long_string_record(void *data, int count, sav_ctx_t *ctx) {
@@ -595,14 +599,18 @@ readstat_error_t sav_parse_very_long_string_record(void *data, int count, sav_ct
 
     error_buf = readstat_malloc(error_buf_len);
     table = build_lookup_table(var_count, ctx);
+    if (error_buf == NULL || (var_count && table == NULL)) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
     
     
-#line 601 "src/spss/readstat_sav_parse.c"
+#line 609 "src/spss/readstat_sav_parse.c"
 	{
 	cs = sav_very_long_string_parse_start;
 	}
 
-#line 606 "src/spss/readstat_sav_parse.c"
+#line 614 "src/spss/readstat_sav_parse.c"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -677,7 +685,7 @@ _match:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 170 "src/spss/readstat_sav_parse.rl"
+#line 178 "src/spss/readstat_sav_parse.rl"
 	{
             varlookup_t *found = bsearch(temp_key, table, var_count, sizeof(varlookup_t), &compare_key_varlookup);
             if (found) {
@@ -686,14 +694,14 @@ _match:
         }
 	break;
 	case 1:
-#line 177 "src/spss/readstat_sav_parse.rl"
+#line 185 "src/spss/readstat_sav_parse.rl"
 	{
             memcpy(temp_key, str_start, str_len);
             temp_key[str_len] = '\0';
         }
 	break;
 	case 2:
-#line 182 "src/spss/readstat_sav_parse.rl"
+#line 190 "src/spss/readstat_sav_parse.rl"
 	{
             if ((*p) != '\0') {
                 unsigned char digit = (*p) - '0';
@@ -706,18 +714,18 @@ _match:
         }
 	break;
 	case 3:
-#line 195 "src/spss/readstat_sav_parse.rl"
+#line 203 "src/spss/readstat_sav_parse.rl"
 	{ str_start = p; }
 	break;
 	case 4:
-#line 195 "src/spss/readstat_sav_parse.rl"
+#line 203 "src/spss/readstat_sav_parse.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 5:
-#line 197 "src/spss/readstat_sav_parse.rl"
+#line 205 "src/spss/readstat_sav_parse.rl"
 	{ temp_val = 0; }
 	break;
-#line 721 "src/spss/readstat_sav_parse.c"
+#line 729 "src/spss/readstat_sav_parse.c"
 		}
 	}
 
@@ -730,7 +738,7 @@ _again:
 	_out: {}
 	}
 
-#line 205 "src/spss/readstat_sav_parse.rl"
+#line 213 "src/spss/readstat_sav_parse.rl"
 
     
     if (cs < 12 || p != pe) {
@@ -742,10 +750,11 @@ _again:
         retval = READSTAT_ERROR_PARSE;
     }
     
+cleanup:
     if (table)
-        free(table);
+        readstat_free(table);
     if (error_buf)
-        free(error_buf);
+        readstat_free(error_buf);
 
     /* suppress warning */
     (void)sav_very_long_string_parse_en_main;
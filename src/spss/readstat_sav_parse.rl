@@ -42,6 +42,8 @@ static varlookup_t *build_lookup_table(int var_count, sav_ctx_t *ctx) {
     int offset = 0;
     int i;
     spss_varinfo_t *last_info = NULL;
+    if (table == NULL)
+        return NULL;
     for (i=0; i<ctx->var_index; i++) {
         spss_varinfo_t *info = ctx->varinfo[i];
 
@@ -78,6 +80,8 @@ readstat_error_t sav_parse_long_variable_names_record(void *data, int count, sav
     unsigned char *pe = c_data + count;
 
     varlookup_t *table = build_lookup_table(var_count, ctx);
+    if (var_count && table == NULL)
+        return READSTAT_ERROR_MALLOC;
 
     unsigned char *eof = pe;
 
@@ -131,7 +135,7 @@ readstat_error_t sav_parse_long_variable_names_record(void *data, int count, sav
     
 
     if (table)
-        free(table);
+        readstat_free(table);
 
     /* suppress warning */
     (void)sav_long_variable_parse_en_main;
@@ -165,6 +169,10 @@ readstat_error_t sav_parse_very_long_string_record(void *data, int count, sav_ct
 
     error_buf = readstat_malloc(error_buf_len);
     table = build_lookup_table(var_count, ctx);
+    if (error_buf == NULL || (var_count && table == NULL)) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
     
     %%{
         action set_width {
@@ -213,10 +221,11 @@ readstat_error_t sav_parse_very_long_string_record(void *data, int count, sav_ct
         retval = READSTAT_ERROR_PARSE;
     }
     
+cleanup:
     if (table)
-        free(table);
+        readstat_free(table);
     if (error_buf)
-        free(error_buf);
+        readstat_free(error_buf);
 
     /* suppress warning */
     (void)sav_very_long_string_parse_en_main;
@@ -7,12 +7,21 @@
 #include <math.h>
 #include <float.h>
 #include <time.h>
+#include <limits.h>
 
 #include "../readstat.h"
 #include "../readstat_bits.h"
 #include "../readstat_iconv.h"
+#include "../readstat_io_cache.h"
 #include "../readstat_convert.h"
 #include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_dictionary.h"
+#include "../readstat_parallel.h"
+#include "../readstat_prefetch.h"
+#include "../readstat_reuse.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 
 #include "readstat_sav.h"
 #include "readstat_sav_compress.h"
@@ -23,7 +32,8 @@
 #include "readstat_zsav_read.h"
 #endif
 
-#define DATA_BUFFER_SIZE    65536
+#define DATA_BUFFER_SIZE        65536
+#define DICTIONARY_BLOCK_SIZE   65536
 
 /* Others defined in table below */
 
@@ -160,6 +170,8 @@ static void sav_tag_missing_double(readstat_value_t *value, sav_ctx_t *ctx) {
 
 static readstat_error_t sav_update_progress(sav_ctx_t *ctx) {
     readstat_io_t *io = ctx->io;
+    if (!ctx->handle.progress || !readstat_progress_due(&ctx->progress, io))
+        return READSTAT_OK;
     return io->update(ctx->file_size, ctx->handle.progress, ctx->user_ctx, io->io_ctx);
 }
 
@@ -233,11 +245,11 @@ static readstat_error_t sav_read_variable_label(spss_varinfo_t *info, sav_ctx_t
 
 cleanup:
     if (label_buf)
-        free(label_buf);
+        readstat_free(label_buf);
 
     if (retval != READSTAT_OK) {
         if (info->label) {
-            free(info->label);
+            readstat_free(info->label);
             info->label = NULL;
         }
     }
@@ -493,7 +505,7 @@ static readstat_error_t sav_read_value_label_record(sav_ctx_t *ctx) {
     if (ctx->bswap)
         label_count = byteswap4(label_count);
     
-    if (label_count && (value_labels = readstat_calloc(label_count, sizeof(value_label_t))) == NULL) {
+    if (label_count && (value_labels = readstat_arena_calloc(ctx->arena, label_count, sizeof(value_label_t))) == NULL) {
         retval = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -520,7 +532,7 @@ static readstat_error_t sav_read_value_label_record(sav_ctx_t *ctx) {
         }
 
         utf8_label_len = padded_label_len*4+1;
-        if ((vlabel->label = readstat_malloc(utf8_label_len)) == NULL) {
+        if ((vlabel->label = readstat_arena_alloc(ctx->arena, utf8_label_len)) == NULL) {
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
@@ -597,15 +609,7 @@ static readstat_error_t sav_read_value_label_record(sav_ctx_t *ctx) {
     ctx->value_labels_count++;
 cleanup:
     if (vars)
-        free(vars);
-    if (value_labels) {
-        for (i=0; i<label_count; i++) {
-            value_label_t *vlabel = &value_labels[i];
-            if (vlabel->label)
-                free(vlabel->label);
-        }
-        free(value_labels);
-    }
+        readstat_free(vars);
     
     return retval;
 }
@@ -677,12 +681,51 @@ static readstat_error_t sav_read_dictionary_termination_record(sav_ctx_t *ctx) {
     return retval;
 }
 
-static readstat_error_t sav_process_row(unsigned char *buffer, size_t buffer_len, sav_ctx_t *ctx) {
-    if (ctx->row_offset) {
-        ctx->row_offset--;
-        return READSTAT_OK;
+/* Where sav_decode_row puts its output. With `values' unset, each value goes
+ * straight to the value handler; otherwise values are stored by variable
+ * index, and strings are converted into the per-variable slots of `strings'. */
+typedef struct sav_row_decoder_s {
+    iconv_t             converter;
+    char               *raw_string;
+    char               *utf8_string;
+    size_t              utf8_string_len;
+
+    readstat_value_t   *values;
+    char               *strings;
+    const size_t       *string_offsets;
+    const size_t       *string_lens;
+    int                 value_count;
+} sav_row_decoder_t;
+
+static readstat_error_t sav_decode_value(sav_ctx_t *ctx, sav_row_decoder_t *decoder,
+        int index, readstat_value_t value) {
+    if (decoder->values) {
+        decoder->values[index] = value;
+    } else if (ctx->handle.value(ctx->current_row, ctx->variables[index],
+                value, ctx->user_ctx) != READSTAT_HANDLER_OK) {
+        return READSTAT_ERROR_USER_ABORT;
     }
+    return READSTAT_OK;
+}
+
+static readstat_error_t sav_handle_string_view(sav_ctx_t *ctx, sav_row_decoder_t *decoder,
+        int index, size_t raw_len) {
+    const char *string = NULL;
+    size_t len = 0;
+    readstat_error_t retval = readstat_convert_view(decoder->utf8_string, decoder->utf8_string_len,
+            decoder->raw_string, raw_len, decoder->converter, &string, &len);
+    if (retval != READSTAT_OK)
+        return retval;
+
+    if (ctx->handle.string_view(ctx->current_row, ctx->variables[index],
+                string, len, ctx->user_ctx) != READSTAT_HANDLER_OK)
+        return READSTAT_ERROR_USER_ABORT;
+
+    return READSTAT_OK;
+}
 
+static readstat_error_t sav_decode_row(unsigned char *buffer, size_t buffer_len,
+        sav_ctx_t *ctx, sav_row_decoder_t *decoder) {
     readstat_error_t retval = READSTAT_OK;
     double fp_value;
     int offset = 0;
@@ -691,6 +734,8 @@ static readstat_error_t sav_process_row(unsigned char *buffer, size_t buffer_len
     int segment_offset = 0;
     int var_index = 0, col = 0;
 
+    decoder->value_count = 0;
+
     while (data_offset < buffer_len && col < ctx->var_index && var_index < ctx->var_index) {
         spss_varinfo_t *col_info = ctx->varinfo[col];
         spss_varinfo_t *var_info = ctx->varinfo[var_index];
@@ -701,7 +746,7 @@ static readstat_error_t sav_process_row(unsigned char *buffer, size_t buffer_len
         }
         if (var_info->type == READSTAT_TYPE_STRING) {
             if (raw_str_used + 8 <= ctx->raw_string_len) {
-                memcpy(ctx->raw_string + raw_str_used, &buffer[data_offset], 8);
+                memcpy(decoder->raw_string + raw_str_used, &buffer[data_offset], 8);
                 raw_str_used += 8;
             }
             if (++offset == col_info->width) {
@@ -712,18 +757,32 @@ static readstat_error_t sav_process_row(unsigned char *buffer, size_t buffer_len
                 col++;
             }
             if (segment_offset == var_info->n_segments) {
-                if (!ctx->variables[var_info->index]->skip) {
-                    retval = readstat_convert(ctx->utf8_string, ctx->utf8_string_len, 
-                            ctx->raw_string, raw_str_used, ctx->converter);
+                if (!ctx->variables[var_info->index]->skip && ctx->handle.string_view && !decoder->values) {
+                    if ((retval = sav_handle_string_view(ctx, decoder, var_info->index, raw_str_used)) != READSTAT_OK)
+                        goto done;
+                } else if (!ctx->variables[var_info->index]->skip) {
+                    char *utf8_string = decoder->utf8_string;
+                    size_t utf8_string_len = decoder->utf8_string_len;
+                    if (decoder->values) {
+                        utf8_string = &decoder->strings[decoder->string_offsets[var_info->index]];
+                        utf8_string_len = decoder->string_lens[var_info->index];
+                    }
+                    if (ctx->dictionary && !decoder->values) {
+                        retval = readstat_string_dictionary_convert(ctx->dictionary,
+                                ctx->variables[var_info->index], decoder->raw_string, raw_str_used,
+                                decoder->converter, utf8_string, utf8_string_len, &value);
+                    } else {
+                        retval = readstat_convert(utf8_string, utf8_string_len, 
+                                decoder->raw_string, raw_str_used, decoder->converter);
+                        value.v.string_value = utf8_string;
+                    }
                     if (retval != READSTAT_OK)
                         goto done;
-                    value.v.string_value = ctx->utf8_string;
-                    if (ctx->handle.value(ctx->current_row, ctx->variables[var_info->index],
-                                value, ctx->user_ctx) != READSTAT_HANDLER_OK) {
-                        retval = READSTAT_ERROR_USER_ABORT;
+                    spss_tag_defined_missing(&value, ctx->variables[var_info->index]);
+                    if ((retval = sav_decode_value(ctx, decoder, var_info->index, value)) != READSTAT_OK)
                         goto done;
-                    }
                 }
+                decoder->value_count = var_info->index + 1;
                 raw_str_used = 0;
                 segment_offset = 0;
                 var_index += var_info->n_segments;
@@ -736,24 +795,45 @@ static readstat_error_t sav_process_row(unsigned char *buffer, size_t buffer_len
                 }
                 value.v.double_value = fp_value;
                 sav_tag_missing_double(&value, ctx);
-                if (ctx->handle.value(ctx->current_row, ctx->variables[var_info->index],
-                            value, ctx->user_ctx) != READSTAT_HANDLER_OK) {
-                    retval = READSTAT_ERROR_USER_ABORT;
+                spss_tag_defined_missing(&value, ctx->variables[var_info->index]);
+                if ((retval = sav_decode_value(ctx, decoder, var_info->index, value)) != READSTAT_OK)
                     goto done;
-                }
             }
+            decoder->value_count = var_info->index + 1;
             var_index += var_info->n_segments;
             col++;
         }
         data_offset += 8;
     }
-    ctx->current_row++;
 done:
     return retval;
 }
 
+static readstat_error_t sav_process_row(unsigned char *buffer, size_t buffer_len, sav_ctx_t *ctx) {
+    if (ctx->row_offset) {
+        ctx->row_offset--;
+        ctx->stats->rows_skipped++;
+        return READSTAT_OK;
+    }
+
+    sav_row_decoder_t decoder = {
+        .converter = ctx->converter,
+        .raw_string = ctx->raw_string,
+        .utf8_string = ctx->utf8_string,
+        .utf8_string_len = ctx->utf8_string_len
+    };
+    readstat_error_t retval = sav_decode_row(buffer, buffer_len, ctx, &decoder);
+    if (retval == READSTAT_OK) {
+        ctx->current_row++;
+        ctx->stats->rows_decoded++;
+    }
+
+    return retval;
+}
+
 static readstat_error_t sav_read_data(sav_ctx_t *ctx) {
     readstat_error_t retval = READSTAT_OK;
+    readstat_prefetch_t *prefetch = NULL;
     size_t longest_string = 256;
     int i;
 
@@ -766,16 +846,20 @@ static readstat_error_t sav_read_data(sav_ctx_t *ctx) {
     }
 
     ctx->raw_string_len = longest_string + sizeof(SAV_EIGHT_SPACES)-2;
-    ctx->raw_string = readstat_malloc(ctx->raw_string_len);
+    ctx->raw_string = readstat_arena_alloc(ctx->arena, ctx->raw_string_len);
 
     ctx->utf8_string_len = 4*longest_string+1 + sizeof(SAV_EIGHT_SPACES)-2;
-    ctx->utf8_string = readstat_malloc(ctx->utf8_string_len);
+    ctx->utf8_string = readstat_arena_alloc(ctx->arena, ctx->utf8_string_len);
 
     if (ctx->raw_string == NULL || ctx->utf8_string == NULL) {
         retval = READSTAT_ERROR_MALLOC;
         goto done;
     }
 
+    if ((retval = readstat_prefetch_init(&prefetch, &ctx->io, ctx->prefetch_depth,
+                    READSTAT_PREFETCH_BLOCK_SIZE)) != READSTAT_OK)
+        goto done;
+
     if (ctx->compression == READSTAT_COMPRESS_ROWS) {
         retval = sav_read_compressed_data(ctx, &sav_process_row);
     } else if (ctx->compression == READSTAT_COMPRESS_BINARY) {
@@ -795,6 +879,184 @@ static readstat_error_t sav_read_data(sav_ctx_t *ctx) {
     }
 
 done:
+    if (prefetch) {
+        readstat_error_t prefetch_retval = readstat_prefetch_free(prefetch, &ctx->io);
+        if (retval == READSTAT_OK)
+            retval = prefetch_retval;
+    }
+
+    return retval;
+}
+
+typedef struct sav_parallel_ctx_s {
+    sav_ctx_t              *ctx;
+    unsigned char          *buf;
+    size_t                  row_len;
+    readstat_value_batch_t *batch;
+    iconv_t                *converters;
+    char                   *raw_strings;
+    size_t                 *string_offsets;
+    size_t                 *string_lens;
+} sav_parallel_ctx_t;
+
+static readstat_error_t sav_decode_rows(void *job_ctx, int worker,
+        long start, long end, long *out_failed_index) {
+    sav_parallel_ctx_t *pctx = (sav_parallel_ctx_t *)job_ctx;
+    sav_ctx_t *ctx = pctx->ctx;
+    readstat_error_t retval = READSTAT_OK;
+    sav_row_decoder_t decoder = {
+        .converter = pctx->converters[worker],
+        .raw_string = &pctx->raw_strings[worker * ctx->raw_string_len],
+        .string_offsets = pctx->string_offsets,
+        .string_lens = pctx->string_lens
+    };
+    long i;
+
+    for (i=start; i<end; i++) {
+        decoder.values = readstat_value_batch_row(pctx->batch, i);
+        decoder.strings = readstat_value_batch_strings(pctx->batch, i);
+        retval = sav_decode_row(&pctx->buf[i * pctx->row_len], pctx->row_len, ctx, &decoder);
+        pctx->batch->value_counts[i] = decoder.value_count;
+        if (retval != READSTAT_OK) {
+            *out_failed_index = i;
+            break;
+        }
+    }
+
+    return retval;
+}
+
+static readstat_error_t sav_submit_values(sav_ctx_t *ctx, readstat_value_batch_t *batch, long row) {
+    readstat_value_t *values = readstat_value_batch_row(batch, row);
+    int i;
+    for (i=0; i<batch->value_counts[row]; i++) {
+        if (ctx->variables[i]->skip)
+            continue;
+
+        if (ctx->handle.value(ctx->current_row, ctx->variables[i], values[i], ctx->user_ctx) != READSTAT_HANDLER_OK)
+            return READSTAT_ERROR_USER_ABORT;
+    }
+    return READSTAT_OK;
+}
+
+/* Reads rows a chunk at a time and decodes them on ctx->thread_count threads,
+ * then hands the values to the value handler in row order. Sets *out_handled
+ * to 0 without consuming any input if the rows can't be batched. */
+static readstat_error_t sav_read_uncompressed_data_parallel(sav_ctx_t *ctx, int *out_handled) {
+    readstat_error_t retval = READSTAT_OK;
+    readstat_io_t *io = ctx->io;
+    sav_parallel_ctx_t pctx = { .ctx = ctx, .row_len = ctx->var_offset * 8 };
+    size_t string_len = 0;
+    long max_rows = ctx->row_limit == -1 ? LONG_MAX : ctx->row_limit - ctx->current_row;
+    int i;
+
+    *out_handled = 0;
+
+    if (ctx->var_count == 0 || pctx.row_len == 0 || max_rows <= 1)
+        goto done;
+
+    pctx.string_offsets = readstat_calloc(ctx->var_count, sizeof(size_t));
+    pctx.string_lens = readstat_calloc(ctx->var_count, sizeof(size_t));
+    if (pctx.string_offsets == NULL || pctx.string_lens == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto done;
+    }
+
+    for (i=0; i<ctx->var_index;) {
+        spss_varinfo_t *info = ctx->varinfo[i];
+        if (info->type == READSTAT_TYPE_STRING && !ctx->variables[info->index]->skip) {
+            /* Bytes sav_decode_row can gather for this variable, at most
+             * four bytes of output apiece */
+            size_t raw_len = 0;
+            int j;
+            for (j=0; j<info->n_segments && i+j<ctx->var_index; j++) {
+                raw_len += 8 * ctx->varinfo[i+j]->width;
+            }
+            raw_len -= info->n_segments - 1;
+            if (raw_len > ctx->raw_string_len)
+                raw_len = ctx->raw_string_len;
+
+            pctx.string_lens[info->index] = 4 * raw_len + 1;
+            if (pctx.string_lens[info->index] > ctx->utf8_string_len)
+                pctx.string_lens[info->index] = ctx->utf8_string_len;
+            pctx.string_offsets[info->index] = string_len;
+            string_len += pctx.string_lens[info->index];
+        }
+        i += info->n_segments;
+    }
+
+    /* Strings are gathered a segment at a time, so they can't be put through
+     * the dictionary or handed out as views after the fact */
+    if ((ctx->dictionary || ctx->handle.string_view) && string_len)
+        goto done;
+
+    if ((pctx.batch = readstat_value_batch_init(ctx->var_count, string_len,
+                    pctx.row_len, max_rows)) == NULL)
+        goto done;
+
+    if ((pctx.buf = readstat_malloc(pctx.batch->row_capacity * pctx.row_len)) == NULL)
+        goto done;
+
+    if ((pctx.raw_strings = readstat_malloc(ctx->thread_count * ctx->raw_string_len)) == NULL)
+        goto done;
+
+    if ((retval = readstat_parallel_converters_init(&pctx.converters, ctx->thread_count,
+                    ctx->converter, ctx->output_encoding, ctx->input_encoding)) != READSTAT_OK)
+        goto done;
+
+    *out_handled = 1;
+
+    while (ctx->row_limit == -1 || ctx->current_row < ctx->row_limit) {
+        long row_count = pctx.batch->row_capacity;
+        long rows_read = 0;
+        long failed_index = -1;
+        readstat_error_t decode_retval = READSTAT_OK;
+        ssize_t bytes_read = 0;
+        long row;
+
+        if (ctx->row_limit != -1 && row_count > ctx->row_limit - ctx->current_row)
+            row_count = ctx->row_limit - ctx->current_row;
+
+        retval = sav_update_progress(ctx);
+        if (retval != READSTAT_OK)
+            goto done;
+
+        /* As with one row at a time, running out of file ends the data */
+        if ((bytes_read = readstat_parallel_read_chunk(io, pctx.buf, row_count * pctx.row_len)) > 0)
+            rows_read = bytes_read / pctx.row_len;
+
+        decode_retval = readstat_parallel_for(ctx->thread_count, rows_read,
+                &sav_decode_rows, &pctx, &failed_index);
+
+        for (row=0; row<rows_read; row++) {
+            if ((retval = sav_submit_values(ctx, pctx.batch, row)) != READSTAT_OK)
+                goto done;
+            if (decode_retval != READSTAT_OK && row == failed_index) {
+                retval = decode_retval;
+                goto done;
+            }
+            ctx->current_row++;
+            ctx->stats->rows_decoded++;
+        }
+
+        if (rows_read < row_count)
+            break;
+    }
+
+done:
+    if (pctx.converters)
+        readstat_parallel_converters_free(pctx.converters, ctx->thread_count);
+    if (pctx.batch)
+        readstat_value_batch_free(pctx.batch);
+    if (pctx.raw_strings)
+        readstat_free(pctx.raw_strings);
+    if (pctx.string_offsets)
+        readstat_free(pctx.string_offsets);
+    if (pctx.string_lens)
+        readstat_free(pctx.string_lens);
+    if (pctx.buf)
+        readstat_free(pctx.buf);
+
     return retval;
 }
 
@@ -813,9 +1075,16 @@ static readstat_error_t sav_read_uncompressed_data(sav_ctx_t *ctx,
             retval = READSTAT_ERROR_SEEK;
             goto done;
         }
+        ctx->stats->rows_skipped += ctx->row_offset;
         ctx->row_offset = 0;
     }
 
+    if (ctx->thread_count > 1) {
+        int handled = 0;
+        if ((retval = sav_read_uncompressed_data_parallel(ctx, &handled)) != READSTAT_OK || handled)
+            goto done;
+    }
+
     while (ctx->row_limit == -1 || ctx->current_row < ctx->row_limit) {
         retval = sav_update_progress(ctx);
         if (retval != READSTAT_OK)
@@ -830,7 +1099,7 @@ static readstat_error_t sav_read_uncompressed_data(sav_ctx_t *ctx,
     }
 done:
     if (buffer)
-        free(buffer);
+        readstat_free(buffer);
 
     return retval;
 }
@@ -838,6 +1107,8 @@ done:
 static readstat_error_t sav_read_compressed_data(sav_ctx_t *ctx,
         readstat_error_t (*row_handler)(unsigned char *, size_t, sav_ctx_t *)) {
     readstat_error_t retval = READSTAT_OK;
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
     readstat_io_t *io = ctx->io;
     readstat_off_t data_offset = 0;
     unsigned char buffer[DATA_BUFFER_SIZE];
@@ -876,7 +1147,10 @@ static readstat_error_t sav_read_compressed_data(sav_ctx_t *ctx,
             state.next_out = &uncompressed_row[uncompressed_offset];
             state.avail_out = uncompressed_row_len - uncompressed_offset;
 
+            readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_DECOMPRESSION, 1);
             sav_decompress_row(&state);
+            readstat_stats_timer_stop(&timer);
+            ctx->stats->bytes_decompressed += uncompressed_row_len - uncompressed_offset - state.avail_out;
 
             uncompressed_offset = uncompressed_row_len - state.avail_out;
             data_offset = buffer_used - state.avail_in;
@@ -898,7 +1172,7 @@ static readstat_error_t sav_read_compressed_data(sav_ctx_t *ctx,
 
 done:
     if (uncompressed_row)
-        free(uncompressed_row);
+        readstat_free(uncompressed_row);
 
     return retval;
 }
@@ -1178,9 +1452,9 @@ static readstat_error_t sav_parse_long_string_value_labels_record(const void *da
 
 cleanup:
     if (value_buffer)
-        free(value_buffer);
+        readstat_free(value_buffer);
     if (label_buffer)
-        free(label_buffer);
+        readstat_free(label_buffer);
     return retval;
 }
 
@@ -1459,7 +1733,7 @@ static readstat_error_t sav_parse_records_pass2(sav_ctx_t *ctx) {
     }
 cleanup:
     if (data_buf)
-        free(data_buf);
+        readstat_free(data_buf);
     return retval;
 }
 
@@ -1474,7 +1748,7 @@ static void sav_set_n_segments_and_var_count(sav_ctx_t *ctx) {
         info->index = ctx->var_count++;
         i += info->n_segments;
     }
-    ctx->variables = readstat_calloc(ctx->var_count, sizeof(readstat_variable_t *));
+    ctx->variables = readstat_arena_calloc(ctx->arena, ctx->var_count, sizeof(readstat_variable_t *));
 }
 
 static readstat_error_t sav_handle_variables(sav_ctx_t *ctx) {
@@ -1488,7 +1762,12 @@ static readstat_error_t sav_handle_variables(sav_ctx_t *ctx) {
     for (i=0; i<ctx->var_index;) {
         char label_name_buf[256];
         spss_varinfo_t *info = ctx->varinfo[i];
-        ctx->variables[info->index] = spss_init_variable_for_info(info, index_after_skipping, ctx->converter);
+        ctx->variables[info->index] = spss_init_variable_for_info(info, index_after_skipping,
+                ctx->converter, ctx->arena);
+        if (ctx->variables[info->index] == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
 
         snprintf(label_name_buf, sizeof(label_name_buf), SAV_LABEL_NAME_PREFIX "%d", info->labels_index);
 
@@ -1553,9 +1832,18 @@ cleanup:
     return retval;
 }
 
-readstat_error_t readstat_parse_sav(readstat_parser_t *parser, const char *path, void *user_ctx) {
+static void sav_reuse_reset(void *ctx) {
+    sav_ctx_reset((sav_ctx_t *)ctx);
+}
+
+static void sav_reuse_free(void *ctx) {
+    sav_ctx_free((sav_ctx_t *)ctx);
+}
+
+static readstat_error_t sav_parse(readstat_parser_t *parser, const char *path, void *user_ctx) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = parser->io;
+    readstat_io_cache_t *dictionary = NULL;
     sav_file_header_record_t header;
     sav_ctx_t *ctx = NULL;
     size_t file_size = 0;
@@ -1575,20 +1863,27 @@ readstat_error_t readstat_parse_sav(readstat_parser_t *parser, const char *path,
         goto cleanup;
     }
 
+    if ((retval = readstat_reuse_io_begin(parser, &io, file_size)) != READSTAT_OK)
+        goto cleanup;
+
     if (io->read(&header, sizeof(sav_file_header_record_t), io->io_ctx) < sizeof(sav_file_header_record_t)) {
         retval = READSTAT_ERROR_READ;
         goto cleanup;
     }
 
-    ctx = sav_ctx_init(&header, io);
+    ctx = sav_ctx_init(readstat_reuse_take(parser, READSTAT_REUSE_SLOT_SAV), &header, io);
     if (ctx == NULL) {
         retval = READSTAT_ERROR_PARSE;
         goto cleanup;
     }
 
     ctx->handle = parser->handlers;
+    ctx->stats = &parser->stats;
+    readstat_progress_init(&ctx->progress, parser);
     ctx->input_encoding = parser->input_encoding;
     ctx->output_encoding = parser->output_encoding;
+    ctx->thread_count = parser->thread_count;
+    ctx->prefetch_depth = parser->prefetch_depth;
     ctx->user_ctx = user_ctx;
     ctx->file_size = file_size;
     if (parser->row_offset > 0)
@@ -1609,10 +1904,14 @@ readstat_error_t readstat_parse_sav(readstat_parser_t *parser, const char *path,
     if ((retval = sav_parse_timestamp(ctx, &header)) != READSTAT_OK)
         goto cleanup;
 
+    /* Both passes walk the dictionary record by record; read it once */
+    if ((retval = readstat_io_cache_init(&dictionary, &ctx->io, DICTIONARY_BLOCK_SIZE)) != READSTAT_OK)
+        goto cleanup;
+
     if ((retval = sav_parse_records_pass1(ctx)) != READSTAT_OK)
         goto cleanup;
     
-    if (io->seek(sizeof(sav_file_header_record_t), READSTAT_SEEK_SET, io->io_ctx) == -1) {
+    if (ctx->io->seek(sizeof(sav_file_header_record_t), READSTAT_SEEK_SET, ctx->io->io_ctx) == -1) {
         retval = READSTAT_ERROR_SEEK;
         goto cleanup;
     }
@@ -1622,6 +1921,11 @@ readstat_error_t readstat_parse_sav(readstat_parser_t *parser, const char *path,
 
     if ((retval = sav_parse_records_pass2(ctx)) != READSTAT_OK)
         goto cleanup;
+
+    retval = readstat_io_cache_free(dictionary, &ctx->io);
+    dictionary = NULL;
+    if (retval != READSTAT_OK)
+        goto cleanup;
  
     sav_set_n_segments_and_var_count(ctx);
 
@@ -1662,14 +1966,31 @@ readstat_error_t readstat_parse_sav(readstat_parser_t *parser, const char *path,
     if ((retval = sav_handle_fweight(ctx)) != READSTAT_OK)
         goto cleanup;
 
+    if (ctx->handle.value && parser->string_dictionary_limit > 0 &&
+            (ctx->dictionary = readstat_string_dictionary_init(ctx->arena, ctx->var_count,
+                    parser->string_dictionary_limit, ctx->handle.dictionary_entry, user_ctx)) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
+
     if (ctx->handle.value) {
         retval = sav_read_data(ctx);
     }
     
 cleanup:
+    if (dictionary)
+        readstat_io_cache_free(dictionary, &ctx->io);
+    readstat_reuse_io_end(parser, &io);
     io->close(io->io_ctx);
-    if (ctx)
-        sav_ctx_free(ctx);
+    if (ctx) {
+        readstat_reuse_keep(parser, READSTAT_REUSE_SLOT_SAV, ctx,
+                &sav_reuse_reset, &sav_reuse_free);
+    }
     
     return retval;
 }
+
+readstat_error_t readstat_parse_sav(readstat_parser_t *parser, const char *path, void *user_ctx) {
+    return readstat_stats_parse(parser, &sav_parse,
+            READSTAT_LABEL_INDEX_PARSE_OWN, path, user_ctx);
+}
@@ -1435,7 +1435,7 @@ readstat_error_t readstat_begin_writing_sav(readstat_writer_t *writer, void *use
 
     if (writer->compression == READSTAT_COMPRESS_ROWS) {
         writer->callbacks.write_row = &sav_write_compressed_row;
-        writer->callbacks.module_ctx_free = &free;
+        writer->callbacks.module_ctx_free = &readstat_free;
 #if HAVE_ZLIB
     } else if (writer->compression == READSTAT_COMPRESS_BINARY) {
         writer->callbacks.write_row = &zsav_write_compressed_row;
@@ -5,6 +5,9 @@
 #include "../readstat.h"
 #include "../readstat_iconv.h"
 #include "../readstat_convert.h"
+#include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_missingness.h"
 #include "readstat_spss.h"
 #include "readstat_spss_parse.h"
 
@@ -78,8 +81,8 @@ int spss_varinfo_compare(const void *elem1, const void *elem2) {
 void spss_varinfo_free(spss_varinfo_t *info) {
     if (info) {
         if (info->label)
-            free(info->label);
-        free(info);
+            readstat_free(info->label);
+        readstat_free(info);
     }
 }
 
@@ -124,6 +127,28 @@ static readstat_value_t spss_boxed_missing_value(spss_varinfo_t *info, int i) {
     return spss_boxed_string_value(info->missing_string_values[i]);
 }
 
+/* One range (numeric only) followed by one discrete value, or up to three
+ * discrete values */
+static void spss_compile_missingness(readstat_missingness_t *missingness, spss_varinfo_t *info) {
+    int i = 0;
+    if (info->missing_range) {
+        if (info->type != READSTAT_TYPE_DOUBLE)
+            return;
+        missingness->has_range = 1;
+        missingness->range_lo = info->missing_double_values[0];
+        missingness->range_hi = info->missing_double_values[1];
+        i = 2;
+    }
+    for (; i<info->n_missing_values && i<3; i++) {
+        if (info->type == READSTAT_TYPE_DOUBLE) {
+            missingness->discrete_doubles[missingness->discrete_count++] = info->missing_double_values[i];
+        } else {
+            missingness->discrete_strings[missingness->discrete_count++] = info->missing_string_values[i];
+        }
+    }
+    missingness->is_compiled = 1;
+}
+
 readstat_missingness_t spss_missingness_for_info(spss_varinfo_t *info) {
     readstat_missingness_t missingness;
     memset(&missingness, '\0', sizeof(readstat_missingness_t));
@@ -144,12 +169,26 @@ readstat_missingness_t spss_missingness_for_info(spss_varinfo_t *info) {
             missingness.missing_ranges[2*i] = missingness.missing_ranges[2*i+1] = spss_boxed_missing_value(info, i);
         }
     }
+
+    spss_compile_missingness(&missingness, info);
     return missingness;
 }
 
+void spss_tag_defined_missing(readstat_value_t *value, const readstat_variable_t *variable) {
+    const readstat_missingness_t *missingness = variable->missingness;
+    if (missingness && missingness->is_compiled)
+        value->is_defined_missing = readstat_missingness_contains(missingness, *value);
+}
+
 readstat_variable_t *spss_init_variable_for_info(spss_varinfo_t *info, int index_after_skipping,
-        iconv_t converter) {
-    readstat_variable_t *variable = calloc(1, sizeof(readstat_variable_t));
+        iconv_t converter, readstat_arena_t *arena) {
+    readstat_variable_t *variable = readstat_arena_variable(arena);
+    readstat_missingness_t missingness = spss_missingness_for_info(info);
+    char name[300] = "";
+    char format[256] = "";
+
+    if (variable == NULL)
+        return NULL;
 
     variable->index = info->index;
     variable->index_after_skipping = index_after_skipping;
@@ -161,19 +200,29 @@ readstat_variable_t *spss_init_variable_for_info(spss_varinfo_t *info, int index
     }
 
     if (info->longname[0]) {
-        readstat_convert(variable->name, sizeof(variable->name),
+        readstat_convert(name, sizeof(name),
                 info->longname, sizeof(info->longname), converter);
     } else {
-        readstat_convert(variable->name, sizeof(variable->name),
+        readstat_convert(name, sizeof(name),
                 info->name, sizeof(info->name), converter);
     }
-    if (info->label) {
-        snprintf(variable->label, sizeof(variable->label), "%s", info->label);
-    }
+    if ((variable->name = readstat_arena_intern(arena, name, sizeof(name))) == NULL)
+        return NULL;
+
+    /* Labels were truncated to this length when they were fixed-size */
+    if (info->label &&
+            (variable->label = readstat_arena_intern(arena, info->label, 1023)) == NULL)
+        return NULL;
 
-    spss_format(variable->format, sizeof(variable->format), &info->print_format);
+    spss_format(format, sizeof(format), &info->print_format);
+    if ((variable->format = readstat_arena_intern(arena, format, sizeof(format))) == NULL)
+        return NULL;
 
-    variable->missingness = spss_missingness_for_info(info);
+    if (missingness.missing_ranges_count) {
+        if ((variable->missingness = readstat_arena_calloc(arena, 1, sizeof(readstat_missingness_t))) == NULL)
+            return NULL;
+        *variable->missingness = missingness;
+    }
     variable->measure = info->measure;
     if (info->display_width) {
         variable->display_width = info->display_width;
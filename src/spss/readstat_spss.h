@@ -93,8 +93,10 @@ int spss_varinfo_compare(const void *elem1, const void *elem2);
 void spss_varinfo_free(spss_varinfo_t *info);
 
 readstat_missingness_t spss_missingness_for_info(spss_varinfo_t *info);
+// Sets is_defined_missing if the value matches the variable's missing values
+void spss_tag_defined_missing(readstat_value_t *value, const readstat_variable_t *variable);
 readstat_variable_t *spss_init_variable_for_info(spss_varinfo_t *info,
-        int index_after_skipping, iconv_t converter);
+        int index_after_skipping, iconv_t converter, struct readstat_arena_s *arena);
 
 uint64_t spss_64bit_value(readstat_value_t value);
 
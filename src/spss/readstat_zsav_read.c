@@ -5,6 +5,8 @@
 #include "../readstat_bits.h"
 #include "../readstat_iconv.h"
 #include "../readstat_malloc.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 #include "readstat_sav.h"
 #include "readstat_sav_compress.h"
 
@@ -31,6 +33,8 @@ struct ztrailer_entry {
 readstat_error_t zsav_read_compressed_data(sav_ctx_t *ctx,
         readstat_error_t (*row_handler)(unsigned char *, size_t, sav_ctx_t *)) {
     readstat_error_t retval = READSTAT_OK;
+    readstat_stats_session_t *session = readstat_stats_current();
+    readstat_stats_timer_t timer;
     readstat_io_t *io = ctx->io;
     readstat_off_t data_offset = 0;
 
@@ -138,8 +142,11 @@ readstat_error_t zsav_read_compressed_data(sav_ctx_t *ctx,
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
+        readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_DECOMPRESSION, 0);
         int status = uncompress(uncompressed_block, &uncompressed_block_len,
                 compressed_block, entry->compressed_size);
+        readstat_stats_timer_stop(&timer);
+        ctx->stats->pages_processed++;
         if (status != Z_OK || uncompressed_block_len != entry->uncompressed_size) {
             retval = READSTAT_ERROR_PARSE;
             goto cleanup;
@@ -156,7 +163,10 @@ readstat_error_t zsav_read_compressed_data(sav_ctx_t *ctx,
             state.next_out = &uncompressed_row[uncompressed_offset];
             state.avail_out = uncompressed_row_len - uncompressed_offset;
 
+            readstat_stats_timer_start(&timer, session, READSTAT_STATS_TIMER_DECOMPRESSION, 1);
             sav_decompress_row(&state);
+            readstat_stats_timer_stop(&timer);
+            ctx->stats->bytes_decompressed += uncompressed_row_len - uncompressed_offset - state.avail_out;
 
             uncompressed_offset = uncompressed_row_len - state.avail_out;
             data_offset = uncompressed_block_len - state.avail_in;
@@ -178,13 +188,13 @@ readstat_error_t zsav_read_compressed_data(sav_ctx_t *ctx,
 
 cleanup:
     if (uncompressed_row)
-        free(uncompressed_row);
+        readstat_free(uncompressed_row);
     if (ztrailer_entries)
-        free(ztrailer_entries);
+        readstat_free(ztrailer_entries);
     if (compressed_block)
-        free(compressed_block);
+        readstat_free(compressed_block);
     if (uncompressed_block)
-        free(uncompressed_block);
+        readstat_free(uncompressed_block);
 
     return retval;
 }
@@ -7,6 +7,8 @@
 #include "../readstat.h"
 #include "../readstat_iconv.h"
 #include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_dictionary.h"
 #include "../readstat_bits.h"
 
 #include "readstat_dta.h"
@@ -45,8 +47,14 @@ readstat_error_t dta_ctx_init(dta_ctx_t *ctx, uint32_t nvar, uint64_t nobs,
     ctx->nvar = nvar;
     ctx->nobs = nobs;
 
+    /* A context from dta_ctx_reset() comes with its arena */
+    if (ctx->arena == NULL && (ctx->arena = readstat_arena_init()) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
+
     if (ctx->nvar) {
-        if ((ctx->variables = readstat_calloc(ctx->nvar, sizeof(readstat_variable_t *))) == NULL) {
+        if ((ctx->variables = readstat_arena_calloc(ctx->arena, ctx->nvar, sizeof(readstat_variable_t *))) == NULL) {
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
@@ -157,11 +165,15 @@ readstat_error_t dta_ctx_init(dta_ctx_t *ctx, uint32_t nvar, uint64_t nobs,
 
     if (output_encoding) {
         if (input_encoding) {
-            ctx->converter = iconv_open(output_encoding, input_encoding);
+            ctx->input_encoding = input_encoding;
         } else if (ds_format < 118) {
-            ctx->converter = iconv_open(output_encoding, "WINDOWS-1252");
+            ctx->input_encoding = "WINDOWS-1252";
         } else if (strcmp(output_encoding, "UTF-8") != 0) {
-            ctx->converter = iconv_open(output_encoding, "UTF-8");
+            ctx->input_encoding = "UTF-8";
+        }
+        ctx->output_encoding = output_encoding;
+        if (ctx->input_encoding) {
+            ctx->converter = iconv_open(ctx->output_encoding, ctx->input_encoding);
         }
         if (ctx->converter == (iconv_t)-1) {
             ctx->converter = NULL;
@@ -176,7 +188,7 @@ readstat_error_t dta_ctx_init(dta_ctx_t *ctx, uint32_t nvar, uint64_t nobs,
         ctx->srtlist_len = (ctx->nvar + 1) * sizeof(int32_t);
     }
 
-    if ((ctx->srtlist = readstat_malloc(ctx->srtlist_len)) == NULL) {
+    if ((ctx->srtlist = readstat_arena_alloc(ctx->arena, ctx->srtlist_len)) == NULL) {
         retval = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -188,23 +200,23 @@ readstat_error_t dta_ctx_init(dta_ctx_t *ctx, uint32_t nvar, uint64_t nobs,
         ctx->lbllist_len = ctx->lbllist_entry_len * ctx->nvar * sizeof(char);
         ctx->variable_labels_len = ctx->variable_labels_entry_len * ctx->nvar * sizeof(char);
 
-        if ((ctx->typlist = readstat_malloc(ctx->typlist_len)) == NULL) {
+        if ((ctx->typlist = readstat_arena_alloc(ctx->arena, ctx->typlist_len)) == NULL) {
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
-        if ((ctx->varlist = readstat_malloc(ctx->varlist_len)) == NULL) {
+        if ((ctx->varlist = readstat_arena_alloc(ctx->arena, ctx->varlist_len)) == NULL) {
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
-        if ((ctx->fmtlist = readstat_malloc(ctx->fmtlist_len)) == NULL) {
+        if ((ctx->fmtlist = readstat_arena_alloc(ctx->arena, ctx->fmtlist_len)) == NULL) {
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
-        if ((ctx->lbllist = readstat_malloc(ctx->lbllist_len)) == NULL) {
+        if ((ctx->lbllist = readstat_arena_alloc(ctx->arena, ctx->lbllist_len)) == NULL) {
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
-        if ((ctx->variable_labels = readstat_malloc(ctx->variable_labels_len)) == NULL) {
+        if ((ctx->variable_labels = readstat_arena_alloc(ctx->arena, ctx->variable_labels_len)) == NULL) {
             retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
@@ -216,38 +228,43 @@ cleanup:
     return retval;
 }
 
-void dta_ctx_free(dta_ctx_t *ctx) {
-    if (ctx->typlist)
-        free(ctx->typlist);
-    if (ctx->varlist)
-        free(ctx->varlist);
-    if (ctx->srtlist)
-        free(ctx->srtlist);
-    if (ctx->fmtlist)
-        free(ctx->fmtlist);
-    if (ctx->lbllist)
-        free(ctx->lbllist);
-    if (ctx->variable_labels)
-        free(ctx->variable_labels);
+/* Everything but the arena, and what's allocated from it */
+static void dta_ctx_release(dta_ctx_t *ctx) {
+    int i;
     if (ctx->converter)
         iconv_close(ctx->converter);
+    if (ctx->dictionary)
+        readstat_string_dictionary_free(ctx->dictionary);
     if (ctx->data_label)
-        free(ctx->data_label);
-    if (ctx->variables) {
-        int i;
-        for (i=0; i<ctx->nvar; i++) {
-            if (ctx->variables[i])
-                free(ctx->variables[i]);
-        }
-        free(ctx->variables);
+        readstat_free(ctx->data_label);
+    for (i=0; i<DTA_STRL_INDEX_PARTS; i++) {
+        if (ctx->strls[i].strls)
+            readstat_free(ctx->strls[i].strls);
     }
-    if (ctx->strls) {
-        int i;
-        for (i=0; i<ctx->strls_count; i++) {
-            free(ctx->strls[i]);
-        }
-        free(ctx->strls);
+    while (ctx->strls_cache_head) {
+        dta_strl_cache_entry_t *entry = ctx->strls_cache_head;
+        ctx->strls_cache_head = entry->next;
+        readstat_free(entry);
     }
+    if (ctx->strl_buf)
+        readstat_free(ctx->strl_buf);
+}
+
+void dta_ctx_reset(dta_ctx_t *ctx) {
+    readstat_arena_t *arena = ctx->arena;
+
+    dta_ctx_release(ctx);
+    memset(ctx, 0, sizeof(dta_ctx_t));
+
+    if (arena)
+        readstat_arena_reset(arena);
+    ctx->arena = arena;
+}
+
+void dta_ctx_free(dta_ctx_t *ctx) {
+    dta_ctx_release(ctx);
+    if (ctx->arena)
+        readstat_arena_free(ctx->arena);
     free(ctx);
 }
 
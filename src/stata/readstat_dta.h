@@ -1,3 +1,5 @@
+#include "../readstat_progress.h"
+
 #pragma pack(push, 1)
 
 // DTA files
@@ -36,14 +38,34 @@ typedef struct dta_118_strl_header_s {
 
 #pragma pack(pop)
 
+// The GSO headers are kept for the whole parse. The first
+// DTA_STRL_PRELOAD_LEN bytes of payloads are read along with them; the rest
+// are read as rows refer to them, and kept in a cache of at most
+// DTA_STRL_CACHE_LEN bytes, least recently used out.
 typedef struct dta_strl_s {
-    uint16_t        v;
     uint64_t        o;
-    unsigned char   type;
-    size_t          len;
-    char            data[1]; // Flexible array; use [1] for C++98 compatibility
+    readstat_off_t  data_offset;
+    const char     *data; // Right after the struct if preloaded
+    uint32_t        v;
+    uint32_t        len;
 } dta_strl_t;
 
+#define DTA_STRL_INDEX_PARTS    64
+
+// Open addressing on (v, o), split up so that no one array gets too big
+typedef struct dta_strl_index_s {
+    dta_strl_t    **strls;
+    size_t          count;
+    size_t          capacity;
+} dta_strl_index_t;
+
+typedef struct dta_strl_cache_entry_s {
+    dta_strl_t                    *strl;
+    struct dta_strl_cache_entry_s *prev;
+    struct dta_strl_cache_entry_s *next;
+    char                           data[1]; // Flexible array; use [1] for C++98 compatibility
+} dta_strl_cache_entry_t;
+
 typedef struct dta_ctx_s {
     char          *data_label;
     size_t         data_label_len;
@@ -101,15 +123,28 @@ typedef struct dta_ctx_s {
     int32_t        max_float;
     int64_t        max_double;
 
-    dta_strl_t   **strls;
-    size_t         strls_count;
-    size_t         strls_capacity;
+    dta_strl_index_t strls[DTA_STRL_INDEX_PARTS];
+    size_t         strls_preloaded_len;
+    dta_strl_cache_entry_t *strls_cache_head;
+    dta_strl_cache_entry_t *strls_cache_tail;
+    size_t         strls_cached_len;
+    char          *strl_buf;
+    size_t         strl_buf_len;
+    struct readstat_prefetch_s *prefetch;
 
     readstat_variable_t  **variables;
+    struct readstat_arena_s *arena;
     readstat_endian_t    endianness;
 
     iconv_t              converter;
+    struct readstat_string_dictionary_s *dictionary;
+    const char          *input_encoding;
+    const char          *output_encoding;
+    int                  thread_count;
+    int                  prefetch_depth;
     readstat_callbacks_t handle;
+    readstat_progress_t  progress;
+    readstat_parser_stats_t *stats;
     size_t               file_size;
     void                *user_ctx;
     readstat_io_t       *io;
@@ -154,6 +189,14 @@ typedef struct dta_ctx_s {
 #define DTA_GSO_TYPE_BINARY        0x81
 #define DTA_GSO_TYPE_ASCII         0x82
 
+// Overridable so that tests can exercise the cache with small files
+#ifndef DTA_STRL_PRELOAD_LEN
+#define DTA_STRL_PRELOAD_LEN   0x4000000
+#endif
+#ifndef DTA_STRL_CACHE_LEN
+#define DTA_STRL_CACHE_LEN     0x1000000
+#endif
+
 #define DTA_117_TYPE_CODE_INT8     0xFFFA
 #define DTA_117_TYPE_CODE_INT16    0xFFF9
 #define DTA_117_TYPE_CODE_INT32    0xFFF8
@@ -179,5 +222,8 @@ readstat_error_t dta_ctx_init(dta_ctx_t *ctx, uint32_t nvar, uint64_t nobs,
         const char *input_encoding, const char *output_encoding);
 void dta_ctx_free(dta_ctx_t *ctx);
 
+/* Empties a context for dta_ctx_init(), keeping its arena */
+void dta_ctx_reset(dta_ctx_t *ctx);
+
 readstat_error_t dta_type_info(uint16_t typecode, dta_ctx_t *ctx,
         size_t *max_len, readstat_type_t *out_type);
@@ -1,5 +1,6 @@
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <math.h>
 #include <time.h>
 #include <stdint.h>
@@ -9,9 +10,17 @@
 
 #include "../readstat.h"
 #include "../readstat_bits.h"
+#include "../CKHashTable.h"
 #include "../readstat_iconv.h"
 #include "../readstat_convert.h"
 #include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+#include "../readstat_dictionary.h"
+#include "../readstat_parallel.h"
+#include "../readstat_prefetch.h"
+#include "../readstat_reuse.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 
 #include "readstat_dta.h"
 #include "readstat_dta_parse_timestamp.h"
@@ -26,52 +35,69 @@ static readstat_error_t dta_read_expansion_fields(dta_ctx_t *ctx);
 
 static readstat_error_t dta_update_progress(dta_ctx_t *ctx) {
     double progress = 0.0;
+    if (!ctx->handle.progress)
+        return READSTAT_OK;
+    if (ctx->current_row == ctx->row_limit)
+        readstat_progress_reset(&ctx->progress);
+    if (!readstat_progress_due(&ctx->progress, ctx->io))
+        return READSTAT_OK;
     if (ctx->row_limit > 0)
         progress = 1.0 * ctx->current_row / ctx->row_limit;
-    if (ctx->handle.progress && ctx->handle.progress(progress, ctx->user_ctx) != READSTAT_HANDLER_OK)
+    if (ctx->handle.progress(progress, ctx->user_ctx) != READSTAT_HANDLER_OK)
         return READSTAT_ERROR_USER_ABORT;
     return READSTAT_OK;
 }
 
 static readstat_variable_t *dta_init_variable(dta_ctx_t *ctx, int i, int index_after_skipping,
         readstat_type_t type, size_t max_len) {
-    readstat_variable_t *variable = calloc(1, sizeof(readstat_variable_t));
+    readstat_variable_t *variable = readstat_arena_variable(ctx->arena);
+    char name[300] = "";
+    char format[256] = "";
+    char label[1024] = "";
+
+    if (variable == NULL)
+        return NULL;
 
     variable->type = type;
     variable->index = i;
     variable->index_after_skipping = index_after_skipping;
     variable->storage_width = max_len;
 
-    readstat_convert(variable->name, sizeof(variable->name), 
+    readstat_convert(name, sizeof(name), 
             &ctx->varlist[ctx->variable_name_len*i],
             ctx->variable_name_len, ctx->converter);
 
     if (ctx->variable_labels[ctx->variable_labels_entry_len*i]) {
-        readstat_convert(variable->label, sizeof(variable->label),
+        readstat_convert(label, sizeof(label),
                 &ctx->variable_labels[ctx->variable_labels_entry_len*i],
                 ctx->variable_labels_entry_len, ctx->converter);
     }
 
     if (ctx->fmtlist[ctx->fmtlist_entry_len*i]) {
-        readstat_convert(variable->format, sizeof(variable->format),
+        readstat_convert(format, sizeof(format),
                 &ctx->fmtlist[ctx->fmtlist_entry_len*i],
                 ctx->fmtlist_entry_len, ctx->converter);
-        if (variable->format[0] == '%') {
-            if (variable->format[1] == '-') {
+        if (format[0] == '%') {
+            if (format[1] == '-') {
                 variable->alignment = READSTAT_ALIGNMENT_LEFT;
-            } else if (variable->format[1] == '~') {
+            } else if (format[1] == '~') {
                 variable->alignment = READSTAT_ALIGNMENT_CENTER;
             } else {
                 variable->alignment = READSTAT_ALIGNMENT_RIGHT;
             }
         }
         int display_width;
-        if (sscanf(variable->format, "%%%ds", &display_width) == 1 ||
-                sscanf(variable->format, "%%-%ds", &display_width) == 1) {
+        if (sscanf(format, "%%%ds", &display_width) == 1 ||
+                sscanf(format, "%%-%ds", &display_width) == 1) {
             variable->display_width = display_width;
         }
     }
 
+    if ((variable->name = readstat_arena_intern(ctx->arena, name, sizeof(name))) == NULL ||
+            (variable->format = readstat_arena_intern(ctx->arena, format, sizeof(format))) == NULL ||
+            (variable->label = readstat_arena_intern(ctx->arena, label, sizeof(label))) == NULL)
+        return NULL;
+
     return variable;
 }
 
@@ -170,7 +196,7 @@ static readstat_error_t dta_read_descriptors(dta_ctx_t *ctx) {
 
 cleanup:
     if (buffer)
-        free(buffer);
+        readstat_free(buffer);
 
     return retval;
 }
@@ -285,7 +311,7 @@ static readstat_error_t dta_read_expansion_fields(dta_ctx_t *ctx) {
 
 cleanup:
     if (buffer)
-        free(buffer);
+        readstat_free(buffer);
 
     return retval;
 }
@@ -309,15 +335,6 @@ cleanup:
     return retval;
 }
 
-static int dta_compare_strls(const void *elem1, const void *elem2) {
-    const dta_strl_t *key = (const dta_strl_t *)elem1;
-    const dta_strl_t *target = *(const dta_strl_t **)elem2;
-    if (key->v == target->v)
-        return key->o - target->o;
-
-    return key->v - target->v;
-}
-
 static dta_strl_t dta_interpret_strl_vo_bytes(dta_ctx_t *ctx, const unsigned char *vo_bytes) {
     dta_strl_t strl = {0};
 
@@ -350,7 +367,7 @@ static dta_strl_t dta_interpret_strl_vo_bytes(dta_ctx_t *ctx, const unsigned cha
     return strl;
 }
 
-static readstat_error_t dta_117_read_strl(dta_ctx_t *ctx, dta_strl_t *strl) {
+static readstat_error_t dta_117_read_strl(dta_ctx_t *ctx, dta_strl_t *strl, unsigned char *out_type) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = ctx->io;
     dta_117_strl_header_t header;
@@ -362,14 +379,14 @@ static readstat_error_t dta_117_read_strl(dta_ctx_t *ctx, dta_strl_t *strl) {
 
     strl->v = ctx->bswap ? byteswap4(header.v) : header.v;
     strl->o = ctx->bswap ? byteswap4(header.o) : header.o;
-    strl->type = header.type;
+    *out_type = header.type;
     strl->len = ctx->bswap ? byteswap4(header.len) : header.len;
 
 cleanup:
     return retval;
 }
 
-static readstat_error_t dta_118_read_strl(dta_ctx_t *ctx, dta_strl_t *strl) {
+static readstat_error_t dta_118_read_strl(dta_ctx_t *ctx, dta_strl_t *strl, unsigned char *out_type) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = ctx->io;
     dta_118_strl_header_t header;
@@ -381,18 +398,255 @@ static readstat_error_t dta_118_read_strl(dta_ctx_t *ctx, dta_strl_t *strl) {
 
     strl->v = ctx->bswap ? byteswap4(header.v) : header.v;
     strl->o = ctx->bswap ? byteswap8(header.o) : header.o;
-    strl->type = header.type;
+    *out_type = header.type;
     strl->len = ctx->bswap ? byteswap4(header.len) : header.len;
 
 cleanup:
     return retval;
 }
 
-static readstat_error_t dta_read_strl(dta_ctx_t *ctx, dta_strl_t *strl) {
+static readstat_error_t dta_read_strl(dta_ctx_t *ctx, dta_strl_t *strl, unsigned char *out_type) {
     if (ctx->strl_o_len > 4) {
-        return dta_118_read_strl(ctx, strl);
+        return dta_118_read_strl(ctx, strl, out_type);
+    }
+    return dta_117_read_strl(ctx, strl, out_type);
+}
+
+static uint64_t dta_strl_hash(uint32_t v, uint64_t o) {
+    char key[sizeof(uint32_t) + sizeof(uint64_t)];
+    memcpy(&key[0], &v, sizeof(uint32_t));
+    memcpy(&key[sizeof(uint32_t)], &o, sizeof(uint64_t));
+    return ck_hash_bytes(key, sizeof(key));
+}
+
+/* The high bits of the hash pick the part, the low bits the slot */
+static dta_strl_index_t *dta_strl_index(dta_ctx_t *ctx, uint64_t hash) {
+    return &ctx->strls[(hash >> 32) % DTA_STRL_INDEX_PARTS];
+}
+
+static dta_strl_t **dta_strl_slot(dta_strl_t **strls, size_t capacity,
+        uint64_t hash, uint32_t v, uint64_t o) {
+    size_t mask = capacity - 1;
+    size_t slot = hash & mask;
+
+    while (strls[slot] && (strls[slot]->v != v || strls[slot]->o != o))
+        slot = (slot + 1) & mask;
+
+    return &strls[slot];
+}
+
+static readstat_error_t dta_index_strl(dta_ctx_t *ctx, dta_strl_t *strl) {
+    readstat_error_t retval = READSTAT_OK;
+    uint64_t hash = dta_strl_hash(strl->v, strl->o);
+    dta_strl_index_t *index = dta_strl_index(ctx, hash);
+    dta_strl_t **slot = NULL;
+
+    if (4 * (index->count + 1) > 3 * index->capacity) {
+        size_t capacity = index->capacity ? 2 * index->capacity : 16;
+        dta_strl_t **strls = NULL;
+        size_t i;
+        if ((strls = readstat_calloc(capacity, sizeof(dta_strl_t *))) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
+        for (i=0; i<index->capacity; i++) {
+            dta_strl_t *old = index->strls[i];
+            if (old)
+                *dta_strl_slot(strls, capacity, dta_strl_hash(old->v, old->o), old->v, old->o) = old;
+        }
+        readstat_free(index->strls);
+        index->strls = strls;
+        index->capacity = capacity;
+    }
+
+    slot = dta_strl_slot(index->strls, index->capacity, hash, strl->v, strl->o);
+    if (*slot == NULL)
+        index->count++;
+    *slot = strl;
+
+cleanup:
+    return retval;
+}
+
+static dta_strl_t *dta_lookup_strl(dta_ctx_t *ctx, uint32_t v, uint64_t o) {
+    uint64_t hash = dta_strl_hash(v, o);
+    dta_strl_index_t *index = dta_strl_index(ctx, hash);
+
+    if (index->count == 0)
+        return NULL;
+
+    return *dta_strl_slot(index->strls, index->capacity, hash, v, o);
+}
+
+static void dta_strl_cache_unlink(dta_ctx_t *ctx, dta_strl_cache_entry_t *entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        ctx->strls_cache_head = entry->next;
     }
-    return dta_117_read_strl(ctx, strl);
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        ctx->strls_cache_tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void dta_strl_cache_push(dta_ctx_t *ctx, dta_strl_cache_entry_t *entry) {
+    entry->prev = NULL;
+    entry->next = ctx->strls_cache_head;
+    if (ctx->strls_cache_head) {
+        ctx->strls_cache_head->prev = entry;
+    } else {
+        ctx->strls_cache_tail = entry;
+    }
+    ctx->strls_cache_head = entry;
+}
+
+static int dta_strl_is_cached(const dta_strl_t *strl) {
+    return strl->data && strl->data != (const char *)&strl[1];
+}
+
+static dta_strl_cache_entry_t *dta_strl_cache_entry(dta_strl_t *strl) {
+    return (dta_strl_cache_entry_t *)(strl->data - offsetof(dta_strl_cache_entry_t, data));
+}
+
+/* Reads the payload at the current position into the space after `strl',
+ * for good */
+static readstat_error_t dta_preload_strl(dta_ctx_t *ctx, dta_strl_t *strl) {
+    readstat_error_t retval = READSTAT_OK;
+    readstat_io_t *io = ctx->io;
+    char *data = (char *)&strl[1];
+
+    if (io->read(data, strl->len, io->io_ctx) != strl->len) {
+        retval = READSTAT_ERROR_READ;
+        goto cleanup;
+    }
+    data[strl->len] = '\0';
+
+    strl->data = data;
+    ctx->strls_preloaded_len += strl->len;
+
+cleanup:
+    return retval;
+}
+
+/* Reads the payload at the current position of `io' into the cache */
+static readstat_error_t dta_cache_strl(dta_ctx_t *ctx, readstat_io_t *io, dta_strl_t *strl) {
+    readstat_error_t retval = READSTAT_OK;
+    dta_strl_cache_entry_t *entry = NULL;
+
+    while (ctx->strls_cache_tail && strl->len > DTA_STRL_CACHE_LEN - ctx->strls_cached_len) {
+        dta_strl_cache_entry_t *evicted = ctx->strls_cache_tail;
+        dta_strl_cache_unlink(ctx, evicted);
+        ctx->strls_cached_len -= evicted->strl->len;
+        evicted->strl->data = NULL;
+        readstat_free(evicted);
+    }
+
+    if ((entry = readstat_malloc(sizeof(dta_strl_cache_entry_t) + strl->len)) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
+    if (io->read(entry->data, strl->len, io->io_ctx) != strl->len) {
+        retval = READSTAT_ERROR_READ;
+        goto cleanup;
+    }
+    entry->data[strl->len] = '\0';
+    entry->strl = strl;
+
+    strl->data = entry->data;
+    ctx->strls_cached_len += strl->len;
+    dta_strl_cache_push(ctx, entry);
+    entry = NULL;
+
+cleanup:
+    if (entry)
+        readstat_free(entry);
+
+    return retval;
+}
+
+/* Uncached payloads are read from the strls section and the data section
+ * picked up where it left off. With read-ahead on, they're read around it:
+ * the thread is paused at the first miss and carries on from where it was at
+ * the next read of row data, so a batch of misses costs one pause. Ones too
+ * big to cache go in ctx->strl_buf, which is good until the next call. */
+static readstat_error_t dta_strl_data(dta_ctx_t *ctx, dta_strl_t *strl, const char **out_data) {
+    readstat_error_t retval = READSTAT_OK;
+    readstat_io_t *io = ctx->io;
+    readstat_off_t position = -1;
+
+    if (strl->data) {
+        if (dta_strl_is_cached(strl)) {
+            dta_strl_cache_entry_t *entry = dta_strl_cache_entry(strl);
+            if (entry != ctx->strls_cache_head) {
+                dta_strl_cache_unlink(ctx, entry);
+                dta_strl_cache_push(ctx, entry);
+            }
+        }
+        *out_data = strl->data;
+        goto cleanup;
+    }
+
+    if (ctx->prefetch) {
+        io = readstat_prefetch_pause(ctx->prefetch);
+    } else if ((position = io->seek(0, READSTAT_SEEK_CUR, io->io_ctx)) == -1) {
+        retval = READSTAT_ERROR_SEEK;
+        goto cleanup;
+    }
+
+    if (io->seek(strl->data_offset, READSTAT_SEEK_SET, io->io_ctx) == -1) {
+        retval = READSTAT_ERROR_SEEK;
+        goto cleanup;
+    }
+
+    if (strl->len <= DTA_STRL_CACHE_LEN) {
+        if ((retval = dta_cache_strl(ctx, io, strl)) != READSTAT_OK)
+            goto cleanup;
+        *out_data = strl->data;
+    } else {
+        if ((size_t)strl->len + 1 > ctx->strl_buf_len) {
+            readstat_free(ctx->strl_buf);
+            ctx->strl_buf_len = 0;
+            if ((ctx->strl_buf = readstat_malloc((size_t)strl->len + 1)) == NULL) {
+                retval = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
+            ctx->strl_buf_len = (size_t)strl->len + 1;
+        }
+        if (io->read(ctx->strl_buf, strl->len, io->io_ctx) != strl->len) {
+            retval = READSTAT_ERROR_READ;
+            goto cleanup;
+        }
+        ctx->strl_buf[strl->len] = '\0';
+        *out_data = ctx->strl_buf;
+    }
+
+    if (position != -1 && io->seek(position, READSTAT_SEEK_SET, io->io_ctx) == -1) {
+        retval = READSTAT_ERROR_SEEK;
+        goto cleanup;
+    }
+
+cleanup:
+    return retval;
+}
+
+static readstat_error_t dta_decode_strl(dta_ctx_t *ctx, const unsigned char *vo_bytes,
+        readstat_value_t *out_value) {
+    readstat_value_t value = { .type = READSTAT_TYPE_STRING };
+    readstat_error_t retval = READSTAT_OK;
+    dta_strl_t key = dta_interpret_strl_vo_bytes(ctx, vo_bytes);
+    dta_strl_t *strl = NULL;
+
+    if ((strl = dta_lookup_strl(ctx, key.v, key.o))) {
+        retval = dta_strl_data(ctx, strl, &value.v.string_value);
+    }
+
+    *out_value = value;
+
+    return retval;
 }
 
 static readstat_error_t dta_read_strls(dta_ctx_t *ctx) {
@@ -416,9 +670,6 @@ static readstat_error_t dta_read_strls(dta_ctx_t *ctx) {
     if (retval != READSTAT_OK)
         goto cleanup;
 
-    ctx->strls_capacity = 100;
-    ctx->strls = readstat_malloc(ctx->strls_capacity * sizeof(dta_strl_t *));
-
     while (1) {
         char tag[3];
         if (io->read(tag, sizeof(tag), io->io_ctx) != sizeof(tag)) {
@@ -427,33 +678,44 @@ static readstat_error_t dta_read_strls(dta_ctx_t *ctx) {
         }
 
         if (memcmp(tag, "GSO", sizeof(tag)) == 0) {
-            dta_strl_t strl;
-            retval = dta_read_strl(ctx, &strl);
+            dta_strl_t strl = { 0 };
+            unsigned char type = 0;
+            retval = dta_read_strl(ctx, &strl, &type);
             if (retval != READSTAT_OK)
                 goto cleanup;
 
-            if (strl.type != DTA_GSO_TYPE_ASCII)
-                continue;
+            if ((strl.data_offset = io->seek(0, READSTAT_SEEK_CUR, io->io_ctx)) == -1) {
+                retval = READSTAT_ERROR_SEEK;
+                goto cleanup;
+            }
 
-            if (ctx->strls_count == ctx->strls_capacity) {
-                ctx->strls_capacity *= 2;
-                if ((ctx->strls = readstat_realloc(ctx->strls, sizeof(dta_strl_t *) * ctx->strls_capacity)) == NULL) {
-                    retval = READSTAT_ERROR_MALLOC;
+            if (type != DTA_GSO_TYPE_ASCII) {
+                if (io->seek(strl.len, READSTAT_SEEK_CUR, io->io_ctx) == -1) {
+                    retval = READSTAT_ERROR_SEEK;
                     goto cleanup;
                 }
+                continue;
             }
 
-            dta_strl_t *strl_ptr = readstat_malloc(sizeof(dta_strl_t) + strl.len);
+            /* Past the preload budget, the payload is read when (and if) a
+             * row refers to it */
+            int preload = (strl.len <= DTA_STRL_PRELOAD_LEN - ctx->strls_preloaded_len);
+            dta_strl_t *strl_ptr = readstat_arena_alloc(ctx->arena,
+                    sizeof(dta_strl_t) + (preload ? (size_t)strl.len + 1 : 0));
             if (strl_ptr == NULL) {
                 retval = READSTAT_ERROR_MALLOC;
                 goto cleanup;
             }
             memcpy(strl_ptr, &strl, sizeof(dta_strl_t));
 
-            ctx->strls[ctx->strls_count++] = strl_ptr;
+            if ((retval = dta_index_strl(ctx, strl_ptr)) != READSTAT_OK)
+                goto cleanup;
 
-            if (io->read(&strl_ptr->data[0], strl_ptr->len, io->io_ctx) != strl_ptr->len) {
-                retval = READSTAT_ERROR_READ;
+            if (preload) {
+                if ((retval = dta_preload_strl(ctx, strl_ptr)) != READSTAT_OK)
+                    goto cleanup;
+            } else if (io->seek(strl.len, READSTAT_SEEK_CUR, io->io_ctx) == -1) {
+                retval = READSTAT_ERROR_SEEK;
                 goto cleanup;
             }
         } else if (memcmp(tag, "</s", sizeof(tag)) == 0) {
@@ -583,6 +845,78 @@ static readstat_value_t dta_interpret_double_bytes(dta_ctx_t *ctx, const void *b
     return value;
 }
 
+static readstat_error_t dta_decode_value(dta_ctx_t *ctx, const unsigned char *buf,
+        readstat_type_t type, size_t max_len, char *str_buf, size_t str_buf_len,
+        iconv_t converter, readstat_value_t *out_value) {
+    readstat_value_t value = { .type = type };
+    readstat_error_t retval = READSTAT_OK;
+
+    if (type == READSTAT_TYPE_STRING) {
+        size_t str_len = 0;
+        while (str_len < max_len && buf[str_len] != '\0') {
+            str_len++;
+        }
+        retval = readstat_convert(str_buf, str_buf_len, (const char *)buf, str_len, converter);
+        if (retval != READSTAT_OK)
+            goto cleanup;
+        value.v.string_value = str_buf;
+    } else if (type == READSTAT_TYPE_STRING_REF) {
+        retval = dta_decode_strl(ctx, buf, &value);
+    } else if (type == READSTAT_TYPE_INT8) {
+        value = dta_interpret_int8_bytes(ctx, buf);
+    } else if (type == READSTAT_TYPE_INT16) {
+        value = dta_interpret_int16_bytes(ctx, buf);
+    } else if (type == READSTAT_TYPE_INT32) {
+        value = dta_interpret_int32_bytes(ctx, buf);
+    } else if (type == READSTAT_TYPE_FLOAT) {
+        value = dta_interpret_float_bytes(ctx, buf);
+    } else if (type == READSTAT_TYPE_DOUBLE) {
+        value = dta_interpret_double_bytes(ctx, buf);
+    }
+
+    *out_value = value;
+
+cleanup:
+    return retval;
+}
+
+static readstat_error_t dta_decode_dictionary_string(dta_ctx_t *ctx, const unsigned char *buf,
+        size_t max_len, readstat_variable_t *variable, char *str_buf, size_t str_buf_len,
+        readstat_value_t *out_value) {
+    readstat_value_t value = { .type = READSTAT_TYPE_STRING };
+    readstat_error_t retval = READSTAT_OK;
+    size_t str_len = 0;
+    while (str_len < max_len && buf[str_len] != '\0') {
+        str_len++;
+    }
+    retval = readstat_string_dictionary_convert(ctx->dictionary, variable,
+            (const char *)buf, str_len, ctx->converter, str_buf, str_buf_len, &value);
+    if (retval == READSTAT_OK)
+        *out_value = value;
+    return retval;
+}
+
+static readstat_error_t dta_handle_string_view(dta_ctx_t *ctx, const unsigned char *buf,
+        size_t max_len, readstat_variable_t *variable, char *str_buf, size_t str_buf_len) {
+    readstat_error_t retval = READSTAT_OK;
+    const char *string = NULL;
+    size_t len = 0;
+    retval = readstat_convert_view(str_buf, str_buf_len, (const char *)buf, max_len,
+            ctx->converter, &string, &len);
+    if (retval != READSTAT_OK)
+        return retval;
+
+    if (ctx->handle.string_view(ctx->current_row, variable, string, len, ctx->user_ctx) != READSTAT_HANDLER_OK)
+        return READSTAT_ERROR_USER_ABORT;
+
+    return READSTAT_OK;
+}
+
+/* Fixed-width strings that dta_handle_rows_parallel hands out itself */
+static int dta_strings_in_row_order(dta_ctx_t *ctx) {
+    return ctx->dictionary || ctx->handle.string_view;
+}
+
 static readstat_error_t dta_handle_row(const unsigned char *buf, dta_ctx_t *ctx) {
     char  str_buf[2048];
     int j;
@@ -590,9 +924,10 @@ static readstat_error_t dta_handle_row(const unsigned char *buf, dta_ctx_t *ctx)
     readstat_error_t retval = READSTAT_OK;
     for (j=0; j<ctx->nvar; j++) {
         size_t max_len;
+        readstat_type_t type;
         readstat_value_t value = { { 0 } };
 
-        retval = dta_type_info(ctx->typlist[j], ctx, &max_len, &value.type);
+        retval = dta_type_info(ctx->typlist[j], ctx, &max_len, &type);
         if (retval != READSTAT_OK)
             goto cleanup;
 
@@ -606,35 +941,24 @@ static readstat_error_t dta_handle_row(const unsigned char *buf, dta_ctx_t *ctx)
             goto cleanup;
         }
 
-        if (value.type == READSTAT_TYPE_STRING) {
-            size_t str_len = 0;
-            while (str_len < max_len && buf[offset + str_len] != '\0') {
-                str_len++;
-            }
-            retval = readstat_convert(str_buf, sizeof(str_buf),
-                    (const char *)&buf[offset], str_len, ctx->converter);
+        if (type == READSTAT_TYPE_STRING && ctx->handle.string_view) {
+            retval = dta_handle_string_view(ctx, &buf[offset], max_len, ctx->variables[j],
+                    str_buf, sizeof(str_buf));
             if (retval != READSTAT_OK)
                 goto cleanup;
-            value.v.string_value = str_buf;
-        } else if (value.type == READSTAT_TYPE_STRING_REF) {
-            dta_strl_t key = dta_interpret_strl_vo_bytes(ctx, &buf[offset]);
-            dta_strl_t **found = bsearch(&key, ctx->strls, ctx->strls_count, sizeof(dta_strl_t *), &dta_compare_strls);
+            offset += max_len;
+            continue;
+        }
 
-            if (found) {
-                value.v.string_value = (*found)->data;
-            }
-            value.type = READSTAT_TYPE_STRING;
-        } else if (value.type == READSTAT_TYPE_INT8) {
-            value = dta_interpret_int8_bytes(ctx, &buf[offset]);
-        } else if (value.type == READSTAT_TYPE_INT16) {
-            value = dta_interpret_int16_bytes(ctx, &buf[offset]);
-        } else if (value.type == READSTAT_TYPE_INT32) {
-            value = dta_interpret_int32_bytes(ctx, &buf[offset]);
-        } else if (value.type == READSTAT_TYPE_FLOAT) {
-            value = dta_interpret_float_bytes(ctx, &buf[offset]);
-        } else if (value.type == READSTAT_TYPE_DOUBLE) {
-            value = dta_interpret_double_bytes(ctx, &buf[offset]);
+        if (type == READSTAT_TYPE_STRING && ctx->dictionary) {
+            retval = dta_decode_dictionary_string(ctx, &buf[offset], max_len, ctx->variables[j],
+                    str_buf, sizeof(str_buf), &value);
+        } else {
+            retval = dta_decode_value(ctx, &buf[offset], type, max_len,
+                    str_buf, sizeof(str_buf), ctx->converter, &value);
         }
+        if (retval != READSTAT_OK)
+            goto cleanup;
 
         if (ctx->handle.value(ctx->current_row, ctx->variables[j], value, ctx->user_ctx) != READSTAT_HANDLER_OK) {
             retval = READSTAT_ERROR_USER_ABORT;
@@ -647,36 +971,252 @@ cleanup:
     return retval;
 }
 
-static readstat_error_t dta_handle_rows(dta_ctx_t *ctx) {
+typedef struct dta_column_s {
+    readstat_type_t  type;
+    size_t           offset;
+    size_t           max_len;
+    size_t           string_offset;
+    size_t           string_len;
+} dta_column_t;
+
+typedef struct dta_parallel_ctx_s {
+    dta_ctx_t              *ctx;
+    dta_column_t           *columns;
+    const unsigned char    *buf;
+    readstat_value_batch_t *batch;
+    iconv_t                *converters;
+} dta_parallel_ctx_t;
+
+static readstat_error_t dta_decode_rows(void *job_ctx, int worker,
+        long start, long end, long *out_failed_index) {
+    dta_parallel_ctx_t *pctx = (dta_parallel_ctx_t *)job_ctx;
+    dta_ctx_t *ctx = pctx->ctx;
+    readstat_error_t retval = READSTAT_OK;
+    long i;
+    int j;
+
+    for (i=start; i<end; i++) {
+        const unsigned char *buf = &pctx->buf[i * ctx->record_len];
+        readstat_value_t *values = readstat_value_batch_row(pctx->batch, i);
+        char *strings = readstat_value_batch_strings(pctx->batch, i);
+
+        for (j=0; j<ctx->nvar; j++) {
+            dta_column_t *column = &pctx->columns[j];
+            /* Resolved in row order by dta_handle_rows_parallel, which
+             * owns the strL cache and the string dictionary */
+            if (ctx->variables[j]->skip || column->type == READSTAT_TYPE_STRING_REF ||
+                    (column->type == READSTAT_TYPE_STRING && dta_strings_in_row_order(ctx)))
+                continue;
+
+            retval = dta_decode_value(ctx, &buf[column->offset], column->type, column->max_len,
+                    &strings[column->string_offset], column->string_len,
+                    pctx->converters[worker], &values[j]);
+            if (retval != READSTAT_OK) {
+                pctx->batch->value_counts[i] = j;
+                *out_failed_index = i;
+                goto cleanup;
+            }
+        }
+        pctx->batch->value_counts[i] = ctx->nvar;
+    }
+
+cleanup:
+    return retval;
+}
+
+/* Reads and decodes rows a chunk at a time on ctx->thread_count threads,
+ * then hands the values to the value handler in row order. Sets *out_handled
+ * to 0 without consuming any input if the layout can't be batched. */
+static readstat_error_t dta_handle_rows_parallel(dta_ctx_t *ctx, int *out_handled) {
     readstat_io_t *io = ctx->io;
+    dta_parallel_ctx_t pctx = { .ctx = ctx };
     unsigned char *buf = NULL;
-    int i;
+    size_t string_len = 0;
+    size_t offset = 0;
+    long rows_done = 0;
+    int i, j;
     readstat_error_t retval = READSTAT_OK;
 
-    if (ctx->record_len && (buf = readstat_malloc(ctx->record_len)) == NULL) {
+    *out_handled = 0;
+
+    if (ctx->nvar == 0 || ctx->row_limit <= 1)
+        goto cleanup;
+
+    if ((pctx.columns = readstat_calloc(ctx->nvar, sizeof(dta_column_t))) == NULL) {
         retval = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
 
-    if (ctx->row_offset) {
-        if (io->seek(ctx->record_len * ctx->row_offset, READSTAT_SEEK_CUR, io->io_ctx) == -1) {
-            retval = READSTAT_ERROR_SEEK;
+    for (j=0; j<ctx->nvar; j++) {
+        dta_column_t *column = &pctx.columns[j];
+        if ((retval = dta_type_info(ctx->typlist[j], ctx, &column->max_len, &column->type)) != READSTAT_OK)
             goto cleanup;
+
+        if (offset + column->max_len > ctx->record_len) {
+            /* Leave the error to the row-at-a-time path */
+            goto cleanup;
+        }
+
+        column->offset = offset;
+        if (column->type == READSTAT_TYPE_STRING && !ctx->variables[j]->skip) {
+            /* Same ceiling as the 2048-byte buffer used by dta_handle_row */
+            column->string_len = 4 * column->max_len + 1;
+            if (column->string_len > 2048)
+                column->string_len = 2048;
+            column->string_offset = string_len;
+            string_len += column->string_len;
         }
+        offset += column->max_len;
     }
 
-    for (i=0; i<ctx->row_limit; i++) {
-        if (io->read(buf, ctx->record_len, io->io_ctx) != ctx->record_len) {
+    if ((pctx.batch = readstat_value_batch_init(ctx->nvar, string_len,
+                    ctx->record_len, ctx->row_limit)) == NULL)
+        goto cleanup;
+
+    if ((buf = readstat_malloc(pctx.batch->row_capacity * ctx->record_len)) == NULL)
+        goto cleanup;
+
+    if ((retval = readstat_parallel_converters_init(&pctx.converters, ctx->thread_count,
+                    ctx->converter, ctx->output_encoding, ctx->input_encoding)) != READSTAT_OK)
+        goto cleanup;
+
+    pctx.buf = buf;
+    *out_handled = 1;
+
+    while (rows_done < ctx->row_limit) {
+        long row_count = ctx->row_limit - rows_done;
+        long rows_read = 0;
+        long failed_index = -1;
+        readstat_error_t decode_retval = READSTAT_OK;
+        ssize_t bytes_read = 0;
+        long row;
+
+        if (row_count > pctx.batch->row_capacity)
+            row_count = pctx.batch->row_capacity;
+
+        if ((bytes_read = readstat_parallel_read_chunk(io, buf, row_count * ctx->record_len)) == -1) {
+            retval = READSTAT_ERROR_READ;
+            goto cleanup;
+        }
+        rows_read = bytes_read / ctx->record_len;
+
+        decode_retval = readstat_parallel_for(ctx->thread_count, rows_read,
+                &dta_decode_rows, &pctx, &failed_index);
+
+        for (row=0; row<rows_read; row++) {
+            readstat_value_t *values = readstat_value_batch_row(pctx.batch, row);
+            char *strings = readstat_value_batch_strings(pctx.batch, row);
+            for (i=0; i<pctx.batch->value_counts[row]; i++) {
+                dta_column_t *column = &pctx.columns[i];
+                if (ctx->variables[i]->skip)
+                    continue;
+
+                if (column->type == READSTAT_TYPE_STRING_REF &&
+                        (retval = dta_decode_strl(ctx, &buf[row * ctx->record_len + column->offset],
+                                                  &values[i])) != READSTAT_OK)
+                    goto cleanup;
+
+                if (column->type == READSTAT_TYPE_STRING && ctx->handle.string_view) {
+                    if ((retval = dta_handle_string_view(ctx, &buf[row * ctx->record_len + column->offset],
+                                    column->max_len, ctx->variables[i], &strings[column->string_offset],
+                                    column->string_len)) != READSTAT_OK)
+                        goto cleanup;
+                    continue;
+                }
+
+                if (column->type == READSTAT_TYPE_STRING && ctx->dictionary &&
+                        (retval = dta_decode_dictionary_string(ctx, &buf[row * ctx->record_len + column->offset],
+                                column->max_len, ctx->variables[i], &strings[column->string_offset],
+                                column->string_len, &values[i])) != READSTAT_OK)
+                    goto cleanup;
+
+                if (ctx->handle.value(ctx->current_row, ctx->variables[i], values[i], ctx->user_ctx) != READSTAT_HANDLER_OK) {
+                    retval = READSTAT_ERROR_USER_ABORT;
+                    goto cleanup;
+                }
+            }
+            if (decode_retval != READSTAT_OK && row == failed_index) {
+                retval = decode_retval;
+                goto cleanup;
+            }
+            ctx->current_row++;
+            ctx->stats->rows_decoded++;
+            if ((retval = dta_update_progress(ctx)) != READSTAT_OK) {
+                goto cleanup;
+            }
+        }
+
+        /* As with one row at a time, the rows before the end of the file
+         * are delivered before the error */
+        if (rows_read < row_count) {
             retval = READSTAT_ERROR_READ;
             goto cleanup;
         }
-        if ((retval = dta_handle_row(buf, ctx)) != READSTAT_OK) {
+
+        rows_done += row_count;
+    }
+
+cleanup:
+    if (pctx.converters)
+        readstat_parallel_converters_free(pctx.converters, ctx->thread_count);
+    if (pctx.batch)
+        readstat_value_batch_free(pctx.batch);
+    if (pctx.columns)
+        readstat_free(pctx.columns);
+    if (buf)
+        readstat_free(buf);
+
+    return retval;
+}
+
+static readstat_error_t dta_handle_rows(dta_ctx_t *ctx) {
+    readstat_prefetch_t *prefetch = NULL;
+    readstat_io_t *io = NULL;
+    unsigned char *buf = NULL;
+    int i;
+    int handled = 0;
+    readstat_error_t retval = READSTAT_OK;
+
+    if ((retval = readstat_prefetch_init(&prefetch, &ctx->io, ctx->prefetch_depth,
+                    READSTAT_PREFETCH_BLOCK_SIZE)) != READSTAT_OK)
+        goto cleanup;
+
+    io = ctx->io;
+    ctx->prefetch = prefetch;
+
+    if (ctx->row_offset) {
+        if (io->seek(ctx->record_len * ctx->row_offset, READSTAT_SEEK_CUR, io->io_ctx) == -1) {
+            retval = READSTAT_ERROR_SEEK;
             goto cleanup;
         }
-        ctx->current_row++;
-        if ((retval = dta_update_progress(ctx)) != READSTAT_OK) {
+        ctx->stats->rows_skipped += ctx->row_offset;
+    }
+
+    if (ctx->thread_count > 1) {
+        if ((retval = dta_handle_rows_parallel(ctx, &handled)) != READSTAT_OK)
+            goto cleanup;
+    }
+
+    if (!handled) {
+        if (ctx->record_len && (buf = readstat_malloc(ctx->record_len)) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
             goto cleanup;
         }
+
+        for (i=0; i<ctx->row_limit; i++) {
+            if (io->read(buf, ctx->record_len, io->io_ctx) != ctx->record_len) {
+                retval = READSTAT_ERROR_READ;
+                goto cleanup;
+            }
+            if ((retval = dta_handle_row(buf, ctx)) != READSTAT_OK) {
+                goto cleanup;
+            }
+            ctx->current_row++;
+            ctx->stats->rows_decoded++;
+            if ((retval = dta_update_progress(ctx)) != READSTAT_OK) {
+                goto cleanup;
+            }
+        }
     }
 
     if (ctx->row_limit < ctx->nobs - ctx->row_offset) {
@@ -685,8 +1225,14 @@ static readstat_error_t dta_handle_rows(dta_ctx_t *ctx) {
     }
 
 cleanup:
+    ctx->prefetch = NULL;
+    if (prefetch) {
+        readstat_error_t prefetch_retval = readstat_prefetch_free(prefetch, &ctx->io);
+        if (retval == READSTAT_OK)
+            retval = prefetch_retval;
+    }
     if (buf)
-        free(buf);
+        readstat_free(buf);
 
     return retval;
 }
@@ -919,9 +1465,9 @@ static readstat_error_t dta_read_label_and_timestamp(dta_ctx_t *ctx) {
 
 cleanup:
     if (data_label_buffer)
-        free(data_label_buffer);
+        readstat_free(data_label_buffer);
     if (timestamp_buffer)
-        free(timestamp_buffer);
+        readstat_free(timestamp_buffer);
 
     return retval;
 }
@@ -948,7 +1494,10 @@ static readstat_error_t dta_handle_variables(dta_ctx_t *ctx) {
             max_len = 0;
         }
 
-        ctx->variables[i] = dta_init_variable(ctx, i, index_after_skipping, type, max_len);
+        if ((ctx->variables[i] = dta_init_variable(ctx, i, index_after_skipping, type, max_len)) == NULL) {
+            retval = READSTAT_ERROR_MALLOC;
+            goto cleanup;
+        }
 
         const char *value_labels = NULL;
 
@@ -1117,21 +1666,33 @@ static readstat_error_t dta_handle_value_labels(dta_ctx_t *ctx) {
 
 cleanup:
     if (table_buffer)
-        free(table_buffer);
+        readstat_free(table_buffer);
     if (utf8_buffer)
         free(utf8_buffer);
 
     return retval;
 }
 
-readstat_error_t readstat_parse_dta(readstat_parser_t *parser, const char *path, void *user_ctx) {
+static void dta_reuse_reset(void *ctx) {
+    dta_ctx_reset((dta_ctx_t *)ctx);
+}
+
+static void dta_reuse_free(void *ctx) {
+    dta_ctx_free((dta_ctx_t *)ctx);
+}
+
+static readstat_error_t dta_parse(readstat_parser_t *parser, const char *path, void *user_ctx) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = parser->io;
     int i;
     dta_ctx_t    *ctx;
     size_t file_size = 0;
 
-    ctx = dta_ctx_alloc(io);
+    if ((ctx = readstat_reuse_take(parser, READSTAT_REUSE_SLOT_DTA)) != NULL) {
+        ctx->io = io;
+    } else if ((ctx = dta_ctx_alloc(io)) == NULL) {
+        return READSTAT_ERROR_MALLOC;
+    }
 
     if (io->open(path, io->io_ctx) == -1) {
         retval = READSTAT_ERROR_OPEN;
@@ -1163,6 +1724,9 @@ readstat_error_t readstat_parse_dta(readstat_parser_t *parser, const char *path,
         goto cleanup;
     }
 
+    if ((retval = readstat_reuse_io_begin(parser, &ctx->io, file_size)) != READSTAT_OK)
+        goto cleanup;
+
     if (strncmp(magic, "<sta", 4) == 0) {
         dta_header64_t header;
         if ((retval = dta_read_xmlish_header(ctx, &header)) != READSTAT_OK) {
@@ -1185,6 +1749,16 @@ readstat_error_t readstat_parse_dta(readstat_parser_t *parser, const char *path,
     ctx->user_ctx = user_ctx;
     ctx->file_size = file_size;
     ctx->handle = parser->handlers;
+    ctx->stats = &parser->stats;
+    readstat_progress_init(&ctx->progress, parser);
+    ctx->thread_count = parser->thread_count;
+    ctx->prefetch_depth = parser->prefetch_depth;
+    if (parser->string_dictionary_limit > 0 &&
+            (ctx->dictionary = readstat_string_dictionary_init(ctx->arena, ctx->nvar,
+                    parser->string_dictionary_limit, ctx->handle.dictionary_entry, user_ctx)) == NULL) {
+        retval = READSTAT_ERROR_MALLOC;
+        goto cleanup;
+    }
     if (parser->row_offset > 0)
         ctx->row_offset = parser->row_offset;
     int64_t nobs_after_skipping = ctx->nobs - ctx->row_offset;
@@ -1253,7 +1827,7 @@ readstat_error_t readstat_parse_dta(readstat_parser_t *parser, const char *path,
         goto cleanup;
 
     if (!ctx->file_is_xmlish) {
-        ctx->data_offset = io->seek(0, READSTAT_SEEK_CUR, io->io_ctx);
+        ctx->data_offset = ctx->io->seek(0, READSTAT_SEEK_CUR, ctx->io->io_ctx);
         if (ctx->data_offset == -1) {
             retval = READSTAT_ERROR_SEEK;
             goto cleanup;
@@ -1264,16 +1838,32 @@ readstat_error_t readstat_parse_dta(readstat_parser_t *parser, const char *path,
     if ((retval = dta_read_strls(ctx)) != READSTAT_OK)
         goto cleanup;
 
-    if ((retval = dta_read_data(ctx)) != READSTAT_OK)
-        goto cleanup;
+    /* Value labels follow the data; read them first if they're wanted while
+     * the values go by */
+    if (parser->value_label_lookup != READSTAT_VALUE_LABEL_LOOKUP_NONE) {
+        if ((retval = dta_handle_value_labels(ctx)) != READSTAT_OK)
+            goto cleanup;
 
-    if ((retval = dta_handle_value_labels(ctx)) != READSTAT_OK)
-        goto cleanup;
+        if ((retval = dta_read_data(ctx)) != READSTAT_OK)
+            goto cleanup;
+    } else {
+        if ((retval = dta_read_data(ctx)) != READSTAT_OK)
+            goto cleanup;
+
+        if ((retval = dta_handle_value_labels(ctx)) != READSTAT_OK)
+            goto cleanup;
+    }
 
 cleanup:
+    readstat_reuse_io_end(parser, &ctx->io);
     io->close(io->io_ctx);
-    if (ctx)
-        dta_ctx_free(ctx);
+    readstat_reuse_keep(parser, READSTAT_REUSE_SLOT_DTA, ctx,
+            &dta_reuse_reset, &dta_reuse_free);
 
     return retval;
 }
+
+readstat_error_t readstat_parse_dta(readstat_parser_t *parser, const char *path, void *user_ctx) {
+    return readstat_stats_parse(parser, &dta_parse,
+            READSTAT_LABEL_INDEX_PARSE_OWN, path, user_ctx);
+}
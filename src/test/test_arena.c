@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../readstat.h"
+#include "../readstat_malloc.h"
+#include "../readstat_arena.h"
+
+#define TEST_ARENA_STRINGS  5000
+
+static void fail(const char *message) {
+    fprintf(stderr, "%s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static void test_arena_alloc() {
+    readstat_arena_t *arena = readstat_arena_init();
+    unsigned char *big = NULL;
+    int *zeroed = NULL;
+    int i;
+
+    for (i=1; i<100; i++) {
+        void *ptr = NULL;
+        readstat_arena_intern(arena, "x", i % 2); /* unaligned string bytes in between */
+        if ((ptr = readstat_arena_alloc(arena, i)) == NULL)
+            fail("Arena allocation failed");
+        if ((uintptr_t)ptr % 16)
+            fail("Arena allocation isn't aligned");
+        memset(ptr, 0xFF, i);
+    }
+
+    /* Bigger than a chunk */
+    if ((big = readstat_arena_alloc(arena, 200000)) == NULL)
+        fail("Big arena allocation failed");
+    memset(big, 0xFF, 200000);
+
+    if ((zeroed = readstat_arena_calloc(arena, 1000, sizeof(int))) == NULL)
+        fail("Arena calloc failed");
+    for (i=0; i<1000; i++) {
+        if (zeroed[i])
+            fail("Arena calloc isn't zeroed");
+    }
+
+    if (readstat_arena_alloc(arena, 0) != NULL || readstat_arena_calloc(arena, SIZE_MAX, 2) != NULL)
+        fail("Empty or overflowing arena allocation succeeded");
+
+    readstat_arena_free(arena);
+}
+
+static void test_arena_intern() {
+    readstat_arena_t *arena = readstat_arena_init();
+    const char *strings[TEST_ARENA_STRINGS];
+    const char *hello = NULL;
+    char buf[32];
+    int i;
+
+    hello = readstat_arena_intern(arena, "hello world", 5);
+    if (hello == NULL || strcmp(hello, "hello") != 0)
+        fail("Interned prefix is wrong");
+    if (readstat_arena_intern(arena, "hello", 5) != hello)
+        fail("Equal strings aren't shared");
+    if (readstat_arena_intern(arena, "hello\0junk", 10) != hello)
+        fail("Interning doesn't stop at a NUL");
+    if (readstat_arena_intern(arena, "help", 4) == hello)
+        fail("Different strings are shared");
+    if (strcmp(readstat_arena_intern(arena, "", 0), "") != 0 ||
+            strcmp(readstat_arena_intern(arena, "\0abc", 4), "") != 0)
+        fail("Empty strings aren't \"\"");
+
+    /* Enough to grow the intern table several times */
+    for (i=0; i<TEST_ARENA_STRINGS; i++) {
+        snprintf(buf, sizeof(buf), "var%d", i);
+        if ((strings[i] = readstat_arena_intern(arena, buf, sizeof(buf))) == NULL)
+            fail("Interning failed");
+    }
+    for (i=0; i<TEST_ARENA_STRINGS; i++) {
+        snprintf(buf, sizeof(buf), "var%d", i);
+        if (readstat_arena_intern(arena, buf, strlen(buf)) != strings[i] || strcmp(strings[i], buf) != 0)
+            fail("Interned string lost after the table grew");
+    }
+    if (readstat_arena_intern(arena, "hello", 5) != hello)
+        fail("Interned string lost after the table grew");
+
+    /* After a reset nothing old is handed out again */
+    readstat_arena_reset(arena);
+    for (i=0; i<TEST_ARENA_STRINGS; i++) {
+        snprintf(buf, sizeof(buf), "new%d", i);
+        if ((strings[i] = readstat_arena_intern(arena, buf, strlen(buf))) == NULL || strcmp(strings[i], buf) != 0)
+            fail("Interning failed after a reset");
+    }
+    hello = readstat_arena_intern(arena, "hello", 5);
+    if (hello == NULL || strcmp(hello, "hello") != 0 || readstat_arena_intern(arena, "hello", 5) != hello)
+        fail("Interning is wrong after a reset");
+
+    readstat_arena_free(arena);
+}
+
+static void test_arena_out_of_memory() {
+    readstat_arena_t *arena = readstat_arena_init();
+    readstat_malloc_scope_t scope;
+    char buf[32];
+    int i, failed = 0;
+
+    readstat_malloc_scope_begin(&scope, 0, 100000);
+    for (i=0; i<100000 && !failed; i++) {
+        snprintf(buf, sizeof(buf), "string%d", i);
+        failed = (readstat_arena_intern(arena, buf, strlen(buf)) == NULL);
+    }
+    if (!failed)
+        fail("Interning past the memory limit succeeded");
+    if (readstat_arena_variable(arena) != NULL)
+        fail("Arena variable past the memory limit succeeded");
+    readstat_malloc_scope_end(&scope, READSTAT_OK);
+
+    readstat_arena_free(arena);
+}
+
+static void test_arena_variable() {
+    readstat_arena_t *arena = readstat_arena_init();
+    readstat_variable_t *variable = readstat_arena_variable(arena);
+
+    if (variable == NULL)
+        fail("Arena variable failed");
+    if (variable->name == NULL || variable->format == NULL || variable->label == NULL ||
+            variable->name[0] || variable->format[0] || variable->label[0])
+        fail("Arena variable strings aren't \"\"");
+    if (variable->label_set || variable->missingness)
+        fail("Arena variable isn't zeroed");
+
+    readstat_arena_free(arena);
+}
+
+/* Setting a variable's label or format from its own current value */
+static void test_writer_variable_strings() {
+    readstat_writer_t *writer = readstat_writer_init();
+    readstat_variable_t *variable = readstat_add_variable(writer, "x", READSTAT_TYPE_DOUBLE, 0);
+
+    readstat_variable_set_label(variable, "A label");
+    readstat_variable_set_label(variable, readstat_variable_get_label(variable));
+    if (strcmp(readstat_variable_get_label(variable), "A label") != 0)
+        fail("Setting the label to itself lost it");
+    readstat_variable_set_label(variable, readstat_variable_get_label(variable) + 2);
+    if (strcmp(readstat_variable_get_label(variable), "label") != 0)
+        fail("Setting the label to its own suffix lost it");
+
+    readstat_variable_set_format(variable, "%9.2f");
+    readstat_variable_set_format(variable, readstat_variable_get_format(variable));
+    if (strcmp(readstat_variable_get_format(variable), "%9.2f") != 0)
+        fail("Setting the format to itself lost it");
+
+    readstat_variable_set_label(variable, NULL);
+    readstat_variable_set_format(variable, "");
+    if (variable->label == NULL || variable->label[0] || readstat_variable_get_label(variable) ||
+            variable->format == NULL || variable->format[0] || readstat_variable_get_format(variable))
+        fail("Clearing the label and format didn't leave \"\"");
+
+    readstat_writer_free(writer);
+}
+
+int main(int argc, char *argv[]) {
+    test_arena_alloc();
+    test_arena_intern();
+    test_arena_out_of_memory();
+    test_arena_variable();
+    test_writer_variable_strings();
+
+    return 0;
+}
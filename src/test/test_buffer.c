@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "test_buffer.h"
@@ -26,6 +27,18 @@ void buffer_free(rt_buffer_t *buffer) {
     free(buffer);
 }
 
+/* For the tests that need a file on disk */
+int buffer_save(rt_buffer_t *buffer, const char *path) {
+    FILE *file = fopen(path, "wb");
+    size_t bytes_written = 0;
+    if (file == NULL)
+        return -1;
+    bytes_written = fwrite(buffer->bytes, 1, buffer->used, file);
+    if (fclose(file) != 0 || bytes_written != buffer->used)
+        return -1;
+    return 0;
+}
+
 rt_buffer_ctx_t *buffer_ctx_init(rt_buffer_t *buffer) {
     rt_buffer_ctx_t *buffer_ctx = calloc(1, sizeof(rt_buffer_ctx_t));
     buffer_ctx->buffer = buffer;
@@ -14,6 +14,7 @@ rt_buffer_t *buffer_init();
 void buffer_reset(rt_buffer_t *buffer);
 void buffer_grow(rt_buffer_t *buffer, size_t len);
 void buffer_free(rt_buffer_t *buffer);
+int buffer_save(rt_buffer_t *buffer, const char *path);
 
 rt_buffer_ctx_t *buffer_ctx_init(rt_buffer_t *buffer);
 void buffer_ctx_reset(rt_buffer_ctx_t *buffer_ctx);
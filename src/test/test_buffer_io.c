@@ -1,11 +1,36 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "../readstat.h"
 
 #include "test_buffer.h"
 #include "test_buffer_io.h"
 
+ssize_t rt_write_handler(const void *bytes, size_t len, void *ctx) {
+    rt_buffer_t *buffer = (rt_buffer_t *)ctx;
+    buffer_grow(buffer, len);
+    if (buffer->bytes == NULL) {
+        return -1;
+    }
+    memcpy(buffer->bytes + buffer->used, bytes, len);
+    buffer->used += len;
+    return len;
+}
+
+void rt_set_io_handlers(readstat_parser_t *parser, rt_buffer_ctx_t *buffer_ctx) {
+    readstat_set_open_handler(parser, rt_open_handler);
+    readstat_set_close_handler(parser, rt_close_handler);
+    readstat_set_seek_handler(parser, rt_seek_handler);
+    readstat_set_read_handler(parser, rt_read_handler);
+    readstat_set_update_handler(parser, rt_update_handler);
+    readstat_set_io_ctx(parser, buffer_ctx);
+}
+
+/* A context without a buffer stands in for a missing file */
 int rt_open_handler(const char *path, void *io_ctx) {
+    rt_buffer_ctx_t *buffer_ctx = (rt_buffer_ctx_t *)io_ctx;
+    if (buffer_ctx->buffer == NULL)
+        return -1;
     return 0;
 }
 
@@ -39,7 +64,9 @@ ssize_t rt_read_handler(void *buf, size_t nbytes, void *io_ctx) {
     rt_buffer_ctx_t *buffer_ctx = (rt_buffer_ctx_t *)io_ctx;
     ssize_t bytes_copied = 0;
     ssize_t bytes_left = buffer_ctx->buffer->used - buffer_ctx->pos;
-    if (nbytes <= bytes_left) {
+    if (nbytes == 0) {
+        /* An empty value label table, say, may come with a NULL buffer */
+    } else if (nbytes <= bytes_left) {
         memcpy(buf, buffer_ctx->buffer->bytes + buffer_ctx->pos, nbytes);
         bytes_copied = nbytes;
     } else if (bytes_left > 0) {
@@ -1,4 +1,8 @@
 
+/* The data writer and parser I/O for files kept in an rt_buffer_t */
+ssize_t rt_write_handler(const void *bytes, size_t len, void *ctx);
+void rt_set_io_handlers(readstat_parser_t *parser, rt_buffer_ctx_t *buffer_ctx);
+
 int rt_open_handler(const char *path, void *io_ctx);
 int rt_close_handler(void *io_ctx);
 readstat_off_t rt_seek_handler(readstat_off_t offset,
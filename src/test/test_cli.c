@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../readstat.h"
+
+#include "test_buffer.h"
+#include "test_buffer_io.h"
+
+#define READSTAT_CLI "./readstat"
+
+static void write_file(const char *filename, int is_dta) {
+    readstat_writer_t *writer = readstat_writer_init();
+    rt_buffer_t *buffer = buffer_init();
+    readstat_variable_t *variable = NULL;
+    readstat_error_t error = READSTAT_OK;
+    int i;
+
+    readstat_set_data_writer(writer, &rt_write_handler);
+    variable = readstat_add_variable(writer, "x", READSTAT_TYPE_DOUBLE, 0);
+
+    if (is_dta) {
+        error = readstat_begin_writing_dta(writer, buffer, 3);
+    } else {
+        error = readstat_begin_writing_sav(writer, buffer, 3);
+    }
+    for (i=0; i<3 && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        if ((error = readstat_insert_double_value(writer, variable, i)) != READSTAT_OK)
+            break;
+        error = readstat_end_row(writer);
+    }
+    if (error == READSTAT_OK)
+        error = readstat_end_writing(writer);
+
+    readstat_writer_free(writer);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error writing %s: %s\n", filename, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (buffer_save(buffer, filename) != 0) {
+        fprintf(stderr, "Error saving %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    buffer_free(buffer);
+}
+
+static int file_exists(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file)
+        fclose(file);
+    return file != NULL;
+}
+
+static int run(const char *command) {
+    int status = system(command);
+    if (status == -1) {
+        fprintf(stderr, "Error running %s\n", command);
+        exit(EXIT_FAILURE);
+    }
+    return status;
+}
+
+static void test_batch_convert() {
+    remove("test_batch_a.csv");
+    remove("test_batch_b.csv");
+
+    if (run(READSTAT_CLI " -f -j 2 -t csv test_batch_a.dta test_batch_b.sav > /dev/null") != 0) {
+        fprintf(stderr, "Batch conversion failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!file_exists("test_batch_a.csv") || !file_exists("test_batch_b.csv")) {
+        fprintf(stderr, "Batch conversion did not write its outputs\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void test_batch_duplicate_outputs() {
+    remove("test_batch_a.csv");
+
+    if (run(READSTAT_CLI " -f -j 2 -t csv test_batch_a.dta test_batch_a.sav > /dev/null 2>&1") == 0) {
+        fprintf(stderr, "Expected a batch with colliding outputs to fail\n");
+        exit(EXIT_FAILURE);
+    }
+    if (file_exists("test_batch_a.csv")) {
+        fprintf(stderr, "Batch with colliding outputs wrote test_batch_a.csv\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void test_shards_stale() {
+    FILE *stale = NULL;
+
+    remove("test_shards.part-0000.csv");
+    remove("test_shards.part-0001.csv");
+
+    /* Pretend an earlier run wrote four shards */
+    if ((stale = fopen("test_shards.part-0002.csv", "wb")) == NULL) {
+        fprintf(stderr, "Error opening test_shards.part-0002.csv\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(stale);
+    if ((stale = fopen("test_shards.part-0003.csv", "wb")) == NULL) {
+        fprintf(stderr, "Error opening test_shards.part-0003.csv\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(stale);
+
+    if (run(READSTAT_CLI " test_batch_a.dta test_shards.csv --shards 2 > /dev/null 2>&1") == 0) {
+        fprintf(stderr, "Expected sharding over stale shards without -f to fail\n");
+        exit(EXIT_FAILURE);
+    }
+    if (file_exists("test_shards.part-0000.csv")) {
+        fprintf(stderr, "Sharding over stale shards without -f wrote output\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (run(READSTAT_CLI " -f test_batch_a.dta test_shards.csv --shards 2 > /dev/null 2>&1") != 0) {
+        fprintf(stderr, "Sharded conversion failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!file_exists("test_shards.part-0000.csv") || !file_exists("test_shards.part-0001.csv")) {
+        fprintf(stderr, "Sharded conversion did not write its outputs\n");
+        exit(EXIT_FAILURE);
+    }
+    if (file_exists("test_shards.part-0002.csv") || file_exists("test_shards.part-0003.csv")) {
+        fprintf(stderr, "Sharded conversion with -f left stale shards behind\n");
+        exit(EXIT_FAILURE);
+    }
+
+    remove("test_shards.part-0000.csv");
+    remove("test_shards.part-0001.csv");
+}
+
+int main(int argc, char *argv[]) {
+    write_file("test_batch_a.dta", 1);
+    write_file("test_batch_a.sav", 0);
+    write_file("test_batch_b.sav", 0);
+
+    test_batch_convert();
+    test_batch_duplicate_outputs();
+    test_shards_stale();
+
+    remove("test_batch_a.dta");
+    remove("test_batch_a.sav");
+    remove("test_batch_b.sav");
+    remove("test_batch_a.csv");
+    remove("test_batch_b.csv");
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../readstat.h"
+
+#include "test_buffer.h"
+#include "test_buffer_io.h"
+
+/* Built with a tiny DTA_STRL_CACHE_LEN and nothing preloaded, so that every
+ * strL goes through the cache */
+
+#define TEST_STRL_LEN       300
+#define TEST_STRL_COUNT     4
+
+/* Three strLs fit in the cache at once */
+static const int row_strls[]   = { 0, 1, 2, 0, 3, 0, 1, 2, 0 };
+static const int row_is_hit[]  = { 0, 0, 0, 1, 0, 1, 0, 0, 1 };
+
+#define TEST_STRL_ROWS  (sizeof(row_strls) / sizeof(row_strls[0]))
+
+typedef struct strl_record_s {
+    long    seeks[TEST_STRL_ROWS];
+    int     values;
+    int     wrong;
+} strl_record_t;
+
+static long seek_count;
+static long bytes_read;
+
+static void fail(const char *message) {
+    fprintf(stderr, "%s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static void strl_text(char *text, int index) {
+    memset(text, 'a' + index, TEST_STRL_LEN);
+    snprintf(text, TEST_STRL_LEN, "strl%d", index);
+    text[strlen(text)] = '-';
+    text[TEST_STRL_LEN] = '\0';
+}
+
+static void write_file(rt_buffer_t *buffer) {
+    readstat_writer_t *writer = readstat_writer_init();
+    readstat_string_ref_t *refs[TEST_STRL_COUNT];
+    readstat_variable_t *variable = NULL;
+    readstat_error_t error = READSTAT_OK;
+    char text[TEST_STRL_LEN + 1];
+    int i;
+
+    readstat_set_data_writer(writer, &rt_write_handler);
+    readstat_writer_set_file_format_version(writer, 118);
+    variable = readstat_add_variable(writer, "s", READSTAT_TYPE_STRING_REF, 0);
+    for (i=0; i<TEST_STRL_COUNT; i++) {
+        strl_text(text, i);
+        refs[i] = readstat_add_string_ref(writer, text);
+    }
+
+    error = readstat_begin_writing_dta(writer, buffer, TEST_STRL_ROWS);
+    for (i=0; i<TEST_STRL_ROWS && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        if ((error = readstat_insert_string_ref(writer, variable, refs[row_strls[i]])) != READSTAT_OK)
+            break;
+        error = readstat_end_row(writer);
+    }
+    if (error == READSTAT_OK)
+        error = readstat_end_writing(writer);
+
+    readstat_writer_free(writer);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error writing the strL file: %s\n", readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static readstat_off_t counting_seek_handler(readstat_off_t offset, readstat_io_flags_t whence, void *io_ctx) {
+    if (whence == READSTAT_SEEK_SET)
+        seek_count++;
+    return rt_seek_handler(offset, whence, io_ctx);
+}
+
+static ssize_t counting_read_handler(void *buf, size_t nbytes, void *io_ctx) {
+    ssize_t len = rt_read_handler(buf, nbytes, io_ctx);
+    if (len > 0)
+        bytes_read += len;
+    return len;
+}
+
+static int handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    strl_record_t *record = (strl_record_t *)ctx;
+    char text[TEST_STRL_LEN + 1];
+
+    if (obs_index < 0 || obs_index >= TEST_STRL_ROWS)
+        fail("Unexpected row");
+
+    strl_text(text, row_strls[obs_index]);
+    if (readstat_string_value(value) == NULL || strcmp(readstat_string_value(value), text) != 0)
+        record->wrong++;
+
+    record->seeks[obs_index] = seek_count;
+    record->values++;
+    return READSTAT_HANDLER_OK;
+}
+
+static void parse_file(strl_record_t *record, rt_buffer_ctx_t *buffer_ctx,
+        int thread_count, int prefetch_depth) {
+    readstat_parser_t *parser = readstat_parser_init();
+    readstat_error_t error = READSTAT_OK;
+
+    memset(record, 0, sizeof(strl_record_t));
+    seek_count = 0;
+    bytes_read = 0;
+    buffer_ctx->pos = 0;
+
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_handler(parser, &handle_value);
+    rt_set_io_handlers(parser, buffer_ctx);
+    readstat_set_seek_handler(parser, &counting_seek_handler);
+    readstat_set_read_handler(parser, &counting_read_handler);
+    readstat_set_thread_count(parser, thread_count);
+    readstat_set_prefetch_depth(parser, prefetch_depth);
+
+    error = readstat_parse_dta(parser, NULL, record);
+    readstat_parser_free(parser);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing the strL file: %s\n", readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (record->values != TEST_STRL_ROWS || record->wrong) {
+        fprintf(stderr, "%d of %d strLs wrong (%d threads, prefetch depth %d)\n",
+                record->wrong, record->values, thread_count, prefetch_depth);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* A hit costs no seek; a miss seeks to the payload, and past the cache's
+ * capacity the least recently used payload is the one read again */
+static void test_strl_cache(rt_buffer_ctx_t *buffer_ctx) {
+    strl_record_t record;
+    int i;
+
+    parse_file(&record, buffer_ctx, 1, 0);
+    for (i=1; i<TEST_STRL_ROWS; i++) {
+        int hit = (record.seeks[i] == record.seeks[i-1]);
+        if (hit != row_is_hit[i]) {
+            fprintf(stderr, "Row %d: expected a cache %s\n", i, row_is_hit[i] ? "hit" : "miss");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/* Misses are read around the read-ahead thread, without throwing away
+ * what it has read */
+static void test_strl_prefetch(rt_buffer_ctx_t *buffer_ctx) {
+    strl_record_t record;
+    long file_size = buffer_ctx->buffer->used;
+
+    parse_file(&record, buffer_ctx, 1, 2);
+    if (bytes_read > file_size + TEST_STRL_ROWS * TEST_STRL_LEN) {
+        fprintf(stderr, "Read %ld bytes of a %ld-byte file with prefetch on\n", bytes_read, file_size);
+        exit(EXIT_FAILURE);
+    }
+
+    parse_file(&record, buffer_ctx, 2, 2);
+    if (bytes_read > file_size + TEST_STRL_ROWS * TEST_STRL_LEN) {
+        fprintf(stderr, "Read %ld bytes of a %ld-byte file with threads and prefetch on\n", bytes_read, file_size);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    rt_buffer_t *buffer = buffer_init();
+    rt_buffer_ctx_t *buffer_ctx = buffer_ctx_init(buffer);
+
+    write_file(buffer);
+    test_strl_cache(buffer_ctx);
+    test_strl_prefetch(buffer_ctx);
+
+    free(buffer_ctx);
+    buffer_free(buffer);
+
+    return 0;
+}
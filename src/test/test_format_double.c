@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "../bin/write/format_double.h"
+
+static uint64_t lcg_state = 0x2545F4914F6CDD1D;
+
+static uint64_t lcg_next(void) {
+    lcg_state = lcg_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return lcg_state;
+}
+
+static long checked = 0;
+
+static void check_double_round_trip(double value) {
+    char buf[FORMAT_DOUBLE_BUFFER_LEN];
+    double got;
+    int len = format_double(value, buf);
+
+    if (len != strlen(buf) || len >= FORMAT_DOUBLE_BUFFER_LEN) {
+        fprintf(stderr, "Bad length %d for %.17g\n", len, value);
+        exit(EXIT_FAILURE);
+    }
+    got = strtod(buf, NULL);
+    if (memcmp(&got, &value, sizeof(double)) != 0) {
+        fprintf(stderr, "%.17g formatted as %s, which reads back as %.17g\n", value, buf, got);
+        exit(EXIT_FAILURE);
+    }
+    checked++;
+}
+
+static void check_float_round_trip(float value) {
+    char buf[FORMAT_DOUBLE_BUFFER_LEN];
+    float got;
+    int len = format_float(value, buf);
+
+    if (len != strlen(buf) || len >= FORMAT_DOUBLE_BUFFER_LEN) {
+        fprintf(stderr, "Bad length %d for %.9g\n", len, value);
+        exit(EXIT_FAILURE);
+    }
+    got = strtof(buf, NULL);
+    if (memcmp(&got, &value, sizeof(float)) != 0) {
+        fprintf(stderr, "%.9g formatted as %s, which reads back as %.9g\n", value, buf, got);
+        exit(EXIT_FAILURE);
+    }
+    checked++;
+}
+
+static void test_known_strings(void) {
+    #define EXPECT_DOUBLE(v, expected) do { \
+        char buf[FORMAT_DOUBLE_BUFFER_LEN]; \
+        format_double(v, buf); \
+        if (strcmp(buf, expected) != 0) { \
+            printf("%s:%d error got %s, expected %s\n", __FILE__, __LINE__, buf, expected); \
+            exit(EXIT_FAILURE); \
+        } \
+    } while (0)
+
+    EXPECT_DOUBLE(0.0, "0");
+    EXPECT_DOUBLE(-0.0, "-0");
+    EXPECT_DOUBLE(1.0, "1");
+    EXPECT_DOUBLE(-100.0, "-100");
+    EXPECT_DOUBLE(123.56, "123.56");
+    EXPECT_DOUBLE(-123.123, "-123.123");
+    EXPECT_DOUBLE(0.1, "0.1");
+    EXPECT_DOUBLE(0.3, "0.3");
+    EXPECT_DOUBLE(1.5, "1.5");
+    EXPECT_DOUBLE(123.12345678901234, "123.12345678901234");
+    EXPECT_DOUBLE(0.000001, "0.000001");
+    EXPECT_DOUBLE(1e-7, "1e-07");
+    EXPECT_DOUBLE(1e21, "1e+21");
+    EXPECT_DOUBLE(1e20, "100000000000000000000");
+    EXPECT_DOUBLE(1.7976931348623157e308, "1.7976931348623157e+308");
+    EXPECT_DOUBLE(5e-324, "5e-324");
+    EXPECT_DOUBLE(INFINITY, "inf");
+    EXPECT_DOUBLE(-INFINITY, "-inf");
+    EXPECT_DOUBLE(NAN, "nan");
+
+    #define EXPECT_FLOAT(v, expected) do { \
+        char buf[FORMAT_DOUBLE_BUFFER_LEN]; \
+        format_float(v, buf); \
+        if (strcmp(buf, expected) != 0) { \
+            printf("%s:%d error got %s, expected %s\n", __FILE__, __LINE__, buf, expected); \
+            exit(EXIT_FAILURE); \
+        } \
+    } while (0)
+
+    EXPECT_FLOAT(0.1f, "0.1");
+    EXPECT_FLOAT(-2.5f, "-2.5");
+    EXPECT_FLOAT(16777216.0f, "16777216");
+    EXPECT_FLOAT(3.4028235e38f, "3.4028235e+38");
+}
+
+static void test_random_bits(void) {
+    int i;
+    for (i=0; i<1000000; i++) {
+        uint64_t bits = lcg_next();
+        uint32_t fbits = bits >> 32;
+        double value;
+        float fvalue;
+
+        memcpy(&value, &bits, sizeof(double));
+        memcpy(&fvalue, &fbits, sizeof(float));
+        if (isfinite(value))
+            check_double_round_trip(value);
+        if (isfinite(fvalue))
+            check_float_round_trip(fvalue);
+    }
+}
+
+static void test_decimal_values(void) {
+    int i, decimals;
+    for (i=0; i<100000; i++) {
+        double scale = 1.0;
+        for (decimals=0; decimals<15; decimals++) {
+            check_double_round_trip((int64_t)(lcg_next() >> 20) / scale);
+            scale *= 10.0;
+        }
+        check_double_round_trip((int32_t)lcg_next());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    test_known_strings();
+    test_random_bits();
+    test_decimal_values();
+
+    printf("Checked %ld values\n", checked);
+
+    return 0;
+}
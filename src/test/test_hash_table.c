@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../CKHashTable.h"
+
+#define TEST_HASH_KEYS          10000
+#define TEST_HASH_LONG_KEY_LEN  300
+#define TEST_HASH_SEARCH_KEYS   500000
+
+static int values[TEST_HASH_KEYS];
+
+static void fail(const char *message) {
+    fprintf(stderr, "%s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static void test_grow() {
+    ck_hash_table_t *table = ck_hash_table_init(0);
+    uint64_t initial_capacity = table->capacity;
+    char key[32];
+    int i;
+
+    for (i=0; i<TEST_HASH_KEYS; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        if (!ck_str_hash_insert(key, &values[i], table))
+            fail("Insert failed");
+        if (4 * table->count > 3 * table->capacity)
+            fail("Table is past its load factor");
+    }
+    if (table->count != TEST_HASH_KEYS || table->capacity <= initial_capacity)
+        fail("Table didn't grow");
+
+    for (i=0; i<TEST_HASH_KEYS; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        if (ck_str_hash_lookup(key, table) != &values[i])
+            fail("Key lost after the table grew");
+        snprintf(key, sizeof(key), "nokey%d", i);
+        if (ck_str_hash_lookup(key, table) != NULL)
+            fail("Missing key found");
+    }
+
+    /* Inserting a key again replaces its value */
+    if (!ck_str_hash_insert("key1", &values[2], table) || table->count != TEST_HASH_KEYS ||
+            ck_str_hash_lookup("key1", table) != &values[2])
+        fail("Reinserting a key didn't replace its value");
+
+    /* Keys with a common prefix, and of any bytes */
+    if (ck_str_n_hash_lookup("key10", 4, table) != &values[2] ||
+            !ck_str_n_hash_insert("a\0b", 3, &values[3], table) ||
+            ck_str_n_hash_lookup("a\0b", 3, table) != &values[3] ||
+            ck_str_n_hash_lookup("a\0c", 3, table) != NULL ||
+            ck_str_hash_lookup("a", table) != NULL)
+        fail("Key lengths aren't respected");
+
+    if (ck_str_hash_insert("", &values[0], table) || ck_str_hash_lookup("", table))
+        fail("Empty key accepted");
+
+    ck_hash_table_wipe(table);
+    if (table->count != 0 || ck_str_hash_lookup("key1", table) != NULL)
+        fail("Wiped table still has keys");
+    if (!ck_str_hash_insert("key1", &values[1], table) || ck_str_hash_lookup("key1", table) != &values[1])
+        fail("Insert after a wipe failed");
+
+    ck_hash_table_free(table);
+}
+
+static int compare_hashes(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Two keys with the same 32-bit hash, found by brute force. Returns 0 if
+ * there are none among the keys tried. */
+static int find_colliding_keys(char *key1, char *key2, size_t len) {
+    uint64_t *hashes = malloc(TEST_HASH_SEARCH_KEYS * sizeof(uint64_t));
+    int found = 0;
+    long i;
+
+    for (i=0; i<TEST_HASH_SEARCH_KEYS; i++) {
+        snprintf(key1, len, "c%ld", i);
+        hashes[i] = ((uint64_t)(uint32_t)ck_hash_str(key1) << 32) | i;
+    }
+    qsort(hashes, TEST_HASH_SEARCH_KEYS, sizeof(uint64_t), &compare_hashes);
+    for (i=1; i<TEST_HASH_SEARCH_KEYS && !found; i++) {
+        if ((hashes[i] >> 32) == (hashes[i-1] >> 32)) {
+            snprintf(key1, len, "c%ld", (long)(hashes[i-1] & UINT32_MAX));
+            snprintf(key2, len, "c%ld", (long)(hashes[i] & UINT32_MAX));
+            found = 1;
+        }
+    }
+    free(hashes);
+    return found;
+}
+
+static void test_collisions() {
+    ck_hash_table_t *table = ck_hash_table_init(0);
+    char key1[32], key2[32], key[32];
+    int i;
+
+    if (!find_colliding_keys(key1, key2, sizeof(key1)))
+        fail("No colliding keys found");
+
+    /* Same stored hash: told apart by the keys themselves */
+    if (!ck_str_hash_insert(key1, &values[1], table) || ck_str_hash_lookup(key2, table) != NULL)
+        fail("Colliding key found before it was inserted");
+    if (!ck_str_hash_insert(key2, &values[2], table) || table->count != 2)
+        fail("Colliding key replaced the other one");
+
+    /* Enough others for both to be moved by several grows */
+    for (i=0; i<1000; i++) {
+        snprintf(key, sizeof(key), "other%d", i);
+        ck_str_hash_insert(key, &values[i], table);
+    }
+    if (ck_str_hash_lookup(key1, table) != &values[1] || ck_str_hash_lookup(key2, table) != &values[2])
+        fail("Colliding keys mixed up");
+
+    ck_hash_table_free(table);
+}
+
+static void long_key(char *key, size_t len, int i) {
+    memset(key, 'x', len);
+    snprintf(key, len, "%d", i);
+    key[strlen(key)] = 'x';
+}
+
+/* Every key is in the pool, which moves as it grows */
+static void test_key_pool() {
+    ck_hash_table_t *table = ck_hash_table_init(TEST_HASH_KEYS);
+    char key[TEST_HASH_LONG_KEY_LEN];
+    const char *keys = NULL;
+    int moves = 0;
+    int i, j;
+
+    for (i=0; i<1000; i++) {
+        long_key(key, sizeof(key), i);
+        if (!ck_str_n_hash_insert(key, sizeof(key), &values[i], table))
+            fail("Insert of a long key failed");
+        if (table->keys != keys) {
+            keys = table->keys;
+            moves++;
+            /* Everything so far is still there */
+            for (j=0; j<=i; j++) {
+                long_key(key, sizeof(key), j);
+                if (ck_str_n_hash_lookup(key, sizeof(key), table) != &values[j])
+                    fail("Key lost after the pool moved");
+            }
+        }
+    }
+    if (moves < 5 || table->keys_len != 1000 * (sizeof(uint32_t) + sizeof(key)))
+        fail("Key pool didn't grow as expected");
+
+    ck_hash_table_free(table);
+}
+
+static void test_number_keys() {
+    ck_hash_table_t *table = ck_hash_table_init(0);
+
+    ck_double_hash_insert(1.5, &values[1], table);
+    ck_double_hash_insert(0.0, &values[2], table);
+    ck_float_hash_insert(1.5f, &values[3], table);
+    if (ck_double_hash_lookup(1.5, table) != &values[1] || ck_float_hash_lookup(1.5f, table) != &values[3])
+        fail("Number keys mixed up");
+    /* Keyed by bits, so -0.0 isn't 0.0 */
+    if (ck_double_hash_lookup(0.0, table) != &values[2] || ck_double_hash_lookup(-0.0, table) != NULL)
+        fail("Number keys aren't keyed by their bits");
+
+    ck_hash_table_free(table);
+}
+
+int main(int argc, char *argv[]) {
+    test_grow();
+    test_collisions();
+    test_key_pool();
+    test_number_keys();
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../sas/ieee.h"
+
+static uint64_t lcg_state = 0x2545F4914F6CDD1D;
+
+static uint64_t lcg_next(void) {
+    lcg_state = lcg_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return lcg_state;
+}
+
+static long checked = 0;
+
+static void check_xport_value(uint64_t xport) {
+    unsigned char bytes[8];
+    double expected = 0.0, got = 0.0;
+    int i;
+
+    for (i=0; i<8; i++) {
+        bytes[i] = (xport >> (56 - 8*i)) & 0xFF;
+    }
+
+    if (cnxptiee(bytes, CN_TYPE_XPORT, &expected, CN_TYPE_NATIVE) != 0) {
+        fprintf(stderr, "cnxptiee failed on %016llx\n", (unsigned long long)xport);
+        exit(EXIT_FAILURE);
+    }
+    if (cnxptiee_batch(bytes, 8, &got, 1) != 0) {
+        fprintf(stderr, "cnxptiee_batch failed on %016llx\n", (unsigned long long)xport);
+        exit(EXIT_FAILURE);
+    }
+    if (memcmp(&expected, &got, sizeof(double)) != 0) {
+        fprintf(stderr, "Mismatch on %016llx: expected %g, got %g\n",
+                (unsigned long long)xport, expected, got);
+        exit(EXIT_FAILURE);
+    }
+    checked++;
+}
+
+static void test_exponents_and_mantissas(void) {
+    int first_byte, bit, nibble, i, width;
+    for (first_byte=0; first_byte<256; first_byte++) {
+        uint64_t hi = (uint64_t)first_byte << 56;
+
+        check_xport_value(hi);
+        check_xport_value(hi | 0x00FFFFFFFFFFFFFFULL);
+
+        for (bit=0; bit<56; bit++) {
+            check_xport_value(hi | (1ULL << bit));
+            check_xport_value(hi | ((1ULL << bit) - 1));
+            check_xport_value(hi | (0x00FFFFFFFFFFFFFFULL & ~(1ULL << bit)));
+        }
+
+        for (nibble=0; nibble<16; nibble++) {
+            for (i=0; i<64; i++) {
+                uint64_t mantissa = ((uint64_t)nibble << 52) | (lcg_next() & 0x000FFFFFFFFFFFFFULL);
+                check_xport_value(hi | mantissa);
+                /* Truncated storage widths zero-fill the low bytes */
+                for (width=3; width<8; width++) {
+                    check_xport_value(hi | (mantissa & ~((1ULL << 8*(8-width)) - 1)));
+                }
+            }
+        }
+    }
+}
+
+static void test_round_trip(void) {
+    int i;
+    for (i=0; i<100000; i++) {
+        uint64_t bits = lcg_next();
+        double value;
+        unsigned char xport[8];
+        uint64_t xport_bits = 0;
+        int j;
+
+        memcpy(&value, &bits, sizeof(double));
+        if (cnxptiee(&value, CN_TYPE_NATIVE, xport, CN_TYPE_XPORT) != 0) {
+            fprintf(stderr, "ieee2xpt failed\n");
+            exit(EXIT_FAILURE);
+        }
+        for (j=0; j<8; j++) {
+            xport_bits = (xport_bits << 8) | xport[j];
+        }
+        check_xport_value(xport_bits);
+    }
+}
+
+static void test_strided_batch(void) {
+    const size_t count = 4096, stride = 13;
+    unsigned char *buffer = calloc(count, stride);
+    double *got = calloc(count, sizeof(double));
+    size_t i;
+    int j;
+
+    for (i=0; i<count; i++) {
+        uint64_t xport = lcg_next();
+        for (j=0; j<8; j++) {
+            buffer[i*stride+j] = (xport >> (56 - 8*j)) & 0xFF;
+        }
+    }
+
+    if (cnxptiee_batch(buffer, stride, got, count) != 0) {
+        fprintf(stderr, "cnxptiee_batch failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i=0; i<count; i++) {
+        double expected;
+        cnxptiee(&buffer[i*stride], CN_TYPE_XPORT, &expected, CN_TYPE_NATIVE);
+        if (memcmp(&expected, &got[i], sizeof(double)) != 0) {
+            fprintf(stderr, "Strided batch mismatch at index %ld\n", (long)i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    free(buffer);
+    free(got);
+}
+
+int main(int argc, char *argv[]) {
+    test_exponents_and_mantissas();
+    test_round_trip();
+    test_strided_batch();
+
+    printf("Checked %ld XPORT values\n", checked);
+
+    return 0;
+}
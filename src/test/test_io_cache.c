@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../readstat.h"
+#include "../readstat_malloc.h"
+#include "../readstat_io_cache.h"
+
+#define TEST_IO_CACHE_LEN       10000
+#define TEST_IO_CACHE_BLOCK     1024
+
+typedef struct mem_io_ctx_s {
+    const unsigned char *data;
+    size_t               len;
+    readstat_off_t       pos;
+    long                 read_calls;
+    long                 seek_calls;
+} mem_io_ctx_t;
+
+static unsigned char test_data[TEST_IO_CACHE_LEN];
+
+static readstat_off_t mem_seek_handler(readstat_off_t offset, readstat_io_flags_t whence, void *io_ctx) {
+    mem_io_ctx_t *ctx = (mem_io_ctx_t *)io_ctx;
+    readstat_off_t target = offset;
+    if (whence == READSTAT_SEEK_CUR) {
+        if (offset == 0)
+            return ctx->pos;
+        target = ctx->pos + offset;
+    } else if (whence == READSTAT_SEEK_END) {
+        target = ctx->len + offset;
+    }
+    ctx->seek_calls++;
+    if (target < 0 || target > ctx->len)
+        return -1;
+    ctx->pos = target;
+    return target;
+}
+
+static ssize_t mem_read_handler(void *buf, size_t nbyte, void *io_ctx) {
+    mem_io_ctx_t *ctx = (mem_io_ctx_t *)io_ctx;
+    size_t n = ctx->len - ctx->pos < nbyte ? ctx->len - ctx->pos : nbyte;
+    ctx->read_calls++;
+    memcpy(buf, &ctx->data[ctx->pos], n);
+    ctx->pos += n;
+    return n;
+}
+
+static int mem_close_handler(void *io_ctx) {
+    return 0;
+}
+
+static void mem_io_init(readstat_io_t *io, mem_io_ctx_t *ctx) {
+    memset(ctx, 0, sizeof(mem_io_ctx_t));
+    ctx->data = test_data;
+    ctx->len = sizeof(test_data);
+
+    memset(io, 0, sizeof(readstat_io_t));
+    io->seek = &mem_seek_handler;
+    io->read = &mem_read_handler;
+    io->close = &mem_close_handler;
+    io->io_ctx = ctx;
+}
+
+static void expect_read(readstat_io_t *io, size_t len, readstat_off_t offset, size_t expected_len) {
+    unsigned char buf[TEST_IO_CACHE_LEN];
+    ssize_t bytes_read = io->read(buf, len, io->io_ctx);
+    if (bytes_read != expected_len) {
+        fprintf(stderr, "Read of %ld bytes at %ld returned %ld (expected %ld)\n",
+                (long)len, (long)offset, (long)bytes_read, (long)expected_len);
+        exit(EXIT_FAILURE);
+    }
+    if (memcmp(buf, &test_data[offset], expected_len) != 0) {
+        fprintf(stderr, "Read of %ld bytes at %ld returned the wrong data\n", (long)len, (long)offset);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void expect_seek(readstat_io_t *io, readstat_off_t offset, readstat_io_flags_t whence,
+        readstat_off_t expected) {
+    readstat_off_t position = io->seek(offset, whence, io->io_ctx);
+    if (position != expected) {
+        fprintf(stderr, "Seek to %ld (whence %d) returned %ld (expected %ld)\n",
+                (long)offset, whence, (long)position, (long)expected);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void expect_calls(mem_io_ctx_t *ctx, long read_calls, const char *what) {
+    if (ctx->read_calls != read_calls) {
+        fprintf(stderr, "%s: %ld reads from the source (expected %ld)\n", what, ctx->read_calls, read_calls);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void test_io_cache_fill() {
+    readstat_io_cache_t *cache = NULL;
+    readstat_io_t source, *io = &source;
+    mem_io_ctx_t ctx;
+
+    mem_io_init(&source, &ctx);
+    expect_seek(io, 100, READSTAT_SEEK_SET, 100);
+    if (readstat_io_cache_init(&cache, &io, TEST_IO_CACHE_BLOCK) != READSTAT_OK || io == &source) {
+        fprintf(stderr, "Error creating the cache\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Small reads are served a block at a time, from where the source was */
+    expect_read(io, 10, 100, 10);
+    expect_calls(&ctx, 1, "First read");
+    expect_read(io, 1000, 110, 1000);
+    expect_calls(&ctx, 1, "Read within the first block");
+    expect_read(io, 100, 1110, 100);
+    expect_calls(&ctx, 2, "Read across a block boundary");
+    expect_seek(io, 0, READSTAT_SEEK_CUR, 1210);
+
+    /* Seeking back into the cached region costs no I/O */
+    expect_seek(io, 100, READSTAT_SEEK_SET, 100);
+    expect_read(io, 2000, 100, 2000);
+    expect_calls(&ctx, 2, "Rereading the cached region");
+
+    /* A forward seek reads up to the target */
+    expect_seek(io, 5000, READSTAT_SEEK_SET, 5000);
+    expect_calls(&ctx, 5, "Seeking forward");
+    expect_read(io, 50, 5000, 50);
+    expect_seek(io, 300, READSTAT_SEEK_SET, 300);
+    expect_read(io, 4000, 300, 4000);
+    expect_calls(&ctx, 5, "Rereading after a forward seek");
+
+    /* Reads stop short at the end of the file */
+    expect_seek(io, -10, READSTAT_SEEK_END, TEST_IO_CACHE_LEN - 10);
+    expect_read(io, 100, TEST_IO_CACHE_LEN - 10, 10);
+    expect_read(io, 100, TEST_IO_CACHE_LEN, 0);
+
+    /* Behind the cached region the cache starts over */
+    expect_seek(io, 50, READSTAT_SEEK_SET, 50);
+    expect_read(io, 20, 50, 20);
+    expect_seek(io, 0, READSTAT_SEEK_CUR, 70);
+
+    if (readstat_io_cache_free(cache, &io) != READSTAT_OK || io != &source) {
+        fprintf(stderr, "Error freeing the cache\n");
+        exit(EXIT_FAILURE);
+    }
+    /* The source is left where the proxy was */
+    if (ctx.pos != 70) {
+        fprintf(stderr, "Source left at %ld (expected 70)\n", (long)ctx.pos);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void test_io_cache_read_through() {
+    readstat_io_cache_t *cache = NULL;
+    readstat_io_t source, *io = &source;
+    mem_io_ctx_t ctx;
+
+    mem_io_init(&source, &ctx);
+    if (readstat_io_cache_init(&cache, &io, TEST_IO_CACHE_BLOCK) != READSTAT_OK) {
+        fprintf(stderr, "Error creating the cache\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* A read bigger than a block keeps filling until it's satisfied */
+    expect_read(io, 3000, 0, 3000);
+    expect_calls(&ctx, 3, "Read of three blocks");
+    expect_read(io, TEST_IO_CACHE_LEN, 3000, TEST_IO_CACHE_LEN - 3000);
+
+    /* Released caches are reused, and start at the source's position */
+    expect_seek(io, 0, READSTAT_SEEK_SET, 0);
+    if (readstat_io_cache_release(cache, &io) != READSTAT_OK || io != &source || ctx.pos != 0) {
+        fprintf(stderr, "Error releasing the cache\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_seek(io, 2000, READSTAT_SEEK_SET, 2000);
+    if (readstat_io_cache_init(&cache, &io, TEST_IO_CACHE_BLOCK) != READSTAT_OK) {
+        fprintf(stderr, "Error reusing the cache\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_read(io, 500, 2000, 500);
+    readstat_io_cache_free(cache, &io);
+}
+
+static void test_io_cache_limit() {
+    readstat_io_cache_t *cache = NULL;
+    readstat_io_t source, *io = &source;
+    readstat_malloc_scope_t scope;
+    mem_io_ctx_t ctx;
+
+    /* Room for a couple of blocks but not the whole file: once the buffer
+     * can't grow, the cache drops what it has and keeps going */
+    readstat_malloc_scope_begin(&scope, 0, 3 * TEST_IO_CACHE_BLOCK);
+
+    mem_io_init(&source, &ctx);
+    if (readstat_io_cache_init(&cache, &io, TEST_IO_CACHE_BLOCK) != READSTAT_OK) {
+        fprintf(stderr, "Error creating the cache\n");
+        exit(EXIT_FAILURE);
+    }
+    expect_read(io, TEST_IO_CACHE_LEN, 0, TEST_IO_CACHE_LEN);
+    expect_seek(io, 100, READSTAT_SEEK_SET, 100);
+    expect_read(io, 100, 100, 100);
+    readstat_io_cache_free(cache, &io);
+
+    readstat_malloc_scope_end(&scope, READSTAT_OK);
+    if (scope.memory_used != 0) {
+        fprintf(stderr, "%ld bytes still held after freeing the cache\n", (long)scope.memory_used);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+    for (i=0; i<TEST_IO_CACHE_LEN; i++)
+        test_data[i] = (i * 7 + i / 256) & 0xFF;
+
+    test_io_cache_fill();
+    test_io_cache_read_through();
+    test_io_cache_limit();
+
+    return 0;
+}
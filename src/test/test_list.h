@@ -1053,6 +1053,126 @@ static rt_test_group_t _test_groups[] = {
                         }
                     }
                 }
+            },
+            {
+                .label = "SPSS missing value boundaries",
+                .test_formats = RT_FORMAT_SPSS,
+                .rows = 10,
+                .columns = {
+                    {
+                        .name = "DISCRETE",
+                        .type = READSTAT_TYPE_DOUBLE,
+                        .missing_ranges_count = 3,
+                        .missing_ranges = {
+                            { .lo = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 1.0 } },
+                              .hi = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 1.0 } } },
+                            { .lo = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 2.0 } },
+                              .hi = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 2.0 } } },
+                            { .lo = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.0 } },
+                              .hi = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.0 } } }
+                        },
+                        .values = {
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -1e6 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 0.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 9.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 10.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 99.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .is_system_missing = 1 }
+                        }
+                    },
+                    {
+                        .name = "RANGE",
+                        .type = READSTAT_TYPE_DOUBLE,
+                        .missing_ranges_count = 1,
+                        .missing_ranges = {
+                            { .lo = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 10.0 } },
+                              .hi = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.0 } } }
+                        },
+                        .values = {
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -1e6 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 0.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 9.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 10.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 99.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .is_system_missing = 1 }
+                        }
+                    },
+                    {
+                        .name = "RANGEVAL",
+                        .type = READSTAT_TYPE_DOUBLE,
+                        .missing_ranges_count = 2,
+                        .missing_ranges = {
+                            { .lo = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 10.0 } },
+                              .hi = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.0 } } },
+                            { .lo = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 99.0 } },
+                              .hi = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 99.0 } } }
+                        },
+                        .values = {
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -1e6 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 0.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 9.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 10.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 99.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .is_system_missing = 1 }
+                        }
+                    },
+                    {
+                        .name = "LOWEST",
+                        .type = READSTAT_TYPE_DOUBLE,
+                        .missing_ranges_count = 1,
+                        .missing_ranges = {
+                            { .lo = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -HUGE_VAL } },
+                              .hi = { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 0.0 } } }
+                        },
+                        .values = {
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -1e6 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 0.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 3.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 9.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 10.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 20.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 99.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .is_system_missing = 1 }
+                        }
+                    },
+                    {
+                        .name = "S",
+                        .type = READSTAT_TYPE_STRING,
+                        .missing_ranges_count = 2,
+                        .missing_ranges = {
+                            { .lo = { .type = READSTAT_TYPE_STRING, .v = { .string_value = "a" } },
+                              .hi = { .type = READSTAT_TYPE_STRING, .v = { .string_value = "a" } } },
+                            { .lo = { .type = READSTAT_TYPE_STRING, .v = { .string_value = "bb" } },
+                              .hi = { .type = READSTAT_TYPE_STRING, .v = { .string_value = "bb" } } }
+                        },
+                        .values = {
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "a" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "bb" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "b" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "aa" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "bbb" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "A" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "a" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "bb" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "c" } },
+                            { .type = READSTAT_TYPE_STRING, .v = { .string_value = "x" } }
+                        }
+                    }
+                }
             }
         }
     },
@@ -2034,6 +2154,31 @@ static rt_test_group_t _test_groups[] = {
                 }
             },
 
+            {
+                .label = "Base-30 numbers in POR",
+                .test_formats = RT_FORMAT_POR,
+                .rows = 10,
+                .columns = {
+                    {
+                        .name = "VAR1",
+                        .label = "Double-precision variable",
+                        .type = READSTAT_TYPE_DOUBLE,
+                        .values = {
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 0.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -0.25 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 27000.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -810000.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 123456789.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 1048576.5 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = -7.75 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 0.0 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = 1e15 } },
+                            { .type = READSTAT_TYPE_DOUBLE, .v = { .double_value = HUGE_VAL } }
+                        }
+                    }
+                }
+            },
+
             {
                 .label = "Extreme values",
                 .test_formats = RT_FORMAT_ALL,
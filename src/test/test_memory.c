@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../readstat.h"
+#include "../readstat_iconv.h"
+#include "../readstat_malloc.h"
+#include "../readstat_parallel.h"
+#include "../readstat_prefetch.h"
+
+#include "test_buffer.h"
+#include "test_buffer_io.h"
+
+#define TEST_MEMORY_ROWS        200000
+#define TEST_MEMORY_SMALL_ROWS  100
+#define TEST_MEMORY_COLUMNS     4
+#define TEST_MEMORY_THREADS     4
+#define TEST_MEMORY_JOB_LEN     4000
+#define TEST_MEMORY_READ_LEN    100000
+
+static void fail(const char *message) {
+    fprintf(stderr, "%s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static readstat_error_t alloc_job(void *job_ctx, int worker, long start, long end, long *out_failed_index) {
+    void **blocks = (void **)job_ctx;
+    long i;
+    for (i=start; i<end; i++) {
+        if ((blocks[i] = readstat_malloc(TEST_MEMORY_JOB_LEN)) == NULL) {
+            *out_failed_index = i;
+            return READSTAT_ERROR_MALLOC;
+        }
+    }
+    return READSTAT_OK;
+}
+
+static readstat_error_t run_alloc_jobs(size_t memory_limit, readstat_malloc_scope_t *scope) {
+    void *blocks[TEST_MEMORY_THREADS] = { NULL };
+    readstat_error_t error = READSTAT_OK;
+    int i;
+
+    readstat_malloc_scope_begin(scope, 0, memory_limit);
+    error = readstat_parallel_for(TEST_MEMORY_THREADS, TEST_MEMORY_THREADS, &alloc_job, blocks, NULL);
+    for (i=0; i<TEST_MEMORY_THREADS; i++)
+        readstat_free(blocks[i]);
+
+    return readstat_malloc_scope_end(scope, error);
+}
+
+/* Workers charge the scope of the thread that started them */
+static void test_parallel_scope() {
+    readstat_malloc_scope_t scope;
+
+    if (run_alloc_jobs(0, &scope) != READSTAT_OK)
+        fail("Worker allocations failed without a limit");
+    if (scope.peak_memory_used != TEST_MEMORY_THREADS * TEST_MEMORY_JOB_LEN || scope.memory_used != 0)
+        fail("Worker allocations weren't charged to the scope");
+
+    if (run_alloc_jobs(3 * TEST_MEMORY_JOB_LEN, &scope) != READSTAT_ERROR_MEMORY_LIMIT_EXCEEDED)
+        fail("Worker allocations went past the memory limit");
+    if (scope.peak_memory_used > 3 * TEST_MEMORY_JOB_LEN || scope.memory_used != 0)
+        fail("Worker allocations past the memory limit were charged");
+}
+
+static ssize_t allocating_read_handler(void *buf, size_t nbyte, void *io_ctx) {
+    void *scratch = readstat_malloc(TEST_MEMORY_READ_LEN);
+    if (scratch == NULL)
+        return -1;
+    readstat_free(scratch);
+    memset(buf, 'x', nbyte);
+    return nbyte;
+}
+
+static readstat_off_t zero_seek_handler(readstat_off_t offset, readstat_io_flags_t whence, void *io_ctx) {
+    return 0;
+}
+
+/* The read-ahead thread charges the scope of the thread that created it */
+static void test_prefetch_scope() {
+    readstat_malloc_scope_t scope;
+    readstat_prefetch_t *prefetch = NULL;
+    readstat_io_t source = { .read = &allocating_read_handler, .seek = &zero_seek_handler };
+    readstat_io_t *io = &source;
+    char buf[1000];
+
+    readstat_malloc_scope_begin(&scope, 0, 0);
+    if (readstat_prefetch_init(&prefetch, &io, 2, sizeof(buf)) != READSTAT_OK)
+        fail("Error starting the prefetch thread");
+    if (prefetch && io->read(buf, sizeof(buf), io->io_ctx) != sizeof(buf))
+        fail("Error reading through the prefetch thread");
+    readstat_prefetch_free(prefetch, &io);
+    readstat_malloc_scope_end(&scope, READSTAT_OK);
+
+    /* Without thread support there's nothing to check */
+    if (prefetch && scope.peak_memory_used < TEST_MEMORY_READ_LEN)
+        fail("Prefetch thread allocations weren't charged to the scope");
+    if (scope.memory_used != 0)
+        fail("Prefetch memory still held after freeing it");
+}
+
+static void write_file(rt_buffer_t *buffer, long rows) {
+    readstat_writer_t *writer = readstat_writer_init();
+    readstat_variable_t *variables[TEST_MEMORY_COLUMNS];
+    readstat_error_t error = READSTAT_OK;
+    char name[16];
+    long i;
+    int j;
+
+    readstat_set_data_writer(writer, &rt_write_handler);
+    for (j=0; j<TEST_MEMORY_COLUMNS; j++) {
+        snprintf(name, sizeof(name), "x%d", j);
+        variables[j] = readstat_add_variable(writer, name, READSTAT_TYPE_DOUBLE, 0);
+    }
+
+    error = readstat_begin_writing_sav(writer, buffer, rows);
+    for (i=0; i<rows && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        for (j=0; j<TEST_MEMORY_COLUMNS && error == READSTAT_OK; j++)
+            error = readstat_insert_double_value(writer, variables[j], i + j);
+        if (error == READSTAT_OK)
+            error = readstat_end_row(writer);
+    }
+    if (error == READSTAT_OK)
+        error = readstat_end_writing(writer);
+
+    readstat_writer_free(writer);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error writing %ld rows: %s\n", rows, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static int handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    long *values = (long *)ctx;
+    (*values)++;
+    return READSTAT_HANDLER_OK;
+}
+
+static readstat_parser_t *threaded_parser_init(rt_buffer_ctx_t *buffer_ctx, size_t memory_limit) {
+    readstat_parser_t *parser = readstat_parser_init();
+    rt_set_io_handlers(parser, buffer_ctx);
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_handler(parser, &handle_value);
+    readstat_set_thread_count(parser, TEST_MEMORY_THREADS);
+    readstat_set_prefetch_depth(parser, 2);
+    readstat_set_memory_limit(parser, memory_limit);
+    return parser;
+}
+
+/* Parses the start of the buffer */
+static readstat_error_t parse_buffer(readstat_parser_t *parser, rt_buffer_ctx_t *buffer_ctx, long *values) {
+    buffer_ctx->pos = 0;
+    return readstat_parse_sav(parser, NULL, values);
+}
+
+static void test_parse_limit(rt_buffer_ctx_t *buffer_ctx) {
+    readstat_parser_t *parser = threaded_parser_init(buffer_ctx, 0);
+    readstat_parser_stats_t stats;
+    readstat_error_t error = READSTAT_OK;
+    long values = 0;
+    size_t peak = 0;
+
+    if ((error = parse_buffer(parser, buffer_ctx, &values)) != READSTAT_OK) {
+        fprintf(stderr, "Error parsing with threads and prefetch on: %s\n", readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (values != (long)TEST_MEMORY_ROWS * TEST_MEMORY_COLUMNS)
+        fail("Wrong number of values with threads and prefetch on");
+    readstat_parser_get_stats(parser, &stats);
+    peak = stats.peak_memory_used;
+    readstat_parser_free(parser);
+
+    /* At least the ring of read-ahead buffers */
+    if (peak < 2 * READSTAT_PREFETCH_BLOCK_SIZE) {
+        fprintf(stderr, "Peak memory of %ld bytes with threads and prefetch on\n", (long)peak);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Too little for the read-ahead ring */
+    parser = threaded_parser_init(buffer_ctx, READSTAT_PREFETCH_BLOCK_SIZE);
+    values = 0;
+    if ((error = parse_buffer(parser, buffer_ctx, &values)) != READSTAT_ERROR_MEMORY_LIMIT_EXCEEDED) {
+        fprintf(stderr, "Parsing past the memory limit returned: %s\n", readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    readstat_parser_get_stats(parser, &stats);
+    if (stats.peak_memory_used == 0 || stats.peak_memory_used > READSTAT_PREFETCH_BLOCK_SIZE)
+        fail("Peak memory wasn't reported within the limit");
+    readstat_parser_free(parser);
+}
+
+/* What a parser keeps between parses is charged to each of them */
+static void test_reuse_peak(rt_buffer_ctx_t *buffer_ctx) {
+    readstat_parser_t *parser = threaded_parser_init(buffer_ctx, 0);
+    readstat_parser_stats_t stats;
+    size_t first_peak = 0;
+    long values = 0;
+    int i;
+
+    readstat_set_context_reuse(parser, 1);
+    for (i=0; i<3; i++) {
+        if (parse_buffer(parser, buffer_ctx, &values) != READSTAT_OK)
+            fail("Error parsing with context reuse on");
+        readstat_parser_get_stats(parser, &stats);
+        if (i == 0) {
+            first_peak = stats.peak_memory_used;
+        } else if (stats.peak_memory_used < first_peak / 2) {
+            fprintf(stderr, "Peak memory of %ld bytes on parse %d with context reuse (%ld on the first)\n",
+                    (long)stats.peak_memory_used, i + 1, (long)first_peak);
+            exit(EXIT_FAILURE);
+        }
+    }
+    readstat_parser_free(parser);
+
+    /* The kept memory counts towards the limit */
+    parser = threaded_parser_init(buffer_ctx, first_peak);
+    readstat_set_context_reuse(parser, 1);
+    if (parse_buffer(parser, buffer_ctx, &values) != READSTAT_OK)
+        fail("Error parsing within the memory limit");
+    readstat_set_memory_limit(parser, 1000);
+    if (parse_buffer(parser, buffer_ctx, &values) != READSTAT_ERROR_MEMORY_LIMIT_EXCEEDED)
+        fail("Kept memory didn't count towards the memory limit");
+    readstat_parser_free(parser);
+}
+
+int main(int argc, char *argv[]) {
+    rt_buffer_t *buffer = buffer_init();
+    rt_buffer_ctx_t *buffer_ctx = buffer_ctx_init(buffer);
+
+    test_parallel_scope();
+    test_prefetch_scope();
+
+    write_file(buffer, TEST_MEMORY_ROWS);
+    test_parse_limit(buffer_ctx);
+
+    buffer_ctx_reset(buffer_ctx);
+    write_file(buffer, TEST_MEMORY_SMALL_ROWS);
+    test_reuse_peak(buffer_ctx);
+
+    free(buffer_ctx);
+    buffer_free(buffer);
+
+    return 0;
+}
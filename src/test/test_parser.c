@@ -0,0 +1,1000 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "../readstat.h"
+
+#include "test_buffer.h"
+#include "test_buffer_io.h"
+
+/* Parser options and failures that the round trips in test_readstat don't
+ * cover: label lookup, string dictionaries, strings with NULs in them,
+ * parsers reused after a failed parse, and read handlers that return less
+ * than they're asked for */
+
+#define TEST_LOOKUP_ROWS        3
+#define TEST_LOOKUP_LABELS      100
+
+#define TEST_DICT_ROWS          2000
+#define TEST_DICT_LIMIT         4
+#define TEST_DICT_HIGH          50
+
+#define TEST_VIEW_WIDTH         8
+#define TEST_VIEW_MARKER        'X'
+
+#define TEST_REUSE_LOG_LEN      65536
+#define TEST_REUSE_ROWS         50
+#define TEST_REUSE_ABORT_ROW    20
+
+#define TEST_SHORT_READ_ROWS    20000
+#define TEST_SHORT_READ_COLUMNS 5
+#define TEST_SHORT_READ_LEN     (64 * 1024)
+
+typedef struct parser_format_s {
+    const char     *name;
+    readstat_type_t label_type;
+    readstat_error_t (*begin_writing)(readstat_writer_t *writer, void *user_ctx, long row_count);
+    readstat_error_t (*parse)(readstat_parser_t *parser, const char *path, void *user_ctx);
+} parser_format_t;
+
+static const parser_format_t dta_format = {
+    "DTA", READSTAT_TYPE_INT32, &readstat_begin_writing_dta, &readstat_parse_dta };
+static const parser_format_t sav_format = {
+    "SAV", READSTAT_TYPE_DOUBLE, &readstat_begin_writing_sav, &readstat_parse_sav };
+static const parser_format_t sas7bdat_format = {
+    "SAS7BDAT", READSTAT_TYPE_DOUBLE, &readstat_begin_writing_sas7bdat, &readstat_parse_sas7bdat };
+static const parser_format_t xport_format = {
+    "XPORT", READSTAT_TYPE_DOUBLE, &readstat_begin_writing_xport, &readstat_parse_xport };
+
+static const parser_format_t *string_formats[] = { &dta_format, &sav_format, &sas7bdat_format };
+static const parser_format_t *label_formats[] = { &dta_format, &sav_format };
+static const parser_format_t *short_read_formats[] = { &dta_format, &sav_format, &xport_format };
+
+#define FORMAT_COUNT(formats) (sizeof(formats) / sizeof(formats[0]))
+
+static void fail(const char *message) {
+    fprintf(stderr, "%s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static readstat_writer_t *buffer_writer_init(rt_buffer_t *buffer) {
+    readstat_writer_t *writer = readstat_writer_init();
+    buffer_reset(buffer);
+    readstat_set_data_writer(writer, &rt_write_handler);
+    return writer;
+}
+
+static void buffer_writer_finish(readstat_writer_t *writer, const parser_format_t *format,
+        readstat_error_t error) {
+    if (error == READSTAT_OK)
+        error = readstat_end_writing(writer);
+    readstat_writer_free(writer);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error writing %s: %s\n", format->name, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static readstat_parser_t *buffer_parser_init(rt_buffer_ctx_t *buffer_ctx) {
+    readstat_parser_t *parser = readstat_parser_init();
+    rt_set_io_handlers(parser, buffer_ctx);
+    return parser;
+}
+
+/* Parses the buffer, or fails to open it if there is none */
+static readstat_error_t parse_buffer(readstat_parser_t *parser, const parser_format_t *format,
+        rt_buffer_ctx_t *buffer_ctx, rt_buffer_t *buffer, void *user_ctx) {
+    buffer_ctx->buffer = buffer;
+    buffer_ctx->pos = 0;
+    return format->parse(parser, NULL, user_ctx);
+}
+
+static int handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    return READSTAT_HANDLER_OK;
+}
+
+/* Value label lookup */
+
+typedef struct lookup_record_s {
+    readstat_value_label_lookup_t mode;
+    int     values;
+    int     wrong;
+} lookup_record_t;
+
+static int fail_next_malloc;
+
+static void *failing_malloc(size_t len) {
+    if (fail_next_malloc) {
+        fail_next_malloc = 0;
+        return NULL;
+    }
+    return malloc(len);
+}
+
+/* x is labelled 1 to TEST_LOOKUP_LABELS except for its last value; y is
+ * unlabelled */
+static void write_lookup_file(rt_buffer_t *buffer) {
+    readstat_writer_t *writer = buffer_writer_init(buffer);
+    readstat_label_set_t *label_set = NULL;
+    readstat_variable_t *x = NULL, *y = NULL;
+    readstat_error_t error = READSTAT_OK;
+    char label[32];
+    int i;
+
+    label_set = readstat_add_label_set(writer, READSTAT_TYPE_DOUBLE, "xl");
+    for (i=1; i<=TEST_LOOKUP_LABELS; i++) {
+        snprintf(label, sizeof(label), "label %d", i);
+        readstat_label_double_value(label_set, i, label);
+    }
+    x = readstat_add_variable(writer, "x", READSTAT_TYPE_DOUBLE, 0);
+    readstat_variable_set_label_set(x, label_set);
+    y = readstat_add_variable(writer, "y", READSTAT_TYPE_DOUBLE, 0);
+
+    error = readstat_begin_writing_sav(writer, buffer, TEST_LOOKUP_ROWS);
+    for (i=0; i<TEST_LOOKUP_ROWS && error == READSTAT_OK; i++) {
+        double value = (i == TEST_LOOKUP_ROWS - 1) ? TEST_LOOKUP_LABELS + 1 : i + 1;
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        if ((error = readstat_insert_double_value(writer, x, value)) != READSTAT_OK)
+            break;
+        if ((error = readstat_insert_double_value(writer, y, value)) != READSTAT_OK)
+            break;
+        error = readstat_end_row(writer);
+    }
+    buffer_writer_finish(writer, &sav_format, error);
+}
+
+/* Checks each value against what the lookup mode should make of it */
+static int lookup_handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    lookup_record_t *record = (lookup_record_t *)ctx;
+    int labelled = (strcmp(readstat_variable_get_name(variable), "x") == 0 && obs_index < TEST_LOOKUP_ROWS - 1);
+    double number = (obs_index == TEST_LOOKUP_ROWS - 1) ? TEST_LOOKUP_LABELS + 1 : obs_index + 1;
+    const char *label = NULL;
+    char expected[32];
+
+    snprintf(expected, sizeof(expected), "label %d", obs_index + 1);
+    record->values++;
+
+    if (record->mode == READSTAT_VALUE_LABEL_LOOKUP_SUBSTITUTE && labelled) {
+        if (readstat_value_type(value) != READSTAT_TYPE_STRING ||
+                strcmp(readstat_string_value(value), expected) != 0)
+            record->wrong++;
+        return READSTAT_HANDLER_OK;
+    }
+
+    if (readstat_value_type(value) != READSTAT_TYPE_DOUBLE || readstat_double_value(value) != number)
+        record->wrong++;
+
+    label = readstat_lookup_value_label(variable, value);
+    if (record->mode == READSTAT_VALUE_LABEL_LOOKUP_NONE || !labelled) {
+        if (label != NULL)
+            record->wrong++;
+    } else if (label == NULL || strcmp(label, expected) != 0) {
+        record->wrong++;
+    }
+    return READSTAT_HANDLER_OK;
+}
+
+/* Hits, misses (an unlabelled value, an unlabelled variable) and
+ * substitution */
+static void test_lookup(rt_buffer_t *buffer, rt_buffer_ctx_t *buffer_ctx) {
+    readstat_value_label_lookup_t modes[] = {
+        READSTAT_VALUE_LABEL_LOOKUP_NONE,
+        READSTAT_VALUE_LABEL_LOOKUP_INDEX,
+        READSTAT_VALUE_LABEL_LOOKUP_SUBSTITUTE
+    };
+    int i;
+
+    for (i=0; i<sizeof(modes)/sizeof(modes[0]); i++) {
+        readstat_parser_t *parser = buffer_parser_init(buffer_ctx);
+        lookup_record_t record = { .mode = modes[i] };
+        readstat_error_t error = READSTAT_OK;
+
+        readstat_set_variable_handler(parser, &handle_variable);
+        readstat_set_value_handler(parser, &lookup_handle_value);
+        readstat_set_value_label_lookup(parser, modes[i]);
+
+        error = parse_buffer(parser, &sav_format, buffer_ctx, buffer, &record);
+        readstat_parser_free(parser);
+
+        if (error != READSTAT_OK) {
+            fprintf(stderr, "Error parsing with lookup mode %d: %s\n", modes[i], readstat_error_message(error));
+            exit(EXIT_FAILURE);
+        }
+        if (record.values != 2 * TEST_LOOKUP_ROWS || record.wrong) {
+            fprintf(stderr, "%d of %d values wrong with lookup mode %d\n", record.wrong, record.values, modes[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/* Arms the allocator to fail once labels start arriving, so that the index
+ * runs out of memory while growing */
+static int handle_value_label_failing(const char *val_labels, readstat_value_t value,
+        const char *label, void *ctx) {
+    fail_next_malloc = 1;
+    return READSTAT_HANDLER_OK;
+}
+
+/* Running out of memory in the label index is reported as such, and not as
+ * a handler abort (or not at all: SAV carries on past aborted labels) */
+static void test_lookup_out_of_memory(rt_buffer_t *buffer, rt_buffer_ctx_t *buffer_ctx) {
+    readstat_parser_t *parser = buffer_parser_init(buffer_ctx);
+    lookup_record_t record = { .mode = READSTAT_VALUE_LABEL_LOOKUP_INDEX };
+    readstat_error_t error = READSTAT_OK;
+
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_handler(parser, &lookup_handle_value);
+    readstat_set_value_label_handler(parser, &handle_value_label_failing);
+    readstat_set_value_label_lookup(parser, READSTAT_VALUE_LABEL_LOOKUP_INDEX);
+
+    readstat_set_allocator(&failing_malloc, NULL, NULL);
+    error = parse_buffer(parser, &sav_format, buffer_ctx, buffer, &record);
+    readstat_set_allocator(NULL, NULL, NULL);
+    readstat_parser_free(parser);
+
+    if (fail_next_malloc)
+        fail("No allocation after the labels arrived");
+    if (error != READSTAT_ERROR_MALLOC) {
+        fprintf(stderr, "Label index out of memory returned: %s\n", readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* x is bound to the set "lx", which holds 1 => "one" if `labelled' and
+ * nothing otherwise; every value of x is 1 */
+static void write_lookup_bound_file(rt_buffer_t *buffer, const parser_format_t *format, int labelled) {
+    readstat_writer_t *writer = buffer_writer_init(buffer);
+    readstat_label_set_t *label_set = NULL;
+    readstat_variable_t *x = NULL;
+    readstat_error_t error = READSTAT_OK;
+    int i;
+
+    label_set = readstat_add_label_set(writer, format->label_type, "lx");
+    if (labelled && format->label_type == READSTAT_TYPE_INT32) {
+        readstat_label_int32_value(label_set, 1, "one");
+    } else if (labelled) {
+        readstat_label_double_value(label_set, 1, "one");
+    }
+    x = readstat_add_variable(writer, "x", format->label_type, 0);
+    readstat_variable_set_label_set(x, label_set);
+
+    error = format->begin_writing(writer, buffer, TEST_LOOKUP_ROWS);
+    for (i=0; i<TEST_LOOKUP_ROWS && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        if (format->label_type == READSTAT_TYPE_INT32) {
+            error = readstat_insert_int32_value(writer, x, 1);
+        } else {
+            error = readstat_insert_double_value(writer, x, 1);
+        }
+        if (error == READSTAT_OK)
+            error = readstat_end_row(writer);
+    }
+    buffer_writer_finish(writer, format, error);
+}
+
+/* Counts values that arrive labelled */
+static int lookup_handle_value_labelled(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    lookup_record_t *record = (lookup_record_t *)ctx;
+    record->values++;
+    if (readstat_value_type(value) == READSTAT_TYPE_STRING ||
+            readstat_lookup_value_label(variable, value) != NULL)
+        record->wrong++;
+    return READSTAT_HANDLER_OK;
+}
+
+/* A file whose variable names a set that it doesn't fill gets no labels,
+ * even from an earlier file that filled a set of that name */
+static void test_lookup_across_parses(const parser_format_t *format, rt_buffer_ctx_t *buffer_ctx) {
+    rt_buffer_t *labelled = buffer_init();
+    rt_buffer_t *unlabelled = buffer_init();
+    readstat_parser_t *parser = buffer_parser_init(buffer_ctx);
+    lookup_record_t record = { .mode = READSTAT_VALUE_LABEL_LOOKUP_SUBSTITUTE };
+    readstat_error_t error = READSTAT_OK;
+
+    write_lookup_bound_file(labelled, format, 1);
+    write_lookup_bound_file(unlabelled, format, 0);
+
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_label_lookup(parser, READSTAT_VALUE_LABEL_LOOKUP_SUBSTITUTE);
+
+    if ((error = parse_buffer(parser, format, buffer_ctx, labelled, &record)) == READSTAT_OK) {
+        readstat_set_value_handler(parser, &lookup_handle_value_labelled);
+        error = parse_buffer(parser, format, buffer_ctx, unlabelled, &record);
+    }
+    readstat_parser_free(parser);
+    buffer_free(labelled);
+    buffer_free(unlabelled);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing %s across parses: %s\n", format->name, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (record.values != TEST_LOOKUP_ROWS || record.wrong) {
+        fprintf(stderr, "%d of %d %s values labelled by an earlier parse\n",
+                record.wrong, record.values, format->name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* String dictionaries */
+
+/* Exactly TEST_DICT_LIMIT distinct strings, one of them empty */
+static const char *low_strings[] = { "red", "green", "", "blue" };
+
+#define TEST_DICT_LOW   (sizeof(low_strings) / sizeof(low_strings[0]))
+
+typedef struct dict_column_s {
+    const char *entries[TEST_DICT_HIGH];
+    int         entry_count;
+    int         encoded;
+    int         plain;
+} dict_column_t;
+
+typedef struct dict_record_s {
+    dict_column_t   columns[2];
+    int             values;
+    int             wrong;
+} dict_record_t;
+
+/* Column 0 repeats a few strings; column 1 has too many for the limit, and
+ * repeats them after it's past it */
+static void cell_string(char *string, size_t len, int column, int row) {
+    if (column == 0) {
+        snprintf(string, len, "%s", low_strings[row % TEST_DICT_LOW]);
+    } else {
+        snprintf(string, len, "s%d", row % TEST_DICT_HIGH);
+    }
+}
+
+static void write_dictionary_file(rt_buffer_t *buffer, const parser_format_t *format) {
+    readstat_writer_t *writer = buffer_writer_init(buffer);
+    readstat_variable_t *variables[2];
+    readstat_error_t error = READSTAT_OK;
+    char string[16];
+    int i, j;
+
+    variables[0] = readstat_add_variable(writer, "low", READSTAT_TYPE_STRING, 8);
+    variables[1] = readstat_add_variable(writer, "high", READSTAT_TYPE_STRING, 8);
+
+    error = format->begin_writing(writer, buffer, TEST_DICT_ROWS);
+    for (i=0; i<TEST_DICT_ROWS && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        for (j=0; j<2 && error == READSTAT_OK; j++) {
+            cell_string(string, sizeof(string), j, i);
+            error = readstat_insert_string_value(writer, variables[j], string);
+        }
+        if (error == READSTAT_OK)
+            error = readstat_end_row(writer);
+    }
+    buffer_writer_finish(writer, format, error);
+}
+
+/* Codes are handed out in order, each before its first use */
+static int dict_handle_entry(readstat_variable_t *variable, int code,
+        const char *string, void *ctx) {
+    dict_record_t *record = (dict_record_t *)ctx;
+    dict_column_t *column = &record->columns[readstat_variable_get_index(variable)];
+
+    if (code != column->entry_count || code >= TEST_DICT_LIMIT || string == NULL) {
+        record->wrong++;
+        return READSTAT_HANDLER_OK;
+    }
+    column->entries[column->entry_count++] = string;
+    return READSTAT_HANDLER_OK;
+}
+
+static int dict_handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    dict_record_t *record = (dict_record_t *)ctx;
+    int index = readstat_variable_get_index(variable);
+    dict_column_t *column = &record->columns[index];
+    const char *string = readstat_string_value(value);
+    int code = readstat_value_dictionary_code(value);
+    char expected[16];
+
+    cell_string(expected, sizeof(expected), index, obs_index);
+    record->values++;
+
+    if (strcmp(string ? string : "", expected) != 0)
+        record->wrong++;
+
+    if (code == -1) {
+        if (value.is_dictionary_encoded)
+            record->wrong++;
+        column->plain++;
+        return READSTAT_HANDLER_OK;
+    }
+
+    /* The entry itself, which is still the string it was when it arrived */
+    column->encoded++;
+    if (code >= column->entry_count || value.v.string_value != column->entries[code] ||
+            strcmp(column->entries[code], expected) != 0)
+        record->wrong++;
+    return READSTAT_HANDLER_OK;
+}
+
+static void parse_dictionary_file(dict_record_t *record, const parser_format_t *format,
+        rt_buffer_t *buffer, rt_buffer_ctx_t *buffer_ctx, int limit, int thread_count) {
+    readstat_parser_t *parser = buffer_parser_init(buffer_ctx);
+    readstat_error_t error = READSTAT_OK;
+
+    memset(record, 0, sizeof(dict_record_t));
+
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_handler(parser, &dict_handle_value);
+    readstat_set_dictionary_entry_handler(parser, &dict_handle_entry);
+    readstat_set_string_dictionary_limit(parser, limit);
+    readstat_set_thread_count(parser, thread_count);
+
+    error = parse_buffer(parser, format, buffer_ctx, buffer, record);
+    readstat_parser_free(parser);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing %s: %s\n", format->name, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (record->values != 2 * TEST_DICT_ROWS || record->wrong) {
+        fprintf(stderr, "%d of %d values wrong in %s (limit %d, %d threads)\n",
+                record->wrong, record->values, format->name, limit, thread_count);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void test_dictionary(const parser_format_t *format, rt_buffer_t *buffer,
+        rt_buffer_ctx_t *buffer_ctx, int thread_count) {
+    dict_record_t record;
+
+    /* Off */
+    parse_dictionary_file(&record, format, buffer, buffer_ctx, 0, thread_count);
+    if (record.columns[0].encoded || record.columns[1].encoded ||
+            record.columns[0].entry_count || record.columns[1].entry_count)
+        fail("Strings were dictionary-encoded with the dictionary off");
+
+    /* Right at the limit: every value comes from the dictionary */
+    parse_dictionary_file(&record, format, buffer, buffer_ctx, TEST_DICT_LIMIT, thread_count);
+    if (record.columns[0].entry_count != TEST_DICT_LOW || record.columns[0].encoded != TEST_DICT_ROWS) {
+        fprintf(stderr, "%s: %d entries for %d values (%d threads)\n", format->name,
+                record.columns[0].entry_count, record.columns[0].encoded, thread_count);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Past it: the first strings keep their codes, and everything from the
+     * first string too many on is plain, repeats included */
+    if (record.columns[1].entry_count != TEST_DICT_LIMIT ||
+            record.columns[1].encoded != TEST_DICT_LIMIT ||
+            record.columns[1].plain != TEST_DICT_ROWS - TEST_DICT_LIMIT) {
+        fprintf(stderr, "%s: %d entries, %d encoded and %d plain values past the limit (%d threads)\n",
+                format->name, record.columns[1].entry_count, record.columns[1].encoded,
+                record.columns[1].plain, thread_count);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Strings with NULs in them */
+
+/* The marker is patched to a NUL once the file is written */
+static const char *view_strings[] = {
+    "plain", "trail  ", "", "full8chr", "ab" "X" "cd", " lead", "a  " "X" "  b", "X" "xyz"
+};
+
+#define TEST_VIEW_ROWS  (sizeof(view_strings) / sizeof(view_strings[0]))
+
+typedef struct view_record_s {
+    char    strings[TEST_VIEW_ROWS][TEST_VIEW_WIDTH + 1];
+    size_t  lens[TEST_VIEW_ROWS];
+    int     values;
+    int     wrong;
+} view_record_t;
+
+/* Turns each marker in the written strings into a NUL */
+static void patch_markers(rt_buffer_t *buffer, const parser_format_t *format) {
+    int i, patched = 0;
+
+    for (i=0; i<TEST_VIEW_ROWS; i++) {
+        const char *string = view_strings[i];
+        const char *marker = strchr(string, TEST_VIEW_MARKER);
+        size_t string_len = strlen(string);
+        size_t offset;
+        if (marker == NULL)
+            continue;
+        for (offset=0; offset + string_len <= buffer->used; offset++) {
+            if (memcmp(&buffer->bytes[offset], string, string_len) == 0) {
+                buffer->bytes[offset + (marker - string)] = '\0';
+                patched++;
+                break;
+            }
+        }
+    }
+
+    if (patched != 3) {
+        fprintf(stderr, "Patched %d strings in %s\n", patched, format->name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void write_view_file(rt_buffer_t *buffer, const parser_format_t *format) {
+    readstat_writer_t *writer = buffer_writer_init(buffer);
+    readstat_variable_t *variable = NULL;
+    readstat_error_t error = READSTAT_OK;
+    int i;
+
+    variable = readstat_add_variable(writer, "s", READSTAT_TYPE_STRING, TEST_VIEW_WIDTH);
+
+    error = format->begin_writing(writer, buffer, TEST_VIEW_ROWS);
+    for (i=0; i<TEST_VIEW_ROWS && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        if ((error = readstat_insert_string_value(writer, variable, view_strings[i])) != READSTAT_OK)
+            break;
+        error = readstat_end_row(writer);
+    }
+    buffer_writer_finish(writer, format, error);
+    patch_markers(buffer, format);
+}
+
+static void record_string(view_record_t *record, int obs_index, const char *string, size_t len) {
+    if (obs_index < 0 || obs_index >= TEST_VIEW_ROWS || len > TEST_VIEW_WIDTH) {
+        record->wrong++;
+        return;
+    }
+    memcpy(record->strings[obs_index], string, len);
+    record->strings[obs_index][len] = '\0';
+    record->lens[obs_index] = len;
+    record->values++;
+}
+
+static int view_handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    const char *string = readstat_string_value(value);
+    if (string == NULL)
+        string = "";
+    record_string((view_record_t *)ctx, obs_index, string, strlen(string));
+    return READSTAT_HANDLER_OK;
+}
+
+static int view_handle_string_view(int obs_index, readstat_variable_t *variable,
+        const char *string, size_t len, void *ctx) {
+    view_record_t *record = (view_record_t *)ctx;
+    if (memchr(string, '\0', len))
+        record->wrong++;
+    record_string(record, obs_index, string, len);
+    return READSTAT_HANDLER_OK;
+}
+
+static void parse_view_file(view_record_t *record, const parser_format_t *format, rt_buffer_t *buffer,
+        rt_buffer_ctx_t *buffer_ctx, const char *encoding, int use_view) {
+    readstat_parser_t *parser = buffer_parser_init(buffer_ctx);
+    readstat_error_t error = READSTAT_OK;
+
+    memset(record, 0, sizeof(view_record_t));
+
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_handler(parser, &view_handle_value);
+    if (use_view)
+        readstat_set_string_view_handler(parser, &view_handle_string_view);
+    if (encoding)
+        readstat_set_file_character_encoding(parser, encoding);
+
+    error = parse_buffer(parser, format, buffer_ctx, buffer, record);
+    readstat_parser_free(parser);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing %s: %s\n", format->name, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (record->values != TEST_VIEW_ROWS || record->wrong) {
+        fprintf(stderr, "%d of %d strings wrong in %s\n", record->wrong, record->values, format->name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Views stop at a NUL as the values do, with and without transcoding */
+static void test_string_view_nul(const parser_format_t *format, rt_buffer_t *buffer,
+        rt_buffer_ctx_t *buffer_ctx, const char *encoding) {
+    view_record_t values, views;
+    int i;
+
+    parse_view_file(&values, format, buffer, buffer_ctx, encoding, 0);
+    parse_view_file(&views, format, buffer, buffer_ctx, encoding, 1);
+
+    for (i=0; i<TEST_VIEW_ROWS; i++) {
+        if (views.lens[i] != values.lens[i] || strcmp(views.strings[i], values.strings[i]) != 0) {
+            fprintf(stderr, "%s row %d: view \"%s\" but value \"%s\" (%s)\n", format->name, i,
+                    views.strings[i], values.strings[i], encoding ? encoding : "no transcoding");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/* Context reuse after a failed parse */
+
+/* Everything the handlers were told, in order */
+typedef struct reuse_log_s {
+    char    text[TEST_REUSE_LOG_LEN];
+    size_t  len;
+    int     abort_row;
+} reuse_log_t;
+
+static void log_append(reuse_log_t *log, const char *format, ...) {
+    va_list args;
+    int len = 0;
+
+    va_start(args, format);
+    len = vsnprintf(&log->text[log->len], sizeof(log->text) - log->len, format, args);
+    va_end(args);
+    if (len < 0 || len >= sizeof(log->text) - log->len)
+        fail("Log is full");
+    log->len += len;
+}
+
+static const char *string_or_empty(const char *string) {
+    return string ? string : "";
+}
+
+static readstat_error_t write_wide_rows(readstat_writer_t *writer, const parser_format_t *format,
+        readstat_variable_t **variables) {
+    readstat_error_t error = READSTAT_OK;
+    char string[32];
+    int i;
+
+    for (i=0; i<TEST_REUSE_ROWS; i++) {
+        snprintf(string, sizeof(string), "name %d", i);
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            goto cleanup;
+        if ((error = readstat_insert_double_value(writer, variables[0], i * 1.5)) != READSTAT_OK)
+            goto cleanup;
+        if ((error = readstat_insert_string_value(writer, variables[1], string)) != READSTAT_OK)
+            goto cleanup;
+        if (format->label_type == READSTAT_TYPE_INT32) {
+            error = readstat_insert_int32_value(writer, variables[2], i % 3);
+        } else {
+            error = readstat_insert_double_value(writer, variables[2], i % 3);
+        }
+        if (error != READSTAT_OK)
+            goto cleanup;
+        if ((error = readstat_end_row(writer)) != READSTAT_OK)
+            goto cleanup;
+    }
+cleanup:
+    return error;
+}
+
+static readstat_error_t write_narrow_rows(readstat_writer_t *writer, readstat_variable_t **variables) {
+    readstat_error_t error = READSTAT_OK;
+    int i;
+
+    for (i=0; i<TEST_REUSE_ROWS / 2; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            goto cleanup;
+        if ((error = readstat_insert_string_value(writer, variables[0], i % 2 ? "odd" : "even")) != READSTAT_OK)
+            goto cleanup;
+        if ((error = readstat_end_row(writer)) != READSTAT_OK)
+            goto cleanup;
+    }
+cleanup:
+    return error;
+}
+
+/* Two files with nothing in common, so that anything left over from one
+ * parse shows up in the next */
+static void write_reuse_file(rt_buffer_t *buffer, const parser_format_t *format, int wide) {
+    readstat_writer_t *writer = buffer_writer_init(buffer);
+    readstat_variable_t *variables[3];
+    readstat_error_t error = READSTAT_OK;
+
+    if (wide) {
+        readstat_label_set_t *label_set = readstat_add_label_set(writer, format->label_type, "groups");
+        if (format->label_type == READSTAT_TYPE_INT32) {
+            readstat_label_int32_value(label_set, 0, "none");
+            readstat_label_int32_value(label_set, 1, "one");
+            readstat_label_int32_value(label_set, 2, "two");
+        } else {
+            readstat_label_double_value(label_set, 0, "none");
+            readstat_label_double_value(label_set, 1, "one");
+            readstat_label_double_value(label_set, 2, "two");
+        }
+        variables[0] = readstat_add_variable(writer, "weight", READSTAT_TYPE_DOUBLE, 0);
+        readstat_variable_set_label(variables[0], "Weight in kg");
+        variables[1] = readstat_add_variable(writer, "name", READSTAT_TYPE_STRING, 12);
+        variables[2] = readstat_add_variable(writer, "grp", format->label_type, 0);
+        readstat_variable_set_label_set(variables[2], label_set);
+    } else {
+        variables[0] = readstat_add_variable(writer, "parity", READSTAT_TYPE_STRING, 4);
+        readstat_variable_set_label(variables[0], "Odd or even");
+    }
+
+    error = format->begin_writing(writer, buffer, wide ? TEST_REUSE_ROWS : TEST_REUSE_ROWS / 2);
+    if (error == READSTAT_OK)
+        error = wide ? write_wide_rows(writer, format, variables) : write_narrow_rows(writer, variables);
+    buffer_writer_finish(writer, format, error);
+}
+
+/* The first half of the wide file */
+static void truncate_file(rt_buffer_t *truncated, rt_buffer_t *buffer) {
+    buffer_reset(truncated);
+    buffer_grow(truncated, buffer->used / 2);
+    memcpy(truncated->bytes, buffer->bytes, buffer->used / 2);
+    truncated->used = buffer->used / 2;
+}
+
+static int reuse_handle_metadata(readstat_metadata_t *metadata, void *ctx) {
+    log_append((reuse_log_t *)ctx, "rows %d, variables %d\n",
+            readstat_get_row_count(metadata), readstat_get_var_count(metadata));
+    return READSTAT_HANDLER_OK;
+}
+
+static int reuse_handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    reuse_log_t *log = (reuse_log_t *)ctx;
+    log_append(log, "variable %d %s (%s) %s %s type %d\n", index,
+            readstat_variable_get_name(variable), string_or_empty(readstat_variable_get_label(variable)),
+            string_or_empty(readstat_variable_get_format(variable)), string_or_empty(val_labels),
+            readstat_variable_get_type(variable));
+    return READSTAT_HANDLER_OK;
+}
+
+static int reuse_handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    reuse_log_t *log = (reuse_log_t *)ctx;
+    if (obs_index == log->abort_row)
+        return READSTAT_HANDLER_ABORT;
+    if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+        log_append(log, "%s", string_or_empty(readstat_string_value(value)));
+    } else {
+        log_append(log, "%g", readstat_double_value(value));
+    }
+    log_append(log, "%c", readstat_variable_get_index(variable) ? ',' : ';');
+    return READSTAT_HANDLER_OK;
+}
+
+static int reuse_handle_value_label(const char *val_labels, readstat_value_t value,
+        const char *label, void *ctx) {
+    reuse_log_t *log = (reuse_log_t *)ctx;
+    log_append(log, "label %s %g %s\n", val_labels, readstat_double_value(value), label);
+    return READSTAT_HANDLER_OK;
+}
+
+static readstat_parser_t *logging_parser_init(rt_buffer_ctx_t *buffer_ctx, int reuse) {
+    readstat_parser_t *parser = buffer_parser_init(buffer_ctx);
+    readstat_set_metadata_handler(parser, &reuse_handle_metadata);
+    readstat_set_variable_handler(parser, &reuse_handle_variable);
+    readstat_set_value_handler(parser, &reuse_handle_value);
+    readstat_set_value_label_handler(parser, &reuse_handle_value_label);
+    readstat_set_context_reuse(parser, reuse);
+    return parser;
+}
+
+static readstat_error_t parse_logged(readstat_parser_t *parser, const parser_format_t *format,
+        rt_buffer_ctx_t *buffer_ctx, rt_buffer_t *buffer, reuse_log_t *log, int abort_row) {
+    memset(log, 0, sizeof(reuse_log_t));
+    log->abort_row = abort_row;
+    return parse_buffer(parser, format, buffer_ctx, buffer, log);
+}
+
+static void fresh_log(reuse_log_t *log, const parser_format_t *format,
+        rt_buffer_ctx_t *buffer_ctx, rt_buffer_t *buffer) {
+    readstat_parser_t *parser = logging_parser_init(buffer_ctx, 0);
+    readstat_error_t error = parse_logged(parser, format, buffer_ctx, buffer, log, -1);
+    readstat_parser_free(parser);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing %s: %s\n", format->name, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void check_reused(readstat_parser_t *parser, const parser_format_t *format,
+        rt_buffer_ctx_t *buffer_ctx, rt_buffer_t *buffer, const reuse_log_t *expected, const char *after) {
+    static reuse_log_t log;
+    readstat_error_t error = parse_logged(parser, format, buffer_ctx, buffer, &log, -1);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing %s with context reuse after %s: %s\n",
+                format->name, after, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (log.len != expected->len || memcmp(log.text, expected->text, log.len) != 0) {
+        fprintf(stderr, "Parsing %s with context reuse after %s differs from a fresh parse\n",
+                format->name, after);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* A failed parse leaves nothing behind for the next one */
+static void test_reuse_after_failure(const parser_format_t *format, rt_buffer_ctx_t *buffer_ctx) {
+    static reuse_log_t wide_log, narrow_log, log;
+    rt_buffer_t *wide = buffer_init();
+    rt_buffer_t *narrow = buffer_init();
+    rt_buffer_t *truncated = buffer_init();
+    readstat_parser_t *parser = NULL;
+
+    write_reuse_file(wide, format, 1);
+    write_reuse_file(narrow, format, 0);
+    truncate_file(truncated, wide);
+    fresh_log(&wide_log, format, buffer_ctx, wide);
+    fresh_log(&narrow_log, format, buffer_ctx, narrow);
+
+    parser = logging_parser_init(buffer_ctx, 1);
+    check_reused(parser, format, buffer_ctx, narrow, &narrow_log, "nothing");
+
+    if (parse_logged(parser, format, buffer_ctx, truncated, &log, -1) == READSTAT_OK)
+        fail("Truncated file parsed");
+    check_reused(parser, format, buffer_ctx, wide, &wide_log, "a truncated file");
+
+    if (parse_logged(parser, format, buffer_ctx, wide, &log, TEST_REUSE_ABORT_ROW) != READSTAT_ERROR_USER_ABORT)
+        fail("Parse wasn't aborted");
+    check_reused(parser, format, buffer_ctx, narrow, &narrow_log, "an aborted parse");
+    check_reused(parser, format, buffer_ctx, wide, &wide_log, "an aborted parse");
+
+    if (parse_logged(parser, format, buffer_ctx, NULL, &log, -1) != READSTAT_ERROR_OPEN)
+        fail("Missing file opened");
+    check_reused(parser, format, buffer_ctx, wide, &wide_log, "a missing file");
+
+    readstat_parser_free(parser);
+    buffer_free(wide);
+    buffer_free(narrow);
+    buffer_free(truncated);
+}
+
+/* Short reads */
+
+typedef struct short_read_record_s {
+    long    values;
+    long    wrong;
+} short_read_record_t;
+
+/* Where reads stop as if the file ended there, or 0 */
+static size_t short_read_end;
+
+static ssize_t short_read_handler(void *buf, size_t nbytes, void *io_ctx) {
+    rt_buffer_ctx_t *buffer_ctx = (rt_buffer_ctx_t *)io_ctx;
+    if (nbytes > TEST_SHORT_READ_LEN)
+        nbytes = TEST_SHORT_READ_LEN;
+    if (short_read_end && buffer_ctx->pos + nbytes > short_read_end)
+        nbytes = buffer_ctx->pos < short_read_end ? short_read_end - buffer_ctx->pos : 0;
+    return rt_read_handler(buf, nbytes, io_ctx);
+}
+
+static void write_short_read_file(rt_buffer_t *buffer, const parser_format_t *format) {
+    readstat_writer_t *writer = buffer_writer_init(buffer);
+    readstat_variable_t *variables[TEST_SHORT_READ_COLUMNS];
+    readstat_error_t error = READSTAT_OK;
+    char name[16];
+    int i, j;
+
+    /* Older DTA files have no strL section after the data to be read before
+     * it, so that reads can end in the middle of the data */
+    if (format == &dta_format)
+        readstat_writer_set_file_format_version(writer, 114);
+
+    for (j=0; j<TEST_SHORT_READ_COLUMNS; j++) {
+        snprintf(name, sizeof(name), "X%d", j);
+        variables[j] = readstat_add_variable(writer, name, READSTAT_TYPE_DOUBLE, 0);
+    }
+
+    error = format->begin_writing(writer, buffer, TEST_SHORT_READ_ROWS);
+    for (i=0; i<TEST_SHORT_READ_ROWS && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        for (j=0; j<TEST_SHORT_READ_COLUMNS && error == READSTAT_OK; j++)
+            error = readstat_insert_double_value(writer, variables[j], i + j);
+        if (error == READSTAT_OK)
+            error = readstat_end_row(writer);
+    }
+    buffer_writer_finish(writer, format, error);
+}
+
+static int short_read_handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    short_read_record_t *record = (short_read_record_t *)ctx;
+    if (readstat_double_value(value) != obs_index + readstat_variable_get_index(variable))
+        record->wrong++;
+    record->values++;
+    return READSTAT_HANDLER_OK;
+}
+
+static readstat_error_t parse_short_reads(short_read_record_t *record, const parser_format_t *format,
+        rt_buffer_t *buffer, rt_buffer_ctx_t *buffer_ctx, int thread_count) {
+    readstat_parser_t *parser = buffer_parser_init(buffer_ctx);
+    readstat_error_t error = READSTAT_OK;
+
+    memset(record, 0, sizeof(short_read_record_t));
+
+    readstat_set_read_handler(parser, &short_read_handler);
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_handler(parser, &short_read_handle_value);
+    readstat_set_thread_count(parser, thread_count);
+
+    error = parse_buffer(parser, format, buffer_ctx, buffer, record);
+    readstat_parser_free(parser);
+
+    return error;
+}
+
+/* Every row arrives whether the data comes in one read or many, on one
+ * thread or several */
+static void test_short_reads(const parser_format_t *format, rt_buffer_t *buffer,
+        rt_buffer_ctx_t *buffer_ctx, int thread_count) {
+    short_read_record_t record;
+    readstat_error_t error = parse_short_reads(&record, format, buffer, buffer_ctx, thread_count);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing %s with short reads (%d threads): %s\n",
+                format->name, thread_count, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (record.values != (long)TEST_SHORT_READ_ROWS * TEST_SHORT_READ_COLUMNS || record.wrong) {
+        fprintf(stderr, "%ld of %ld values wrong in %s with short reads (%d threads)\n",
+                record.wrong, record.values, format->name, thread_count);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Reads that end partway through the data fail the same way on several
+ * threads as on one, after the same whole rows */
+static void test_short_reads_truncated(const parser_format_t *format, rt_buffer_t *buffer,
+        rt_buffer_ctx_t *buffer_ctx) {
+    short_read_record_t serial, parallel;
+    readstat_error_t serial_error = READSTAT_OK, parallel_error = READSTAT_OK;
+
+    short_read_end = buffer->used / 2;
+    serial_error = parse_short_reads(&serial, format, buffer, buffer_ctx, 1);
+    parallel_error = parse_short_reads(&parallel, format, buffer, buffer_ctx, 3);
+    short_read_end = 0;
+
+    if (parallel_error != serial_error || parallel.values != serial.values ||
+            serial.values == 0 || serial.values % TEST_SHORT_READ_COLUMNS || serial.wrong || parallel.wrong) {
+        fprintf(stderr, "Truncated %s: %ld values and \"%s\" on one thread, "
+                "%ld values and \"%s\" on three\n", format->name,
+                serial.values, readstat_error_message(serial_error),
+                parallel.values, readstat_error_message(parallel_error));
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    rt_buffer_t *buffer = buffer_init();
+    rt_buffer_ctx_t *buffer_ctx = buffer_ctx_init(buffer);
+    int i;
+
+    write_lookup_file(buffer);
+    test_lookup(buffer, buffer_ctx);
+    test_lookup_out_of_memory(buffer, buffer_ctx);
+    for (i=0; i<FORMAT_COUNT(label_formats); i++)
+        test_lookup_across_parses(label_formats[i], buffer_ctx);
+
+    for (i=0; i<FORMAT_COUNT(string_formats); i++) {
+        write_dictionary_file(buffer, string_formats[i]);
+        test_dictionary(string_formats[i], buffer, buffer_ctx, 1);
+        test_dictionary(string_formats[i], buffer, buffer_ctx, 4);
+    }
+
+    for (i=0; i<FORMAT_COUNT(string_formats); i++) {
+        write_view_file(buffer, string_formats[i]);
+        test_string_view_nul(string_formats[i], buffer, buffer_ctx, NULL);
+        test_string_view_nul(string_formats[i], buffer, buffer_ctx, "WINDOWS-1252");
+    }
+
+    for (i=0; i<FORMAT_COUNT(label_formats); i++)
+        test_reuse_after_failure(label_formats[i], buffer_ctx);
+
+    for (i=0; i<FORMAT_COUNT(short_read_formats); i++) {
+        write_short_read_file(buffer, short_read_formats[i]);
+        test_short_reads(short_read_formats[i], buffer, buffer_ctx, 1);
+        test_short_reads(short_read_formats[i], buffer, buffer_ctx, 3);
+        test_short_reads_truncated(short_read_formats[i], buffer, buffer_ctx);
+    }
+
+    free(buffer_ctx);
+    buffer_free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../readstat.h"
+#include "../readstat_progress.h"
+#include "../readstat_io_unistd.h"
+
+#include "test_buffer.h"
+#include "test_buffer_io.h"
+
+#define TEST_PROGRESS_FILE      "test_progress.sav"
+#define TEST_PROGRESS_ROWS      20000
+#define TEST_PROGRESS_COLUMNS   4
+#define TEST_PROGRESS_INTERVAL  (64 * 1024)
+
+typedef struct progress_record_s {
+    double  first;
+    double  last;
+    double  max_step;
+    long    count;
+    int     decreased;
+} progress_record_t;
+
+static readstat_off_t fake_offset;
+
+static readstat_off_t fake_seek_handler(readstat_off_t offset, readstat_io_flags_t whence, void *io_ctx) {
+    return fake_offset;
+}
+
+static void expect_due(readstat_progress_t *progress, readstat_io_t *io, readstat_off_t offset,
+        int expected) {
+    fake_offset = offset;
+    if (readstat_progress_due(progress, io) != expected) {
+        fprintf(stderr, "Progress at offset %ld: expected %s\n", (long)offset,
+                expected ? "an update" : "no update");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void test_progress_due() {
+    readstat_parser_t *parser = readstat_parser_init();
+    readstat_progress_t progress;
+    readstat_io_t io = { .seek = &fake_seek_handler };
+
+    /* No interval: every update is due */
+    readstat_progress_init(&progress, parser);
+    expect_due(&progress, &io, 0, 1);
+    expect_due(&progress, &io, 0, 1);
+    expect_due(&progress, &io, 1, 1);
+
+    readstat_set_progress_interval(parser, 100, 0);
+    readstat_progress_init(&progress, parser);
+    expect_due(&progress, &io, 10, 1);
+    expect_due(&progress, &io, 60, 0);
+    expect_due(&progress, &io, 109, 0);
+    expect_due(&progress, &io, 110, 1);
+    expect_due(&progress, &io, 209, 0);
+    expect_due(&progress, &io, 500, 1);
+
+    /* After a seek back the interval counts from the last update */
+    expect_due(&progress, &io, 300, 0);
+    expect_due(&progress, &io, 599, 0);
+    expect_due(&progress, &io, 600, 1);
+
+    /* An unknown position doesn't hold the update back */
+    expect_due(&progress, &io, -1, 1);
+
+    readstat_progress_reset(&progress);
+    expect_due(&progress, &io, 601, 1);
+    expect_due(&progress, &io, 602, 0);
+
+    /* A time interval far longer than the test holds back all but the first */
+    readstat_set_progress_interval(parser, 0, 1000000);
+    readstat_progress_init(&progress, parser);
+    expect_due(&progress, &io, 0, 1);
+    expect_due(&progress, &io, 1000000, 0);
+    readstat_progress_reset(&progress);
+    expect_due(&progress, &io, 1000000, 1);
+
+    readstat_parser_free(parser);
+}
+
+static void test_unistd_offset() {
+    unistd_io_ctx_t io_ctx = { .fd = -1 };
+    char buf[1000];
+    long file_size = 0;
+
+    if (unistd_open_handler(TEST_PROGRESS_FILE, &io_ctx) == -1) {
+        fprintf(stderr, "Error opening %s\n", TEST_PROGRESS_FILE);
+        exit(EXIT_FAILURE);
+    }
+    file_size = unistd_seek_handler(0, READSTAT_SEEK_END, &io_ctx);
+    if (unistd_seek_handler(0, READSTAT_SEEK_SET, &io_ctx) != 0 ||
+            unistd_seek_handler(0, READSTAT_SEEK_CUR, &io_ctx) != 0) {
+        fprintf(stderr, "Seek to the start not tracked\n");
+        exit(EXIT_FAILURE);
+    }
+    if (unistd_read_handler(buf, sizeof(buf), &io_ctx) != sizeof(buf) ||
+            unistd_seek_handler(0, READSTAT_SEEK_CUR, &io_ctx) != sizeof(buf)) {
+        fprintf(stderr, "Read not tracked\n");
+        exit(EXIT_FAILURE);
+    }
+    if (unistd_seek_handler(5000, READSTAT_SEEK_CUR, &io_ctx) != 6000 ||
+            unistd_seek_handler(0, READSTAT_SEEK_CUR, &io_ctx) != 6000) {
+        fprintf(stderr, "Relative seek not tracked\n");
+        exit(EXIT_FAILURE);
+    }
+    if (unistd_seek_handler(-10, READSTAT_SEEK_END, &io_ctx) != file_size - 10 ||
+            unistd_read_handler(buf, sizeof(buf), &io_ctx) != 10 ||
+            unistd_seek_handler(0, READSTAT_SEEK_CUR, &io_ctx) != file_size) {
+        fprintf(stderr, "Short read at the end not tracked\n");
+        exit(EXIT_FAILURE);
+    }
+
+    unistd_close_handler(&io_ctx);
+}
+
+/* On disk, for the unistd handlers */
+static void write_file() {
+    readstat_writer_t *writer = readstat_writer_init();
+    rt_buffer_t *buffer = buffer_init();
+    readstat_variable_t *variables[TEST_PROGRESS_COLUMNS];
+    readstat_error_t error = READSTAT_OK;
+    char name[16];
+    int i, j;
+
+    readstat_set_data_writer(writer, &rt_write_handler);
+    for (j=0; j<TEST_PROGRESS_COLUMNS; j++) {
+        snprintf(name, sizeof(name), "x%d", j);
+        variables[j] = readstat_add_variable(writer, name, READSTAT_TYPE_DOUBLE, 0);
+    }
+
+    error = readstat_begin_writing_sav(writer, buffer, TEST_PROGRESS_ROWS);
+    for (i=0; i<TEST_PROGRESS_ROWS && error == READSTAT_OK; i++) {
+        if ((error = readstat_begin_row(writer)) != READSTAT_OK)
+            break;
+        for (j=0; j<TEST_PROGRESS_COLUMNS && error == READSTAT_OK; j++)
+            error = readstat_insert_double_value(writer, variables[j], i + j);
+        if (error == READSTAT_OK)
+            error = readstat_end_row(writer);
+    }
+    if (error == READSTAT_OK)
+        error = readstat_end_writing(writer);
+
+    readstat_writer_free(writer);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error writing %s: %s\n", TEST_PROGRESS_FILE, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (buffer_save(buffer, TEST_PROGRESS_FILE) != 0) {
+        fprintf(stderr, "Error saving %s\n", TEST_PROGRESS_FILE);
+        exit(EXIT_FAILURE);
+    }
+    buffer_free(buffer);
+}
+
+static int handle_progress(double progress, void *ctx) {
+    progress_record_t *record = (progress_record_t *)ctx;
+    if (record->count == 0)
+        record->first = progress;
+    if (record->count && progress < record->last)
+        record->decreased = 1;
+    if (record->count && progress - record->last > record->max_step)
+        record->max_step = progress - record->last;
+    record->last = progress;
+    record->count++;
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_variable(int index, readstat_variable_t *variable,
+        const char *val_labels, void *ctx) {
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_value(int obs_index, readstat_variable_t *variable,
+        readstat_value_t value, void *ctx) {
+    return READSTAT_HANDLER_OK;
+}
+
+static progress_record_t *parse_with_progress(long interval_bytes, long row_offset) {
+    readstat_parser_t *parser = readstat_parser_init();
+    progress_record_t *record = calloc(1, sizeof(progress_record_t));
+    readstat_error_t error = READSTAT_OK;
+
+    readstat_set_progress_handler(parser, &handle_progress);
+    readstat_set_variable_handler(parser, &handle_variable);
+    readstat_set_value_handler(parser, &handle_value);
+    readstat_set_progress_interval(parser, interval_bytes, 0);
+    readstat_set_row_offset(parser, row_offset);
+
+    error = readstat_parse_sav(parser, TEST_PROGRESS_FILE, record);
+    readstat_parser_free(parser);
+
+    if (error != READSTAT_OK) {
+        fprintf(stderr, "Error parsing %s: %s\n", TEST_PROGRESS_FILE, readstat_error_message(error));
+        exit(EXIT_FAILURE);
+    }
+    if (record->decreased) {
+        fprintf(stderr, "Progress went backwards (interval %ld, row offset %ld)\n",
+                interval_bytes, row_offset);
+        exit(EXIT_FAILURE);
+    }
+    if (record->count < 2 || record->first < 0.0 || record->last > 1.0) {
+        fprintf(stderr, "Progress out of range (interval %ld, row offset %ld)\n",
+                interval_bytes, row_offset);
+        exit(EXIT_FAILURE);
+    }
+
+    return record;
+}
+
+static void test_parse_progress() {
+    long file_size = 0;
+    long max_updates = 0;
+    progress_record_t *every = NULL, *interval = NULL, *skipped = NULL;
+    FILE *file = fopen(TEST_PROGRESS_FILE, "rb");
+
+    fseek(file, 0, SEEK_END);
+    file_size = ftell(file);
+    fclose(file);
+
+    every = parse_with_progress(0, 0);
+    interval = parse_with_progress(TEST_PROGRESS_INTERVAL, 0);
+
+    /* The first update, then at most one per interval */
+    max_updates = file_size / TEST_PROGRESS_INTERVAL + 2;
+    if (interval->count > max_updates || interval->count >= every->count) {
+        fprintf(stderr, "Expected at most %ld updates every %d bytes, got %ld (%ld without an interval)\n",
+                max_updates, TEST_PROGRESS_INTERVAL, interval->count, every->count);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Nothing is held back for long, and the last update comes within an
+     * interval of the end */
+    if (interval->max_step > 2.0 * TEST_PROGRESS_INTERVAL / file_size ||
+            interval->last < 1.0 - 2.0 * TEST_PROGRESS_INTERVAL / file_size) {
+        fprintf(stderr, "Updates every %d bytes jumped by %lf and ended at %lf\n",
+                TEST_PROGRESS_INTERVAL, interval->max_step, interval->last);
+        exit(EXIT_FAILURE);
+    }
+
+    /* The row offset seeks past the first half of the data, which shows up
+     * as one jump forward rather than as updates */
+    skipped = parse_with_progress(TEST_PROGRESS_INTERVAL, TEST_PROGRESS_ROWS / 2);
+    if (skipped->count >= interval->count || skipped->max_step < 0.4 ||
+            skipped->last < 1.0 - 2.0 * TEST_PROGRESS_INTERVAL / file_size) {
+        fprintf(stderr, "Unexpected progress after a seek: %ld updates, jumping by %lf, ending at %lf\n",
+                skipped->count, skipped->max_step, skipped->last);
+        exit(EXIT_FAILURE);
+    }
+
+    free(every);
+    free(interval);
+    free(skipped);
+}
+
+int main(int argc, char *argv[]) {
+    test_progress_due();
+
+    write_file();
+    test_unistd_offset();
+    test_parse_progress();
+    remove(TEST_PROGRESS_FILE);
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "../readstat.h"
 
@@ -249,6 +250,26 @@ static int handle_value_label(const char *val_labels, readstat_value_t value, co
     return READSTAT_HANDLER_OK;
 }
 
+static int column_is_defined_missing(rt_column_t *column, readstat_value_t value) {
+    long i;
+    if (readstat_value_is_system_missing(value))
+        return 0;
+    for (i=0; i<column->missing_ranges_count; i++) {
+        if (readstat_value_type_class(value) == READSTAT_TYPE_CLASS_STRING) {
+            const char *string = readstat_string_value(value);
+            if (string && strcmp(string, readstat_string_value(column->missing_ranges[i].lo)) >= 0 &&
+                    strcmp(string, readstat_string_value(column->missing_ranges[i].hi)) <= 0)
+                return 1;
+        } else {
+            double number = readstat_double_value(value);
+            if (number >= readstat_double_value(column->missing_ranges[i].lo) &&
+                    number <= readstat_double_value(column->missing_ranges[i].hi))
+                return 1;
+        }
+    }
+    return 0;
+}
+
 static int handle_value(int obs_index, readstat_variable_t *variable, readstat_value_t value, void *ctx) {
     rt_parse_ctx_t *rt_ctx = (rt_parse_ctx_t *)ctx;
     rt_ctx->obs_index = obs_index;
@@ -267,6 +288,42 @@ static int handle_value(int obs_index, readstat_variable_t *variable, readstat_v
                 value, "Data values");
     }
 
+    push_error_if_doubles_differ(rt_ctx,
+            column_is_defined_missing(column, column->values[file_obs_index]),
+            value.is_defined_missing, "Defined missing values");
+    push_error_if_doubles_differ(rt_ctx,
+            value.is_defined_missing,
+            readstat_value_is_defined_missing(value, variable), "Defined missing predicate");
+
+    return READSTAT_HANDLER_OK;
+}
+
+static int handle_string_view(int obs_index, readstat_variable_t *variable,
+        const char *string, size_t len, void *ctx) {
+    rt_parse_ctx_t *rt_ctx = (rt_parse_ctx_t *)ctx;
+    rt_ctx->obs_index = obs_index;
+    rt_ctx->var_index = readstat_variable_get_index(variable);
+    long file_obs_index = obs_index + rt_ctx->args->row_offset;
+
+    rt_column_t *column = &rt_ctx->file->columns[rt_ctx->var_index];
+    const char *expected = NULL;
+
+    if (column->type == READSTAT_TYPE_STRING_REF) {
+        expected = rt_ctx->file->string_refs[readstat_int32_value(column->values[file_obs_index])];
+    } else {
+        expected = readstat_string_value(column->values[file_obs_index]);
+    }
+    if (expected == NULL)
+        expected = "";
+
+    if (memchr(string, '\0', len) || strlen(expected) != len || strncmp(expected, string, len) != 0) {
+        char *received = malloc(len + 1);
+        memcpy(received, string, len);
+        received[len] = '\0';
+        push_error_if_strings_differ(rt_ctx, expected, received, "String views");
+        free(received);
+    }
+
     return READSTAT_HANDLER_OK;
 }
 
@@ -277,14 +334,11 @@ static void handle_error(const char *error_message, void *ctx) {
 readstat_error_t read_file(rt_parse_ctx_t *parse_ctx, long format) {
     readstat_error_t error = READSTAT_OK;
 
-    readstat_parser_t *parser = readstat_parser_init();
+    readstat_parser_t *parser = parse_ctx->parser;
+    if (parser == NULL)
+        parser = readstat_parser_init();
 
-    readstat_set_open_handler(parser, rt_open_handler);
-    readstat_set_close_handler(parser, rt_close_handler);
-    readstat_set_seek_handler(parser, rt_seek_handler);
-    readstat_set_read_handler(parser, rt_read_handler);
-    readstat_set_update_handler(parser, rt_update_handler);
-    readstat_set_io_ctx(parser, parse_ctx->buffer_ctx);
+    rt_set_io_handlers(parser, parse_ctx->buffer_ctx);
 
     readstat_set_metadata_handler(parser, &handle_metadata);
     readstat_set_note_handler(parser, &handle_note);
@@ -293,9 +347,16 @@ readstat_error_t read_file(rt_parse_ctx_t *parse_ctx, long format) {
     readstat_set_value_handler(parser, &handle_value);
     readstat_set_value_label_handler(parser, &handle_value_label);
     readstat_set_error_handler(parser, &handle_error);
+    if (parse_ctx->args->string_view)
+        readstat_set_string_view_handler(parser, &handle_string_view);
 
+    readstat_set_collect_stats(parser, parse_ctx->args->collect_stats);
     readstat_set_row_limit(parser, parse_ctx->args->row_limit);
     readstat_set_row_offset(parser, parse_ctx->args->row_offset);
+    if (parse_ctx->args->thread_count)
+        readstat_set_thread_count(parser, parse_ctx->args->thread_count);
+    if (parse_ctx->args->prefetch_depth)
+        readstat_set_prefetch_depth(parser, parse_ctx->args->prefetch_depth);
 
     if ((format & RT_FORMAT_DTA)) {
         parse_ctx->file_format_version = dta_file_format_version(format);
@@ -327,6 +388,14 @@ readstat_error_t read_file(rt_parse_ctx_t *parse_ctx, long format) {
     push_error_if_doubles_differ(parse_ctx, expected_row_count(parse_ctx),
             parse_ctx->obs_index + 1, "Row count");
 
+    if (!(format & RT_FORMAT_SAS7BCAT)) {
+        readstat_parser_stats_t stats;
+        readstat_parser_get_stats(parser, &stats);
+
+        push_error_if_doubles_differ(parse_ctx, expected_row_count(parse_ctx),
+                stats.rows_decoded, "Rows decoded");
+    }
+
     long value_labels_count = 0;
     long i;
     for (i=0; i<parse_ctx->file->label_sets_count; i++) {
@@ -337,7 +406,8 @@ readstat_error_t read_file(rt_parse_ctx_t *parse_ctx, long format) {
             parse_ctx->value_labels_count, "Value labels count");
 
 cleanup:
-    readstat_parser_free(parser);
+    if (parser != parse_ctx->parser)
+        readstat_parser_free(parser);
 
     return error;
 }
@@ -27,6 +27,28 @@ static rt_test_args_t _test_args[] = {
     {
         .row_limit = 1,
         .row_offset = 1,
+    },
+    {
+        .row_limit = 0,
+        .row_offset = 0,
+        .thread_count = 3,
+        .collect_stats = 1,
+    },
+    {
+        .row_limit = 0,
+        .row_offset = 1,
+        .prefetch_depth = 2,
+        .collect_stats = 1,
+    },
+    {
+        .row_limit = 0,
+        .row_offset = 0,
+        .string_view = 1,
+    },
+    {
+        .row_limit = 0,
+        .row_offset = 0,
+        .context_reuse = 1,
     }
 };
 
@@ -46,16 +68,22 @@ static void dump_buffer(rt_buffer_t *buffer, long format) {
 
 int main(int argc, char *argv[]) {
     rt_buffer_t *buffer = buffer_init();
+    readstat_parser_t *reused_parser = readstat_parser_init();
     readstat_error_t error = READSTAT_OK;
 
     int g, t, a, f;
 
+    /* One parser for every file and format */
+    readstat_set_context_reuse(reused_parser, 1);
+
     for (g=0; g<sizeof(_test_groups)/sizeof(_test_groups[0]); g++) {
         for (t=0; t<MAX_TESTS_PER_GROUP && _test_groups[g].tests[t].label[0]; t++) {
             rt_test_file_t *file = &_test_groups[g].tests[t];
             for (a=0; a<sizeof(_test_args)/sizeof(_test_args[0]); a++) {
                 rt_test_args_t *args = &_test_args[a];
                 rt_parse_ctx_t *parse_ctx = parse_ctx_init(buffer, file, args);
+                if (args->context_reuse)
+                    parse_ctx->parser = reused_parser;
 
                 for (f=RT_FORMAT_DTA_104; f<RT_FORMAT_ALL; f*=2) {
                     if (!(file->test_formats & f))
@@ -89,6 +117,7 @@ int main(int argc, char *argv[]) {
                         print_error(&parse_ctx->errors[i]);
                     }
                     parse_ctx_free(parse_ctx);
+                    readstat_parser_free(reused_parser);
                     buffer_free(buffer);
                     return 1;
                 }
@@ -107,9 +136,11 @@ cleanup:
         printf("Error running test \"%s\" (format=%s): %s\n", 
                 _test_groups[g].tests[t].label,
                 file_extension(f), readstat_error_message(error));
+        readstat_parser_free(reused_parser);
         buffer_free(buffer);
         return 1;
     }
+    readstat_parser_free(reused_parser);
     buffer_free(buffer);
 
     return 0;
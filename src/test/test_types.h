@@ -74,6 +74,11 @@ typedef struct rt_test_group_s {
 typedef struct rt_test_args_s {
     long             row_limit;
     long             row_offset;    
+    int              thread_count;
+    int              prefetch_depth;
+    int              string_view;
+    int              context_reuse;
+    int              collect_stats;
 } rt_test_args_t;
 
 
@@ -106,6 +111,7 @@ typedef struct rt_parse_ctx_s {
     long             notes_count;
 
     rt_test_args_t  *args;
+    readstat_parser_t *parser;
 
     rt_test_file_t  *file;
     long             file_format;
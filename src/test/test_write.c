@@ -4,6 +4,7 @@
 #include "../CKHashTable.h"
 
 #include "test_buffer.h"
+#include "test_buffer_io.h"
 #include "test_types.h"
 #include "test_readstat.h"
 #include "test_dta.h"
@@ -13,24 +14,13 @@ static void handle_error(const char *error_message, void *ctx) {
     printf("%s\n", error_message);
 }
 
-static ssize_t write_data(const void *bytes, size_t len, void *ctx) {
-    rt_buffer_t *buffer = (rt_buffer_t *)ctx;
-    buffer_grow(buffer, len);
-    if (buffer->bytes == NULL) {
-        return -1;
-    }
-    memcpy(buffer->bytes + buffer->used, bytes, len);
-    buffer->used += len;
-    return len;
-}
-
 readstat_error_t write_file_to_buffer(rt_test_file_t *file, rt_buffer_t *buffer, long format) {
     readstat_error_t error = READSTAT_OK;
 
     ck_hash_table_t *label_sets = ck_hash_table_init(100);
 
     readstat_writer_t *writer = readstat_writer_init();
-    readstat_set_data_writer(writer, &write_data);
+    readstat_set_data_writer(writer, &rt_write_handler);
     readstat_writer_set_file_label(writer, file->label);
     readstat_writer_set_table_name(writer, file->table_name);
     readstat_writer_set_error_handler(writer, &handle_error);
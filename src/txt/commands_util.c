@@ -3,22 +3,39 @@
 #include "../readstat.h"
 #include "readstat_schema.h"
 #include "commands_util.h"
+#include "../readstat_label_index.h"
+
+/* Schema files are read outside of a parse, so labels are indexed here
+ * rather than by the stats proxies */
+static readstat_error_t submit_value_label_value(readstat_parser_t *parser, const char *labelset,
+        readstat_value_t value, const char *buf, void *user_ctx) {
+    readstat_error_t retval = READSTAT_OK;
+    if (parser->value_label_lookup != READSTAT_VALUE_LABEL_LOOKUP_NONE) {
+        if ((retval = readstat_label_index_add(parser, labelset, value, buf)) != READSTAT_OK)
+            return retval;
+    }
+    if (parser->handlers.value_label &&
+            parser->handlers.value_label(labelset, value, buf, user_ctx) != READSTAT_HANDLER_OK)
+        retval = READSTAT_ERROR_USER_ABORT;
+    return retval;
+}
 
 readstat_error_t submit_value_label(readstat_parser_t *parser, const char *labelset,
         label_type_t label_type, int64_t first_integer, int64_t last_integer,
         double double_value, const char *string_value, const char *buf, void *user_ctx) {
-    if (!parser->handlers.value_label)
+    if (!parser->handlers.value_label &&
+            parser->value_label_lookup == READSTAT_VALUE_LABEL_LOOKUP_NONE)
         return READSTAT_OK;
 
-    int cb_retval = READSTAT_HANDLER_OK;
+    readstat_error_t retval = READSTAT_OK;
     if (label_type == LABEL_TYPE_RANGE) {
         int64_t i;
         for (i=first_integer; i<=last_integer; i++) {
             readstat_value_t value = { 
                 .type = READSTAT_TYPE_DOUBLE,
                 .v = { .double_value = i } };
-            cb_retval = parser->handlers.value_label(labelset, value, buf, user_ctx);
-            if (cb_retval != READSTAT_HANDLER_OK)
+            retval = submit_value_label_value(parser, labelset, value, buf, user_ctx);
+            if (retval != READSTAT_OK)
                 goto cleanup;
         }
     } else if (label_type != LABEL_TYPE_OTHER) {
@@ -34,11 +51,11 @@ readstat_error_t submit_value_label(readstat_parser_t *parser, const char *label
             value.v.double_value = NAN;
         }
 
-        cb_retval = parser->handlers.value_label(labelset, value, buf, user_ctx);
+        retval = submit_value_label_value(parser, labelset, value, buf, user_ctx);
     }
 
 cleanup:
-    return (cb_retval == READSTAT_HANDLER_OK) ? READSTAT_OK : READSTAT_ERROR_USER_ABORT;
+    return retval;
 }
 
 readstat_error_t submit_columns(readstat_parser_t *parser, readstat_schema_t *dct, void *user_ctx) {
@@ -4,13 +4,14 @@
 #include <strings.h>
 
 #include "../readstat.h"
+#include "../readstat_arena.h"
 #include "readstat_schema.h"
 
 #include "readstat_copy.h"
 #include "commands_util.h"
 
 
-#line 14 "src/txt/readstat_sas_commands_read.c"
+#line 15 "src/txt/readstat_sas_commands_read.c"
 static const char _sas_commands_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 7, 1, 12, 1, 13, 1, 
@@ -2883,7 +2884,7 @@ static const int sas_commands_start = 1094;
 static const int sas_commands_en_main = 1094;
 
 
-#line 13 "src/txt/readstat_sas_commands_read.rl"
+#line 14 "src/txt/readstat_sas_commands_read.rl"
 
 
 readstat_schema_t *readstat_parse_sas_commands(readstat_parser_t *parser,
@@ -2935,7 +2936,7 @@ readstat_schema_t *readstat_parse_sas_commands(readstat_parser_t *parser,
     int var_row = 0, var_col = 0;
     int var_len = 0;
 
-    if ((schema = calloc(1, sizeof(readstat_schema_t))) == NULL) {
+    if ((schema = readstat_schema_init()) == NULL) {
         error = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -2943,12 +2944,12 @@ readstat_schema_t *readstat_parse_sas_commands(readstat_parser_t *parser,
     schema->rows_per_observation = 1;
     
     
-#line 2947 "src/txt/readstat_sas_commands_read.c"
+#line 2948 "src/txt/readstat_sas_commands_read.c"
 	{
 	cs = sas_commands_start;
 	}
 
-#line 2952 "src/txt/readstat_sas_commands_read.c"
+#line 2953 "src/txt/readstat_sas_commands_read.c"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -3022,19 +3023,19 @@ _match:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 72 "src/txt/readstat_sas_commands_read.rl"
+#line 73 "src/txt/readstat_sas_commands_read.rl"
 	{
             integer = 0;
         }
 	break;
 	case 1:
-#line 76 "src/txt/readstat_sas_commands_read.rl"
+#line 77 "src/txt/readstat_sas_commands_read.rl"
 	{
             integer = 10 * integer + ((*p) - '0');
         }
 	break;
 	case 2:
-#line 80 "src/txt/readstat_sas_commands_read.rl"
+#line 81 "src/txt/readstat_sas_commands_read.rl"
 	{
             int value = 0;
             if ((*p) >= '0' && (*p) <= '9') {
@@ -3048,62 +3049,62 @@ _match:
         }
 	break;
 	case 3:
-#line 92 "src/txt/readstat_sas_commands_read.rl"
+#line 93 "src/txt/readstat_sas_commands_read.rl"
 	{
             var_col = integer - 1;
             var_len = 1;
         }
 	break;
 	case 4:
-#line 97 "src/txt/readstat_sas_commands_read.rl"
+#line 98 "src/txt/readstat_sas_commands_read.rl"
 	{
             var_len = integer - var_col;
         }
 	break;
 	case 5:
-#line 101 "src/txt/readstat_sas_commands_read.rl"
+#line 102 "src/txt/readstat_sas_commands_read.rl"
 	{
             var_type = READSTAT_TYPE_STRING;
         }
 	break;
 	case 6:
-#line 105 "src/txt/readstat_sas_commands_read.rl"
+#line 106 "src/txt/readstat_sas_commands_read.rl"
 	{
             var_type = READSTAT_TYPE_DOUBLE;
         }
 	break;
 	case 7:
-#line 109 "src/txt/readstat_sas_commands_read.rl"
+#line 110 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_copy(buf, sizeof(buf), (char *)str_start, str_len);
         }
 	break;
 	case 8:
-#line 113 "src/txt/readstat_sas_commands_read.rl"
+#line 114 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_copy(labelset, sizeof(labelset), (char *)str_start, str_len);
         }
 	break;
 	case 9:
-#line 117 "src/txt/readstat_sas_commands_read.rl"
+#line 118 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_copy(string_value, sizeof(string_value), (char *)str_start, str_len);
         }
 	break;
 	case 10:
-#line 121 "src/txt/readstat_sas_commands_read.rl"
+#line 122 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_copy(argname, sizeof(argname), (char *)str_start, str_len);
         }
 	break;
 	case 11:
-#line 125 "src/txt/readstat_sas_commands_read.rl"
+#line 126 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_copy_lower(varname, sizeof(varname), (char *)str_start, str_len);
         }
 	break;
 	case 12:
-#line 129 "src/txt/readstat_sas_commands_read.rl"
+#line 130 "src/txt/readstat_sas_commands_read.rl"
 	{
             if (strcasecmp(argname, "firstobs") == 0) {
                 schema->first_line = integer;
@@ -3114,7 +3115,7 @@ _match:
         }
 	break;
 	case 13:
-#line 138 "src/txt/readstat_sas_commands_read.rl"
+#line 139 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
             entry->variable.type = var_type;
@@ -3124,28 +3125,31 @@ _match:
         }
 	break;
 	case 14:
-#line 146 "src/txt/readstat_sas_commands_read.rl"
+#line 147 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
             entry->len = var_len;
         }
 	break;
 	case 15:
-#line 151 "src/txt/readstat_sas_commands_read.rl"
+#line 152 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
-            readstat_copy(entry->variable.label, sizeof(entry->variable.label), buf, sizeof(buf));
+            if ((entry->variable.label = readstat_arena_intern(schema->arena, buf, sizeof(buf))) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 	break;
 	case 16:
-#line 156 "src/txt/readstat_sas_commands_read.rl"
+#line 160 "src/txt/readstat_sas_commands_read.rl"
 	{
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
             readstat_copy(entry->labelset, sizeof(entry->labelset), labelset, sizeof(labelset));
         }
 	break;
 	case 17:
-#line 161 "src/txt/readstat_sas_commands_read.rl"
+#line 165 "src/txt/readstat_sas_commands_read.rl"
 	{
             error = submit_value_label(parser, labelset, label_type,
                 first_integer, integer, double_value, string_value, buf, user_ctx); 
@@ -3154,74 +3158,74 @@ _match:
         }
 	break;
 	case 18:
-#line 168 "src/txt/readstat_sas_commands_read.rl"
+#line 172 "src/txt/readstat_sas_commands_read.rl"
 	{ str_start = p; }
 	break;
 	case 19:
-#line 168 "src/txt/readstat_sas_commands_read.rl"
+#line 172 "src/txt/readstat_sas_commands_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 20:
-#line 170 "src/txt/readstat_sas_commands_read.rl"
+#line 174 "src/txt/readstat_sas_commands_read.rl"
 	{ str_start = p; }
 	break;
 	case 21:
-#line 170 "src/txt/readstat_sas_commands_read.rl"
+#line 174 "src/txt/readstat_sas_commands_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 22:
-#line 178 "src/txt/readstat_sas_commands_read.rl"
+#line 182 "src/txt/readstat_sas_commands_read.rl"
 	{ line_no++; line_start = p; }
 	break;
 	case 23:
-#line 182 "src/txt/readstat_sas_commands_read.rl"
+#line 186 "src/txt/readstat_sas_commands_read.rl"
 	{ str_start = p; }
 	break;
 	case 24:
-#line 182 "src/txt/readstat_sas_commands_read.rl"
+#line 186 "src/txt/readstat_sas_commands_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 25:
-#line 221 "src/txt/readstat_sas_commands_read.rl"
+#line 225 "src/txt/readstat_sas_commands_read.rl"
 	{ label_type = LABEL_TYPE_DOUBLE; double_value = -integer; }
 	break;
 	case 26:
-#line 222 "src/txt/readstat_sas_commands_read.rl"
+#line 226 "src/txt/readstat_sas_commands_read.rl"
 	{ label_type = LABEL_TYPE_DOUBLE; double_value = integer; }
 	break;
 	case 27:
-#line 223 "src/txt/readstat_sas_commands_read.rl"
+#line 227 "src/txt/readstat_sas_commands_read.rl"
 	{ first_integer = integer; }
 	break;
 	case 28:
-#line 223 "src/txt/readstat_sas_commands_read.rl"
+#line 227 "src/txt/readstat_sas_commands_read.rl"
 	{ label_type = LABEL_TYPE_RANGE; }
 	break;
 	case 29:
-#line 224 "src/txt/readstat_sas_commands_read.rl"
+#line 228 "src/txt/readstat_sas_commands_read.rl"
 	{ label_type = LABEL_TYPE_STRING; }
 	break;
 	case 30:
-#line 225 "src/txt/readstat_sas_commands_read.rl"
+#line 229 "src/txt/readstat_sas_commands_read.rl"
 	{ label_type = LABEL_TYPE_STRING; }
 	break;
 	case 31:
-#line 226 "src/txt/readstat_sas_commands_read.rl"
+#line 230 "src/txt/readstat_sas_commands_read.rl"
 	{ label_type = LABEL_TYPE_OTHER; }
 	break;
 	case 32:
-#line 229 "src/txt/readstat_sas_commands_read.rl"
+#line 233 "src/txt/readstat_sas_commands_read.rl"
 	{ var_len = integer; }
 	break;
 	case 33:
-#line 328 "src/txt/readstat_sas_commands_read.rl"
+#line 332 "src/txt/readstat_sas_commands_read.rl"
 	{ var_row = integer - 1; }
 	break;
 	case 34:
-#line 332 "src/txt/readstat_sas_commands_read.rl"
+#line 336 "src/txt/readstat_sas_commands_read.rl"
 	{ var_row = 0; }
 	break;
-#line 3225 "src/txt/readstat_sas_commands_read.c"
+#line 3229 "src/txt/readstat_sas_commands_read.c"
 		}
 	}
 
@@ -3238,10 +3242,10 @@ _again:
 	while ( __nacts-- > 0 ) {
 		switch ( *__acts++ ) {
 	case 22:
-#line 178 "src/txt/readstat_sas_commands_read.rl"
+#line 182 "src/txt/readstat_sas_commands_read.rl"
 	{ line_no++; line_start = p; }
 	break;
-#line 3245 "src/txt/readstat_sas_commands_read.c"
+#line 3249 "src/txt/readstat_sas_commands_read.c"
 		}
 	}
 	}
@@ -3249,7 +3253,7 @@ _again:
 	_out: {}
 	}
 
-#line 378 "src/txt/readstat_sas_commands_read.rl"
+#line 382 "src/txt/readstat_sas_commands_read.rl"
 
                                        
    /* suppress warnings */
@@ -2,6 +2,7 @@
 #include <strings.h>
 
 #include "../readstat.h"
+#include "../readstat_arena.h"
 #include "readstat_schema.h"
 
 #include "readstat_copy.h"
@@ -61,7 +62,7 @@ readstat_schema_t *readstat_parse_sas_commands(readstat_parser_t *parser,
     int var_row = 0, var_col = 0;
     int var_len = 0;
 
-    if ((schema = calloc(1, sizeof(readstat_schema_t))) == NULL) {
+    if ((schema = readstat_schema_init()) == NULL) {
         error = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -150,7 +151,10 @@ readstat_schema_t *readstat_parse_sas_commands(readstat_parser_t *parser,
 
         action handle_var_label {
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
-            readstat_copy(entry->variable.label, sizeof(entry->variable.label), buf, sizeof(buf));
+            if ((entry->variable.label = readstat_arena_intern(schema->arena, buf, sizeof(buf))) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 
         action handle_var_labelset {
@@ -1,12 +1,27 @@
 #include <stdlib.h>
 
 #include "../readstat.h"
+#include "../readstat_arena.h"
 #include "readstat_schema.h"
 #include "readstat_copy.h"
 
+readstat_schema_t *readstat_schema_init(void) {
+    readstat_schema_t *schema = NULL;
+    if ((schema = calloc(1, sizeof(readstat_schema_t))) == NULL)
+        return NULL;
+
+    if ((schema->arena = readstat_arena_init()) == NULL) {
+        free(schema);
+        return NULL;
+    }
+
+    return schema;
+}
+
 void readstat_schema_free(readstat_schema_t *schema) {
     if (schema) {
         free(schema->entries);
+        readstat_arena_free(schema->arena);
         free(schema);
     }
 }
@@ -26,7 +41,10 @@ readstat_schema_entry_t *readstat_schema_find_or_create_entry(readstat_schema_t
         entry = &dct->entries[dct->entry_count];
         memset(entry, 0, sizeof(readstat_schema_entry_t));
         
-        readstat_copy(entry->variable.name, sizeof(entry->variable.name), var_name, strlen(var_name));
+        if ((entry->variable.name = readstat_arena_intern(dct->arena, var_name, strlen(var_name))) == NULL)
+            return NULL;
+        entry->variable.format = "";
+        entry->variable.label = "";
         entry->decimal_separator = '.';
         entry->variable.index = dct->entry_count++;
     }
@@ -1 +1,2 @@
+readstat_schema_t *readstat_schema_init(void);
 readstat_schema_entry_t *readstat_schema_find_or_create_entry(readstat_schema_t *dct, const char *var_name);
@@ -5,13 +5,14 @@
 #include <inttypes.h>
 
 #include "../readstat.h"
+#include "../readstat_arena.h"
 #include "readstat_schema.h"
 
 #include "readstat_copy.h"
 #include "commands_util.h"
 
 
-#line 15 "src/txt/readstat_spss_commands_read.c"
+#line 16 "src/txt/readstat_spss_commands_read.c"
 static const char _spss_commands_actions[] = {
 	0, 1, 1, 1, 2, 1, 4, 1, 
 	8, 1, 12, 1, 13, 1, 15, 1, 
@@ -1662,7 +1663,7 @@ static const int spss_commands_start = 628;
 static const int spss_commands_en_main = 628;
 
 
-#line 14 "src/txt/readstat_spss_commands_read.rl"
+#line 15 "src/txt/readstat_spss_commands_read.rl"
 
 
 readstat_schema_t *readstat_parse_spss_commands(readstat_parser_t *parser,
@@ -1719,7 +1720,7 @@ readstat_schema_t *readstat_parse_spss_commands(readstat_parser_t *parser,
 
     int labelset_count = 0;
 
-    if ((schema = calloc(1, sizeof(readstat_schema_t))) == NULL) {
+    if ((schema = readstat_schema_init()) == NULL) {
         error = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -1727,12 +1728,12 @@ readstat_schema_t *readstat_parse_spss_commands(readstat_parser_t *parser,
     schema->rows_per_observation = 1;
     
     
-#line 1731 "src/txt/readstat_spss_commands_read.c"
+#line 1732 "src/txt/readstat_spss_commands_read.c"
 	{
 	cs = spss_commands_start;
 	}
 
-#line 1736 "src/txt/readstat_spss_commands_read.c"
+#line 1737 "src/txt/readstat_spss_commands_read.c"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -1806,56 +1807,56 @@ _match:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 78 "src/txt/readstat_spss_commands_read.rl"
+#line 79 "src/txt/readstat_spss_commands_read.rl"
 	{
             integer = 0;
         }
 	break;
 	case 1:
-#line 82 "src/txt/readstat_spss_commands_read.rl"
+#line 83 "src/txt/readstat_spss_commands_read.rl"
 	{
             integer = 10 * integer + ((*p) - '0');
         }
 	break;
 	case 2:
-#line 86 "src/txt/readstat_spss_commands_read.rl"
+#line 87 "src/txt/readstat_spss_commands_read.rl"
 	{
             var_col = integer - 1;
             var_len = 1;
         }
 	break;
 	case 3:
-#line 91 "src/txt/readstat_spss_commands_read.rl"
+#line 92 "src/txt/readstat_spss_commands_read.rl"
 	{
             var_len = integer - var_col;
         }
 	break;
 	case 4:
-#line 95 "src/txt/readstat_spss_commands_read.rl"
+#line 96 "src/txt/readstat_spss_commands_read.rl"
 	{
             readstat_copy_quoted(buf, sizeof(buf), (char *)str_start, str_len);
         }
 	break;
 	case 5:
-#line 99 "src/txt/readstat_spss_commands_read.rl"
+#line 100 "src/txt/readstat_spss_commands_read.rl"
 	{
             readstat_copy_quoted(string_value, sizeof(string_value), (char *)str_start, str_len);
         }
 	break;
 	case 6:
-#line 107 "src/txt/readstat_spss_commands_read.rl"
+#line 108 "src/txt/readstat_spss_commands_read.rl"
 	{
             readstat_copy(varname, sizeof(varname), (char *)str_start, str_len);
         }
 	break;
 	case 7:
-#line 111 "src/txt/readstat_spss_commands_read.rl"
+#line 112 "src/txt/readstat_spss_commands_read.rl"
 	{
             readstat_copy(argname, sizeof(argname), (char *)str_start, str_len);
         }
 	break;
 	case 8:
-#line 115 "src/txt/readstat_spss_commands_read.rl"
+#line 116 "src/txt/readstat_spss_commands_read.rl"
 	{
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
             entry->variable.type = var_type;
@@ -1865,20 +1866,23 @@ _match:
         }
 	break;
 	case 9:
-#line 123 "src/txt/readstat_spss_commands_read.rl"
+#line 124 "src/txt/readstat_spss_commands_read.rl"
 	{
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
-            readstat_copy(entry->variable.label, sizeof(entry->variable.label), buf, sizeof(buf));
+            if ((entry->variable.label = readstat_arena_intern(schema->arena, buf, sizeof(buf))) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 	break;
 	case 10:
-#line 128 "src/txt/readstat_spss_commands_read.rl"
+#line 132 "src/txt/readstat_spss_commands_read.rl"
 	{
             var_count = 0;
         }
 	break;
 	case 11:
-#line 132 "src/txt/readstat_spss_commands_read.rl"
+#line 136 "src/txt/readstat_spss_commands_read.rl"
 	{
             if (var_count < sizeof(var_list)/sizeof(var_list[0])) {
                 memcpy(var_list[var_count++], varname, sizeof(varname));
@@ -1886,7 +1890,7 @@ _match:
         }
 	break;
 	case 12:
-#line 138 "src/txt/readstat_spss_commands_read.rl"
+#line 142 "src/txt/readstat_spss_commands_read.rl"
 	{
             if (strcasecmp(argname, "FIRSTCASE") == 0) {
                 schema->first_line = integer;
@@ -1897,7 +1901,7 @@ _match:
         }
 	break;
 	case 13:
-#line 147 "src/txt/readstat_spss_commands_read.rl"
+#line 151 "src/txt/readstat_spss_commands_read.rl"
 	{
             char labelset_name[256];
             snprintf(labelset_name, sizeof(labelset_name), "labels%d", labelset_count++);
@@ -1908,7 +1912,7 @@ _match:
         }
 	break;
 	case 14:
-#line 156 "src/txt/readstat_spss_commands_read.rl"
+#line 160 "src/txt/readstat_spss_commands_read.rl"
 	{
             char labelset_name[256];
             snprintf(labelset_name, sizeof(labelset_name), "labels%d", labelset_count);
@@ -1919,90 +1923,90 @@ _match:
         }
 	break;
 	case 15:
-#line 165 "src/txt/readstat_spss_commands_read.rl"
+#line 169 "src/txt/readstat_spss_commands_read.rl"
 	{ str_start = p; }
 	break;
 	case 16:
-#line 165 "src/txt/readstat_spss_commands_read.rl"
+#line 169 "src/txt/readstat_spss_commands_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 17:
-#line 167 "src/txt/readstat_spss_commands_read.rl"
+#line 171 "src/txt/readstat_spss_commands_read.rl"
 	{ str_start = p; }
 	break;
 	case 18:
-#line 167 "src/txt/readstat_spss_commands_read.rl"
+#line 171 "src/txt/readstat_spss_commands_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 19:
-#line 171 "src/txt/readstat_spss_commands_read.rl"
+#line 175 "src/txt/readstat_spss_commands_read.rl"
 	{ line_no++; line_start = p; }
 	break;
 	case 20:
-#line 173 "src/txt/readstat_spss_commands_read.rl"
+#line 177 "src/txt/readstat_spss_commands_read.rl"
 	{ str_start = p; }
 	break;
 	case 21:
-#line 173 "src/txt/readstat_spss_commands_read.rl"
+#line 177 "src/txt/readstat_spss_commands_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 22:
-#line 191 "src/txt/readstat_spss_commands_read.rl"
+#line 195 "src/txt/readstat_spss_commands_read.rl"
 	{ var_type = READSTAT_TYPE_STRING; }
 	break;
 	case 23:
-#line 194 "src/txt/readstat_spss_commands_read.rl"
+#line 198 "src/txt/readstat_spss_commands_read.rl"
 	{ var_type = READSTAT_TYPE_STRING; }
 	break;
 	case 24:
-#line 195 "src/txt/readstat_spss_commands_read.rl"
+#line 199 "src/txt/readstat_spss_commands_read.rl"
 	{ var_type = READSTAT_TYPE_DOUBLE; }
 	break;
 	case 25:
-#line 196 "src/txt/readstat_spss_commands_read.rl"
+#line 200 "src/txt/readstat_spss_commands_read.rl"
 	{ var_type = READSTAT_TYPE_DOUBLE; }
 	break;
 	case 26:
-#line 197 "src/txt/readstat_spss_commands_read.rl"
+#line 201 "src/txt/readstat_spss_commands_read.rl"
 	{ var_type = READSTAT_TYPE_STRING; }
 	break;
 	case 27:
-#line 218 "src/txt/readstat_spss_commands_read.rl"
+#line 222 "src/txt/readstat_spss_commands_read.rl"
 	{ var_row = integer - 1; }
 	break;
 	case 28:
-#line 219 "src/txt/readstat_spss_commands_read.rl"
+#line 223 "src/txt/readstat_spss_commands_read.rl"
 	{ var_type = READSTAT_TYPE_DOUBLE; }
 	break;
 	case 29:
-#line 220 "src/txt/readstat_spss_commands_read.rl"
+#line 224 "src/txt/readstat_spss_commands_read.rl"
 	{ var_type = READSTAT_TYPE_DOUBLE; }
 	break;
 	case 30:
-#line 253 "src/txt/readstat_spss_commands_read.rl"
+#line 257 "src/txt/readstat_spss_commands_read.rl"
 	{ label_type = -1; }
 	break;
 	case 31:
-#line 259 "src/txt/readstat_spss_commands_read.rl"
+#line 263 "src/txt/readstat_spss_commands_read.rl"
 	{ label_type = LABEL_TYPE_DOUBLE; double_value = -integer; }
 	break;
 	case 32:
-#line 260 "src/txt/readstat_spss_commands_read.rl"
+#line 264 "src/txt/readstat_spss_commands_read.rl"
 	{ label_type = LABEL_TYPE_DOUBLE; double_value = integer; }
 	break;
 	case 33:
-#line 261 "src/txt/readstat_spss_commands_read.rl"
+#line 265 "src/txt/readstat_spss_commands_read.rl"
 	{ first_integer = integer; }
 	break;
 	case 34:
-#line 261 "src/txt/readstat_spss_commands_read.rl"
+#line 265 "src/txt/readstat_spss_commands_read.rl"
 	{ label_type = LABEL_TYPE_RANGE; }
 	break;
 	case 35:
-#line 262 "src/txt/readstat_spss_commands_read.rl"
+#line 266 "src/txt/readstat_spss_commands_read.rl"
 	{ label_type = LABEL_TYPE_STRING; }
 	break;
-#line 2006 "src/txt/readstat_spss_commands_read.c"
+#line 2010 "src/txt/readstat_spss_commands_read.c"
 		}
 	}
 
@@ -2019,7 +2023,7 @@ _again:
 	while ( __nacts-- > 0 ) {
 		switch ( *__acts++ ) {
 	case 8:
-#line 115 "src/txt/readstat_spss_commands_read.rl"
+#line 116 "src/txt/readstat_spss_commands_read.rl"
 	{
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
             entry->variable.type = var_type;
@@ -2029,10 +2033,10 @@ _again:
         }
 	break;
 	case 19:
-#line 171 "src/txt/readstat_spss_commands_read.rl"
+#line 175 "src/txt/readstat_spss_commands_read.rl"
 	{ line_no++; line_start = p; }
 	break;
-#line 2036 "src/txt/readstat_spss_commands_read.c"
+#line 2040 "src/txt/readstat_spss_commands_read.c"
 		}
 	}
 	}
@@ -2040,7 +2044,7 @@ _again:
 	_out: {}
 	}
 
-#line 312 "src/txt/readstat_spss_commands_read.rl"
+#line 316 "src/txt/readstat_spss_commands_read.rl"
 
                                        
    /* suppress warnings */
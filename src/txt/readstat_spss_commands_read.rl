@@ -3,6 +3,7 @@
 #include <inttypes.h>
 
 #include "../readstat.h"
+#include "../readstat_arena.h"
 #include "readstat_schema.h"
 
 #include "readstat_copy.h"
@@ -67,7 +68,7 @@ readstat_schema_t *readstat_parse_spss_commands(readstat_parser_t *parser,
 
     int labelset_count = 0;
 
-    if ((schema = calloc(1, sizeof(readstat_schema_t))) == NULL) {
+    if ((schema = readstat_schema_init()) == NULL) {
         error = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -122,7 +123,10 @@ readstat_schema_t *readstat_parse_spss_commands(readstat_parser_t *parser,
 
         action handle_var_label {
             readstat_schema_entry_t *entry = readstat_schema_find_or_create_entry(schema, varname);
-            readstat_copy(entry->variable.label, sizeof(entry->variable.label), buf, sizeof(buf));
+            if ((entry->variable.label = readstat_arena_intern(schema->arena, buf, sizeof(buf))) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 
         action reset_variable_list {
@@ -3,12 +3,13 @@
 #include <stdlib.h>
 
 #include "../readstat.h"
+#include "../readstat_arena.h"
 #include "readstat_schema.h"
 
 #include "readstat_copy.h"
 
 
-#line 12 "src/txt/readstat_stata_dictionary_read.c"
+#line 13 "src/txt/readstat_stata_dictionary_read.c"
 static const char _stata_dictionary_actions[] = {
 	0, 1, 1, 1, 4, 1, 6, 1, 
 	7, 1, 8, 1, 9, 1, 11, 1, 
@@ -451,7 +452,7 @@ static const int stata_dictionary_start = 1;
 static const int stata_dictionary_en_main = 1;
 
 
-#line 11 "src/txt/readstat_stata_dictionary_read.rl"
+#line 12 "src/txt/readstat_stata_dictionary_read.rl"
 
 
 readstat_schema_t *readstat_parse_stata_dictionary(readstat_parser_t *parser,
@@ -496,7 +497,7 @@ readstat_schema_t *readstat_parse_stata_dictionary(readstat_parser_t *parser,
 
     readstat_schema_entry_t current_entry;
     
-    if ((schema = calloc(1, sizeof(readstat_schema_t))) == NULL) {
+    if ((schema = readstat_schema_init()) == NULL) {
         error = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -504,12 +505,12 @@ readstat_schema_t *readstat_parse_stata_dictionary(readstat_parser_t *parser,
     schema->rows_per_observation = 1;
     
     
-#line 508 "src/txt/readstat_stata_dictionary_read.c"
+#line 509 "src/txt/readstat_stata_dictionary_read.c"
 	{
 	cs = stata_dictionary_start;
 	}
 
-#line 513 "src/txt/readstat_stata_dictionary_read.c"
+#line 514 "src/txt/readstat_stata_dictionary_read.c"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -583,28 +584,31 @@ _match:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 63 "src/txt/readstat_stata_dictionary_read.rl"
+#line 64 "src/txt/readstat_stata_dictionary_read.rl"
 	{
             integer = 0;
         }
 	break;
 	case 1:
-#line 67 "src/txt/readstat_stata_dictionary_read.rl"
+#line 68 "src/txt/readstat_stata_dictionary_read.rl"
 	{
             integer = 10 * integer + ((*p) - '0');
         }
 	break;
 	case 2:
-#line 71 "src/txt/readstat_stata_dictionary_read.rl"
+#line 72 "src/txt/readstat_stata_dictionary_read.rl"
 	{
             memset(&current_entry, 0, sizeof(readstat_schema_entry_t));
+            current_entry.variable.name = "";
+            current_entry.variable.format = "";
+            current_entry.variable.label = "";
             current_entry.decimal_separator = '.';
             current_entry.variable.type = READSTAT_TYPE_DOUBLE;
             current_entry.variable.index = total_entry_count;
         }
 	break;
 	case 3:
-#line 78 "src/txt/readstat_stata_dictionary_read.rl"
+#line 82 "src/txt/readstat_stata_dictionary_read.rl"
 	{
             current_entry.row = current_row;
             current_entry.col = current_col;
@@ -629,115 +633,121 @@ _match:
         }
 	break;
 	case 4:
-#line 101 "src/txt/readstat_stata_dictionary_read.rl"
+#line 105 "src/txt/readstat_stata_dictionary_read.rl"
 	{
             readstat_copy(schema->filename, sizeof(schema->filename), (char *)str_start, str_len);
         }
 	break;
 	case 5:
-#line 105 "src/txt/readstat_stata_dictionary_read.rl"
+#line 109 "src/txt/readstat_stata_dictionary_read.rl"
 	{
-            readstat_copy(current_entry.variable.name, sizeof(current_entry.variable.name),
-                 (char *)str_start, str_len);
+            if ((current_entry.variable.name = readstat_arena_intern(schema->arena,
+                            (char *)str_start, str_len)) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 	break;
 	case 6:
-#line 110 "src/txt/readstat_stata_dictionary_read.rl"
+#line 117 "src/txt/readstat_stata_dictionary_read.rl"
 	{
-            readstat_copy(current_entry.variable.label, sizeof(current_entry.variable.label),
-                 (char *)str_start, str_len);
+            if ((current_entry.variable.label = readstat_arena_intern(schema->arena,
+                            (char *)str_start, str_len)) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 	break;
 	case 7:
-#line 115 "src/txt/readstat_stata_dictionary_read.rl"
+#line 125 "src/txt/readstat_stata_dictionary_read.rl"
 	{ str_start = p; }
 	break;
 	case 8:
-#line 115 "src/txt/readstat_stata_dictionary_read.rl"
+#line 125 "src/txt/readstat_stata_dictionary_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 9:
-#line 117 "src/txt/readstat_stata_dictionary_read.rl"
+#line 127 "src/txt/readstat_stata_dictionary_read.rl"
 	{ str_start = p; }
 	break;
 	case 10:
-#line 117 "src/txt/readstat_stata_dictionary_read.rl"
+#line 127 "src/txt/readstat_stata_dictionary_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 11:
-#line 119 "src/txt/readstat_stata_dictionary_read.rl"
+#line 129 "src/txt/readstat_stata_dictionary_read.rl"
 	{ str_start = p; }
 	break;
 	case 12:
-#line 119 "src/txt/readstat_stata_dictionary_read.rl"
+#line 129 "src/txt/readstat_stata_dictionary_read.rl"
 	{ str_len = p - str_start; }
 	break;
 	case 13:
-#line 121 "src/txt/readstat_stata_dictionary_read.rl"
+#line 131 "src/txt/readstat_stata_dictionary_read.rl"
 	{ line_no++; line_start = p; }
 	break;
 	case 14:
-#line 131 "src/txt/readstat_stata_dictionary_read.rl"
+#line 141 "src/txt/readstat_stata_dictionary_read.rl"
 	{ schema->rows_per_observation = integer; }
 	break;
 	case 15:
-#line 133 "src/txt/readstat_stata_dictionary_read.rl"
+#line 143 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_row = integer - 1; }
 	break;
 	case 16:
-#line 135 "src/txt/readstat_stata_dictionary_read.rl"
+#line 145 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_col = integer - 1; }
 	break;
 	case 17:
-#line 137 "src/txt/readstat_stata_dictionary_read.rl"
+#line 147 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_row++; }
 	break;
 	case 18:
-#line 137 "src/txt/readstat_stata_dictionary_read.rl"
+#line 147 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_row += (integer - 1); }
 	break;
 	case 19:
-#line 141 "src/txt/readstat_stata_dictionary_read.rl"
+#line 151 "src/txt/readstat_stata_dictionary_read.rl"
 	{ schema->cols_per_observation = integer; }
 	break;
 	case 20:
-#line 143 "src/txt/readstat_stata_dictionary_read.rl"
+#line 153 "src/txt/readstat_stata_dictionary_read.rl"
 	{ schema->first_line = integer - 1; }
 	break;
 	case 21:
-#line 147 "src/txt/readstat_stata_dictionary_read.rl"
+#line 157 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.variable.type = READSTAT_TYPE_INT8; }
 	break;
 	case 22:
-#line 148 "src/txt/readstat_stata_dictionary_read.rl"
+#line 158 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.variable.type = READSTAT_TYPE_INT16; }
 	break;
 	case 23:
-#line 149 "src/txt/readstat_stata_dictionary_read.rl"
+#line 159 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.variable.type = READSTAT_TYPE_INT32; }
 	break;
 	case 24:
-#line 150 "src/txt/readstat_stata_dictionary_read.rl"
+#line 160 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.variable.type = READSTAT_TYPE_FLOAT; }
 	break;
 	case 25:
-#line 151 "src/txt/readstat_stata_dictionary_read.rl"
+#line 161 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.variable.type = READSTAT_TYPE_DOUBLE; }
 	break;
 	case 26:
-#line 152 "src/txt/readstat_stata_dictionary_read.rl"
+#line 162 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.variable.type = READSTAT_TYPE_STRING;
                                current_entry.variable.storage_width = integer; }
 	break;
 	case 27:
-#line 159 "src/txt/readstat_stata_dictionary_read.rl"
+#line 169 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.len = integer; }
 	break;
 	case 28:
-#line 160 "src/txt/readstat_stata_dictionary_read.rl"
+#line 170 "src/txt/readstat_stata_dictionary_read.rl"
 	{ current_entry.decimal_separator = ','; }
 	break;
-#line 741 "src/txt/readstat_stata_dictionary_read.c"
+#line 751 "src/txt/readstat_stata_dictionary_read.c"
 		}
 	}
 
@@ -750,7 +760,7 @@ _again:
 	_out: {}
 	}
 
-#line 174 "src/txt/readstat_stata_dictionary_read.rl"
+#line 184 "src/txt/readstat_stata_dictionary_read.rl"
 
 
     /* suppress warnings */
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 
 #include "../readstat.h"
+#include "../readstat_arena.h"
 #include "readstat_schema.h"
 
 #include "readstat_copy.h"
@@ -52,7 +53,7 @@ readstat_schema_t *readstat_parse_stata_dictionary(readstat_parser_t *parser,
 
     readstat_schema_entry_t current_entry;
     
-    if ((schema = calloc(1, sizeof(readstat_schema_t))) == NULL) {
+    if ((schema = readstat_schema_init()) == NULL) {
         error = READSTAT_ERROR_MALLOC;
         goto cleanup;
     }
@@ -70,6 +71,9 @@ readstat_schema_t *readstat_parse_stata_dictionary(readstat_parser_t *parser,
 
         action start_entry {
             memset(&current_entry, 0, sizeof(readstat_schema_entry_t));
+            current_entry.variable.name = "";
+            current_entry.variable.format = "";
+            current_entry.variable.label = "";
             current_entry.decimal_separator = '.';
             current_entry.variable.type = READSTAT_TYPE_DOUBLE;
             current_entry.variable.index = total_entry_count;
@@ -103,13 +107,19 @@ readstat_schema_t *readstat_parse_stata_dictionary(readstat_parser_t *parser,
         }
 
         action copy_varname {
-            readstat_copy(current_entry.variable.name, sizeof(current_entry.variable.name),
-                 (char *)str_start, str_len);
+            if ((current_entry.variable.name = readstat_arena_intern(schema->arena,
+                            (char *)str_start, str_len)) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 
         action copy_varlabel {
-            readstat_copy(current_entry.variable.label, sizeof(current_entry.variable.label),
-                 (char *)str_start, str_len);
+            if ((current_entry.variable.label = readstat_arena_intern(schema->arena,
+                            (char *)str_start, str_len)) == NULL) {
+                error = READSTAT_ERROR_MALLOC;
+                goto cleanup;
+            }
         }
 
         quoted_string = "\"" ( [^"]* ) >{ str_start = fpc; } %{ str_len = fpc - str_start; } "\"";
@@ -8,6 +8,9 @@
 #include "../readstat.h"
 #include "../readstat_iconv.h"
 #include "../readstat_convert.h"
+#include "../readstat_malloc.h"
+#include "../readstat_label_index.h"
+#include "../readstat_stats.h"
 #include "readstat_schema.h"
 
 typedef struct txt_ctx_s {
@@ -22,7 +25,17 @@ static readstat_error_t handle_value(readstat_parser_t *parser, iconv_t converte
     char converted_value[4*len+1];
     readstat_variable_t *variable = &entry->variable;
     readstat_value_t value = { .type = variable->type };
-    if (readstat_type_class(variable->type) == READSTAT_TYPE_CLASS_STRING) {
+    if (readstat_type_class(variable->type) == READSTAT_TYPE_CLASS_STRING && parser->handlers.string_view) {
+        const char *string = NULL;
+        size_t string_len = 0;
+        error = readstat_convert_view(converted_value, sizeof(converted_value), bytes, len, converter,
+                &string, &string_len);
+        if (error != READSTAT_OK)
+            goto cleanup;
+        if (parser->handlers.string_view(obs_index, variable, string, string_len, ctx) == READSTAT_HANDLER_ABORT)
+            error = READSTAT_ERROR_USER_ABORT;
+        goto cleanup;
+    } else if (readstat_type_class(variable->type) == READSTAT_TYPE_CLASS_STRING) {
         error = readstat_convert(converted_value, sizeof(converted_value), bytes, len, converter);
         if (error != READSTAT_OK)
             goto cleanup;
@@ -159,7 +172,7 @@ cleanup:
     return retval;
 }
 
-readstat_error_t readstat_parse_txt(readstat_parser_t *parser, const char *filename, 
+static readstat_error_t txt_parse(readstat_parser_t *parser, const char *filename, 
         readstat_schema_t *schema, void *user_ctx) {
     readstat_error_t retval = READSTAT_OK;
     readstat_io_t *io = parser->io;
@@ -230,6 +243,8 @@ readstat_error_t readstat_parse_txt(readstat_parser_t *parser, const char *filen
     if (retval != READSTAT_OK)
         goto cleanup;
 
+    parser->stats.rows_decoded += ctx.rows;
+
     if (parser->handlers.metadata) {
         readstat_metadata_t metadata = {
             .row_count = ctx.rows,
@@ -253,3 +268,24 @@ cleanup:
     return retval;
 }
 
+readstat_error_t readstat_parse_txt(readstat_parser_t *parser, const char *filename, 
+        readstat_schema_t *schema, void *user_ctx) {
+    readstat_stats_session_t session;
+    readstat_malloc_scope_t scope;
+    readstat_label_index_scope_t label_scope;
+    readstat_error_t retval = READSTAT_OK;
+
+    readstat_stats_begin(&session, parser);
+    readstat_malloc_scope_begin(&scope, parser->max_allocation, parser->memory_limit);
+    /* Keeps the labels read with the schema */
+    if ((retval = readstat_label_index_begin_parse(&label_scope, parser,
+                    READSTAT_LABEL_INDEX_PARSE_DATA, user_ctx)) == READSTAT_OK)
+        retval = txt_parse(parser, filename, schema, label_scope.parse_ctx);
+    retval = readstat_label_index_end_parse(&label_scope, retval);
+    retval = readstat_malloc_scope_end(&scope, retval);
+    parser->stats.peak_memory_used = scope.peak_memory_used;
+    parser->stats.peak_buffer_size = scope.peak_allocation;
+    readstat_stats_end(&session, parser);
+
+    return retval;
+}